@@ -1344,3 +1344,10 @@ draw_set_constant_buffer_stride(struct draw_context *draw, unsigned num_bytes)
 {
    draw->constant_buffer_stride = num_bytes;
 }
+
+
+void
+draw_set_vs_threads(struct draw_context *draw, unsigned num_threads)
+{
+   draw->num_vs_threads = MIN2(num_threads, DRAW_MAX_VS_THREADS);
+}
@@ -126,6 +126,9 @@ void draw_set_zs_format(struct draw_context *draw, enum pipe_format format);
 /* for TGSI constants are 4 * sizeof(float), but for NIR they need to be sizeof(float); */
 void draw_set_constant_buffer_stride(struct draw_context *draw, unsigned num_bytes);
 
+/* llvm path: split fetch and vertex shading of large draws over this many threads */
+void draw_set_vs_threads(struct draw_context *draw, unsigned num_threads);
+
 boolean
 draw_install_aaline_stage(struct draw_context *draw, struct pipe_context *pipe);
 
@@ -830,27 +830,31 @@ draw_llvm_destroy(struct draw_llvm *llvm)
 
 static void
 draw_get_ir_cache_key(struct nir_shader *nir,
+                      unsigned char ir_sha1[20], bool *ir_sha1_valid,
                       const void *key, size_t key_size,
                       uint32_t val_32bit,
                       unsigned char ir_sha1_cache_key[20])
 {
-   struct blob blob = { 0 };
-   unsigned ir_size;
-   void *ir_binary;
-
-   blob_init(&blob);
-   nir_serialize(&blob, nir, true);
-   ir_binary = blob.data;
-   ir_size = blob.size;
+   /* Serializing the NIR is costly, so only do it for the first variant.
+    * This must happen before the first variant is built, as building it
+    * modifies the NIR.
+    */
+   if (!*ir_sha1_valid) {
+      struct blob blob = { 0 };
+
+      blob_init(&blob);
+      nir_serialize(&blob, nir, true);
+      _mesa_sha1_compute(blob.data, blob.size, ir_sha1);
+      blob_finish(&blob);
+      *ir_sha1_valid = true;
+   }
 
    struct mesa_sha1 ctx;
    _mesa_sha1_init(&ctx);
    _mesa_sha1_update(&ctx, key, key_size);
-   _mesa_sha1_update(&ctx, ir_binary, ir_size);
+   _mesa_sha1_update(&ctx, ir_sha1, 20);
    _mesa_sha1_update(&ctx, &val_32bit, 4);
    _mesa_sha1_final(&ctx, ir_sha1_cache_key);
-
-   blob_finish(&blob);
 }
 
 
@@ -884,6 +888,7 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
 
    if (shader->base.state.ir.nir && llvm->draw->disk_cache_cookie) {
       draw_get_ir_cache_key(shader->base.state.ir.nir,
+                            shader->ir_sha1, &shader->ir_sha1_valid,
                             key,
                             shader->variant_key_size,
                             num_inputs,
@@ -917,10 +922,11 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
    variant->jit_func = (draw_jit_vert_func)
          gallivm_jit_function(variant->gallivm, variant->function);
 
-   if (needs_caching)
+   if (needs_caching) {
       llvm->draw->disk_cache_insert_shader(llvm->draw->disk_cache_cookie,
                                            &cached,
                                            ir_sha1_cache_key);
+   }
    gallivm_free_ir(variant->gallivm);
 
    variant->list_item_global.base = variant;
@@ -2946,6 +2952,7 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
 
    if (shader->base.state.ir.nir && llvm->draw->disk_cache_cookie) {
       draw_get_ir_cache_key(shader->base.state.ir.nir,
+                            shader->ir_sha1, &shader->ir_sha1_valid,
                             key,
                             shader->variant_key_size,
                             num_outputs,
@@ -2971,10 +2978,11 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
    variant->jit_func = (draw_gs_jit_func)
          gallivm_jit_function(variant->gallivm, variant->function);
 
-   if (needs_caching)
+   if (needs_caching) {
       llvm->draw->disk_cache_insert_shader(llvm->draw->disk_cache_cookie,
                                            &cached,
                                            ir_sha1_cache_key);
+   }
    gallivm_free_ir(variant->gallivm);
 
    variant->list_item_global.base = variant;
@@ -3608,6 +3616,7 @@ draw_tcs_llvm_create_variant(struct draw_llvm *llvm,
 
    if (shader->base.state.ir.nir && llvm->draw->disk_cache_cookie) {
       draw_get_ir_cache_key(shader->base.state.ir.nir,
+                            shader->ir_sha1, &shader->ir_sha1_valid,
                             key,
                             shader->variant_key_size,
                             num_outputs,
@@ -3636,10 +3645,11 @@ draw_tcs_llvm_create_variant(struct draw_llvm *llvm,
    variant->jit_func = (draw_tcs_jit_func)
       gallivm_jit_function(variant->gallivm, variant->function);
 
-   if (needs_caching)
+   if (needs_caching) {
       llvm->draw->disk_cache_insert_shader(llvm->draw->disk_cache_cookie,
                                            &cached,
                                            ir_sha1_cache_key);
+   }
    gallivm_free_ir(variant->gallivm);
 
    variant->list_item_global.base = variant;
@@ -4140,6 +4150,7 @@ draw_tes_llvm_create_variant(struct draw_llvm *llvm,
    memcpy(&variant->key, key, shader->variant_key_size);
    if (shader->base.state.ir.nir && llvm->draw->disk_cache_cookie) {
       draw_get_ir_cache_key(shader->base.state.ir.nir,
+                            shader->ir_sha1, &shader->ir_sha1_valid,
                             key,
                             shader->variant_key_size,
                             num_outputs,
@@ -4170,10 +4181,11 @@ draw_tes_llvm_create_variant(struct draw_llvm *llvm,
    variant->jit_func = (draw_tes_jit_func)
       gallivm_jit_function(variant->gallivm, variant->function);
 
-   if (needs_caching)
+   if (needs_caching) {
       llvm->draw->disk_cache_insert_shader(llvm->draw->disk_cache_cookie,
                                            &cached,
                                            ir_sha1_cache_key);
+   }
    gallivm_free_ir(variant->gallivm);
 
    variant->list_item_global.base = variant;
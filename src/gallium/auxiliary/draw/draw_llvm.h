@@ -729,6 +729,10 @@ struct llvm_vertex_shader {
    struct draw_llvm_variant_list_item variants;
    unsigned variants_created;
    unsigned variants_cached;
+
+   /* sha1 of the serialized NIR, used for the disk cache keys */
+   unsigned char ir_sha1[20];
+   bool ir_sha1_valid;
 };
 
 struct llvm_geometry_shader {
@@ -738,6 +742,10 @@ struct llvm_geometry_shader {
    struct draw_gs_llvm_variant_list_item variants;
    unsigned variants_created;
    unsigned variants_cached;
+
+   /* sha1 of the serialized NIR, used for the disk cache keys */
+   unsigned char ir_sha1[20];
+   bool ir_sha1_valid;
 };
 
 struct llvm_tess_ctrl_shader {
@@ -747,6 +755,10 @@ struct llvm_tess_ctrl_shader {
    struct draw_tcs_llvm_variant_list_item variants;
    unsigned variants_created;
    unsigned variants_cached;
+
+   /* sha1 of the serialized NIR, used for the disk cache keys */
+   unsigned char ir_sha1[20];
+   bool ir_sha1_valid;
 };
 
 struct llvm_tess_eval_shader {
@@ -756,6 +768,10 @@ struct llvm_tess_eval_shader {
    struct draw_tes_llvm_variant_list_item variants;
    unsigned variants_created;
    unsigned variants_cached;
+
+   /* sha1 of the serialized NIR, used for the disk cache keys */
+   unsigned char ir_sha1[20];
+   bool ir_sha1_valid;
 };
 
 struct draw_llvm {
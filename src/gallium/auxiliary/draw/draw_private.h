@@ -132,6 +132,9 @@ struct vertex_header {
 /* maximum number of shader variants we can cache */
 #define DRAW_MAX_SHADER_VARIANTS 512
 
+/* maximum number of threads vertex shading may be split over */
+#define DRAW_MAX_VS_THREADS 16
+
 /**
  * Private context for the drawing module.
  */
@@ -395,6 +398,7 @@ struct draw_context
    unsigned start_instance;
    unsigned start_index;
    unsigned constant_buffer_stride;
+   unsigned num_vs_threads;
    struct draw_llvm *llvm;
 
    /** Texture sampler and sampler view state.
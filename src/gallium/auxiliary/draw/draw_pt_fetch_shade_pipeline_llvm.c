@@ -28,6 +28,7 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
+#include "util/u_queue.h"
 #include "draw/draw_context.h"
 #include "draw/draw_gs.h"
 #include "draw/draw_tess.h"
@@ -41,6 +42,24 @@
 #include "gallivm/lp_bld_debug.h"
 
 
+/* Don't wake up worker threads for less than this many vertices each. */
+#define LLVM_VS_MIN_SLICE 256
+
+/**
+ * A contiguous range of the fetched vertices, shaded by a worker thread.
+ */
+struct llvm_vs_job {
+   struct llvm_middle_end *fpme;
+   struct vertex_header *verts;
+   const unsigned *elts;
+   unsigned start;
+   unsigned count;
+   unsigned vertex_id_offset;
+   boolean clipped;
+   struct util_queue_fence fence;
+};
+
+
 struct llvm_middle_end {
    struct draw_pt_middle_end base;
    struct draw_context *draw;
@@ -58,6 +77,10 @@ struct llvm_middle_end {
 
    struct draw_llvm *llvm;
    struct draw_llvm_variant *current_variant;
+
+   /* created on first use, see llvm_middle_end_shade() */
+   struct util_queue vs_queue;
+   struct llvm_vs_job vs_jobs[DRAW_MAX_VS_THREADS];
 };
 
 
@@ -542,6 +565,114 @@ emit(struct pt_emit *emit,
 }
 
 
+static boolean
+llvm_run_vs(struct llvm_middle_end *fpme,
+            struct vertex_header *verts,
+            unsigned count,
+            unsigned start,
+            const unsigned *elts,
+            unsigned vertex_id_offset)
+{
+   struct draw_context *draw = fpme->draw;
+
+   return fpme->current_variant->jit_func(&fpme->llvm->jit_context,
+                                          verts,
+                                          draw->pt.user.vbuffer,
+                                          count,
+                                          start,
+                                          fpme->vertex_size,
+                                          draw->pt.vertex_buffer,
+                                          draw->instance_id,
+                                          vertex_id_offset,
+                                          draw->start_instance,
+                                          elts,
+                                          draw->pt.user.drawid,
+                                          draw->pt.user.viewid);
+}
+
+
+static void
+llvm_vs_job_execute(void *data, void *gdata, int thread_index)
+{
+   struct llvm_vs_job *job = (struct llvm_vs_job *)data;
+   unsigned fpstate = util_fpstate_get();
+
+   /* Same as draw_vbo() does for the calling thread. */
+   util_fpstate_set_denorms_to_zero(fpstate);
+
+   job->clipped = llvm_run_vs(job->fpme, job->verts, job->count, job->start,
+                              job->elts, job->vertex_id_offset);
+
+   util_fpstate_set(fpstate);
+}
+
+
+/**
+ * Run the fetch + vertex shader function over the vertices of a chunk.
+ *
+ * Every vertex is shaded independently and written to its own slot in
+ * verts, so large chunks are cut into contiguous slices which are shaded
+ * concurrently.  Everything after this (tessellation, geometry shaders,
+ * stream output and the pipeline/emit stages) still sees the vertices and
+ * primitives in their original order.
+ */
+static boolean
+llvm_middle_end_shade(struct llvm_middle_end *fpme,
+                      struct vertex_header *verts,
+                      unsigned count,
+                      unsigned start,
+                      const unsigned *elts,
+                      unsigned vertex_id_offset)
+{
+   struct draw_context *draw = fpme->draw;
+   const unsigned num_slices = MIN2(draw->num_vs_threads,
+                                    count / LLVM_VS_MIN_SLICE);
+
+   if (num_slices <= 1)
+      return llvm_run_vs(fpme, verts, count, start, elts, vertex_id_offset);
+
+   if (!util_queue_is_initialized(&fpme->vs_queue) &&
+       !util_queue_init(&fpme->vs_queue, "draw_vs", DRAW_MAX_VS_THREADS,
+                        draw->num_vs_threads - 1, 0, NULL)) {
+      draw->num_vs_threads = 0;
+      return llvm_run_vs(fpme, verts, count, start, elts, vertex_id_offset);
+   }
+
+   /*
+    * The shader writes whole vectors of vertices, so slices must start on
+    * a vector boundary to not clobber their neighbours.
+    */
+   const unsigned slice = align(DIV_ROUND_UP(count, num_slices),
+                                lp_native_vector_width / 32);
+   unsigned num_jobs = 0;
+
+   for (unsigned first = slice; first < count; first += slice) {
+      struct llvm_vs_job *job = &fpme->vs_jobs[num_jobs++];
+
+      job->fpme = fpme;
+      job->verts = (struct vertex_header *)
+         ((char *)verts + first * fpme->vertex_size);
+      job->count = MIN2(slice, count - first);
+      job->start = elts ? start : start + first;
+      job->elts = elts ? elts + first : NULL;
+      job->vertex_id_offset = vertex_id_offset;
+      util_queue_add_job(&fpme->vs_queue, job, &job->fence,
+                         llvm_vs_job_execute, NULL, 0);
+   }
+
+   /* The calling thread shades the first slice itself. */
+   boolean clipped = llvm_run_vs(fpme, verts, MIN2(slice, count), start,
+                                 elts, vertex_id_offset);
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      util_queue_fence_wait(&fpme->vs_jobs[i].fence);
+      clipped |= fpme->vs_jobs[i].clipped;
+   }
+
+   return clipped;
+}
+
+
 static void
 llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                       const struct draw_fetch_info *fetch_info,
@@ -606,19 +737,9 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
          elts = fetch_info->elts;
       }
       /* Run vertex fetch shader */
-      clipped = fpme->current_variant->jit_func(&fpme->llvm->jit_context,
-                                                llvm_vert_info.verts,
-                                                draw->pt.user.vbuffer,
-                                                fetch_info->count,
-                                                start,
-                                                fpme->vertex_size,
-                                                draw->pt.vertex_buffer,
-                                                draw->instance_id,
-                                                vertex_id_offset,
-                                                draw->start_instance,
-                                                elts,
-                                                draw->pt.user.drawid,
-                                                draw->pt.user.viewid);
+      clipped = llvm_middle_end_shade(fpme, llvm_vert_info.verts,
+                                      fetch_info->count, start, elts,
+                                      vertex_id_offset);
 
       /* Finished with fetch and vs */
       fetch_info = NULL;
@@ -897,6 +1018,12 @@ llvm_middle_end_destroy(struct draw_pt_middle_end *middle)
    if (fpme->post_vs)
       draw_pt_post_vs_destroy(fpme->post_vs);
 
+   if (util_queue_is_initialized(&fpme->vs_queue))
+      util_queue_destroy(&fpme->vs_queue);
+
+   for (unsigned i = 0; i < DRAW_MAX_VS_THREADS; i++)
+      util_queue_fence_destroy(&fpme->vs_jobs[i].fence);
+
    FREE(middle);
 }
 
@@ -923,6 +1050,9 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
 
    fpme->draw = draw;
 
+   for (unsigned i = 0; i < DRAW_MAX_VS_THREADS; i++)
+      util_queue_fence_init(&fpme->vs_jobs[i].fence);
+
    fpme->fetch = draw_pt_fetch_create(draw);
    if (!fpme->fetch)
       goto fail;
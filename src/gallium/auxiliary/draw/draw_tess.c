@@ -354,10 +354,17 @@ int draw_tess_eval_shader_run(struct draw_tess_eval_shader *shader,
 #ifdef DRAW_LLVM_AVAILABLE
    struct pipe_tessellation_factors factors;
    struct pipe_tessellator_data data = { 0 };
-   struct pipe_tessellator *ptess = p_tess_init(shader->prim_mode,
-                                                shader->spacing,
-                                                !shader->vertex_order_cw,
-                                                shader->point_mode);
+   uint32_t verts_cap = 0, elts_cap = 0, prims_cap = 0;
+
+   /* kept on the shader so its pattern cache survives across draws */
+   if (!shader->ptess)
+      shader->ptess = p_tess_init(shader->prim_mode,
+                                  shader->spacing,
+                                  !shader->vertex_order_cw,
+                                  shader->point_mode);
+   struct pipe_tessellator *ptess = shader->ptess;
+   uint32_t prim_len = u_prim_vertex_count(output_prims->prim)->min;
+
    for (unsigned i = 0; i < input_prim->primitive_count; i++) {
       uint32_t vert_start = output_verts->count;
       uint32_t prim_start = output_prims->primitive_count;
@@ -371,17 +378,25 @@ int draw_tess_eval_shader_run(struct draw_tess_eval_shader *shader,
       if (data.num_domain_points == 0)
          continue;
 
-      uint32_t old_verts = vert_start;
+      /* grow the outputs geometrically, most patches only add a few verts */
       uint32_t new_verts = vert_start + util_align_npot(data.num_domain_points, 4);
-      uint32_t old_size = output_verts->vertex_size * old_verts;
-      uint32_t new_size = output_verts->vertex_size * new_verts;
-      output_verts->verts = REALLOC(output_verts->verts, old_size, new_size);
+      if (new_verts > verts_cap) {
+         uint32_t old_cap = verts_cap;
+         verts_cap = MAX2(new_verts, verts_cap * 2);
+         output_verts->verts = REALLOC(output_verts->verts,
+                                       output_verts->vertex_size * old_cap,
+                                       output_verts->vertex_size * verts_cap);
+      }
 
       output_verts->count += data.num_domain_points;
 
       output_prims->count += data.num_indices;
-      elts = REALLOC(elts, elt_start * sizeof(uint16_t),
-                     output_prims->count * sizeof(uint16_t));
+      if (output_prims->count > elts_cap) {
+         uint32_t old_cap = elts_cap;
+         elts_cap = MAX2(output_prims->count, elts_cap * 2);
+         elts = REALLOC(elts, old_cap * sizeof(uint16_t),
+                        elts_cap * sizeof(uint16_t));
+      }
 
       for (unsigned i = 0; i < data.num_indices; i++)
          elts[elt_start + i] = vert_start + data.indices[i];
@@ -396,15 +411,18 @@ int draw_tess_eval_shader_run(struct draw_tess_eval_shader *shader,
          shader->draw->statistics.ds_invocations += data.num_domain_points;
       }
 
-      uint32_t prim_len = u_prim_vertex_count(output_prims->prim)->min;
       output_prims->primitive_count += data.num_indices / prim_len;
-      output_prims->primitive_lengths = REALLOC(output_prims->primitive_lengths, prim_start * sizeof(uint32_t),
-                                                output_prims->primitive_count * sizeof(uint32_t));
+      if (output_prims->primitive_count > prims_cap) {
+         uint32_t old_cap = prims_cap;
+         prims_cap = MAX2(output_prims->primitive_count, prims_cap * 2);
+         output_prims->primitive_lengths = REALLOC(output_prims->primitive_lengths,
+                                                   old_cap * sizeof(uint32_t),
+                                                   prims_cap * sizeof(uint32_t));
+      }
       for (unsigned i = prim_start; i < output_prims->primitive_count; i++) {
          output_prims->primitive_lengths[i] = prim_len;
       }
    }
-   p_tess_destroy(ptess);
 #endif
 
    *elts_out = elts;
@@ -625,6 +643,8 @@ void draw_delete_tess_eval_shader(struct draw_context *draw,
       assert(shader->variants_cached == 0);
       align_free(dtes->tes_input);
    }
+   if (dtes->ptess)
+      p_tess_destroy(dtes->ptess);
 #endif
    if (dtes->state.type == PIPE_SHADER_IR_NIR && dtes->state.ir.nir)
       ralloc_free(dtes->state.ir.nir);
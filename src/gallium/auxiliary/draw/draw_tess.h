@@ -96,6 +96,7 @@ struct draw_tess_eval_shader {
    struct draw_tes_inputs *tes_input;
    struct draw_tes_jit_context *jit_context;
    struct draw_tes_llvm_variant *current_variant;
+   struct pipe_tessellator *ptess;
 #endif
 };
 
@@ -1341,8 +1341,9 @@ lp_build_lerp_simple(struct lp_build_context *bld,
          if (bld->type.width == 16 && bld->type.length == 8 && util_get_cpu_caps()->has_ssse3) {
             res = lp_build_intrinsic_binary(builder, "llvm.x86.ssse3.pmul.hr.sw.128", bld->vec_type, x, lp_build_shl_imm(bld, delta, 7));
             res = lp_build_and(bld, res, lp_build_const_int_vec(bld->gallivm, bld->type, 0xff));
-         } else if (bld->type.width == 16 && bld->type.length == 16 && util_get_cpu_caps()->has_avx2) {
-            res = lp_build_intrinsic_binary(builder, "llvm.x86.avx2.pmul.hr.sw", bld->vec_type, x, lp_build_shl_imm(bld, delta, 7));
+         } else if (bld->type.width == 16 && bld->type.length % 16 == 0 && util_get_cpu_caps()->has_avx2) {
+            /* wider vectors (16-wide fragment shaders) are split in 256 bit chunks */
+            res = lp_build_intrinsic_binary_anylength(bld->gallivm, "llvm.x86.avx2.pmul.hr.sw", bld->type, 256, x, lp_build_shl_imm(bld, delta, 7));
             res = lp_build_and(bld, res, lp_build_const_int_vec(bld->gallivm, bld->type, 0xff));
          } else {
             res = lp_build_mul(bld, x, delta);
@@ -110,7 +110,9 @@ lp_build_half_to_float(struct gallivm_state *gallivm,
    LLVMValueRef h;
 
    if (util_get_cpu_caps()->has_f16c &&
-       (src_length == 4 || src_length == 8)) {
+       (src_length == 4 || src_length == 8 ||
+        (src_length == 16 && util_get_cpu_caps()->has_avx512f &&
+         LLVM_VERSION_MAJOR >= 11))) {
       if (LLVM_VERSION_MAJOR < 11) {
          const char *intrinsic = NULL;
          if (src_length == 4) {
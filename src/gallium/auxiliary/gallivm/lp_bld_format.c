@@ -26,6 +26,8 @@
  **************************************************************************/
 
 
+#include "util/format/u_format.h"
+
 #include "lp_bld_format.h"
 
 LLVMTypeRef lp_build_format_cache_elem_type(struct gallivm_state *gallivm, enum cache_member member) {
@@ -72,3 +74,35 @@ lp_build_format_cache_type(struct gallivm_state *gallivm)
 
    return s;
 }
+
+
+/**
+ * Whether texels of this format should be fetched through the block cache.
+ *
+ * This is the case for 4x4 block compressed formats which have no JIT
+ * decoder and would otherwise decode the whole block in C again for every
+ * single texel fetched. S3TC and RGTC have vectorized decoders which don't
+ * need the cache.
+ */
+boolean
+lp_build_format_use_cache(const struct util_format_description *format_desc)
+{
+   const struct util_format_unpack_description *unpack;
+
+   switch (format_desc->layout) {
+   case UTIL_FORMAT_LAYOUT_ETC:
+   case UTIL_FORMAT_LAYOUT_BPTC:
+   case UTIL_FORMAT_LAYOUT_ASTC:
+      break;
+   default:
+      return FALSE;
+   }
+
+   if (format_desc->block.width != 4 ||
+       format_desc->block.height != 4 ||
+       !util_format_fits_8unorm(format_desc))
+      return FALSE;
+
+   unpack = util_format_unpack_description(format_desc->format);
+   return unpack && unpack->unpack_rgba_8unorm_rect;
+}
@@ -88,6 +88,9 @@ lp_build_format_cache_member_type(struct gallivm_state *gallivm, enum cache_memb
 LLVMTypeRef
 lp_build_format_cache_elem_type(struct gallivm_state *gallivm, enum cache_member member);
 
+boolean
+lp_build_format_use_cache(const struct util_format_description *format_desc);
+
 /*
  * AoS
  */
@@ -194,6 +197,16 @@ lp_build_fetch_s3tc_rgba_aos(struct gallivm_state *gallivm,
                              LLVMValueRef j,
                              LLVMValueRef cache);
 
+LLVMValueRef
+lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             unsigned n,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j,
+                             LLVMValueRef cache);
+
 /*
  * RGTC
  */
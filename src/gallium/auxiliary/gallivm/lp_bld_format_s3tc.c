@@ -38,6 +38,7 @@
 
 #include "util/format/u_format.h"
 #include "util/u_math.h"
+#include "util/u_pointer.h"
 #include "util/u_string.h"
 #include "util/u_cpu_detect.h"
 #include "util/u_debug.h"
@@ -57,6 +58,7 @@
 #include "lp_bld_init.h"
 #include "lp_bld_debug.h"
 #include "lp_bld_intr.h"
+#include "lp_bld_misc.h"
 
 
 /**
@@ -1911,6 +1913,78 @@ s3tc_decode_block_dxt5(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Decode a block of a format without JIT decoder, by calling the
+ * util_format unpack function on it. The rows it returns are transposed
+ * to the per-column layout of the cache.
+ */
+static void
+generic_decode_block(struct gallivm_state *gallivm,
+                     const struct util_format_description *format_desc,
+                     LLVMValueRef ptr_addr,
+                     LLVMValueRef *col)
+{
+   const struct util_format_unpack_description *unpack =
+      util_format_unpack_description(format_desc->format);
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
+   LLVMTypeRef pi8t = LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+   LLVMTypeRef type32_4 = LLVMVectorType(i32t, 4);
+   LLVMTypeRef block_type = LLVMArrayType(type32_4, 4);
+   LLVMTypeRef function_type;
+   LLVMValueRef function, block_ptr, args[6], rows[4];
+   unsigned count;
+
+   {
+      /*
+       * Function to call looks like:
+       *   unpack(uint8_t *dst, unsigned dst_stride,
+       *          const uint8_t *src, unsigned src_stride,
+       *          unsigned width, unsigned height)
+       */
+      LLVMTypeRef arg_types[6];
+
+      arg_types[0] = pi8t;
+      arg_types[1] = i32t;
+      arg_types[2] = pi8t;
+      arg_types[3] = i32t;
+      arg_types[4] = i32t;
+      arg_types[5] = i32t;
+      function_type = LLVMFunctionType(LLVMVoidTypeInContext(gallivm->context),
+                                       arg_types, ARRAY_SIZE(arg_types), 0);
+   }
+
+   if (gallivm->cache)
+      gallivm->cache->dont_cache = true;
+   function = lp_build_const_func_pointer_from_type(gallivm,
+                                                    func_to_pointer((func_pointer) unpack->unpack_rgba_8unorm_rect),
+                                                    function_type,
+                                                    format_desc->short_name);
+
+   block_ptr = lp_build_alloca(gallivm, block_type, "block");
+
+   args[0] = LLVMBuildBitCast(builder, block_ptr, pi8t, "");
+   args[1] = lp_build_const_int32(gallivm, 16);
+   args[2] = ptr_addr;
+   args[3] = lp_build_const_int32(gallivm, format_desc->block.bits / 8);
+   args[4] = lp_build_const_int32(gallivm, 4);
+   args[5] = lp_build_const_int32(gallivm, 4);
+   LLVMBuildCall2(builder, function_type, function, args, ARRAY_SIZE(args), "");
+
+   for (count = 0; count < 4; count++) {
+      LLVMValueRef indices[2], ptr;
+
+      indices[0] = lp_build_const_int32(gallivm, 0);
+      indices[1] = lp_build_const_int32(gallivm, count);
+      ptr = LLVMBuildGEP2(builder, block_type, block_ptr,
+                          indices, ARRAY_SIZE(indices), "");
+      rows[count] = LLVMBuildLoad2(builder, type32_4, ptr, "");
+   }
+
+   lp_build_transpose_aos(gallivm, lp_type_uint_vec(32, 128), rows, col);
+}
+
+
 static void
 generate_update_cache_one_block(struct gallivm_state *gallivm,
                                 LLVMValueRef function,
@@ -1941,28 +2015,33 @@ generate_update_cache_one_block(struct gallivm_state *gallivm,
    gallivm->builder = LLVMCreateBuilderInContext(gallivm->context);
    LLVMPositionBuilderAtEnd(gallivm->builder, block);
 
-   lp_build_gather_s3tc_simple_scalar(gallivm, format_desc, &dxt_block,
-                                      ptr_addr);
-
-   switch (format_desc->format) {
-   case PIPE_FORMAT_DXT1_RGB:
-   case PIPE_FORMAT_DXT1_RGBA:
-   case PIPE_FORMAT_DXT1_SRGB:
-   case PIPE_FORMAT_DXT1_SRGBA:
-      s3tc_decode_block_dxt1(gallivm, format_desc->format, dxt_block, col);
-      break;
-   case PIPE_FORMAT_DXT3_RGBA:
-   case PIPE_FORMAT_DXT3_SRGBA:
-      s3tc_decode_block_dxt3(gallivm, format_desc->format, dxt_block, col);
-      break;
-   case PIPE_FORMAT_DXT5_RGBA:
-   case PIPE_FORMAT_DXT5_SRGBA:
-      s3tc_decode_block_dxt5(gallivm, format_desc->format, dxt_block, col);
-      break;
-   default:
-      assert(0);
-      s3tc_decode_block_dxt1(gallivm, format_desc->format, dxt_block, col);
-      break;
+   if (format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
+      lp_build_gather_s3tc_simple_scalar(gallivm, format_desc, &dxt_block,
+                                         ptr_addr);
+
+      switch (format_desc->format) {
+      case PIPE_FORMAT_DXT1_RGB:
+      case PIPE_FORMAT_DXT1_RGBA:
+      case PIPE_FORMAT_DXT1_SRGB:
+      case PIPE_FORMAT_DXT1_SRGBA:
+         s3tc_decode_block_dxt1(gallivm, format_desc->format, dxt_block, col);
+         break;
+      case PIPE_FORMAT_DXT3_RGBA:
+      case PIPE_FORMAT_DXT3_SRGBA:
+         s3tc_decode_block_dxt3(gallivm, format_desc->format, dxt_block, col);
+         break;
+      case PIPE_FORMAT_DXT5_RGBA:
+      case PIPE_FORMAT_DXT5_SRGBA:
+         s3tc_decode_block_dxt5(gallivm, format_desc->format, dxt_block, col);
+         break;
+      default:
+         assert(0);
+         s3tc_decode_block_dxt1(gallivm, format_desc->format, dxt_block, col);
+         break;
+      }
+   }
+   else {
+      generic_decode_block(gallivm, format_desc, ptr_addr, col);
    }
 
    tag_value = LLVMBuildPtrToInt(gallivm->builder, ptr_addr,
@@ -2159,6 +2238,36 @@ compressed_fetch_cached(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Fetch texels of a block compressed format through the block cache,
+ * decoding each block missing from it once.
+ *
+ * @param n  number of pixels processed
+ * @param base_ptr  base pointer of the texture
+ * @param offset <n x i32> vector with the relative offsets of the blocks
+ * @param i  is a <n x i32> vector with the x subpixel coordinate (0..3)
+ * @param j  is a <n x i32> vector with the y subpixel coordinate (0..3)
+ * @return  a <4*n x i8> vector with the pixel RGBA values in AoS
+ */
+LLVMValueRef
+lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             unsigned n,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j,
+                             LLVMValueRef cache)
+{
+   assert(format_desc->block.width == 4);
+   assert(format_desc->block.height == 4);
+   assert(cache);
+
+   return compressed_fetch_cached(gallivm, format_desc, n,
+                                  base_ptr, offset, i, j, cache);
+}
+
+
 static LLVMValueRef
 s3tc_dxt5_to_rgba_aos(struct gallivm_state *gallivm,
                       unsigned n,
@@ -212,12 +212,19 @@ gallivm_free_ir(struct gallivm_state *gallivm)
 #endif
 #endif
 
+#if GALLIVM_USE_ORCJIT
+   if (gallivm->target_machine)
+      LLVMDisposeTargetMachine(gallivm->target_machine);
+   if (gallivm->module)
+      LLVMDisposeModule(gallivm->module);
+#else
    if (gallivm->engine) {
       /* This will already destroy any associated module */
       LLVMDisposeExecutionEngine(gallivm->engine);
    } else if (gallivm->module) {
       LLVMDisposeModule(gallivm->module);
    }
+#endif
 
    if (gallivm->cache) {
       lp_free_objcache(gallivm->cache->jit_obj_cache);
@@ -234,7 +241,11 @@ gallivm_free_ir(struct gallivm_state *gallivm)
 
    /* The LLVMContext should be owned by the parent of gallivm. */
 
+#if GALLIVM_USE_ORCJIT
+   gallivm->target_machine = NULL;
+#else
    gallivm->engine = NULL;
+#endif
    gallivm->target = NULL;
    gallivm->module = NULL;
    gallivm->module_name = NULL;
@@ -257,11 +268,16 @@ static void
 gallivm_free_code(struct gallivm_state *gallivm)
 {
    assert(!gallivm->module);
+#if GALLIVM_USE_ORCJIT
+   lp_free_jit_dylib(gallivm->dylib);
+   gallivm->dylib = NULL;
+#else
    assert(!gallivm->engine);
    lp_free_generated_code(gallivm->code);
    gallivm->code = NULL;
    lp_free_memory_manager(gallivm->memorymgr);
    gallivm->memorymgr = NULL;
+#endif
 }
 
 
@@ -280,6 +296,13 @@ init_gallivm_engine(struct gallivm_state *gallivm)
          optlevel = Default;
       }
 
+#if GALLIVM_USE_ORCJIT
+      ret = lp_build_create_jit_dylib(&gallivm->dylib,
+                                      &gallivm->target_machine,
+                                      gallivm->module,
+                                      (unsigned) optlevel,
+                                      &error);
+#else
       ret = lp_build_create_jit_compiler_for_module(&gallivm->engine,
                                                     &gallivm->code,
                                                     gallivm->cache,
@@ -287,6 +310,7 @@ init_gallivm_engine(struct gallivm_state *gallivm)
                                                     gallivm->memorymgr,
                                                     (unsigned) optlevel,
                                                     &error);
+#endif
       if (ret) {
          _debug_printf("%s\n", error);
          LLVMDisposeMessage(error);
@@ -299,7 +323,7 @@ init_gallivm_engine(struct gallivm_state *gallivm)
         * Dump the data layout strings.
         */
 
-       LLVMTargetDataRef target = LLVMGetExecutionEngineTargetData(gallivm->engine);
+       LLVMTargetDataRef target = LLVMGetModuleDataLayout(gallivm->module);
        char *data_layout;
        char *engine_data_layout;
 
@@ -363,9 +387,11 @@ init_gallivm_state(struct gallivm_state *gallivm, const char *name,
    if (!gallivm->builder)
       goto fail;
 
+#if !GALLIVM_USE_ORCJIT
    gallivm->memorymgr = lp_get_default_memory_manager();
    if (!gallivm->memorymgr)
       goto fail;
+#endif
 
    /* FIXME: MC-JIT only allows compiling one module at a time, and it must be
     * complete when MC-JIT is created. So defer the MC-JIT engine creation for
@@ -431,7 +457,9 @@ lp_build_init(void)
     * component is linked at buildtime, which is sufficient for its static
     * constructors to be called at load time.
     */
+#if !GALLIVM_USE_ORCJIT
    LLVMLinkInMCJIT();
+#endif
 
 #ifdef DEBUG
    gallivm_debug = debug_get_option_gallivm_debug();
@@ -493,6 +521,10 @@ gallivm_create(const char *name, LLVMContextRef context,
       }
    }
 
+   /* The caller builds the IR next */
+   if (gallivm && cache && !cache->data_size)
+      cache->build_start = os_time_get_nano();
+
    assert(gallivm != NULL);
    return gallivm;
 }
@@ -543,6 +575,51 @@ void lp_init_clock_hook(struct gallivm_state *gallivm)
    gallivm->get_time_hook = LLVMAddFunction(gallivm->module, "get_time_hook", get_time_type);
 }
 
+/**
+ * Map a declared global of the module to a host address, for the hooks
+ * the generated code calls back into.
+ */
+void
+gallivm_add_global_mapping(struct gallivm_state *gallivm,
+                           LLVMValueRef global, void *addr)
+{
+#if GALLIVM_USE_ORCJIT
+   assert(gallivm->dylib);
+   lp_build_jit_dylib_add_symbol(gallivm->dylib, LLVMGetValueName(global), addr);
+#else
+   assert(gallivm->engine);
+   LLVMAddGlobalMapping(gallivm->engine, global, addr);
+#endif
+}
+
+
+static void *
+gallivm_get_pointer_to_function(struct gallivm_state *gallivm,
+                                LLVMValueRef func)
+{
+#if GALLIVM_USE_ORCJIT
+   assert(gallivm->dylib);
+   return lp_build_jit_dylib_lookup(gallivm->dylib, LLVMGetValueName(func));
+#else
+   assert(gallivm->engine);
+   return LLVMGetPointerToGlobal(gallivm->engine, func);
+#endif
+}
+
+
+#if GALLIVM_USE_NEW_PASS == 1
+static LLVMTargetMachineRef
+gallivm_target_machine(struct gallivm_state *gallivm)
+{
+#if GALLIVM_USE_ORCJIT
+   return gallivm->target_machine;
+#else
+   return LLVMGetExecutionEngineTargetMachine(gallivm->engine);
+#endif
+}
+#endif
+
+
 /**
  * Compile a module.
  * This does IR optimization on all functions in the module.
@@ -559,17 +636,34 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       gallivm->builder = NULL;
    }
 
+   /* Creating the engine isn't skipped by a cache hit, so leave it out */
+   if (gallivm->cache && !gallivm->cache->data_size)
+      gallivm->cache->build_time_us +=
+         (os_time_get_nano() - gallivm->cache->build_start) / 1000;
+
    LLVMSetDataLayout(gallivm->module, "");
+#if GALLIVM_USE_ORCJIT
+   assert(!gallivm->dylib);
+   if (!init_gallivm_engine(gallivm)) {
+      assert(0);
+   }
+   assert(gallivm->dylib);
+#else
    assert(!gallivm->engine);
    if (!init_gallivm_engine(gallivm)) {
       assert(0);
    }
    assert(gallivm->engine);
+#endif
 
    if (gallivm->cache && gallivm->cache->data_size) {
       goto skip_cached;
    }
 
+   /* Optimization and code generation, up to when the object is emitted */
+   if (gallivm->cache)
+      gallivm->cache->build_start = os_time_get_nano();
+
    /* Dump bitcode to a file */
    if (gallivm_debug & GALLIVM_DEBUG_DUMP_BC) {
       char filename[256];
@@ -600,14 +694,14 @@ gallivm_compile_module(struct gallivm_state *gallivm)
    strcpy(passes, "default<O0>");
 
    LLVMPassBuilderOptionsRef opts = LLVMCreatePassBuilderOptions();
-   LLVMRunPasses(gallivm->module, passes, LLVMGetExecutionEngineTargetMachine(gallivm->engine), opts);
+   LLVMRunPasses(gallivm->module, passes, gallivm_target_machine(gallivm), opts);
 
    if (!(gallivm_perf & GALLIVM_PERF_NO_OPT))
       strcpy(passes, "sroa,early-cse,simplifycfg,reassociate,mem2reg,instsimplify,instcombine");
    else
       strcpy(passes, "mem2reg");
 
-   LLVMRunPasses(gallivm->module, passes, LLVMGetExecutionEngineTargetMachine(gallivm->engine), opts);
+   LLVMRunPasses(gallivm->module, passes, gallivm_target_machine(gallivm), opts);
    LLVMDisposePassBuilderOptions(opts);
 #else
 #if GALLIVM_HAVE_CORO == 1
@@ -664,13 +758,33 @@ gallivm_compile_module(struct gallivm_state *gallivm)
    ++gallivm->compiled;
 
    lp_init_printf_hook(gallivm);
-   LLVMAddGlobalMapping(gallivm->engine, gallivm->debug_printf_hook, debug_printf);
+   gallivm_add_global_mapping(gallivm, gallivm->debug_printf_hook, debug_printf);
 
    lp_init_clock_hook(gallivm);
-   LLVMAddGlobalMapping(gallivm->engine, gallivm->get_time_hook, os_time_get_nano);
+   gallivm_add_global_mapping(gallivm, gallivm->get_time_hook, os_time_get_nano);
 
    lp_build_coro_add_malloc_hooks(gallivm);
 
+#if GALLIVM_USE_ORCJIT
+   /*
+    * Unlike MCJIT, which generates code on the first function lookup, the
+    * object file is produced right here so that all the work happens in the
+    * calling thread and the ORC session is only needed for linking.
+    */
+   {
+      char *error = NULL;
+      if (lp_build_jit_dylib_add_module(gallivm->dylib,
+                                        gallivm->target_machine,
+                                        gallivm->cache,
+                                        gallivm->module,
+                                        &error)) {
+         _debug_printf("%s\n", error);
+         free(error);
+         assert(0);
+      }
+   }
+#endif
+
    if (gallivm_debug & GALLIVM_DEBUG_ASM) {
       LLVMValueRef llvm_func = LLVMGetFirstFunction(gallivm->module);
 
@@ -681,7 +795,7 @@ gallivm_compile_module(struct gallivm_state *gallivm)
           * LLVMGetPointerToGlobal() will abort otherwise.
           */
          if (!LLVMIsDeclaration(llvm_func)) {
-            void *func_code = LLVMGetPointerToGlobal(gallivm->engine, llvm_func);
+            void *func_code = gallivm_get_pointer_to_function(gallivm, llvm_func);
             lp_disassemble(llvm_func, func_code);
          }
          llvm_func = LLVMGetNextFunction(llvm_func);
@@ -694,7 +808,7 @@ gallivm_compile_module(struct gallivm_state *gallivm)
 
       while (llvm_func) {
          if (!LLVMIsDeclaration(llvm_func)) {
-            void *func_code = LLVMGetPointerToGlobal(gallivm->engine, llvm_func);
+            void *func_code = gallivm_get_pointer_to_function(gallivm, llvm_func);
             lp_profile(llvm_func, func_code);
          }
          llvm_func = LLVMGetNextFunction(llvm_func);
@@ -714,12 +828,11 @@ gallivm_jit_function(struct gallivm_state *gallivm,
    int64_t time_begin = 0;
 
    assert(gallivm->compiled);
-   assert(gallivm->engine);
 
    if (gallivm_debug & GALLIVM_DEBUG_PERF)
       time_begin = os_time_get();
 
-   code = LLVMGetPointerToGlobal(gallivm->engine, func);
+   code = gallivm_get_pointer_to_function(gallivm, func);
    assert(code);
    jit_func = pointer_to_func(code);
 
@@ -733,6 +846,40 @@ gallivm_jit_function(struct gallivm_state *gallivm,
    return jit_func;
 }
 
+/**
+ * Like gallivm_jit_function, but for a function the module may only have in
+ * cached object code, with no LLVM IR to refer to it.
+ */
+func_pointer
+gallivm_jit_function_by_name(struct gallivm_state *gallivm,
+                             const char *name)
+{
+   void *code;
+   func_pointer jit_func;
+   int64_t time_begin = 0;
+
+   assert(gallivm->compiled);
+
+   if (gallivm_debug & GALLIVM_DEBUG_PERF)
+      time_begin = os_time_get();
+
+#if GALLIVM_USE_ORCJIT
+   code = lp_build_jit_dylib_lookup(gallivm->dylib, name);
+#else
+   code = lp_build_jit_engine_lookup(gallivm->engine, name);
+#endif
+   assert(code);
+   jit_func = pointer_to_func(code);
+
+   if (gallivm_debug & GALLIVM_DEBUG_PERF) {
+      int64_t time_end = os_time_get();
+      int time_msec = (int)(time_end - time_begin) / 1000;
+      debug_printf("   jitting func %s took %d msec\n", name, time_msec);
+   }
+
+   return jit_func;
+}
+
 unsigned gallivm_get_perf_flags(void)
 {
    return gallivm_perf;
@@ -34,17 +34,24 @@
 #include "util/u_pointer.h" // for func_pointer
 #include "lp_bld.h"
 #include <llvm-c/ExecutionEngine.h>
+#include <llvm-c/TargetMachine.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 struct lp_cached_code;
+struct lp_jit_dylib;
 struct gallivm_state
 {
    char *module_name;
    LLVMModuleRef module;
+#if GALLIVM_USE_ORCJIT
+   LLVMTargetMachineRef target_machine;
+   struct lp_jit_dylib *dylib;
+#else
    LLVMExecutionEngineRef engine;
+#endif
    LLVMTargetDataRef target;
 #if GALLIVM_USE_NEW_PASS == 0
    LLVMPassManagerRef passmgr;
@@ -54,8 +61,10 @@ struct gallivm_state
 #endif
    LLVMContextRef context;
    LLVMBuilderRef builder;
+#if !GALLIVM_USE_ORCJIT
    LLVMMCJITMemoryManagerRef memorymgr;
    struct lp_generated_code *code;
+#endif
    struct lp_cached_code *cache;
    unsigned compiled;
    LLVMValueRef coro_malloc_hook;
@@ -94,6 +103,14 @@ func_pointer
 gallivm_jit_function(struct gallivm_state *gallivm,
                      LLVMValueRef func);
 
+func_pointer
+gallivm_jit_function_by_name(struct gallivm_state *gallivm,
+                             const char *name);
+
+void
+gallivm_add_global_mapping(struct gallivm_state *gallivm,
+                           LLVMValueRef global, void *addr);
+
 unsigned gallivm_get_perf_flags(void);
 
 void lp_init_clock_hook(struct gallivm_state *gallivm);
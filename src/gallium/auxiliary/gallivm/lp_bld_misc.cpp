@@ -80,6 +80,17 @@
 #include <llvm/ExecutionEngine/JITEventListener.h>
 #endif
 
+#if GALLIVM_USE_ORCJIT
+#include <atomic>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/SmallVectorMemoryBuffer.h>
+#include <llvm/Target/TargetMachine.h>
+#endif
+
 #if LLVM_VERSION_MAJOR < 7
 // Workaround http://llvm.org/PR23628
 #pragma pop_macro("DEBUG")
@@ -90,6 +101,7 @@
 #include "pipe/p_config.h"
 #include "util/u_debug.h"
 #include "util/u_cpu_detect.h"
+#include "util/os_time.h"
 
 #include "lp_bld_misc.h"
 #include "lp_bld_debug.h"
@@ -175,6 +187,7 @@ gallivm_dispose_target_library_info(LLVMTargetLibraryInfoRef library_info)
 }
 
 
+#if !GALLIVM_USE_ORCJIT
 typedef llvm::RTDyldMemoryManager BaseMemoryManager;
 
 
@@ -292,6 +305,8 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
       }
 };
 
+#endif
+
 class LPObjectCache : public llvm::ObjectCache {
 private:
    bool has_object;
@@ -309,6 +324,8 @@ public:
       if (has_object)
          fprintf(stderr, "CACHE ALREADY HAS MODULE OBJECT\n");
       has_object = true;
+      cache_out->build_time_us +=
+         (os_time_get_nano() - cache_out->build_start) / 1000;
       cache_out->data_size = Obj.getBufferSize();
       cache_out->data = malloc(cache_out->data_size);
       memcpy(cache_out->data, Obj.getBufferStart(), cache_out->data_size);
@@ -324,61 +341,15 @@ public:
 };
 
 /**
- * Same as LLVMCreateJITCompilerForModule, but:
- * - allows using MCJIT and enabling AVX feature where available.
- * - set target options
- *
- * See also:
- * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
- * - llvm/tools/lli/lli.cpp
- * - http://markmail.org/message/ttkuhvgj4cxxy2on#query:+page:1+mid:aju2dggerju3ivd3+state:results
+ * Pick the target cpu and features to generate code for.  Shared by the MCJIT
+ * and ORC JIT code paths.
  */
-extern "C"
-LLVMBool
-lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
-                                        lp_generated_code **OutCode,
-                                        struct lp_cached_code *cache_out,
-                                        LLVMModuleRef M,
-                                        LLVMMCJITMemoryManagerRef CMM,
-                                        unsigned OptLevel,
-                                        char **OutError)
+static void
+lp_get_jit_target(llvm::SmallVectorImpl<std::string> &MAttrs,
+                  std::string &CPU)
 {
    using namespace llvm;
 
-   std::string Error;
-   EngineBuilder builder(std::unique_ptr<Module>(unwrap(M)));
-
-   /**
-    * LLVM 3.1+ haven't more "extern unsigned llvm::StackAlignmentOverride" and
-    * friends for configuring code generation options, like stack alignment.
-    */
-   TargetOptions options;
-#if defined(PIPE_ARCH_X86) && LLVM_VERSION_MAJOR < 13
-   options.StackAlignmentOverride = 4;
-#endif
-
-   builder.setEngineKind(EngineKind::JIT)
-          .setErrorStr(&Error)
-          .setTargetOptions(options)
-          .setOptLevel((CodeGenOpt::Level)OptLevel);
-
-#ifdef _WIN32
-    /*
-     * MCJIT works on Windows, but currently only through ELF object format.
-     *
-     * XXX: We could use `LLVM_HOST_TRIPLE "-elf"` but LLVM_HOST_TRIPLE has
-     * different strings for MinGW/MSVC, so better play it safe and be
-     * explicit.
-     */
-#  ifdef _WIN64
-    LLVMSetTarget(M, "x86_64-pc-win32-elf");
-#  else
-    LLVMSetTarget(M, "i686-pc-win32-elf");
-#  endif
-#endif
-
-   llvm::SmallVector<std::string, 16> MAttrs;
-
 #if defined(PIPE_ARCH_ARM)
    /* llvm-3.3+ implements sys::getHostCPUFeatures for Arm,
     * which allows us to enable/disable code generation based
@@ -455,8 +426,6 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    MAttrs.push_back("+fp64");
 #endif
 
-   builder.setMAttrs(MAttrs);
-
    if (gallivm_debug & (GALLIVM_DEBUG_IR | GALLIVM_DEBUG_ASM | GALLIVM_DEBUG_DUMP_BC)) {
       int n = MAttrs.size();
       if (n > 0) {
@@ -490,8 +459,8 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
     * The cost of changing from Medium to Large is negligible:
     * - an additional 8-byte pointer stored immediately before the shader entrypoint;
     * - change an add-immediate (addis) instruction to a load (ld).
+    * The callers select CodeModel::Large themselves.
     */
-   builder.setCodeModel(CodeModel::Large);
 
 #if UTIL_ARCH_LITTLE_ENDIAN
    /*
@@ -520,11 +489,317 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
       MCPU = util_get_cpu_caps()->has_msa ? "mips64r5" : "mips64r2";
 #endif
 
-   builder.setMCPU(MCPU);
    if (gallivm_debug & (GALLIVM_DEBUG_IR | GALLIVM_DEBUG_ASM | GALLIVM_DEBUG_DUMP_BC)) {
       debug_printf("llc -mcpu option: %s\n", MCPU.str().c_str());
    }
 
+   CPU = MCPU.str();
+}
+
+
+#if GALLIVM_USE_ORCJIT
+/*
+ * All gallivm modules share a single ORC JIT instance, and so a single
+ * ExecutionSession and symbol string pool.  Each gallivm_state gets its own
+ * JITDylib, so that identical function names in different modules don't
+ * clash and so that the code of one module can be released on its own.
+ *
+ * Code generation happens in the thread calling gallivm_compile_module(),
+ * with a TargetMachine private to that module, so any number of threads can
+ * compile modules at the same time.  Only the linking of an object file into
+ * the session is deferred, until its first symbol is looked up.
+ */
+static llvm::orc::LLJIT *lp_orc_jit;
+static once_flag lp_orc_jit_once_flag = ONCE_FLAG_INIT;
+static std::atomic<unsigned> lp_orc_dylib_count;
+
+static llvm::orc::JITTargetMachineBuilder
+lp_orc_target_machine_builder(unsigned OptLevel)
+{
+   using namespace llvm;
+
+   Triple T(sys::getProcessTriple());
+#ifdef _WIN32
+   /* See lp_build_create_jit_compiler_for_module() for why we use ELF. */
+   T.setObjectFormat(Triple::ELF);
+#endif
+   orc::JITTargetMachineBuilder JTMB(T);
+
+   TargetOptions options;
+#if defined(PIPE_ARCH_X86) && LLVM_VERSION_MAJOR < 13
+   options.StackAlignmentOverride = 4;
+#endif
+   JTMB.setOptions(options);
+   JTMB.setCodeGenOptLevel((CodeGenOpt::Level)OptLevel);
+
+   SmallVector<std::string, 16> MAttrs;
+   std::string MCPU;
+   lp_get_jit_target(MAttrs, MCPU);
+   JTMB.setCPU(MCPU);
+   JTMB.addFeatures(std::vector<std::string>(MAttrs.begin(), MAttrs.end()));
+#ifdef PIPE_ARCH_PPC_64
+   JTMB.setCodeModel(CodeModel::Large);
+#endif
+   return JTMB;
+}
+
+static void
+lp_orc_jit_init(void)
+{
+   using namespace llvm;
+
+   auto J = orc::LLJITBuilder()
+      .setJITTargetMachineBuilder(lp_orc_target_machine_builder(CodeGenOpt::Default))
+      .create();
+   if (!J) {
+      _debug_printf("gallivm: failed to create ORC JIT: %s\n",
+                    toString(J.takeError()).c_str());
+      return;
+   }
+
+   /* Resolve libm and friends from the process, as MCJIT did. */
+   auto Gen = orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+      (*J)->getDataLayout().getGlobalPrefix());
+   if (!Gen) {
+      _debug_printf("gallivm: %s\n", toString(Gen.takeError()).c_str());
+      return;
+   }
+   (*J)->getMainJITDylib().addGenerator(std::move(*Gen));
+
+#if LLVM_USE_INTEL_JITEVENTS
+   static_cast<orc::RTDyldObjectLinkingLayer &>((*J)->getObjLinkingLayer())
+      .registerJITEventListener(*JITEventListener::createIntelJITEventListener());
+#endif
+
+   /* Deliberately never destroyed: code may be in use until process exit. */
+   lp_orc_jit = J->release();
+}
+
+static inline llvm::orc::JITDylib *
+unwrap(struct lp_jit_dylib *dylib)
+{
+   return reinterpret_cast<llvm::orc::JITDylib *>(dylib);
+}
+
+/**
+ * Create a JITDylib to hold the code of module M, plus a TargetMachine to
+ * generate that code with.  M's data layout and triple are set to match.
+ */
+extern "C"
+LLVMBool
+lp_build_create_jit_dylib(struct lp_jit_dylib **OutDylib,
+                          LLVMTargetMachineRef *OutTM,
+                          LLVMModuleRef M,
+                          unsigned OptLevel,
+                          char **OutError)
+{
+   using namespace llvm;
+
+   call_once(&lp_orc_jit_once_flag, lp_orc_jit_init);
+   if (!lp_orc_jit) {
+      *OutError = strdup("ORC JIT is not available");
+      return 1;
+   }
+
+   auto TM = lp_orc_target_machine_builder(OptLevel).createTargetMachine();
+   if (!TM) {
+      *OutError = strdup(toString(TM.takeError()).c_str());
+      return 1;
+   }
+
+   Module *Mod = unwrap(M);
+   std::string Name = Mod->getModuleIdentifier() + "." +
+                      std::to_string(lp_orc_dylib_count++);
+   auto JD = lp_orc_jit->getExecutionSession().createJITDylib(Name);
+   if (!JD) {
+      *OutError = strdup(toString(JD.takeError()).c_str());
+      return 1;
+   }
+   JD->addToLinkOrder(lp_orc_jit->getMainJITDylib());
+
+   Mod->setDataLayout((*TM)->createDataLayout());
+   Mod->setTargetTriple((*TM)->getTargetTriple().str());
+
+   *OutDylib = reinterpret_cast<struct lp_jit_dylib *>(&*JD);
+   *OutTM = reinterpret_cast<LLVMTargetMachineRef>(TM->release());
+   return 0;
+}
+
+/**
+ * Generate an object file for module M, or take it from the cache, and add
+ * it to the dylib.
+ */
+extern "C"
+LLVMBool
+lp_build_jit_dylib_add_module(struct lp_jit_dylib *dylib,
+                              LLVMTargetMachineRef TMRef,
+                              struct lp_cached_code *cache_out,
+                              LLVMModuleRef M,
+                              char **OutError)
+{
+   using namespace llvm;
+
+   std::unique_ptr<MemoryBuffer> Obj;
+
+   if (cache_out && cache_out->data_size) {
+      Obj = MemoryBuffer::getMemBufferCopy(
+         StringRef((const char *)cache_out->data, cache_out->data_size));
+   } else {
+      TargetMachine *TM = reinterpret_cast<TargetMachine *>(TMRef);
+      SmallVector<char, 0> ObjBuffer;
+      raw_svector_ostream OS(ObjBuffer);
+      legacy::PassManager PM;
+
+#if LLVM_VERSION_MAJOR >= 18
+      if (TM->addPassesToEmitFile(PM, OS, nullptr, CodeGenFileType::ObjectFile)) {
+#else
+      if (TM->addPassesToEmitFile(PM, OS, nullptr, CGFT_ObjectFile)) {
+#endif
+         *OutError = strdup("target does not support object emission");
+         return 1;
+      }
+      PM.run(*unwrap(M));
+
+      if (cache_out) {
+         cache_out->build_time_us +=
+            (os_time_get_nano() - cache_out->build_start) / 1000;
+         cache_out->data_size = ObjBuffer.size();
+         cache_out->data = malloc(cache_out->data_size);
+         memcpy(cache_out->data, ObjBuffer.data(), cache_out->data_size);
+      }
+      Obj = std::make_unique<SmallVectorMemoryBuffer>(std::move(ObjBuffer));
+   }
+
+   if (Error E = lp_orc_jit->addObjectFile(*unwrap(dylib), std::move(Obj))) {
+      *OutError = strdup(toString(std::move(E)).c_str());
+      return 1;
+   }
+   return 0;
+}
+
+extern "C"
+void
+lp_build_jit_dylib_add_symbol(struct lp_jit_dylib *dylib,
+                              const char *name, void *addr)
+{
+   using namespace llvm;
+
+   orc::SymbolMap Symbols;
+#if LLVM_VERSION_MAJOR >= 17
+   Symbols[lp_orc_jit->mangleAndIntern(name)] =
+      orc::ExecutorSymbolDef(orc::ExecutorAddr::fromPtr(addr),
+                             JITSymbolFlags::Exported | JITSymbolFlags::Callable);
+#else
+   Symbols[lp_orc_jit->mangleAndIntern(name)] =
+      JITEvaluatedSymbol(pointerToJITTargetAddress(addr),
+                         JITSymbolFlags::Exported | JITSymbolFlags::Callable);
+#endif
+   if (Error E = unwrap(dylib)->define(orc::absoluteSymbols(std::move(Symbols))))
+      _debug_printf("gallivm: %s\n", toString(std::move(E)).c_str());
+}
+
+/**
+ * Look up a function, linking the dylib's object file on first use.
+ */
+extern "C"
+void *
+lp_build_jit_dylib_lookup(struct lp_jit_dylib *dylib, const char *name)
+{
+   using namespace llvm;
+
+   auto Sym = lp_orc_jit->lookup(*unwrap(dylib), name);
+   if (!Sym) {
+      _debug_printf("gallivm: %s\n", toString(Sym.takeError()).c_str());
+      return NULL;
+   }
+#if LLVM_VERSION_MAJOR >= 15
+   return Sym->toPtr<void *>();
+#else
+   return jitTargetAddressToPointer<void *>(Sym->getAddress());
+#endif
+}
+
+/**
+ * Release the dylib and all code linked into it.
+ */
+extern "C"
+void
+lp_free_jit_dylib(struct lp_jit_dylib *dylib)
+{
+   using namespace llvm;
+
+   if (!dylib)
+      return;
+
+   if (Error E = lp_orc_jit->getExecutionSession().removeJITDylib(*unwrap(dylib)))
+      _debug_printf("gallivm: %s\n", toString(std::move(E)).c_str());
+}
+
+#else
+/**
+ * Same as LLVMCreateJITCompilerForModule, but:
+ * - allows using MCJIT and enabling AVX feature where available.
+ * - set target options
+ *
+ * See also:
+ * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
+ * - llvm/tools/lli/lli.cpp
+ * - http://markmail.org/message/ttkuhvgj4cxxy2on#query:+page:1+mid:aju2dggerju3ivd3+state:results
+ */
+extern "C"
+LLVMBool
+lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
+                                        lp_generated_code **OutCode,
+                                        struct lp_cached_code *cache_out,
+                                        LLVMModuleRef M,
+                                        LLVMMCJITMemoryManagerRef CMM,
+                                        unsigned OptLevel,
+                                        char **OutError)
+{
+   using namespace llvm;
+
+   std::string Error;
+   EngineBuilder builder(std::unique_ptr<Module>(unwrap(M)));
+
+   /**
+    * LLVM 3.1+ haven't more "extern unsigned llvm::StackAlignmentOverride" and
+    * friends for configuring code generation options, like stack alignment.
+    */
+   TargetOptions options;
+#if defined(PIPE_ARCH_X86) && LLVM_VERSION_MAJOR < 13
+   options.StackAlignmentOverride = 4;
+#endif
+
+   builder.setEngineKind(EngineKind::JIT)
+          .setErrorStr(&Error)
+          .setTargetOptions(options)
+          .setOptLevel((CodeGenOpt::Level)OptLevel);
+
+#ifdef _WIN32
+    /*
+     * MCJIT works on Windows, but currently only through ELF object format.
+     *
+     * XXX: We could use `LLVM_HOST_TRIPLE "-elf"` but LLVM_HOST_TRIPLE has
+     * different strings for MinGW/MSVC, so better play it safe and be
+     * explicit.
+     */
+#  ifdef _WIN64
+    LLVMSetTarget(M, "x86_64-pc-win32-elf");
+#  else
+    LLVMSetTarget(M, "i686-pc-win32-elf");
+#  endif
+#endif
+
+   llvm::SmallVector<std::string, 16> MAttrs;
+   std::string MCPU;
+   lp_get_jit_target(MAttrs, MCPU);
+
+   builder.setMAttrs(MAttrs);
+   builder.setMCPU(MCPU);
+#ifdef PIPE_ARCH_PPC_64
+   builder.setCodeModel(CodeModel::Large);
+#endif
+
    ShaderMemoryManager *MM = NULL;
    BaseMemoryManager* JMM = reinterpret_cast<BaseMemoryManager*>(CMM);
    MM = new ShaderMemoryManager(JMM);
@@ -559,6 +834,21 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
 }
 
 
+/**
+ * Look up a function by name, generating or loading the module code first
+ * if that didn't happen yet.  Unlike LLVMGetPointerToGlobal this also finds
+ * functions which are only defined in cached object code.
+ */
+extern "C"
+void *
+lp_build_jit_engine_lookup(LLVMExecutionEngineRef EE, const char *name)
+{
+   llvm::ExecutionEngine *E = llvm::unwrap(EE);
+
+   E->finalizeObject();
+   return reinterpret_cast<void *>(E->getFunctionAddress(name));
+}
+
 extern "C"
 void
 lp_free_generated_code(struct lp_generated_code *code)
@@ -582,6 +872,8 @@ lp_free_memory_manager(LLVMMCJITMemoryManagerRef memorymgr)
    delete reinterpret_cast<BaseMemoryManager*>(memorymgr);
 }
 
+#endif
+
 extern "C" void
 lp_free_objcache(void *objcache_ptr)
 {
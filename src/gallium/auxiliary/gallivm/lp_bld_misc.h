@@ -34,6 +34,7 @@
 #include <llvm/Config/llvm-config.h>
 #include <llvm-c/ExecutionEngine.h>
 #include <llvm-c/Target.h>
+#include <llvm-c/TargetMachine.h>
 
 
 #ifdef __cplusplus
@@ -51,6 +52,13 @@ struct lp_cached_code {
    size_t data_size;
    bool dont_cache;
    void *jit_obj_cache;
+   /*
+    * Time spent building the IR, optimizing it and generating the object
+    * code, i.e. what a cache hit skips.  Stored next to the code in the
+    * disk cache.  build_start is when the stage being timed began.
+    */
+   unsigned build_time_us;
+   int64_t build_start;
 };
 
 struct lp_generated_code;
@@ -65,6 +73,33 @@ extern void
 lp_set_target_options(void);
 
 
+#if GALLIVM_USE_ORCJIT
+struct lp_jit_dylib;
+
+extern int
+lp_build_create_jit_dylib(struct lp_jit_dylib **OutDylib,
+                          LLVMTargetMachineRef *OutTM,
+                          LLVMModuleRef M,
+                          unsigned OptLevel,
+                          char **OutError);
+
+extern int
+lp_build_jit_dylib_add_module(struct lp_jit_dylib *dylib,
+                              LLVMTargetMachineRef TM,
+                              struct lp_cached_code *cache_out,
+                              LLVMModuleRef M,
+                              char **OutError);
+
+extern void
+lp_build_jit_dylib_add_symbol(struct lp_jit_dylib *dylib,
+                              const char *name, void *addr);
+
+extern void *
+lp_build_jit_dylib_lookup(struct lp_jit_dylib *dylib, const char *name);
+
+extern void
+lp_free_jit_dylib(struct lp_jit_dylib *dylib);
+#else
 extern int
 lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
                                         struct lp_generated_code **OutCode,
@@ -74,6 +109,9 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
                                         unsigned OptLevel,
                                         char **OutError);
 
+extern void *
+lp_build_jit_engine_lookup(LLVMExecutionEngineRef EE, const char *name);
+
 extern void
 lp_free_generated_code(struct lp_generated_code *code);
 
@@ -82,6 +120,7 @@ lp_get_default_memory_manager();
 
 extern void
 lp_free_memory_manager(LLVMMCJITMemoryManagerRef memorymgr);
+#endif
 
 extern LLVMValueRef
 lp_get_called_value(LLVMValueRef call);
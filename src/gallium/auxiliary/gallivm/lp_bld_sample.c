@@ -121,6 +121,7 @@ lp_sampler_static_texture_state(struct lp_static_texture_state *state,
    state->pot_height = util_is_power_of_two_or_zero(texture->height0);
    state->pot_depth = util_is_power_of_two_or_zero(texture->depth0);
    state->level_zero_only = !view->u.tex.last_level;
+   state->tiled = !!(texture->flags & LP_RESOURCE_FLAG_TILED);
 
    /*
     * the layer / element / level parameters are all either dynamic
@@ -2078,6 +2079,9 @@ lp_build_cube_lookup(struct lp_build_sample_context *bld,
  * @param stride  number of bytes between rows of successive pixel blocks
  * @param block_length  number of pixels in a pixels block along the coordinate
  *                      axis
+ * @param sub_stride    for tiled textures (block_length is then the tile
+ *                      size) the number of bytes between successive pixels
+ *                      within a tile, otherwise NULL
  * @param out_offset    resulting relative offset of the pixel block in bytes
  * @param out_subcoord  resulting sub-block pixel coordinate
  */
@@ -2086,6 +2090,7 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
                                unsigned block_length,
                                LLVMValueRef coord,
                                LLVMValueRef stride,
+                               LLVMValueRef sub_stride,
                                LLVMValueRef *out_offset,
                                LLVMValueRef *out_subcoord)
 {
@@ -2120,6 +2125,12 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
 
    offset = lp_build_mul(bld, coord, stride);
 
+   /* The position within a tile is part of the address, not a sub-coord. */
+   if (sub_stride) {
+      offset = lp_build_add(bld, offset, lp_build_mul(bld, subcoord, sub_stride));
+      subcoord = bld->zero;
+   }
+
    assert(out_offset);
    assert(out_subcoord);
 
@@ -2138,6 +2149,7 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
@@ -2147,22 +2159,36 @@ lp_build_sample_offset(struct lp_build_context *bld,
                        LLVMValueRef *out_i,
                        LLVMValueRef *out_j)
 {
-   LLVMValueRef x_stride;
+   const unsigned texel_size = format_desc->block.bits/8;
+   unsigned block_width = format_desc->block.width;
+   unsigned block_height = format_desc->block.height;
+   LLVMValueRef x_stride, x_sub_stride = NULL, y_sub_stride = NULL;
    LLVMValueRef offset;
 
-   x_stride = lp_build_const_vec(bld->gallivm, bld->type,
-                                 format_desc->block.bits/8);
+   if (tiled) {
+      assert(block_width == 1 && block_height == 1);
+      block_width = block_height = LP_TILED_TEX_DIM;
+      x_stride = lp_build_const_int_vec(bld->gallivm, bld->type,
+                                        texel_size * LP_TILED_TEX_DIM *
+                                        LP_TILED_TEX_DIM);
+      x_sub_stride = lp_build_const_int_vec(bld->gallivm, bld->type,
+                                            texel_size);
+      y_sub_stride = lp_build_const_int_vec(bld->gallivm, bld->type,
+                                            texel_size * LP_TILED_TEX_DIM);
+   } else {
+      x_stride = lp_build_const_vec(bld->gallivm, bld->type, texel_size);
+   }
 
    lp_build_sample_partial_offset(bld,
-                                  format_desc->block.width,
-                                  x, x_stride,
+                                  block_width,
+                                  x, x_stride, x_sub_stride,
                                   &offset, out_i);
 
    if (y && y_stride) {
       LLVMValueRef y_offset;
       lp_build_sample_partial_offset(bld,
-                                     format_desc->block.height,
-                                     y, y_stride,
+                                     block_height,
+                                     y, y_stride, y_sub_stride,
                                      &y_offset, out_j);
       offset = lp_build_add(bld, offset, y_offset);
    }
@@ -2175,7 +2201,7 @@ lp_build_sample_offset(struct lp_build_context *bld,
       LLVMValueRef k;
       lp_build_sample_partial_offset(bld,
                                      1, /* pixel blocks are always 2D */
-                                     z, z_stride,
+                                     z, z_stride, NULL,
                                      &z_offset, &k);
       offset = lp_build_add(bld, offset, z_offset);
    }
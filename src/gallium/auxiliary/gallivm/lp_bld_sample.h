@@ -164,6 +164,17 @@ struct lp_img_params
 };
 
 
+/**
+ * Textures with LP_RESOURCE_FLAG_TILED set in pipe_resource::flags are stored
+ * in LP_TILED_TEX_DIM x LP_TILED_TEX_DIM texel tiles.  The texels of a tile
+ * are contiguous and tiles follow each other along x; row_stride is the
+ * distance between rows of tiles.  Only uncompressed formats with a power of
+ * two block size are ever tiled.
+ */
+#define LP_TILED_TEX_DIM 4
+#define LP_RESOURCE_FLAG_TILED PIPE_RESOURCE_FLAG_DRV_PRIV
+
+
 /**
  * Texture static state.
  *
@@ -186,6 +197,7 @@ struct lp_static_texture_state
    unsigned pot_height:1;
    unsigned pot_depth:1;
    unsigned level_zero_only:1;
+   unsigned tiled:1;         /**< LP_RESOURCE_FLAG_TILED layout */
 };
 
 
@@ -701,6 +713,7 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
                                unsigned block_length,
                                LLVMValueRef coord,
                                LLVMValueRef stride,
+                               LLVMValueRef sub_stride,
                                LLVMValueRef *out_offset,
                                LLVMValueRef *out_i);
 
@@ -708,6 +721,7 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
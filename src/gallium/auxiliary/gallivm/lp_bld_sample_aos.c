@@ -59,6 +59,40 @@
 #include "lp_bld_quad.h"
 
 
+/**
+ * Get the pixel block dimensions and the strides needed to address texels
+ * along x and y, taking a tiled texture layout into account.
+ * The sub strides are NULL for linear textures.
+ */
+static void
+lp_build_sample_x_y_strides(struct lp_build_sample_context *bld,
+                            unsigned *block_width,
+                            unsigned *block_height,
+                            LLVMValueRef *x_stride,
+                            LLVMValueRef *x_sub_stride,
+                            LLVMValueRef *y_sub_stride)
+{
+   const unsigned texel_size = bld->format_desc->block.bits/8;
+   struct lp_type type = bld->int_coord_bld.type;
+
+   if (bld->static_texture_state->tiled) {
+      *block_width = *block_height = LP_TILED_TEX_DIM;
+      *x_stride = lp_build_const_int_vec(bld->gallivm, type,
+                                         texel_size * LP_TILED_TEX_DIM *
+                                         LP_TILED_TEX_DIM);
+      *x_sub_stride = lp_build_const_int_vec(bld->gallivm, type, texel_size);
+      *y_sub_stride = lp_build_const_int_vec(bld->gallivm, type,
+                                             texel_size * LP_TILED_TEX_DIM);
+   } else {
+      *block_width = bld->format_desc->block.width;
+      *block_height = bld->format_desc->block.height;
+      *x_stride = lp_build_const_vec(bld->gallivm, type, texel_size);
+      *x_sub_stride = NULL;
+      *y_sub_stride = NULL;
+   }
+}
+
+
 /**
  * Build LLVM code for texture coord wrapping, for nearest filtering,
  * for scaled integer texcoords.
@@ -68,6 +102,7 @@
  * \param coord_f  the incoming texcoord (s,t or r) as float vec
  * \param length  the texture size along one dimension
  * \param stride  pixel stride along the coordinate axis (in bytes)
+ * \param sub_stride  pixel stride within a tile for tiled textures, or NULL
  * \param offset  the texel offset along the coord axis
  * \param is_pot  if TRUE, length is a power of two
  * \param wrap_mode  one of PIPE_TEX_WRAP_x
@@ -81,6 +116,7 @@ lp_build_sample_wrap_nearest_int(struct lp_build_sample_context *bld,
                                  LLVMValueRef coord_f,
                                  LLVMValueRef length,
                                  LLVMValueRef stride,
+                                 LLVMValueRef sub_stride,
                                  LLVMValueRef offset,
                                  boolean is_pot,
                                  unsigned wrap_mode,
@@ -127,7 +163,7 @@ lp_build_sample_wrap_nearest_int(struct lp_build_sample_context *bld,
    }
 
    lp_build_sample_partial_offset(int_coord_bld, block_length, coord, stride,
-                                  out_offset, out_i);
+                                  sub_stride, out_offset, out_i);
 }
 
 
@@ -202,6 +238,7 @@ lp_build_coord_repeat_npot_linear_int(struct lp_build_sample_context *bld,
  * \param coord_f  the incoming texcoord (s,t or r) as float vec
  * \param length  the texture size along one dimension
  * \param stride  pixel stride along the coordinate axis (in bytes)
+ * \param sub_stride  pixel stride within a tile for tiled textures, or NULL
  * \param offset  the texel offset along the coord axis
  * \param is_pot  if TRUE, length is a power of two
  * \param wrap_mode  one of PIPE_TEX_WRAP_x
@@ -218,6 +255,7 @@ lp_build_sample_wrap_linear_int(struct lp_build_sample_context *bld,
                                 LLVMValueRef coord_f,
                                 LLVMValueRef length,
                                 LLVMValueRef stride,
+                                LLVMValueRef sub_stride,
                                 LLVMValueRef offset,
                                 boolean is_pot,
                                 unsigned wrap_mode,
@@ -290,9 +328,9 @@ lp_build_sample_wrap_linear_int(struct lp_build_sample_context *bld,
          break;
       }
       lp_build_sample_partial_offset(int_coord_bld, block_length, coord0, stride,
-                                     offset0, i0);
+                                     sub_stride, offset0, i0);
       lp_build_sample_partial_offset(int_coord_bld, block_length, coord1, stride,
-                                     offset1, i1);
+                                     sub_stride, offset1, i1);
       return;
    }
 
@@ -452,7 +490,8 @@ lp_build_sample_image_nearest(struct lp_build_sample_context *bld,
    LLVMValueRef width_vec, height_vec, depth_vec;
    LLVMValueRef s_ipart, t_ipart = NULL, r_ipart = NULL;
    LLVMValueRef s_float, t_float = NULL, r_float = NULL;
-   LLVMValueRef x_stride;
+   LLVMValueRef x_stride, x_sub_stride, y_sub_stride;
+   unsigned block_width, block_height;
    LLVMValueRef x_offset, offset;
    LLVMValueRef x_subcoord, y_subcoord = NULL, z_subcoord;
 
@@ -500,15 +539,15 @@ lp_build_sample_image_nearest(struct lp_build_sample_context *bld,
    }
 
    /* get pixel, row, image strides */
-   x_stride = lp_build_const_vec(bld->gallivm,
-                                 bld->int_coord_bld.type,
-                                 bld->format_desc->block.bits/8);
+   lp_build_sample_x_y_strides(bld, &block_width, &block_height,
+                               &x_stride, &x_sub_stride, &y_sub_stride);
 
    /* Do texcoord wrapping, compute texel offset */
    lp_build_sample_wrap_nearest_int(bld,
-                                    bld->format_desc->block.width,
+                                    block_width,
                                     s_ipart, s_float,
-                                    width_vec, x_stride, offsets[0],
+                                    width_vec, x_stride, x_sub_stride,
+                                    offsets[0],
                                     bld->static_texture_state->pot_width,
                                     bld->static_sampler_state->wrap_s,
                                     &x_offset, &x_subcoord);
@@ -516,9 +555,10 @@ lp_build_sample_image_nearest(struct lp_build_sample_context *bld,
    if (dims >= 2) {
       LLVMValueRef y_offset;
       lp_build_sample_wrap_nearest_int(bld,
-                                       bld->format_desc->block.height,
+                                       block_height,
                                        t_ipart, t_float,
-                                       height_vec, row_stride_vec, offsets[1],
+                                       height_vec, row_stride_vec,
+                                       y_sub_stride, offsets[1],
                                        bld->static_texture_state->pot_height,
                                        bld->static_sampler_state->wrap_t,
                                        &y_offset, &y_subcoord);
@@ -528,7 +568,8 @@ lp_build_sample_image_nearest(struct lp_build_sample_context *bld,
          lp_build_sample_wrap_nearest_int(bld,
                                           1, /* block length (depth) */
                                           r_ipart, r_float,
-                                          depth_vec, img_stride_vec, offsets[2],
+                                          depth_vec, img_stride_vec, NULL,
+                                          offsets[2],
                                           bld->static_texture_state->pot_depth,
                                           bld->static_sampler_state->wrap_r,
                                           &z_offset, &z_subcoord);
@@ -757,6 +798,8 @@ lp_build_sample_image_linear(struct lp_build_sample_context *bld,
    LLVMValueRef t_ipart = NULL, t_fpart = NULL, t_float = NULL;
    LLVMValueRef r_ipart = NULL, r_fpart = NULL, r_float = NULL;
    LLVMValueRef x_stride, y_stride, z_stride;
+   LLVMValueRef x_sub_stride, y_sub_stride;
+   unsigned block_width, block_height;
    LLVMValueRef x_offset0, x_offset1;
    LLVMValueRef y_offset0, y_offset1;
    LLVMValueRef z_offset0, z_offset1;
@@ -847,16 +890,17 @@ lp_build_sample_image_linear(struct lp_build_sample_context *bld,
       r_fpart = LLVMBuildAnd(builder, r, i32_c255, "");
 
    /* get pixel, row and image strides */
-   x_stride = lp_build_const_vec(bld->gallivm, bld->int_coord_bld.type,
-                                 bld->format_desc->block.bits/8);
+   lp_build_sample_x_y_strides(bld, &block_width, &block_height,
+                               &x_stride, &x_sub_stride, &y_sub_stride);
    y_stride = row_stride_vec;
    z_stride = img_stride_vec;
 
    /* do texcoord wrapping and compute texel offsets */
    lp_build_sample_wrap_linear_int(bld,
-                                   bld->format_desc->block.width,
+                                   block_width,
                                    s_ipart, &s_fpart, s_float,
-                                   width_vec, x_stride, offsets[0],
+                                   width_vec, x_stride, x_sub_stride,
+                                   offsets[0],
                                    bld->static_texture_state->pot_width,
                                    bld->static_sampler_state->wrap_s,
                                    &x_offset0, &x_offset1,
@@ -884,9 +928,10 @@ lp_build_sample_image_linear(struct lp_build_sample_context *bld,
 
    if (dims >= 2) {
       lp_build_sample_wrap_linear_int(bld,
-                                      bld->format_desc->block.height,
+                                      block_height,
                                       t_ipart, &t_fpart, t_float,
-                                      height_vec, y_stride, offsets[1],
+                                      height_vec, y_stride, y_sub_stride,
+                                      offsets[1],
                                       bld->static_texture_state->pot_height,
                                       bld->static_sampler_state->wrap_t,
                                       &y_offset0, &y_offset1,
@@ -906,7 +951,8 @@ lp_build_sample_image_linear(struct lp_build_sample_context *bld,
       lp_build_sample_wrap_linear_int(bld,
                                       1, /* block length (depth) */
                                       r_ipart, &r_fpart, r_float,
-                                      depth_vec, z_stride, offsets[2],
+                                      depth_vec, z_stride, NULL,
+                                      offsets[2],
                                       bld->static_texture_state->pot_depth,
                                       bld->static_sampler_state->wrap_r,
                                       &z_offset0, &z_offset1,
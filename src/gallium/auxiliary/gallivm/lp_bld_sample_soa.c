@@ -141,6 +141,7 @@ lp_build_sample_texel_soa(struct lp_build_sample_context *bld,
    /* convert x,y,z coords to linear offset from start of texture, in bytes */
    lp_build_sample_offset(&bld->int_coord_bld,
                           bld->format_desc,
+                          bld->static_texture_state->tiled,
                           x, y, z, y_stride, z_stride,
                           &offset, &i, &j);
    if (mipoffsets) {
@@ -3227,6 +3228,7 @@ lp_build_fetch_texel(struct lp_build_sample_context *bld,
 
    lp_build_sample_offset(int_coord_bld,
                           bld->format_desc,
+                          bld->static_texture_state->tiled,
                           x, y, z, row_stride_vec, img_stride_vec,
                           &offset, &i, &j);
 
@@ -3622,7 +3624,8 @@ lp_build_sample_soa_code(struct gallivm_state *gallivm,
 
    /* Note that mip_offsets is an array[level] of offsets to texture images */
 
-   if (dynamic_state->cache_ptr && thread_data_ptr) {
+   if (dynamic_state->cache_ptr && thread_data_ptr &&
+       lp_build_format_use_cache(bld.format_desc)) {
       bld.cache = dynamic_state->cache_ptr(gallivm, thread_data_type,
                                            thread_data_ptr, texture_index);
    }
@@ -4088,7 +4091,7 @@ lp_build_sample_gen_func(struct gallivm_state *gallivm,
    if (dynamic_state->cache_ptr) {
       const struct util_format_description *format_desc;
       format_desc = util_format_description(static_texture_state->format);
-      if (format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
+      if (lp_build_format_use_cache(format_desc)) {
          need_cache = TRUE;
       }
    }
@@ -4214,7 +4217,7 @@ lp_build_sample_soa_func(struct gallivm_state *gallivm,
    if (dynamic_state->cache_ptr) {
       const struct util_format_description *format_desc;
       format_desc = util_format_description(static_texture_state->format);
-      if (format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
+      if (lp_build_format_use_cache(format_desc)) {
          need_cache = TRUE;
       }
    }
@@ -4897,6 +4900,7 @@ lp_build_img_op_soa(const struct lp_static_texture_state *static_texture_state,
    LLVMValueRef offset, i, j;
    lp_build_sample_offset(&int_coord_bld,
                           format_desc,
+                          static_texture_state->tiled,
                           x, y, z, row_stride_vec, img_stride_vec,
                           &offset, &i, &j);
 
@@ -424,6 +424,17 @@ static unsigned get_counter(struct hud_graph *gr, enum hud_counter counter)
       value = mon->num_batches;
       mon->num_batches = 0;
       return value;
+   case HUD_COUNTER_STALL_TIME:
+      value = mon->stall_time_us;
+      mon->stall_time_us = 0;
+      return value;
+   case HUD_COUNTER_BATCH_FILL:
+      /* the average over the period */
+      value = mon->num_filled_batches ?
+                 mon->batch_fill_sum / mon->num_filled_batches : 0;
+      mon->batch_fill_sum = 0;
+      mon->num_filled_batches = 0;
+      return value;
    default:
       assert(0);
       return 0;
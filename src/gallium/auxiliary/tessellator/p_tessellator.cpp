@@ -33,6 +33,26 @@
 
 namespace pipe_tessellator_wrap
 {
+   /// Number of tessellation results remembered per tessellator.  Patches
+   /// of a draw usually share a handful of distinct factor sets (constant
+   /// levels, or a few LODs on terrain), so a short MRU list is enough.
+   static const unsigned PATTERN_CACHE_SIZE = 8;
+
+   /// One cached tessellation: the output of CHWTessellator only depends on
+   /// the factors once partitioning and output primitive are fixed at Init.
+   struct pattern
+   {
+      float     outer_tf[4];
+      float     inner_tf[2];
+      uint32_t  num_domain_points;
+      uint32_t  num_indices;
+      uint32_t  max_domain_points;
+      uint32_t  max_indices;
+      float    *domain_points_u;
+      float    *domain_points_v;
+      uint32_t *indices;
+   };
+
    /// Wrapper class for the CHWTessellator reference tessellator from MSFT
    /// This class will store data not originally stored in CHWTessellator
    class pipe_ts : private CHWTessellator
@@ -40,40 +60,35 @@ namespace pipe_tessellator_wrap
    private:
       typedef CHWTessellator SUPER;
       enum pipe_prim_type    prim_mode;
-      alignas(32) float      domain_points_u[MAX_POINT_COUNT];
-      alignas(32) float      domain_points_v[MAX_POINT_COUNT];
-      uint32_t               num_domain_points;
+      unsigned               num_outer_tf;  // factors the domain reads
+      unsigned               num_inner_tf;
+      pattern                patterns[PATTERN_CACHE_SIZE]; // MRU first
+      unsigned               num_patterns;
+      uint64_t               num_calls;
+      uint64_t               num_hits;
 
-   public:
-      void Init(enum pipe_prim_type tes_prim_mode,
-                enum pipe_tess_spacing ts_spacing,
-                bool tes_vertex_order_cw, bool tes_point_mode)
+      /// Only the factors read by the domain are compared: the others are
+      /// whatever the TCS left in them and don't change the output.
+      bool MatchFactors(const pattern *pat,
+                        const struct pipe_tessellation_factors *tess_factors) const
       {
-         static PIPE_TESSELLATOR_PARTITIONING CVT_TS_D3D_PARTITIONING[] = {
-                                                                            PIPE_TESSELLATOR_PARTITIONING_FRACTIONAL_ODD,  // PIPE_TESS_SPACING_ODD
-                                                                            PIPE_TESSELLATOR_PARTITIONING_FRACTIONAL_EVEN, // PIPE_TESS_SPACING_EVEN
-                                                                            PIPE_TESSELLATOR_PARTITIONING_INTEGER,         // PIPE_TESS_SPACING_EQUAL
-         };
-
-         PIPE_TESSELLATOR_OUTPUT_PRIMITIVE out_prim;
-         if (tes_point_mode)
-            out_prim = PIPE_TESSELLATOR_OUTPUT_POINT;
-         else if (tes_prim_mode == PIPE_PRIM_LINES)
-            out_prim = PIPE_TESSELLATOR_OUTPUT_LINE;
-         else if (tes_vertex_order_cw)
-            out_prim = PIPE_TESSELLATOR_OUTPUT_TRIANGLE_CW;
-         else
-            out_prim = PIPE_TESSELLATOR_OUTPUT_TRIANGLE_CCW;
-
-         SUPER::Init(CVT_TS_D3D_PARTITIONING[ts_spacing],
-                     out_prim);
+         return !memcmp(pat->outer_tf, tess_factors->outer_tf, num_outer_tf * sizeof(float)) &&
+                !memcmp(pat->inner_tf, tess_factors->inner_tf, num_inner_tf * sizeof(float));
+      }
 
-         prim_mode          = tes_prim_mode;
-         num_domain_points = 0;
+      /// Move patterns[idx] to the front of the MRU list.
+      void Touch(unsigned idx)
+      {
+         if (idx == 0)
+            return;
+         pattern tmp = patterns[idx];
+         memmove(&patterns[1], &patterns[0], idx * sizeof(pattern));
+         patterns[0] = tmp;
       }
 
-      void Tessellate(const struct pipe_tessellation_factors *tess_factors,
-                      struct pipe_tessellator_data *tess_data)
+      /// Run the reference tessellator and record its output in a pattern
+      /// slot, recycling the least recently used one when the list is full.
+      bool Generate(const struct pipe_tessellation_factors *tess_factors)
       {
          switch (prim_mode)
             {
@@ -103,23 +118,143 @@ namespace pipe_tessellator_wrap
 
             default:
                assert(0);
-               return;
+               return false;
             }
 
-         num_domain_points = (uint32_t)SUPER::GetPointCount();
+         unsigned idx = num_patterns < PATTERN_CACHE_SIZE ? num_patterns++ :
+                                                            PATTERN_CACHE_SIZE - 1;
+         pattern *pat = &patterns[idx];
+         uint32_t num_points = (uint32_t)SUPER::GetPointCount();
+         uint32_t num_indices = (uint32_t)SUPER::GetIndexCount();
+
+         if (num_points > pat->max_domain_points) {
+            align_free(pat->domain_points_u);
+            align_free(pat->domain_points_v);
+            pat->domain_points_u = (float *)align_malloc(num_points * sizeof(float), 32);
+            pat->domain_points_v = (float *)align_malloc(num_points * sizeof(float), 32);
+            pat->max_domain_points = num_points;
+         }
+         if (num_indices > pat->max_indices) {
+            FREE(pat->indices);
+            pat->indices = (uint32_t *)MALLOC(num_indices * sizeof(uint32_t));
+            pat->max_indices = num_indices;
+         }
+         if ((num_points && (!pat->domain_points_u || !pat->domain_points_v)) ||
+             (num_indices && !pat->indices)) {
+            FreePattern(pat);
+            num_patterns--;
+            return false;
+         }
 
          DOMAIN_POINT *points = SUPER::GetPoints();
-         for (uint32_t i = 0; i < num_domain_points; i++) {
-            domain_points_u[i] = points[i].u;
-            domain_points_v[i] = points[i].v;
+         for (uint32_t i = 0; i < num_points; i++) {
+            pat->domain_points_u[i] = points[i].u;
+            pat->domain_points_v[i] = points[i].v;
          }
-         tess_data->num_domain_points = num_domain_points;
-         tess_data->domain_points_u = &domain_points_u[0];
-         tess_data->domain_points_v = &domain_points_v[0];
+         if (num_indices)
+            memcpy(pat->indices, SUPER::GetIndices(), num_indices * sizeof(uint32_t));
 
-         tess_data->num_indices = (uint32_t)SUPER::GetIndexCount();
+         memset(pat->outer_tf, 0, sizeof(pat->outer_tf));
+         memset(pat->inner_tf, 0, sizeof(pat->inner_tf));
+         memcpy(pat->outer_tf, tess_factors->outer_tf, num_outer_tf * sizeof(float));
+         memcpy(pat->inner_tf, tess_factors->inner_tf, num_inner_tf * sizeof(float));
+         pat->num_domain_points = num_points;
+         pat->num_indices = num_indices;
+         Touch(idx);
+         return true;
+      }
 
-         tess_data->indices = (uint32_t*)SUPER::GetIndices();
+      static void FreePattern(pattern *pat)
+      {
+         align_free(pat->domain_points_u);
+         align_free(pat->domain_points_v);
+         FREE(pat->indices);
+         memset(pat, 0, sizeof(*pat));
+      }
+
+   public:
+      void Init(enum pipe_prim_type tes_prim_mode,
+                enum pipe_tess_spacing ts_spacing,
+                bool tes_vertex_order_cw, bool tes_point_mode)
+      {
+         static PIPE_TESSELLATOR_PARTITIONING CVT_TS_D3D_PARTITIONING[] = {
+                                                                            PIPE_TESSELLATOR_PARTITIONING_FRACTIONAL_ODD,  // PIPE_TESS_SPACING_ODD
+                                                                            PIPE_TESSELLATOR_PARTITIONING_FRACTIONAL_EVEN, // PIPE_TESS_SPACING_EVEN
+                                                                            PIPE_TESSELLATOR_PARTITIONING_INTEGER,         // PIPE_TESS_SPACING_EQUAL
+         };
+
+         PIPE_TESSELLATOR_OUTPUT_PRIMITIVE out_prim;
+         if (tes_point_mode)
+            out_prim = PIPE_TESSELLATOR_OUTPUT_POINT;
+         else if (tes_prim_mode == PIPE_PRIM_LINES)
+            out_prim = PIPE_TESSELLATOR_OUTPUT_LINE;
+         else if (tes_vertex_order_cw)
+            out_prim = PIPE_TESSELLATOR_OUTPUT_TRIANGLE_CW;
+         else
+            out_prim = PIPE_TESSELLATOR_OUTPUT_TRIANGLE_CCW;
+
+         SUPER::Init(CVT_TS_D3D_PARTITIONING[ts_spacing],
+                     out_prim);
+
+         switch (tes_prim_mode) {
+         case PIPE_PRIM_QUADS:
+            num_outer_tf = 4;
+            num_inner_tf = 2;
+            break;
+         case PIPE_PRIM_TRIANGLES:
+            num_outer_tf = 3;
+            num_inner_tf = 1;
+            break;
+         default:
+            num_outer_tf = 2;
+            num_inner_tf = 0;
+            break;
+         }
+
+         prim_mode          = tes_prim_mode;
+         num_patterns       = 0;
+         num_calls          = 0;
+         num_hits           = 0;
+         memset(patterns, 0, sizeof(patterns));
+      }
+
+      ~pipe_ts()
+      {
+         for (unsigned i = 0; i < PATTERN_CACHE_SIZE; i++)
+            FreePattern(&patterns[i]);
+      }
+
+      void Tessellate(const struct pipe_tessellation_factors *tess_factors,
+                      struct pipe_tessellator_data *tess_data)
+      {
+         unsigned i;
+
+         num_calls++;
+         for (i = 0; i < num_patterns; i++) {
+            if (MatchFactors(&patterns[i], tess_factors))
+               break;
+         }
+
+         if (i < num_patterns) {
+            num_hits++;
+            Touch(i);
+         } else if (!Generate(tess_factors)) {
+            memset(tess_data, 0, sizeof(*tess_data));
+            return;
+         }
+
+         const pattern *pat = &patterns[0];
+         tess_data->num_domain_points = pat->num_domain_points;
+         tess_data->domain_points_u = pat->domain_points_u;
+         tess_data->domain_points_v = pat->domain_points_v;
+         tess_data->num_indices = pat->num_indices;
+         tess_data->indices = pat->indices;
+      }
+
+      void GetStats(uint64_t *calls, uint64_t *hits) const
+      {
+         *calls = num_calls;
+         *hits = num_hits;
       }
    };
 } // namespace Tessellator
@@ -163,3 +298,13 @@ void p_tessellate(struct pipe_tessellator *pipe_tess,
    tessellator->Tessellate(tess_factors, tess_data);
 }
 
+
+/* query pattern cache statistics */
+void p_tess_get_stats(struct pipe_tessellator *pipe_tess,
+                      uint64_t *calls, uint64_t *hits)
+{
+   using pipe_tessellator_wrap::pipe_ts;
+   pipe_ts *tessellator = (pipe_ts*)pipe_tess;
+
+   tessellator->GetStats(calls, hits);
+}
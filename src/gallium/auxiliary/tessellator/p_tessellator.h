@@ -59,10 +59,16 @@ void p_tess_destroy(struct pipe_tessellator *pipe_ts);
 
 
 /// Perform Tessellation
+/// The returned arrays are owned by the tessellator and stay valid until the
+/// next call.  Results for recently seen factors are served from a cache.
 void p_tessellate(struct pipe_tessellator *pipe_ts,
                   const struct pipe_tessellation_factors *tess_factors,
                   struct pipe_tessellator_data *tess_data);
 
+/// Number of p_tessellate calls so far, and how many of them hit the cache
+void p_tess_get_stats(struct pipe_tessellator *pipe_ts,
+                      uint64_t *calls, uint64_t *hits);
+
 #ifdef __cplusplus
 }
 #endif
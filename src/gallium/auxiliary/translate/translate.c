@@ -46,6 +46,13 @@ struct translate *translate_create( const struct translate_key *key )
    (void)translate;
 #endif
 
+#ifdef DRAW_LLVM_AVAILABLE
+   /* Costlier to build, but fast for everything translate_sse rejects. */
+   translate = translate_llvm_create( key );
+   if (translate)
+      return translate;
+#endif
+
    return translate_generic_create( key );
 }
 
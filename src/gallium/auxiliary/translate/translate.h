@@ -169,6 +169,10 @@ static inline void translate_key_sanitize( struct translate_key *a )
  */
 struct translate *translate_sse2_create( const struct translate_key *key );
 
+#ifdef DRAW_LLVM_AVAILABLE
+struct translate *translate_llvm_create( const struct translate_key *key );
+#endif
+
 struct translate *translate_generic_create( const struct translate_key *key );
 
 boolean translate_generic_is_output_format_supported(enum pipe_format format);
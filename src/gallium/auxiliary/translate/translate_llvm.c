@@ -0,0 +1,1061 @@
+/**************************************************************************
+ *
+ * Copyright 2023 The Mesa Authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Vertex translation with gallivm.
+ *
+ * All elements of the key are compiled into one function per index size.
+ * Each loop iteration handles a full native vector of vertices: the
+ * attributes are fetched in SoA form with lp_build_fetch_rgba_soa (which
+ * uses hardware gathers where available), converted per channel and then
+ * scattered to the output vertices.  Lanes past the end of the run are
+ * clamped to the last vertex, so the tail needs no masking; those lanes
+ * simply store the last vertex again.
+ *
+ * Values are clamped to the range of the destination channel.  Conversion
+ * to normalized channels rounds to nearest, like util_format packing does,
+ * while scaled channels truncate like translate_generic.
+ */
+
+
+#include "pipe/p_config.h"
+#include "pipe/p_compiler.h"
+#include "util/u_memory.h"
+#include "util/u_math.h"
+#include "util/format/u_format.h"
+
+#include "gallivm/lp_bld_arit.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_conv.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_format.h"
+#include "gallivm/lp_bld_gather.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_intr.h"
+#include "gallivm/lp_bld_pack.h"
+#include "gallivm/lp_bld_struct.h"
+#include "gallivm/lp_bld_swizzle.h"
+#include "gallivm/lp_bld_type.h"
+
+#include "translate.h"
+
+
+struct translate_llvm_buffer
+{
+   const uint8_t *base_ptr;
+   unsigned stride;
+   unsigned max_index;
+};
+
+enum {
+   TRANSLATE_LLVM_BUFFER_BASE_PTR = 0,
+   TRANSLATE_LLVM_BUFFER_STRIDE,
+   TRANSLATE_LLVM_BUFFER_MAX_INDEX,
+   TRANSLATE_LLVM_BUFFER_NUM_FIELDS
+};
+
+enum translate_llvm_variant {
+   TRANSLATE_LLVM_LINEAR = 0,
+   TRANSLATE_LLVM_ELTS8,
+   TRANSLATE_LLVM_ELTS16,
+   TRANSLATE_LLVM_ELTS,
+   TRANSLATE_LLVM_NUM_VARIANTS
+};
+
+typedef void
+(*translate_llvm_func)(const struct translate_llvm_buffer *buffers,
+                       const void *elts,
+                       unsigned start,
+                       unsigned count,
+                       unsigned start_instance,
+                       unsigned instance_id,
+                       void *output_buffer);
+
+struct translate_llvm
+{
+   struct translate translate;
+
+   struct translate_llvm_buffer buffer[TRANSLATE_MAX_ATTRIBS];
+   unsigned nr_buffers;
+
+   /*
+    * Each variant is compiled on first use, most users only ever run
+    * one of them.
+    */
+   LLVMContextRef context;
+   struct gallivm_state *gallivm[TRANSLATE_LLVM_NUM_VARIANTS];
+   translate_llvm_func func[TRANSLATE_LLVM_NUM_VARIANTS];
+
+   /*
+    * Runs everything once a variant failed to compile, as the failure
+    * can't be reported from inside a draw.
+    */
+   struct translate *fallback;
+};
+
+
+/**
+ * State shared by the code generation of all elements in one loop
+ * iteration.
+ */
+struct translate_llvm_iter
+{
+   struct lp_build_context fbld;     /* float32 x length */
+   struct lp_build_context ibld;     /* int32 x length */
+   struct lp_build_context ubld;     /* uint32 x length */
+   unsigned length;
+
+   LLVMValueRef base_ptr[TRANSLATE_MAX_ATTRIBS];
+   LLVMValueRef stride[TRANSLATE_MAX_ATTRIBS];
+   LLVMValueRef max_index[TRANSLATE_MAX_ATTRIBS];
+   LLVMValueRef instance_index[TRANSLATE_MAX_ATTRIBS];
+   LLVMValueRef instance_id;
+
+   LLVMValueRef index;               /* vertex indices, uint32 x length */
+   LLVMValueRef dst[LP_MAX_VECTOR_LENGTH];
+};
+
+
+static struct translate_llvm *
+translate_llvm(struct translate *translate)
+{
+   return (struct translate_llvm *)translate;
+}
+
+
+static void
+store_lanes(struct gallivm_state *gallivm,
+            struct translate_llvm_iter *it,
+            unsigned offset,
+            LLVMValueRef value)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef elem_type = LLVMGetElementType(LLVMTypeOf(value));
+   LLVMTypeRef ptr_type = LLVMPointerType(elem_type, 0);
+   LLVMValueRef offset_val = lp_build_const_int32(gallivm, offset);
+   LLVMTypeRef i8t = LLVMInt8TypeInContext(gallivm->context);
+   unsigned j;
+
+   for (j = 0; j < it->length; j++) {
+      LLVMValueRef elem, ptr, store;
+
+      elem = LLVMBuildExtractElement(builder, value,
+                                     lp_build_const_int32(gallivm, j), "");
+      ptr = LLVMBuildGEP2(builder, i8t, it->dst[j], &offset_val, 1, "");
+      ptr = LLVMBuildBitCast(builder, ptr, ptr_type, "");
+      store = LLVMBuildStore(builder, elem, ptr);
+      LLVMSetAlignment(store, 1);
+   }
+}
+
+
+/**
+ * Convert one channel of a vector of vertices to the integer representation
+ * of an output channel.  Returns a vector of int32 with the channel value in
+ * the low bits, or of int64 for 64-bit channels.
+ */
+static LLVMValueRef
+emit_channel(struct gallivm_state *gallivm,
+             struct translate_llvm_iter *it,
+             const struct util_format_channel_description *chan_desc,
+             LLVMValueRef value)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *fbld = &it->fbld;
+   struct lp_build_context *ibld = &it->ibld;
+   const unsigned width = chan_desc->size;
+   LLVMValueRef lo, hi, res;
+
+   if (chan_desc->pure_integer) {
+      /* The key only allows integer to integer of equal or larger size. */
+      res = value;
+   }
+   else if (chan_desc->type == UTIL_FORMAT_TYPE_FLOAT) {
+      if (width == 16) {
+         res = lp_build_float_to_half(gallivm, value);
+         res = LLVMBuildBitCast(builder, res,
+                                lp_build_vec_type(gallivm,
+                                                  lp_type_int_vec(16, 16 * it->length)), "");
+         res = LLVMBuildZExt(builder, res, ibld->vec_type, "");
+      }
+      else if (width == 64) {
+         /*
+          * Extend in 128-bit pieces, llvm fails to select wider extends
+          * of values which were just truncated from double.
+          */
+         struct lp_type dtype = lp_type_float_vec(64, 128);
+         struct lp_type qtype = lp_type_int_vec(64, 128);
+         LLVMValueRef parts[LP_MAX_VECTOR_LENGTH / 2];
+         unsigned i;
+
+         for (i = 0; i < it->length / 2; i++) {
+            parts[i] = lp_build_extract_range(gallivm, value, i * 2, 2);
+            parts[i] = LLVMBuildFPExt(builder, parts[i],
+                                      lp_build_vec_type(gallivm, dtype), "");
+            parts[i] = LLVMBuildBitCast(builder, parts[i],
+                                        lp_build_vec_type(gallivm, qtype), "");
+         }
+         return lp_build_concat(gallivm, parts, qtype, it->length / 2);
+      }
+      else {
+         assert(width == 32);
+         res = LLVMBuildBitCast(builder, value, ibld->vec_type, "");
+      }
+   }
+   else if (chan_desc->normalized) {
+      const boolean is_signed = chan_desc->type == UTIL_FORMAT_TYPE_SIGNED;
+      const double scale = is_signed ? (double)((1ull << (width - 1)) - 1)
+                                     : (double)((1ull << width) - 1);
+      char intrin[32];
+
+      lo = is_signed ? lp_build_const_vec(gallivm, fbld->type, -1.0)
+                     : fbld->zero;
+      value = lp_build_clamp(fbld, value, lo, fbld->one);
+      value = LLVMBuildFMul(builder, value,
+                            lp_build_const_vec(gallivm, fbld->type, scale), "");
+      lp_format_intrinsic(intrin, sizeof intrin, "llvm.rint", fbld->vec_type);
+      value = lp_build_intrinsic_unary(builder, intrin, fbld->vec_type, value);
+
+      if (width == 32) {
+         /* the scale itself rounds up to 2^32 or 2^31 in a float */
+         hi = lp_build_const_vec(gallivm, fbld->type,
+                                 is_signed ? 2147483520.0 : 4294967040.0);
+         value = lp_build_min(fbld, value, hi);
+      }
+
+      if (is_signed)
+         res = LLVMBuildFPToSI(builder, value, ibld->vec_type, "");
+      else
+         res = LLVMBuildFPToUI(builder, value, ibld->vec_type, "");
+   }
+   else if (chan_desc->type == UTIL_FORMAT_TYPE_FIXED) {
+      assert(width == 32);
+      lo = lp_build_const_vec(gallivm, fbld->type, -32768.0);
+      hi = lp_build_const_vec(gallivm, fbld->type, 32767.998046875);
+      value = lp_build_clamp(fbld, value, lo, hi);
+      value = LLVMBuildFMul(builder, value,
+                            lp_build_const_vec(gallivm, fbld->type, 65536.0), "");
+      res = LLVMBuildFPToSI(builder, value, ibld->vec_type, "");
+   }
+   else {
+      /*
+       * Scaled.  For 32-bit channels, clamp to the largest floats which
+       * still convert without overflow.
+       */
+      if (chan_desc->type == UTIL_FORMAT_TYPE_SIGNED) {
+         lo = lp_build_const_vec(gallivm, fbld->type,
+                                 -(double)(1ull << (width - 1)));
+         hi = lp_build_const_vec(gallivm, fbld->type,
+                                 width == 32 ? 2147483520.0 :
+                                 (double)((1ull << (width - 1)) - 1));
+         value = lp_build_clamp(fbld, value, lo, hi);
+         res = LLVMBuildFPToSI(builder, value, ibld->vec_type, "");
+      }
+      else {
+         hi = lp_build_const_vec(gallivm, fbld->type,
+                                 width == 32 ? 4294967040.0 :
+                                 (double)((1ull << width) - 1));
+         value = lp_build_clamp(fbld, value, fbld->zero, hi);
+         res = LLVMBuildFPToUI(builder, value, ibld->vec_type, "");
+      }
+   }
+
+   if (width < 32) {
+      res = LLVMBuildAnd(builder, res,
+                         lp_build_const_int_vec(gallivm, ibld->type,
+                                                (1u << width) - 1), "");
+   }
+
+   return res;
+}
+
+
+/**
+ * Convert SoA rgba values to the output format and store them to the
+ * vertices of this iteration.
+ */
+static void
+emit_rgba(struct gallivm_state *gallivm,
+          struct translate_llvm_iter *it,
+          const struct util_format_description *desc,
+          unsigned offset,
+          const LLVMValueRef rgba[4])
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef chans[4];
+   boolean packed = FALSE;
+   boolean uniform = TRUE;
+   unsigned c, k;
+
+   for (c = 0; c < desc->nr_channels; c++) {
+      const struct util_format_channel_description *chan_desc =
+         &desc->channel[c];
+      LLVMValueRef value = NULL;
+
+      chans[c] = NULL;
+      if (chan_desc->type == UTIL_FORMAT_TYPE_VOID) {
+         uniform = FALSE;
+         continue;
+      }
+
+      if (chan_desc->size % 8 || chan_desc->shift % 8)
+         packed = TRUE;
+      if (chan_desc->size != desc->channel[0].size ||
+          chan_desc->shift != c * chan_desc->size)
+         uniform = FALSE;
+
+      for (k = 0; k < 4; k++) {
+         if (desc->swizzle[k] == c) {
+            value = rgba[k];
+            break;
+         }
+      }
+      if (!value) {
+         value = chan_desc->pure_integer ? it->ibld.zero : it->fbld.zero;
+      }
+
+      chans[c] = emit_channel(gallivm, it, chan_desc, value);
+   }
+
+   if (packed) {
+      /* bitfield formats, all of which fit in 32 bits */
+      LLVMValueRef res = it->ibld.zero;
+      struct lp_type type = lp_type_int_vec(desc->block.bits,
+                                            desc->block.bits * it->length);
+
+      for (c = 0; c < desc->nr_channels; c++) {
+         LLVMValueRef chan = chans[c];
+
+         if (!chan)
+            continue;
+         if (desc->channel[c].shift) {
+            chan = LLVMBuildShl(builder, chan,
+                                lp_build_const_int_vec(gallivm, it->ibld.type,
+                                                       desc->channel[c].shift), "");
+         }
+         res = LLVMBuildOr(builder, res, chan, "");
+      }
+
+      if (desc->block.bits < 32) {
+         res = LLVMBuildTrunc(builder, res,
+                              lp_build_vec_type(gallivm, type), "");
+      }
+      store_lanes(gallivm, it, offset, res);
+      return;
+   }
+
+   for (c = 0; c < desc->nr_channels; c++) {
+      const unsigned width = desc->channel[c].size;
+      struct lp_type type = lp_type_int_vec(width, width * it->length);
+
+      if (!chans[c])
+         continue;
+      if (width < 32) {
+         chans[c] = LLVMBuildTrunc(builder, chans[c],
+                                   lp_build_vec_type(gallivm, type), "");
+      }
+   }
+
+   if (uniform && desc->nr_channels > 1) {
+      /*
+       * Array formats: transpose to one small vector per vertex so every
+       * vertex is written with a single store.
+       */
+      LLVMTypeRef elem_type = LLVMGetElementType(LLVMTypeOf(chans[0]));
+      LLVMTypeRef vert_type = LLVMVectorType(elem_type, desc->nr_channels);
+      LLVMTypeRef ptr_type = LLVMPointerType(vert_type, 0);
+      LLVMValueRef offset_val = lp_build_const_int32(gallivm, offset);
+      LLVMTypeRef i8t = LLVMInt8TypeInContext(gallivm->context);
+      unsigned j;
+
+      for (j = 0; j < it->length; j++) {
+         LLVMValueRef lane = lp_build_const_int32(gallivm, j);
+         LLVMValueRef vert = LLVMGetUndef(vert_type);
+         LLVMValueRef ptr, store;
+
+         for (c = 0; c < desc->nr_channels; c++) {
+            LLVMValueRef elem = LLVMBuildExtractElement(builder, chans[c],
+                                                        lane, "");
+            vert = LLVMBuildInsertElement(builder, vert, elem,
+                                          lp_build_const_int32(gallivm, c), "");
+         }
+         ptr = LLVMBuildGEP2(builder, i8t, it->dst[j], &offset_val, 1, "");
+         ptr = LLVMBuildBitCast(builder, ptr, ptr_type, "");
+         store = LLVMBuildStore(builder, vert, ptr);
+         LLVMSetAlignment(store, 1);
+      }
+      return;
+   }
+
+   for (c = 0; c < desc->nr_channels; c++) {
+      if (chans[c])
+         store_lanes(gallivm, it, offset + desc->channel[c].shift / 8, chans[c]);
+   }
+}
+
+
+static void
+emit_element(struct gallivm_state *gallivm,
+             struct translate_llvm_iter *it,
+             const struct translate_element *element,
+             unsigned elem_nr)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct util_format_description *out_desc =
+      util_format_description(element->output_format);
+   const struct util_format_description *in_desc =
+      util_format_description(element->input_format);
+   struct lp_build_context *ubld = &it->ubld;
+   LLVMValueRef rgba[4];
+   LLVMValueRef index, offsets, base_ptr;
+   struct lp_type fetch_type;
+   unsigned buf, j;
+
+   if (element->type == TRANSLATE_ELEMENT_INSTANCE_ID) {
+      if (element->output_format == PIPE_FORMAT_R32_USCALED ||
+          element->output_format == PIPE_FORMAT_R32_SSCALED) {
+         /* the raw id, as translate_generic does */
+         store_lanes(gallivm, it, element->output_offset,
+                     lp_build_broadcast_scalar(ubld, it->instance_id));
+         return;
+      }
+
+      if (out_desc->channel[0].pure_integer) {
+         rgba[0] = lp_build_broadcast_scalar(&it->ibld, it->instance_id);
+         rgba[1] = it->ibld.zero;
+         rgba[2] = it->ibld.zero;
+         rgba[3] = it->ibld.one;
+      }
+      else {
+         rgba[0] = LLVMBuildUIToFP(builder,
+                                   lp_build_broadcast_scalar(ubld, it->instance_id),
+                                   it->fbld.vec_type, "");
+         rgba[1] = it->fbld.zero;
+         rgba[2] = it->fbld.zero;
+         rgba[3] = it->fbld.one;
+      }
+      emit_rgba(gallivm, it, out_desc, element->output_offset, rgba);
+      return;
+   }
+
+   buf = element->input_buffer;
+
+   if (element->instance_divisor) {
+      index = lp_build_broadcast_scalar(ubld, it->instance_index[elem_nr]);
+   }
+   else {
+      /* clamp to avoid going out of bounds */
+      index = lp_build_min(ubld, it->index,
+                           lp_build_broadcast_scalar(ubld, it->max_index[buf]));
+   }
+
+   /* This mul can overflow. Wraparound is ok. */
+   offsets = LLVMBuildMul(builder, index,
+                          lp_build_broadcast_scalar(ubld, it->stride[buf]), "");
+
+   base_ptr = it->base_ptr[buf];
+   if (element->input_offset) {
+      LLVMValueRef input_offset =
+         lp_build_const_int32(gallivm, element->input_offset);
+      base_ptr = LLVMBuildGEP2(builder, LLVMInt8TypeInContext(gallivm->context),
+                               base_ptr, &input_offset, 1, "");
+   }
+
+   if (element->input_format == element->output_format &&
+       !(in_desc->block.bits & 7)) {
+      /* straight copy */
+      LLVMTypeRef i8t = LLVMInt8TypeInContext(gallivm->context);
+      LLVMTypeRef vert_type = LLVMVectorType(i8t, in_desc->block.bits / 8);
+      LLVMTypeRef ptr_type = LLVMPointerType(vert_type, 0);
+      LLVMValueRef output_offset =
+         lp_build_const_int32(gallivm, element->output_offset);
+
+      for (j = 0; j < it->length; j++) {
+         LLVMValueRef lane = lp_build_const_int32(gallivm, j);
+         LLVMValueRef offset, src, dst, load, store;
+
+         offset = LLVMBuildExtractElement(builder, offsets, lane, "");
+         src = LLVMBuildGEP2(builder, i8t, base_ptr, &offset, 1, "");
+         src = LLVMBuildBitCast(builder, src, ptr_type, "");
+         load = LLVMBuildLoad2(builder, vert_type, src, "");
+         LLVMSetAlignment(load, 1);
+
+         dst = LLVMBuildGEP2(builder, i8t, it->dst[j], &output_offset, 1, "");
+         dst = LLVMBuildBitCast(builder, dst, ptr_type, "");
+         store = LLVMBuildStore(builder, load, dst);
+         LLVMSetAlignment(store, 1);
+      }
+      return;
+   }
+
+   if (in_desc->channel[0].pure_integer) {
+      if (in_desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED)
+         fetch_type = it->ibld.type;
+      else
+         fetch_type = it->ubld.type;
+   }
+   else {
+      fetch_type = it->fbld.type;
+   }
+
+   lp_build_fetch_rgba_soa(gallivm, in_desc, fetch_type, FALSE,
+                           base_ptr, offsets,
+                           ubld->zero, ubld->zero,
+                           NULL, rgba);
+
+   /* The type handling is annoying here... */
+   for (j = 0; j < 4; j++) {
+      rgba[j] = LLVMBuildBitCast(builder, rgba[j],
+                                 in_desc->channel[0].pure_integer ?
+                                 it->ibld.vec_type : it->fbld.vec_type, "");
+   }
+
+   emit_rgba(gallivm, it, out_desc, element->output_offset, rgba);
+}
+
+
+static LLVMTypeRef
+create_buffer_type(struct gallivm_state *gallivm)
+{
+   LLVMTargetDataRef target = gallivm->target;
+   LLVMTypeRef elem_types[TRANSLATE_LLVM_BUFFER_NUM_FIELDS];
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(gallivm->context);
+   LLVMTypeRef buffer_type;
+
+   elem_types[TRANSLATE_LLVM_BUFFER_BASE_PTR] =
+      LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+   elem_types[TRANSLATE_LLVM_BUFFER_STRIDE] = int32_type;
+   elem_types[TRANSLATE_LLVM_BUFFER_MAX_INDEX] = int32_type;
+
+   buffer_type = LLVMStructTypeInContext(gallivm->context, elem_types,
+                                         ARRAY_SIZE(elem_types), 0);
+
+   (void) target; /* silence unused var warning for non-debug build */
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_buffer, base_ptr,
+                          target, buffer_type,
+                          TRANSLATE_LLVM_BUFFER_BASE_PTR);
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_buffer, stride,
+                          target, buffer_type,
+                          TRANSLATE_LLVM_BUFFER_STRIDE);
+   LP_CHECK_MEMBER_OFFSET(struct translate_llvm_buffer, max_index,
+                          target, buffer_type,
+                          TRANSLATE_LLVM_BUFFER_MAX_INDEX);
+   LP_CHECK_STRUCT_SIZE(struct translate_llvm_buffer,
+                        target, buffer_type);
+
+   return buffer_type;
+}
+
+
+static LLVMValueRef
+generate_run(struct translate_llvm *p,
+             struct gallivm_state *gallivm,
+             enum translate_llvm_variant variant)
+{
+   static const unsigned index_sizes[TRANSLATE_LLVM_NUM_VARIANTS] = {
+      0, 1, 2, 4
+   };
+   static const char *func_names[TRANSLATE_LLVM_NUM_VARIANTS] = {
+      "translate_run_linear",
+      "translate_run_elts8",
+      "translate_run_elts16",
+      "translate_run_elts"
+   };
+   const unsigned index_size = index_sizes[variant];
+   LLVMContextRef context = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct translate_key *key = &p->translate.key;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(context);
+   LLVMTypeRef i8_type = LLVMInt8TypeInContext(context);
+   LLVMTypeRef i8_ptr_type = LLVMPointerType(i8_type, 0);
+   LLVMTypeRef arg_types[7];
+   LLVMTypeRef func_type;
+   LLVMValueRef func, buffers, elts, start, count, start_instance, out;
+   LLVMValueRef lane_ids[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef last, lanes, vertex, out_offsets;
+   LLVMBasicBlockRef block;
+   struct lp_build_for_loop_state loop;
+   struct translate_llvm_iter it;
+   LLVMTypeRef buffer_type = create_buffer_type(gallivm);
+   struct lp_type uint_type;
+   unsigned i;
+
+   arg_types[0] = LLVMPointerType(buffer_type, 0);   /* buffers */
+   arg_types[1] = i8_ptr_type;                       /* elts */
+   arg_types[2] = int32_type;                        /* start */
+   arg_types[3] = int32_type;                        /* count */
+   arg_types[4] = int32_type;                        /* start_instance */
+   arg_types[5] = int32_type;                        /* instance_id */
+   arg_types[6] = i8_ptr_type;                       /* output_buffer */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                arg_types, ARRAY_SIZE(arg_types), 0);
+   func = LLVMAddFunction(gallivm->module, func_names[variant], func_type);
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+   for (i = 0; i < ARRAY_SIZE(arg_types); ++i)
+      if (LLVMGetTypeKind(arg_types[i]) == LLVMPointerTypeKind)
+         lp_add_function_attr(func, i + 1, LP_FUNC_ATTR_NOALIAS);
+
+   buffers        = LLVMGetParam(func, 0);
+   elts           = LLVMGetParam(func, 1);
+   start          = LLVMGetParam(func, 2);
+   count          = LLVMGetParam(func, 3);
+   start_instance = LLVMGetParam(func, 4);
+   it.instance_id = LLVMGetParam(func, 5);
+   out            = LLVMGetParam(func, 6);
+
+   lp_build_name(buffers, "buffers");
+   lp_build_name(elts, "elts");
+   lp_build_name(start, "start");
+   lp_build_name(count, "count");
+   lp_build_name(start_instance, "start_instance");
+   lp_build_name(it.instance_id, "instance_id");
+   lp_build_name(out, "output_buffer");
+
+   block = LLVMAppendBasicBlockInContext(context, func, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   it.length = lp_native_vector_width / 32;
+   uint_type = lp_type_uint_vec(32, 32 * it.length);
+   lp_build_context_init(&it.fbld, gallivm, lp_type_float_vec(32, 32 * it.length));
+   lp_build_context_init(&it.ibld, gallivm, lp_type_int_vec(32, 32 * it.length));
+   lp_build_context_init(&it.ubld, gallivm, uint_type);
+
+   /*
+    * Everything which doesn't depend on the vertex is loaded or computed
+    * once, outside the loop.
+    */
+   for (i = 0; i < p->nr_buffers; i++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, i);
+      LLVMValueRef buf_ptr = LLVMBuildGEP2(builder, buffer_type, buffers,
+                                           &index, 1, "");
+
+      it.base_ptr[i] = lp_build_struct_get2(gallivm, buffer_type, buf_ptr,
+                                            TRANSLATE_LLVM_BUFFER_BASE_PTR,
+                                            "base_ptr");
+      it.stride[i] = lp_build_struct_get2(gallivm, buffer_type, buf_ptr,
+                                          TRANSLATE_LLVM_BUFFER_STRIDE,
+                                          "stride");
+      it.max_index[i] = lp_build_struct_get2(gallivm, buffer_type, buf_ptr,
+                                             TRANSLATE_LLVM_BUFFER_MAX_INDEX,
+                                             "max_index");
+   }
+
+   for (i = 0; i < key->nr_elements; i++) {
+      const struct translate_element *element = &key->element[i];
+
+      it.instance_index[i] = NULL;
+      if (element->type == TRANSLATE_ELEMENT_NORMAL &&
+          element->instance_divisor) {
+         /*
+          * XXX like translate_generic this isn't clamped, we'd need a
+          * per-array max value.
+          */
+         LLVMValueRef divisor =
+            lp_build_const_int32(gallivm, element->instance_divisor);
+         it.instance_index[i] =
+            LLVMBuildAdd(builder, start_instance,
+                         LLVMBuildUDiv(builder, it.instance_id, divisor, ""),
+                         "");
+      }
+   }
+
+   for (i = 0; i < it.length; i++)
+      lane_ids[i] = lp_build_const_int32(gallivm, i);
+   lanes = LLVMConstVector(lane_ids, it.length);
+
+   lp_build_for_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0),
+                           LLVMIntULT, count,
+                           lp_build_const_int32(gallivm, it.length));
+   {
+      /* vertices past the end repeat the last one */
+      last = LLVMBuildSub(builder, count, lp_build_const_int32(gallivm, 1), "");
+      vertex = LLVMBuildAdd(builder,
+                            lp_build_broadcast_scalar(&it.ubld, loop.counter),
+                            lanes, "");
+      vertex = lp_build_min(&it.ubld, vertex,
+                            lp_build_broadcast_scalar(&it.ubld, last));
+
+      if (index_size) {
+         LLVMValueRef elt_offsets =
+            LLVMBuildMul(builder, vertex,
+                         lp_build_const_int_vec(gallivm, uint_type, index_size), "");
+         it.index = lp_build_gather(gallivm, it.length, index_size * 8,
+                                    lp_type_uint(32), FALSE,
+                                    elts, elt_offsets, FALSE);
+      }
+      else {
+         it.index = LLVMBuildAdd(builder, vertex,
+                                 lp_build_broadcast_scalar(&it.ubld, start), "");
+      }
+
+      out_offsets = LLVMBuildMul(builder, vertex,
+                                 lp_build_const_int_vec(gallivm, uint_type,
+                                                        key->output_stride), "");
+      for (i = 0; i < it.length; i++) {
+         LLVMValueRef offset =
+            LLVMBuildExtractElement(builder, out_offsets,
+                                    lp_build_const_int32(gallivm, i), "");
+         it.dst[i] = LLVMBuildGEP2(builder, i8_type, out, &offset, 1, "");
+      }
+
+      for (i = 0; i < key->nr_elements; i++)
+         emit_element(gallivm, &it, &key->element[i], i);
+   }
+   lp_build_for_loop_end(&loop);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+static void
+translate_llvm_create_fallback(struct translate_llvm *p)
+{
+   unsigned i;
+
+   p->fallback = translate_generic_create(&p->translate.key);
+   if (!p->fallback)
+      return;
+
+   for (i = 0; i < p->nr_buffers; i++)
+      p->fallback->set_buffer(p->fallback, i, p->buffer[i].base_ptr,
+                              p->buffer[i].stride, p->buffer[i].max_index);
+}
+
+
+/**
+ * Return the function of a variant, compiling it on first use.  Returns
+ * NULL if the fallback must be used instead.
+ */
+static translate_llvm_func
+translate_llvm_get_func(struct translate_llvm *p,
+                        enum translate_llvm_variant variant)
+{
+   struct gallivm_state *gallivm;
+   LLVMValueRef func;
+
+   if (likely(p->func[variant]))
+      return p->func[variant];
+
+   if (p->fallback)
+      return NULL;
+
+   gallivm = gallivm_create("translate", p->context, NULL);
+   if (!gallivm) {
+      translate_llvm_create_fallback(p);
+      return NULL;
+   }
+
+   func = generate_run(p, gallivm, variant);
+
+   gallivm_compile_module(gallivm);
+
+   p->func[variant] = (translate_llvm_func)gallivm_jit_function(gallivm, func);
+
+   gallivm_free_ir(gallivm);
+
+   p->gallivm[variant] = gallivm;
+
+   if (!p->func[variant])
+      translate_llvm_create_fallback(p);
+
+   return p->func[variant];
+}
+
+
+/**
+ * Whether an output channel can be generated by emit_channel.
+ */
+static boolean
+is_supported_output_channel(const struct util_format_channel_description *chan)
+{
+   switch (chan->type) {
+   case UTIL_FORMAT_TYPE_VOID:
+      return TRUE;
+   case UTIL_FORMAT_TYPE_FLOAT:
+      return chan->size == 16 || chan->size == 32 || chan->size == 64;
+   case UTIL_FORMAT_TYPE_FIXED:
+      return chan->size == 32;
+   case UTIL_FORMAT_TYPE_UNSIGNED:
+   case UTIL_FORMAT_TYPE_SIGNED:
+      return chan->size <= 32;
+   default:
+      return FALSE;
+   }
+}
+
+
+static boolean
+is_supported_element(const struct translate_element *element)
+{
+   const struct util_format_description *out_desc =
+      util_format_description(element->output_format);
+   const struct util_format_description *in_desc;
+   unsigned i;
+
+   if (!out_desc ||
+       out_desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       out_desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       out_desc->block.width != 1 || out_desc->block.height != 1 ||
+       out_desc->block.bits & 7)
+      return FALSE;
+
+   for (i = 0; i < out_desc->nr_channels; i++) {
+      if (!is_supported_output_channel(&out_desc->channel[i]))
+         return FALSE;
+      /* bitfields must fit into a dword */
+      if ((out_desc->channel[i].size % 8 || out_desc->channel[i].shift % 8) &&
+          out_desc->block.bits > 32)
+         return FALSE;
+   }
+
+   if (element->type == TRANSLATE_ELEMENT_INSTANCE_ID)
+      return TRUE;
+
+   if (element->input_buffer >= TRANSLATE_MAX_ATTRIBS)
+      return FALSE;
+
+   if (element->input_format == element->output_format)
+      return TRUE;
+
+   in_desc = util_format_description(element->input_format);
+   if (!in_desc ||
+       in_desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       (in_desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB &&
+        in_desc->colorspace != UTIL_FORMAT_COLORSPACE_SRGB) ||
+       in_desc->block.width != 1 || in_desc->block.height != 1)
+      return FALSE;
+
+   for (i = 0; i < in_desc->nr_channels; i++) {
+      /* gallivm unpacks fixed as n/65535, and has no 64-bit integers */
+      if (in_desc->channel[i].type == UTIL_FORMAT_TYPE_FIXED ||
+          (in_desc->channel[i].size == 64 &&
+           in_desc->channel[i].type != UTIL_FORMAT_TYPE_FLOAT))
+         return FALSE;
+   }
+
+   /* no conversions between pure integer and other formats */
+   if (!!in_desc->channel[0].pure_integer !=
+       !!out_desc->channel[0].pure_integer)
+      return FALSE;
+
+   if (in_desc->channel[0].pure_integer) {
+      unsigned nr = MIN2(in_desc->nr_channels, out_desc->nr_channels);
+
+      /* same rules as translate_generic */
+      for (i = 0; i < nr; i++) {
+         if (in_desc->channel[i].type != out_desc->channel[i].type ||
+             in_desc->channel[i].size > out_desc->channel[i].size)
+            return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+static void
+translate_llvm_set_buffer(struct translate *translate,
+                          unsigned buf,
+                          const void *ptr,
+                          unsigned stride,
+                          unsigned max_index)
+{
+   struct translate_llvm *p = translate_llvm(translate);
+
+   if (buf < p->nr_buffers) {
+      p->buffer[buf].base_ptr = (const uint8_t *)ptr;
+      p->buffer[buf].stride = stride;
+      p->buffer[buf].max_index = max_index;
+   }
+
+   if (unlikely(p->fallback))
+      p->fallback->set_buffer(p->fallback, buf, ptr, stride, max_index);
+}
+
+
+static void
+translate_llvm_release(struct translate *translate)
+{
+   struct translate_llvm *p = translate_llvm(translate);
+
+   unsigned i;
+
+   for (i = 0; i < TRANSLATE_LLVM_NUM_VARIANTS; i++) {
+      if (p->gallivm[i])
+         gallivm_destroy(p->gallivm[i]);
+   }
+   if (p->context)
+      LLVMContextDispose(p->context);
+   if (p->fallback)
+      p->fallback->release(p->fallback);
+
+   FREE(p);
+}
+
+
+static void PIPE_CDECL
+translate_llvm_run_elts(struct translate *translate,
+                        const unsigned *elts,
+                        unsigned count,
+                        unsigned start_instance,
+                        unsigned instance_id,
+                        void *output_buffer)
+{
+   struct translate_llvm *p = translate_llvm(translate);
+   translate_llvm_func func = translate_llvm_get_func(p, TRANSLATE_LLVM_ELTS);
+
+   if (unlikely(!func)) {
+      if (p->fallback)
+         p->fallback->run_elts(p->fallback, elts, count, start_instance,
+                               instance_id, output_buffer);
+      return;
+   }
+
+   func(p->buffer, elts, 0, count, start_instance, instance_id, output_buffer);
+}
+
+
+static void PIPE_CDECL
+translate_llvm_run_elts16(struct translate *translate,
+                          const uint16_t *elts,
+                          unsigned count,
+                          unsigned start_instance,
+                          unsigned instance_id,
+                          void *output_buffer)
+{
+   struct translate_llvm *p = translate_llvm(translate);
+   translate_llvm_func func = translate_llvm_get_func(p, TRANSLATE_LLVM_ELTS16);
+
+   if (unlikely(!func)) {
+      if (p->fallback)
+         p->fallback->run_elts16(p->fallback, elts, count, start_instance,
+                                 instance_id, output_buffer);
+      return;
+   }
+
+   func(p->buffer, elts, 0, count, start_instance, instance_id, output_buffer);
+}
+
+
+static void PIPE_CDECL
+translate_llvm_run_elts8(struct translate *translate,
+                         const uint8_t *elts,
+                         unsigned count,
+                         unsigned start_instance,
+                         unsigned instance_id,
+                         void *output_buffer)
+{
+   struct translate_llvm *p = translate_llvm(translate);
+   translate_llvm_func func = translate_llvm_get_func(p, TRANSLATE_LLVM_ELTS8);
+
+   if (unlikely(!func)) {
+      if (p->fallback)
+         p->fallback->run_elts8(p->fallback, elts, count, start_instance,
+                                instance_id, output_buffer);
+      return;
+   }
+
+   func(p->buffer, elts, 0, count, start_instance, instance_id, output_buffer);
+}
+
+
+static void PIPE_CDECL
+translate_llvm_run(struct translate *translate,
+                   unsigned start,
+                   unsigned count,
+                   unsigned start_instance,
+                   unsigned instance_id,
+                   void *output_buffer)
+{
+   struct translate_llvm *p = translate_llvm(translate);
+   translate_llvm_func func = translate_llvm_get_func(p, TRANSLATE_LLVM_LINEAR);
+
+   if (unlikely(!func)) {
+      if (p->fallback)
+         p->fallback->run(p->fallback, start, count, start_instance,
+                          instance_id, output_buffer);
+      return;
+   }
+
+   func(p->buffer, NULL, start, count, start_instance, instance_id, output_buffer);
+}
+
+
+struct translate *
+translate_llvm_create(const struct translate_key *key)
+{
+   struct translate_llvm *p;
+   unsigned i;
+
+   assert(key->nr_elements <= TRANSLATE_MAX_ATTRIBS);
+
+   /* the bitfield packing assumes little endian layouts */
+   if (UTIL_ARCH_BIG_ENDIAN)
+      return NULL;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      if (!is_supported_element(&key->element[i]))
+         return NULL;
+   }
+
+   if (!lp_build_init())
+      return NULL;
+
+   p = CALLOC_STRUCT(translate_llvm);
+   if (!p)
+      return NULL;
+
+   p->translate.key = *key;
+   p->translate.release = translate_llvm_release;
+   p->translate.set_buffer = translate_llvm_set_buffer;
+   p->translate.run_elts = translate_llvm_run_elts;
+   p->translate.run_elts16 = translate_llvm_run_elts16;
+   p->translate.run_elts8 = translate_llvm_run_elts8;
+   p->translate.run = translate_llvm_run;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      if (key->element[i].type == TRANSLATE_ELEMENT_NORMAL)
+         p->nr_buffers = MAX2(p->nr_buffers, key->element[i].input_buffer + 1);
+   }
+
+   p->context = LLVMContextCreate();
+   if (!p->context)
+      goto fail;
+#if LLVM_VERSION_MAJOR >= 15
+   LLVMContextSetOpaquePointers(p->context, false);
+#endif
+
+   return &p->translate;
+
+fail:
+   translate_llvm_release(&p->translate);
+   return NULL;
+}
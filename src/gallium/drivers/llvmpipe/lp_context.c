@@ -67,6 +67,10 @@ llvmpipe_destroy(struct pipe_context *pipe)
    mtx_unlock(&lp_screen->ctx_mutex);
    lp_print_counters();
 
+   /* Background fs builds still point at this context. */
+   if (lp_screen->async_fs_compile)
+      util_queue_finish(&lp_screen->fs_compile_queue);
+
    if (llvmpipe->csctx) {
       lp_csctx_destroy(llvmpipe->csctx);
    }
@@ -283,6 +287,9 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
    draw_set_constant_buffer_stride(llvmpipe->draw,
                                    lp_get_constant_buffer_stride(screen));
 
+   /* Large draws shade their vertices on as many threads as we rasterize. */
+   draw_set_vs_threads(llvmpipe->draw, lp_screen->num_threads);
+
    /* FIXME: devise alternative to draw_texture_samplers */
 
    llvmpipe->setup = lp_setup_create(&llvmpipe->pipe, llvmpipe->draw);
@@ -159,6 +159,9 @@ struct llvmpipe_context {
    unsigned nr_fs_variants;
    unsigned nr_fs_instrs;
 
+   /** Bound fs variant whose full version is being compiled, if any */
+   struct lp_fragment_shader_variant *fs_fallback;
+
    boolean permit_linear_rasterizer;
    boolean single_vp;
 
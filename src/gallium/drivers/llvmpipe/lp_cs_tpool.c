@@ -30,8 +30,31 @@
 
 #include "util/u_thread.h"
 #include "util/u_memory.h"
+#include "util/u_atomic.h"
+#include "util/u_math.h"
+#include "util/u_cpu_detect.h"
 #include "lp_cs_tpool.h"
 
+/**
+ * Execute chunks of iterations of the task until none are left.
+ */
+static void
+lp_cs_tpool_run_task(struct lp_cs_tpool_task *task,
+                     struct lp_cs_local_mem *lmem)
+{
+   const unsigned chunk = task->iter_per_chunk;
+
+   while (true) {
+      unsigned start = p_atomic_add_return(&task->iter_next, chunk) - chunk;
+      if (start >= task->iter_total)
+         break;
+
+      unsigned end = MIN2(start + chunk, task->iter_total);
+      for (unsigned i = start; i < end; i++)
+         task->work(task->data, i, lmem);
+   }
+}
+
 static int
 lp_cs_tpool_worker(void *data)
 {
@@ -43,7 +66,6 @@ lp_cs_tpool_worker(void *data)
 
    while (!pool->shutdown) {
       struct lp_cs_tpool_task *task;
-      unsigned iter_per_thread;
 
       while (list_is_empty(&pool->workqueue) && !pool->shutdown)
          cnd_wait(&pool->new_work, &pool->m);
@@ -54,32 +76,29 @@ lp_cs_tpool_worker(void *data)
       task = list_first_entry(&pool->workqueue, struct lp_cs_tpool_task,
                               list);
 
-      unsigned this_iter = task->iter_start;
+      /* Move the task to the back of the queue, so that the next idle
+       * thread starts on another task if there is one.
+       */
+      list_del(&task->list);
+      list_addtail(&task->list, &pool->workqueue);
+      task->num_workers++;
 
-      iter_per_thread = task->iter_per_thread;
-
-      if (task->iter_remainder &&
-          task->iter_start + task->iter_remainder == task->iter_total) {
-         task->iter_remainder--;
-         iter_per_thread = 1;
-      }
-
-      task->iter_start += iter_per_thread;
+      mtx_unlock(&pool->m);
+      lp_cs_tpool_run_task(task, &lmem);
+      mtx_lock(&pool->m);
 
-      if (task->iter_start == task->iter_total)
+      /* All iterations have been handed out, don't let any other thread
+       * pick up this task.
+       */
+      if (list_is_linked(&task->list))
          list_del(&task->list);
 
-      mtx_unlock(&pool->m);
-      for (unsigned i = 0; i < iter_per_thread; i++)
-         task->work(task->data, this_iter + i, &lmem);
-
-      mtx_lock(&pool->m);
-      task->iter_finished += iter_per_thread;
-      if (task->iter_finished == task->iter_total)
+      if (--task->num_workers == 0)
          cnd_broadcast(&task->finish);
    }
    mtx_unlock(&pool->m);
    FREE(lmem.local_mem_ptr);
+   align_free(lmem.cache);
    return 0;
 }
 
@@ -96,11 +115,24 @@ lp_cs_tpool_create(unsigned num_threads)
 
    list_inithead(&pool->workqueue);
    assert (num_threads <= LP_MAX_THREADS);
+   pool->threads = CALLOC(MAX2(1, num_threads), sizeof(*pool->threads));
+   if (!pool->threads)
+      num_threads = 0;
+
+   const struct util_cpu_caps_t *caps = util_get_cpu_caps();
    for (unsigned i = 0; i < num_threads; i++) {
       if (thrd_success != u_thread_create(pool->threads + i, lp_cs_tpool_worker, pool)) {
          num_threads = i;  /* previous thread is max */
          break;
       }
+
+      /* Spread the threads evenly over the L3 caches. */
+      if (caps->num_L3_caches > 1 && caps->L3_affinity_mask) {
+         unsigned L3_cache = i * caps->num_L3_caches / num_threads;
+         util_set_thread_affinity(pool->threads[i],
+                                  caps->L3_affinity_mask[L3_cache],
+                                  NULL, caps->num_cpu_mask_bits);
+      }
    }
    pool->num_threads = num_threads;
    return pool;
@@ -123,6 +155,7 @@ lp_cs_tpool_destroy(struct lp_cs_tpool *pool)
 
    cnd_destroy(&pool->new_work);
    mtx_destroy(&pool->m);
+   FREE(pool->threads);
    FREE(pool);
 }
 
@@ -132,6 +165,10 @@ lp_cs_tpool_queue_task(struct lp_cs_tpool *pool,
 {
    struct lp_cs_tpool_task *task;
 
+   /* Nothing to run, and no chunk size to compute */
+   if (num_iters <= 0)
+      return NULL;
+
    if (pool->num_threads == 0) {
       struct lp_cs_local_mem lmem;
 
@@ -140,6 +177,7 @@ lp_cs_tpool_queue_task(struct lp_cs_tpool *pool,
          work(data, t, &lmem);
       }
       FREE(lmem.local_mem_ptr);
+      align_free(lmem.cache);
       return NULL;
    }
    task = CALLOC_STRUCT(lp_cs_tpool_task);
@@ -151,8 +189,13 @@ lp_cs_tpool_queue_task(struct lp_cs_tpool *pool,
    task->data = data;
    task->iter_total = num_iters;
 
-   task->iter_per_thread = num_iters / pool->num_threads;
-   task->iter_remainder = num_iters % pool->num_threads;
+   /* Cut the iterations into a few chunks per thread (the waiting thread
+    * included), small enough to even out workgroups of uneven cost, large
+    * enough to keep the atomic traffic low.
+    */
+   unsigned num_chunks = MIN2(MAX2(num_iters, 1), (pool->num_threads + 1) * 4);
+   task->iter_per_chunk = DIV_ROUND_UP(num_iters, num_chunks);
+   num_chunks = DIV_ROUND_UP(num_iters, task->iter_per_chunk);
 
    cnd_init(&task->finish);
 
@@ -160,7 +203,15 @@ lp_cs_tpool_queue_task(struct lp_cs_tpool *pool,
 
    list_addtail(&task->list, &pool->workqueue);
 
-   cnd_broadcast(&pool->new_work);
+   /* The thread waiting for the task takes one chunk itself, only wake up
+    * as many threads as there are chunks left.
+    */
+   if (num_chunks - 1 >= pool->num_threads) {
+      cnd_broadcast(&pool->new_work);
+   } else {
+      for (unsigned i = 0; i < num_chunks - 1; i++)
+         cnd_signal(&pool->new_work);
+   }
    mtx_unlock(&pool->m);
    return task;
 }
@@ -174,8 +225,20 @@ lp_cs_tpool_wait_for_task(struct lp_cs_tpool *pool,
    if (!pool || !task)
       return;
 
+   /* Help with the task rather than just sleeping. */
+   struct lp_cs_local_mem lmem;
+   memset(&lmem, 0, sizeof(lmem));
+   lp_cs_tpool_run_task(task, &lmem);
+   FREE(lmem.local_mem_ptr);
+   align_free(lmem.cache);
+
+   /* Everything has been handed out, wait for the pool threads still
+    * executing their last chunk.
+    */
    mtx_lock(&pool->m);
-   while (task->iter_finished < task->iter_total)
+   if (list_is_linked(&task->list))
+      list_del(&task->list);
+   while (task->num_workers)
       cnd_wait(&task->finish, &pool->m);
    mtx_unlock(&pool->m);
 
@@ -30,6 +30,12 @@
  * structs with just unique indexes in them.
  * It also supports a local memory support struct to be passed from
  * outside the thread exec function.
+ *
+ * Iterations are handed out in chunks with an atomic counter, so the
+ * pool lock is only taken to pick a task and to go to sleep. Idle threads
+ * rotate through the queued tasks, so that tasks queued concurrently
+ * (e.g. from different contexts) make progress at the same time, and the
+ * thread waiting for a task helps executing it.
  */
 #ifndef LP_CS_QUEUE
 #define LP_CS_QUEUE
@@ -41,11 +47,13 @@
 
 #include "lp_limits.h"
 
+struct lp_build_format_cache;
+
 struct lp_cs_tpool {
    mtx_t m;
    cnd_t new_work;
 
-   thrd_t threads[LP_MAX_THREADS];
+   thrd_t *threads;
    unsigned num_threads;
    struct list_head workqueue;
    bool shutdown;
@@ -54,6 +62,7 @@ struct lp_cs_tpool {
 struct lp_cs_local_mem {
    unsigned local_size;
    void *local_mem_ptr;
+   struct lp_build_format_cache *cache;
 };
 
 typedef void (*lp_cs_tpool_task_func)(void *data, int iter_idx, struct lp_cs_local_mem *lmem);
@@ -61,13 +70,12 @@ typedef void (*lp_cs_tpool_task_func)(void *data, int iter_idx, struct lp_cs_loc
 struct lp_cs_tpool_task {
    lp_cs_tpool_task_func work;
    void *data;
-   struct list_head list;
+   struct list_head list;       /* unlinked once all iterations are handed out */
    cnd_t finish;
    unsigned iter_total;
-   unsigned iter_start;
-   unsigned iter_finished;
-   unsigned iter_per_thread;
-   unsigned iter_remainder;
+   unsigned iter_per_chunk;
+   unsigned iter_next;          /* next iteration to hand out, atomic */
+   unsigned num_workers;        /* pool threads running the task, under pool->m */
 };
 
 struct lp_cs_tpool *lp_cs_tpool_create(unsigned num_threads);
@@ -73,6 +73,10 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info,
       return;
    }
 
+   /* Pick up a full fs variant finished by a compiler thread. */
+   if (lp->fs_fallback)
+      llvmpipe_update_fs_fallback(lp);
+
    if (lp->dirty)
       llvmpipe_update_derived(lp);
 
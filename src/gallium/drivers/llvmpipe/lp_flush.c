@@ -119,13 +119,18 @@ llvmpipe_flush_resource(struct pipe_context *pipe,
                         const char *reason)
 {
    unsigned referenced = 0;
+   boolean referenced_elsewhere = FALSE;
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
    struct llvmpipe_screen *lp_screen = llvmpipe_screen(pipe->screen);
 
    mtx_lock(&lp_screen->ctx_mutex);
    list_for_each_entry(struct llvmpipe_context, ctx, &lp_screen->ctx_list, list) {
-      referenced |=
+      unsigned ref =
          llvmpipe_is_resource_referenced((struct pipe_context *)ctx,
                                          resource, level);
+      if (ref && ctx != llvmpipe)
+         referenced_elsewhere = TRUE;
+      referenced |= ref;
    }
    mtx_unlock(&lp_screen->ctx_mutex);
 
@@ -136,11 +141,27 @@ llvmpipe_flush_resource(struct pipe_context *pipe,
          if (do_not_block)
             return FALSE;
 
-      /*
-       * Flush and wait.
-       * Finish so VS can use FS results.
-       */
-      llvmpipe_finish(pipe, reason);
+      if (referenced_elsewhere) {
+         /*
+          * Flush and wait.
+          * Finish so VS can use FS results.
+          */
+         llvmpipe_finish(pipe, reason);
+      } else {
+         /*
+          * Only wait for the scenes of this context which access the
+          * resource, so that binning can carry on while the rasterizer
+          * works through any later scenes.
+          */
+         struct lp_fence *fence = NULL;
+
+         draw_flush(llvmpipe->draw);
+         lp_setup_flush_resource(llvmpipe->setup, resource, &fence, reason);
+         if (fence) {
+            lp_fence_wait(fence);
+            lp_fence_reference(&fence, NULL);
+         }
+      }
    }
 
    return TRUE;
@@ -66,7 +66,17 @@
 
 #define LP_MAX_SAMPLES 4
 
-#define LP_MAX_THREADS 32
+/**
+ * Upper bound on LP_NUM_THREADS.  Per-thread state is allocated at
+ * screen creation, so this is only a sanity limit.
+ */
+#define LP_MAX_THREADS 1024
+
+/**
+ * Max number of groups of rasterizer threads sharing a L3 cache which get
+ * their own region of the framebuffer to work on.
+ */
+#define LP_MAX_BIN_QUEUES 64
 
 
 /**
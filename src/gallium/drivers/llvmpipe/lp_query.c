@@ -55,10 +55,17 @@ llvmpipe_create_query(struct pipe_context *pipe,
                       unsigned type,
                       unsigned index)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   unsigned num_threads = MAX2(1, screen->num_threads);
+
    assert(type < PIPE_QUERY_TYPES);
 
-   struct llvmpipe_query *pq = CALLOC_STRUCT(llvmpipe_query);
+   struct llvmpipe_query *pq =
+      CALLOC_VARIANT_LENGTH_STRUCT(llvmpipe_query,
+                                   2 * num_threads * sizeof(uint64_t));
    if (pq) {
+      pq->start = pq->counts;
+      pq->end = pq->counts + num_threads;
       pq->type = type;
       pq->index = index;
    }
@@ -382,6 +389,8 @@ static bool
 llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
 {
    struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   unsigned num_threads = MAX2(1, screen->num_threads);
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
    /* Check if the query is already in the scene.  If so, we need to
@@ -392,8 +401,8 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
       llvmpipe_finish(pipe, __FUNCTION__);
    }
 
-   memset(pq->start, 0, sizeof(pq->start));
-   memset(pq->end, 0, sizeof(pq->end));
+   memset(pq->start, 0, num_threads * sizeof(pq->start[0]));
+   memset(pq->end, 0, num_threads * sizeof(pq->end[0]));
    lp_setup_begin_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
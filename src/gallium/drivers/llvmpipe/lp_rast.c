@@ -33,6 +33,7 @@
 #include "util/u_pack_color.h"
 #include "util/u_string.h"
 #include "util/u_thread.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_memset.h"
 #include "util/os_time.h"
 
@@ -78,7 +79,7 @@ lp_rast_begin(struct lp_rasterizer *rast,
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
 
    lp_scene_begin_rasterization(scene);
-   lp_scene_bin_iter_begin(scene);
+   lp_scene_bin_iter_begin(scene, rast->num_bin_queues);
 }
 
 
@@ -860,6 +861,79 @@ dispatch_tri[] = {
 };
 
 
+/**
+ * Set up the rasterizer's triangle commands, replacing the plane
+ * rasterizers from dispatch_tri with AVX-512 or AVX2 builds of them
+ * when the CPU supports those.
+ */
+static void
+init_tri_dispatch(struct lp_rasterizer *rast)
+{
+   ASSERTED const struct util_cpu_caps_t *caps = util_get_cpu_caps();
+
+   memcpy(rast->dispatch_tri, dispatch_tri, sizeof(dispatch_tri));
+
+#ifdef LP_RAST_AVX512
+   if (caps->has_avx512f) {
+      static const lp_rast_cmd_func tri[8] = {
+         lp_rast_triangle_avx512_1,
+         lp_rast_triangle_avx512_2,
+         lp_rast_triangle_avx512_3,
+         lp_rast_triangle_avx512_4,
+         lp_rast_triangle_avx512_5,
+         lp_rast_triangle_avx512_6,
+         lp_rast_triangle_avx512_7,
+         lp_rast_triangle_avx512_8,
+      };
+      static const lp_rast_cmd_func tri_32[8] = {
+         lp_rast_triangle_32_avx512_1,
+         lp_rast_triangle_32_avx512_2,
+         lp_rast_triangle_32_avx512_3,
+         lp_rast_triangle_32_avx512_4,
+         lp_rast_triangle_32_avx512_5,
+         lp_rast_triangle_32_avx512_6,
+         lp_rast_triangle_32_avx512_7,
+         lp_rast_triangle_32_avx512_8,
+      };
+
+      memcpy(&rast->dispatch_tri[LP_RAST_OP_TRIANGLE_1], tri, sizeof(tri));
+      memcpy(&rast->dispatch_tri[LP_RAST_OP_TRIANGLE_32_1], tri_32,
+             sizeof(tri_32));
+      return;
+   }
+#endif
+
+#ifdef LP_RAST_AVX2
+   if (caps->has_avx2) {
+      static const lp_rast_cmd_func tri[8] = {
+         lp_rast_triangle_avx2_1,
+         lp_rast_triangle_avx2_2,
+         lp_rast_triangle_avx2_3,
+         lp_rast_triangle_avx2_4,
+         lp_rast_triangle_avx2_5,
+         lp_rast_triangle_avx2_6,
+         lp_rast_triangle_avx2_7,
+         lp_rast_triangle_avx2_8,
+      };
+      static const lp_rast_cmd_func tri_32[8] = {
+         lp_rast_triangle_32_avx2_1,
+         lp_rast_triangle_32_avx2_2,
+         lp_rast_triangle_32_avx2_3,
+         lp_rast_triangle_32_avx2_4,
+         lp_rast_triangle_32_avx2_5,
+         lp_rast_triangle_32_avx2_6,
+         lp_rast_triangle_32_avx2_7,
+         lp_rast_triangle_32_avx2_8,
+      };
+
+      memcpy(&rast->dispatch_tri[LP_RAST_OP_TRIANGLE_1], tri, sizeof(tri));
+      memcpy(&rast->dispatch_tri[LP_RAST_OP_TRIANGLE_32_1], tri_32,
+             sizeof(tri_32));
+   }
+#endif
+}
+
+
 /* Debug rasterization with most fastpaths disabled.
  */
 static const lp_rast_cmd_func
@@ -953,9 +1027,11 @@ tri_rasterize_bin(struct lp_rasterizer_task *task,
 {
    STATIC_ASSERT(ARRAY_SIZE(dispatch_tri) == LP_RAST_OP_MAX);
 
+   const lp_rast_cmd_func *dispatch = task->rast->dispatch_tri;
+
    for (const struct cmd_block *block = bin->head; block; block = block->next) {
       for (unsigned k = 0; k < block->count; k++) {
-         dispatch_tri[block->cmd[k]](task, block->arg[k]);
+         dispatch[block->cmd[k]](task, block->arg[k]);
       }
    }
 }
@@ -1018,20 +1094,6 @@ rasterize_bin(struct lp_rasterizer_task *task,
 }
 
 
-/* An empty bin is one that just loads the contents of the tile and
- * stores them again unchanged.  This typically happens when bins have
- * been flushed for some reason in the middle of a frame, or when
- * incremental updates are being made to a render target.
- *
- * Try to avoid doing pointless work in this case.
- */
-static boolean
-is_empty_bin(const struct cmd_bin *bin)
-{
-   return bin->head == NULL;
-}
-
-
 /**
  * Rasterize/execute all bins within a scene.
  * Called per thread.
@@ -1054,15 +1116,14 @@ rasterize_scene(struct lp_rasterizer_task *task,
 #endif
 
    if (!task->rast->no_rast) {
-      /* loop over scene bins, rasterize each */
+      /* loop over the non-empty scene bins, rasterize each */
       {
          struct cmd_bin *bin;
          int i, j;
 
          assert(scene);
-         while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
-            if (!is_empty_bin(bin))
-               rasterize_bin(task, bin, i, j);
+         while ((bin = lp_scene_bin_iter_next(scene, task->bin_queue, &i, &j))) {
+            rasterize_bin(task, bin, i, j);
          }
       }
    }
@@ -1203,11 +1264,24 @@ thread_function(void *init_data)
       if (debug)
          debug_printf("thread %d doing work\n", task->thread_index);
 
+      int64_t start_time = rast->thread_stats ? os_time_get_nano() : 0;
+
       rasterize_scene(task, rast->curr_scene);
 
+      int64_t end_time = rast->thread_stats ? os_time_get_nano() : 0;
+
       /* wait for all threads to finish with this scene */
       util_barrier_wait(&rast->barrier);
 
+      if (rast->thread_stats) {
+         /* Time spent at the barrier is time this thread had no bins left
+          * while some other thread was still busy with the scene.
+          */
+         task->busy_time += end_time - start_time;
+         task->idle_time += os_time_get_nano() - end_time;
+         task->num_scenes++;
+      }
+
       /* XXX: shouldn't be necessary:
        */
       if (task->thread_index == 0) {
@@ -1229,6 +1303,26 @@ thread_function(void *init_data)
 }
 
 
+/**
+ * Pin the thread to the CPUs sharing the L3 cache of its bin queue.
+ */
+static void
+pin_rast_thread(struct lp_rasterizer *rast, unsigned i)
+{
+   const struct util_cpu_caps_t *caps = util_get_cpu_caps();
+
+   if (rast->num_bin_queues <= 1 || !caps->L3_affinity_mask)
+      return;
+
+   unsigned L3_cache = rast->tasks[i].bin_queue * caps->num_L3_caches /
+                       rast->num_bin_queues;
+
+   util_set_thread_affinity(rast->threads[i],
+                            caps->L3_affinity_mask[L3_cache],
+                            NULL, caps->num_cpu_mask_bits);
+}
+
+
 /**
  * Initialize semaphores and spawn the threads.
  */
@@ -1244,6 +1338,7 @@ create_rast_threads(struct lp_rasterizer *rast)
          rast->num_threads = i; /* previous thread is max */
          break;
       }
+      pin_rast_thread(rast, i);
    }
 }
 
@@ -1269,10 +1364,23 @@ lp_rast_create(unsigned num_threads)
       goto no_full_scenes;
    }
 
+   rast->tasks = CALLOC(MAX2(1, num_threads), sizeof(*rast->tasks));
+   rast->threads = CALLOC(MAX2(1, num_threads), sizeof(*rast->threads));
+   if (!rast->tasks || !rast->threads) {
+      goto no_thread_data_cache;
+   }
+
+   /* Split the framebuffer into one region per L3 cache, so that each
+    * group of threads sharing a cache keeps rasterizing the same tiles.
+    */
+   rast->num_bin_queues = MIN3(util_get_cpu_caps()->num_L3_caches,
+                               MAX2(1, num_threads), LP_MAX_BIN_QUEUES);
+
    for (i = 0; i < MAX2(1, num_threads); i++) {
       struct lp_rasterizer_task *task = &rast->tasks[i];
       task->rast = rast;
       task->thread_index = i;
+      task->bin_queue = i * rast->num_bin_queues / MAX2(1, num_threads);
       task->thread_data.cache =
          align_malloc(sizeof(struct lp_build_format_cache), 16);
       if (!task->thread_data.cache) {
@@ -1282,7 +1390,10 @@ lp_rast_create(unsigned num_threads)
 
    rast->num_threads = num_threads;
 
+   init_tri_dispatch(rast);
+
    rast->no_rast = debug_get_bool_option("LP_NO_RAST", FALSE);
+   rast->thread_stats = debug_get_bool_option("LP_RAST_THREAD_STATS", FALSE);
 
    create_rast_threads(rast);
 
@@ -1296,12 +1407,16 @@ lp_rast_create(unsigned num_threads)
    return rast;
 
 no_thread_data_cache:
-   for (i = 0; i < MAX2(1, rast->num_threads); i++) {
-      if (rast->tasks[i].thread_data.cache) {
-         align_free(rast->tasks[i].thread_data.cache);
+   if (rast->tasks) {
+      for (i = 0; i < MAX2(1, num_threads); i++) {
+         if (rast->tasks[i].thread_data.cache) {
+            align_free(rast->tasks[i].thread_data.cache);
+         }
       }
    }
 
+   FREE(rast->tasks);
+   FREE(rast->threads);
    lp_scene_queue_destroy(rast->full_scenes);
 no_full_scenes:
    FREE(rast);
@@ -1310,6 +1425,27 @@ no_rast:
 }
 
 
+/**
+ * Report how long each rasterizer thread spent rasterizing bins versus
+ * waiting for the other threads to finish the same scene.
+ */
+static void
+print_thread_stats(const struct lp_rasterizer *rast)
+{
+   for (unsigned i = 0; i < rast->num_threads; i++) {
+      const struct lp_rasterizer_task *task = &rast->tasks[i];
+      int64_t total = task->busy_time + task->idle_time;
+
+      debug_printf("llvmpipe-%u: %u scenes, busy %.3f ms, idle %.3f ms "
+                   "(%.1f%% idle)\n",
+                   task->thread_index, task->num_scenes,
+                   task->busy_time / 1000000.0,
+                   task->idle_time / 1000000.0,
+                   total ? 100.0 * task->idle_time / total : 0.0);
+   }
+}
+
+
 /* Shutdown:
  */
 void
@@ -1342,6 +1478,9 @@ lp_rast_destroy(struct lp_rasterizer *rast)
 #endif
    }
 
+   if (rast->thread_stats)
+      print_thread_stats(rast);
+
    /* Clean up per-thread data */
    for (unsigned i = 0; i < rast->num_threads; i++) {
       pipe_semaphore_destroy(&rast->tasks[i].work_ready);
@@ -1360,6 +1499,8 @@ lp_rast_destroy(struct lp_rasterizer *rast)
 
    lp_scene_queue_destroy(rast->full_scenes);
 
+   FREE(rast->tasks);
+   FREE(rast->threads);
    FREE(rast);
 }
 
@@ -97,9 +97,17 @@ struct lp_rasterizer_task
    /** "my" index */
    unsigned thread_index;
 
+   /** bin queue (framebuffer region) this thread starts working on */
+   unsigned bin_queue;
+
    /** Non-interpolated passthru state and occlude counter for visible pixels */
    struct lp_jit_thread_data thread_data;
 
+   /** LP_RAST_THREAD_STATS: time spent rasterizing / waiting, in ns */
+   int64_t busy_time;
+   int64_t idle_time;
+   unsigned num_scenes;
+
    pipe_semaphore work_ready;
    pipe_semaphore work_done;
 };
@@ -114,6 +122,7 @@ struct lp_rasterizer
 {
    boolean exit_flag;
    boolean no_rast;  /**< For debugging/profiling */
+   boolean thread_stats;  /**< Collect per-thread busy/idle times */
 
    /** The incoming queue of scenes ready to rasterize */
    struct lp_scene_queue *full_scenes;
@@ -122,10 +131,22 @@ struct lp_rasterizer
    struct lp_scene *curr_scene;
 
    /** A task object for each rasterization thread */
-   struct lp_rasterizer_task tasks[LP_MAX_THREADS];
+   struct lp_rasterizer_task *tasks;
 
    unsigned num_threads;
-   thrd_t threads[LP_MAX_THREADS];
+   thrd_t *threads;
+
+   /**
+    * Number of regions the bins of a scene are split into, one per group
+    * of threads sharing a L3 cache.
+    */
+   unsigned num_bin_queues;
+
+   /**
+    * Commands for binned triangles, with the triangle rasterizers for the
+    * widest vector extension the CPU has.
+    */
+   lp_rast_cmd_func dispatch_tri[LP_RAST_OP_MAX];
 
    /** For synchronizing the rasterization threads */
    util_barrier barrier;
@@ -288,6 +309,34 @@ lp_rast_shade_quads_all(struct lp_rasterizer_task *task,
    }
 }
 
+
+/**
+ * Shade all pixels in a 4x4 block.
+ */
+static inline void
+lp_rast_block_full_4(struct lp_rasterizer_task *task,
+                     const struct lp_rast_triangle *tri,
+                     int x, int y)
+{
+   lp_rast_shade_quads_all(task, &tri->inputs, x, y);
+}
+
+
+/**
+ * Shade all pixels in a 16x16 block.
+ */
+static inline void
+lp_rast_block_full_16(struct lp_rasterizer_task *task,
+                      const struct lp_rast_triangle *tri,
+                      int x, int y)
+{
+   assert(x % 16 == 0);
+   assert(y % 16 == 0);
+   for (unsigned iy = 0; iy < 16; iy += 4)
+      for (unsigned ix = 0; ix < 16; ix += 4)
+         lp_rast_block_full_4(task, tri, x + ix, y + iy);
+}
+
 void
 lp_rast_triangle_1(struct lp_rasterizer_task *, const union lp_rast_cmd_arg);
 
@@ -453,6 +502,143 @@ void
 lp_rast_triangle_ms_32_4_16(struct lp_rasterizer_task *,
                             const union lp_rast_cmd_arg);
 
+
+/* Triangle rasterizers built with wider x86 vector extensions, see
+ * lp_rast_tri_avx2.c and lp_rast_tri_avx512.c.  lp_rast_create() picks
+ * them over the SSE ones when the CPU supports them.
+ */
+#ifdef LP_RAST_AVX2
+void
+lp_rast_triangle_avx2_1(struct lp_rasterizer_task *,
+                        const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx2_2(struct lp_rasterizer_task *,
+                        const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx2_3(struct lp_rasterizer_task *,
+                        const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx2_4(struct lp_rasterizer_task *,
+                        const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx2_5(struct lp_rasterizer_task *,
+                        const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx2_6(struct lp_rasterizer_task *,
+                        const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx2_7(struct lp_rasterizer_task *,
+                        const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx2_8(struct lp_rasterizer_task *,
+                        const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx2_1(struct lp_rasterizer_task *,
+                           const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx2_2(struct lp_rasterizer_task *,
+                           const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx2_3(struct lp_rasterizer_task *,
+                           const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx2_4(struct lp_rasterizer_task *,
+                           const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx2_5(struct lp_rasterizer_task *,
+                           const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx2_6(struct lp_rasterizer_task *,
+                           const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx2_7(struct lp_rasterizer_task *,
+                           const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx2_8(struct lp_rasterizer_task *,
+                           const union lp_rast_cmd_arg);
+#endif
+
+#ifdef LP_RAST_AVX512
+void
+lp_rast_triangle_avx512_1(struct lp_rasterizer_task *,
+                          const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx512_2(struct lp_rasterizer_task *,
+                          const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx512_3(struct lp_rasterizer_task *,
+                          const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx512_4(struct lp_rasterizer_task *,
+                          const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx512_5(struct lp_rasterizer_task *,
+                          const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx512_6(struct lp_rasterizer_task *,
+                          const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx512_7(struct lp_rasterizer_task *,
+                          const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_avx512_8(struct lp_rasterizer_task *,
+                          const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx512_1(struct lp_rasterizer_task *,
+                             const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx512_2(struct lp_rasterizer_task *,
+                             const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx512_3(struct lp_rasterizer_task *,
+                             const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx512_4(struct lp_rasterizer_task *,
+                             const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx512_5(struct lp_rasterizer_task *,
+                             const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx512_6(struct lp_rasterizer_task *,
+                             const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx512_7(struct lp_rasterizer_task *,
+                             const union lp_rast_cmd_arg);
+
+void
+lp_rast_triangle_32_avx512_8(struct lp_rasterizer_task *,
+                             const union lp_rast_cmd_arg);
+#endif
+
 void
 lp_rast_set_state(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg);
@@ -0,0 +1,175 @@
+/**************************************************************************
+ *
+ * Copyright 2023 The Mesa Authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * AVX2 variants of the triangle rasterizers in lp_rast_tri.c.
+ *
+ * The 4x4 grid of edge function values used to build the block and pixel
+ * masks is kept in two 256-bit registers, one per pair of rows, instead
+ * of four 128-bit ones.
+ *
+ * This file is built with -mavx2, only call into it when
+ * util_get_cpu_caps()->has_avx2 is set.
+ */
+
+#include <immintrin.h>
+
+#include "util/u_math.h"
+#include "lp_debug.h"
+#include "lp_perf.h"
+#include "lp_rast_priv.h"
+
+
+/**
+ * Edge function values across a 4x4 grid, rows 0-1 in cstep01 and rows
+ * 2-3 in cstep23, lane i being at x = i % 4.
+ */
+static inline void
+cstep_avx2(int c, int dcdx, int dcdy, __m256i *cstep01, __m256i *cstep23)
+{
+   const __m256i x1 = _mm256_setr_epi32(0, ~0, 0, ~0, 0, ~0, 0, ~0);
+   const __m256i x2 = _mm256_setr_epi32(0, 0, ~0, ~0, 0, 0, ~0, ~0);
+   const __m256i y1 = _mm256_setr_epi32(0, 0, 0, 0, ~0, ~0, ~0, ~0);
+   __m256i xdcdx = _mm256_set1_epi32(dcdx);
+   __m256i xdcdy = _mm256_set1_epi32(dcdy);
+   __m256i cstep = _mm256_set1_epi32(c);
+
+   cstep = _mm256_add_epi32(cstep, _mm256_and_si256(xdcdx, x1));
+   cstep = _mm256_add_epi32(cstep,
+                            _mm256_and_si256(_mm256_slli_epi32(xdcdx, 1), x2));
+   cstep = _mm256_add_epi32(cstep, _mm256_and_si256(xdcdy, y1));
+
+   *cstep01 = cstep;
+   *cstep23 = _mm256_add_epi32(cstep, _mm256_slli_epi32(xdcdy, 1));
+}
+
+
+static inline unsigned
+sign_bits_avx2(__m256i cstep01, __m256i cstep23)
+{
+   unsigned lo = _mm256_movemask_ps(_mm256_castsi256_ps(cstep01));
+   unsigned hi = _mm256_movemask_ps(_mm256_castsi256_ps(cstep23));
+   return lo | (hi << 8);
+}
+
+
+static inline void
+build_masks_avx2(int c,
+                 int cdiff,
+                 int dcdx,
+                 int dcdy,
+                 unsigned *outmask,
+                 unsigned *partmask)
+{
+   __m256i cstep01, cstep23;
+   cstep_avx2(c, dcdx, dcdy, &cstep01, &cstep23);
+
+   *outmask |= sign_bits_avx2(cstep01, cstep23);
+
+   __m256i xcdiff = _mm256_set1_epi32(cdiff);
+   *partmask |= sign_bits_avx2(_mm256_add_epi32(cstep01, xcdiff),
+                               _mm256_add_epi32(cstep23, xcdiff));
+}
+
+
+static inline unsigned
+build_mask_linear_avx2(int c, int dcdx, int dcdy)
+{
+   __m256i cstep01, cstep23;
+   cstep_avx2(c, dcdx, dcdy, &cstep01, &cstep23);
+   return sign_bits_avx2(cstep01, cstep23);
+}
+
+
+#define BUILD_MASKS(c, cdiff, dcdx, dcdy, omask, pmask) build_masks_avx2((int)c, (int)cdiff, dcdx, dcdy, omask, pmask)
+#define BUILD_MASK_LINEAR(c, dcdx, dcdy) build_mask_linear_avx2((int)c, dcdx, dcdy)
+
+#define RASTER_64 1
+
+#define TAG(x) x##_avx2_1
+#define NR_PLANES 1
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx2_2
+#define NR_PLANES 2
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx2_3
+#define NR_PLANES 3
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx2_4
+#define NR_PLANES 4
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx2_5
+#define NR_PLANES 5
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx2_6
+#define NR_PLANES 6
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx2_7
+#define NR_PLANES 7
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx2_8
+#define NR_PLANES 8
+#include "lp_rast_tri_tmp.h"
+
+#undef RASTER_64
+
+#define TAG(x) x##_32_avx2_1
+#define NR_PLANES 1
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx2_2
+#define NR_PLANES 2
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx2_3
+#define NR_PLANES 3
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx2_4
+#define NR_PLANES 4
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx2_5
+#define NR_PLANES 5
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx2_6
+#define NR_PLANES 6
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx2_7
+#define NR_PLANES 7
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx2_8
+#define NR_PLANES 8
+#include "lp_rast_tri_tmp.h"
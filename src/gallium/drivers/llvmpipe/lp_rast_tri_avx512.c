@@ -0,0 +1,161 @@
+/**************************************************************************
+ *
+ * Copyright 2023 The Mesa Authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * AVX-512 variants of the triangle rasterizers in lp_rast_tri.c.
+ *
+ * A 4x4 grid of edge function values fits a single 512-bit register, so
+ * the masks for a 64x64 tile (16x16 blocks), a 16x16 block (4x4 blocks)
+ * and a 4x4 block (pixels) each come out of one compare.
+ *
+ * This file is built with -mavx512f, only call into it when
+ * util_get_cpu_caps()->has_avx512f is set.
+ */
+
+#include <immintrin.h>
+
+#include "util/u_math.h"
+#include "lp_debug.h"
+#include "lp_perf.h"
+#include "lp_rast_priv.h"
+
+
+/**
+ * Edge function values across a 4x4 grid, lane i being at
+ * x = i % 4, y = i / 4.
+ */
+static inline __m512i
+cstep_avx512(int c, int dcdx, int dcdy)
+{
+   __m512i xdcdx = _mm512_set1_epi32(dcdx);
+   __m512i xdcdy = _mm512_set1_epi32(dcdy);
+   __m512i cstep = _mm512_set1_epi32(c);
+
+   cstep = _mm512_mask_add_epi32(cstep, 0xaaaa, cstep, xdcdx);
+   cstep = _mm512_mask_add_epi32(cstep, 0xcccc, cstep,
+                                 _mm512_slli_epi32(xdcdx, 1));
+   cstep = _mm512_mask_add_epi32(cstep, 0xf0f0, cstep, xdcdy);
+   cstep = _mm512_mask_add_epi32(cstep, 0xff00, cstep,
+                                 _mm512_slli_epi32(xdcdy, 1));
+   return cstep;
+}
+
+
+static inline void
+build_masks_avx512(int c,
+                   int cdiff,
+                   int dcdx,
+                   int dcdy,
+                   unsigned *outmask,
+                   unsigned *partmask)
+{
+   const __m512i zero = _mm512_setzero_si512();
+   __m512i cstep = cstep_avx512(c, dcdx, dcdy);
+
+   *outmask |= _mm512_cmplt_epi32_mask(cstep, zero);
+
+   cstep = _mm512_add_epi32(cstep, _mm512_set1_epi32(cdiff));
+   *partmask |= _mm512_cmplt_epi32_mask(cstep, zero);
+}
+
+
+static inline unsigned
+build_mask_linear_avx512(int c, int dcdx, int dcdy)
+{
+   return _mm512_cmplt_epi32_mask(cstep_avx512(c, dcdx, dcdy),
+                                  _mm512_setzero_si512());
+}
+
+
+#define BUILD_MASKS(c, cdiff, dcdx, dcdy, omask, pmask) build_masks_avx512((int)c, (int)cdiff, dcdx, dcdy, omask, pmask)
+#define BUILD_MASK_LINEAR(c, dcdx, dcdy) build_mask_linear_avx512((int)c, dcdx, dcdy)
+
+#define RASTER_64 1
+
+#define TAG(x) x##_avx512_1
+#define NR_PLANES 1
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx512_2
+#define NR_PLANES 2
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx512_3
+#define NR_PLANES 3
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx512_4
+#define NR_PLANES 4
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx512_5
+#define NR_PLANES 5
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx512_6
+#define NR_PLANES 6
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx512_7
+#define NR_PLANES 7
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_avx512_8
+#define NR_PLANES 8
+#include "lp_rast_tri_tmp.h"
+
+#undef RASTER_64
+
+#define TAG(x) x##_32_avx512_1
+#define NR_PLANES 1
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx512_2
+#define NR_PLANES 2
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx512_3
+#define NR_PLANES 3
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx512_4
+#define NR_PLANES 4
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx512_5
+#define NR_PLANES 5
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx512_6
+#define NR_PLANES 6
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx512_7
+#define NR_PLANES 7
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_avx512_8
+#define NR_PLANES 8
+#include "lp_rast_tri_tmp.h"
@@ -183,7 +183,7 @@ TAG(do_block_16)(struct lp_rasterizer_task *task,
       inmask &= ~(1 << i);
 
       LP_COUNT(nr_fully_covered_4);
-      block_full_4(task, tri, px, py);
+      lp_rast_block_full_4(task, tri, px, py);
    }
 }
 
@@ -338,7 +338,7 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
       inmask &= ~(1 << i);
 
       LP_COUNT(nr_fully_covered_16);
-      block_full_16(task, tri, px, py);
+      lp_rast_block_full_16(task, tri, px, py);
    }
 }
 
@@ -30,6 +30,7 @@
 #include "util/u_memory.h"
 #include "util/reallocarray.h"
 #include "util/u_inlines.h"
+#include "util/u_atomic.h"
 #include "util/format/u_format.h"
 #include "lp_scene.h"
 #include "lp_fence.h"
@@ -73,8 +74,6 @@ lp_scene_create(struct lp_setup_context *setup)
    scene->setup = setup;
    scene->data.head = &scene->data.first;
 
-   (void) mtx_init(&scene->mutex, mtx_plain);
-
 #ifdef DEBUG
    /* Do some scene limit sanity checks here */
    {
@@ -101,8 +100,8 @@ void
 lp_scene_destroy(struct lp_scene *scene)
 {
    lp_scene_end_rasterization(scene);
-   mtx_destroy(&scene->mutex);
    free(scene->tiles);
+   free(scene->bin_order);
    assert(scene->data.head == &scene->data.first);
    slab_free_st(&scene->setup->scene_slab, scene);
 }
@@ -147,6 +146,7 @@ lp_scene_bin_reset(struct lp_scene *scene, unsigned x, unsigned y)
    struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
 
    bin->last_state = NULL;
+   bin->num_cmds = 0;
    bin->head = bin->tail;
    if (bin->tail) {
       bin->tail->next = NULL;
@@ -533,60 +533,91 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 }
 
 
-/** advance curr_x,y to the next bin */
-static boolean
-next_bin(struct lp_scene *scene)
+/**
+ * Prepare the list of bins to be handed out to the rasterizer threads.
+ * Called once per scene, before any thread calls lp_scene_bin_iter_next().
+ *
+ * The framebuffer is split into num_queues horizontal bands, each with its
+ * own queue of bins, so that a group of threads sharing a cache keeps
+ * working on the same tiles from one scene to the next.
+ *
+ * Empty bins are skipped entirely.  In each queue the remaining bins are
+ * bucketed by the log2 of their command count and emitted most expensive
+ * bucket first, so that the long-running bins start early and the cheap
+ * ones fill in the gaps at the end of the scene instead of leaving threads
+ * idle behind a few expensive tiles.  Within a bucket, bins keep their
+ * raster order.
+ */
+void
+lp_scene_bin_iter_begin(struct lp_scene *scene, unsigned num_queues)
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
-   }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return FALSE;
-   }
-   return TRUE;
-}
+   unsigned offset = 0;
 
+   num_queues = CLAMP(num_queues, 1, ARRAY_SIZE(scene->bin_queues));
 
-void
-lp_scene_bin_iter_begin(struct lp_scene *scene)
-{
-   scene->curr_x = scene->curr_y = -1;
+   for (unsigned q = 0; q < num_queues; q++) {
+      const unsigned start = scene->tiles_x * (scene->tiles_y * q / num_queues);
+      const unsigned end = scene->tiles_x * (scene->tiles_y * (q + 1) / num_queues);
+      unsigned bucket_start[32] = { 0 };
+
+      for (unsigned i = start; i < end; i++) {
+         const struct cmd_bin *bin = &scene->tiles[i];
+         if (bin->head)
+            bucket_start[util_logbase2(bin->num_cmds)]++;
+      }
+
+      /* Turn the bucket sizes into start offsets, highest cost first. */
+      scene->bin_queues[q].next = offset;
+      for (int b = ARRAY_SIZE(bucket_start) - 1; b >= 0; b--) {
+         unsigned count = bucket_start[b];
+         bucket_start[b] = offset;
+         offset += count;
+      }
+      scene->bin_queues[q].end = offset;
+
+      for (unsigned i = start; i < end; i++) {
+         const struct cmd_bin *bin = &scene->tiles[i];
+         if (bin->head)
+            scene->bin_order[bucket_start[util_logbase2(bin->num_cmds)]++] = i;
+      }
+   }
+
+   scene->num_bin_queues = num_queues;
 }
 
 
 /**
  * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
  * Multiple rendering threads will call this function to get a chunk
- * of work (a bin) to work on.
+ * of work (a bin) to work on.  Bins are claimed with a single atomic
+ * increment, so no lock is taken.  Threads take bins from their own
+ * queue first, and steal from the other queues once it is empty.
  */
 struct cmd_bin *
-lp_scene_bin_iter_next(struct lp_scene *scene , int *x, int *y)
+lp_scene_bin_iter_next(struct lp_scene *scene, unsigned queue,
+                       int *x, int *y)
 {
-   struct cmd_bin *bin = NULL;
+   for (unsigned q = 0; q < scene->num_bin_queues; q++) {
+      struct lp_bin_queue *bq =
+         &scene->bin_queues[(queue + q) % scene->num_bin_queues];
 
-   mtx_lock(&scene->mutex);
+      if (p_atomic_read(&bq->next) >= bq->end)
+         continue;
 
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   } else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
-   }
+      unsigned i = p_atomic_inc_return(&bq->next) - 1;
+      if (i >= bq->end)
+         continue;
+
+      unsigned idx = scene->bin_order[i];
+      *x = idx % scene->tiles_x;
+      *y = idx / scene->tiles_x;
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
+      /*printf("return bin %u at %d, %d\n", idx, *x, *y);*/
+      return &scene->tiles[idx];
+   }
 
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
-   mtx_unlock(&scene->mutex);
-   return bin;
+   /* no more bins left */
+   return NULL;
 }
 
 
@@ -607,7 +638,9 @@ lp_scene_begin_binning(struct lp_scene *scene,
    if (scene->num_alloced_tiles < num_required_tiles) {
       scene->tiles = reallocarray(scene->tiles, num_required_tiles,
                                   sizeof(struct cmd_bin));
-      if (!scene->tiles)
+      scene->bin_order = reallocarray(scene->bin_order, num_required_tiles,
+                                      sizeof(unsigned));
+      if (!scene->tiles || !scene->bin_order)
          return;
       memset(scene->tiles, 0, sizeof(struct cmd_bin) * num_required_tiles);
       scene->num_alloced_tiles = num_required_tiles;
@@ -648,9 +681,62 @@ lp_scene_begin_binning(struct lp_scene *scene,
 }
 
 
+/**
+ * Grow the damage of the display targets written by this scene.  Color
+ * buffers are damaged by the bounding box of the tiles that have commands
+ * binned, other writeable display targets (shader images) as a whole.
+ */
+static void
+lp_scene_damage_display_targets(struct lp_scene *scene)
+{
+   bool any_dt_cbuf = false;
+
+   for (unsigned i = 0; i < scene->fb.nr_cbufs; i++) {
+      struct pipe_surface *cbuf = scene->fb.cbufs[i];
+      if (cbuf && llvmpipe_resource(cbuf->texture)->dt)
+         any_dt_cbuf = true;
+   }
+
+   if (any_dt_cbuf) {
+      int x0 = scene->tiles_x, y0 = scene->tiles_y, x1 = -1, y1 = -1;
+
+      for (int y = 0; y < scene->tiles_y; y++) {
+         for (int x = 0; x < scene->tiles_x; x++) {
+            if (scene->tiles[y * scene->tiles_x + x].head) {
+               x0 = MIN2(x0, x);
+               x1 = MAX2(x1, x);
+               y0 = MIN2(y0, y);
+               y1 = MAX2(y1, y);
+            }
+         }
+      }
+
+      if (x1 >= 0) {
+         for (unsigned i = 0; i < scene->fb.nr_cbufs; i++) {
+            struct pipe_surface *cbuf = scene->fb.cbufs[i];
+            if (!cbuf)
+               continue;
+            llvmpipe_resource_damage(llvmpipe_resource(cbuf->texture),
+                                     x0 * TILE_SIZE, y0 * TILE_SIZE,
+                                     (x1 - x0 + 1) * TILE_SIZE,
+                                     (y1 - y0 + 1) * TILE_SIZE);
+         }
+      }
+   }
+
+   for (struct resource_ref *ref = scene->writeable_resources; ref;
+        ref = ref->next) {
+      for (int i = 0; i < ref->count; i++)
+         llvmpipe_resource_damage_all(llvmpipe_resource(ref->resource[i]));
+   }
+}
+
+
 void
 lp_scene_end_binning(struct lp_scene *scene)
 {
+   lp_scene_damage_display_targets(scene);
+
    if (LP_DEBUG & DEBUG_SCENE) {
       debug_printf("rasterize scene:\n");
       debug_printf("  scene_size: %u\n",
@@ -98,6 +98,17 @@ struct cmd_bin {
    const struct lp_rast_state *last_state;  /* most recent state set in bin */
    struct cmd_block *head;
    struct cmd_block *tail;
+   unsigned num_cmds;  /* number of commands, used as a cost estimate */
+};
+
+
+/**
+ * A contiguous range of lp_scene::bin_order, covering one horizontal band
+ * of the framebuffer.
+ */
+struct lp_bin_queue {
+   unsigned next;  /**< next entry of bin_order to hand out */
+   unsigned end;
 };
 
 
@@ -195,8 +206,15 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
-   mtx_t mutex;
+   /**
+    * Indices of the non-empty bins, grouped by bin queue and most expensive
+    * first within each queue.  Built by lp_scene_bin_iter_begin() and
+    * consumed by the rasterizer threads through the lock-free
+    * lp_scene_bin_iter_next().
+    */
+   unsigned *bin_order;
+   struct lp_bin_queue bin_queues[LP_MAX_BIN_QUEUES];
+   unsigned num_bin_queues;
 
    unsigned num_alloced_tiles;
    struct cmd_bin *tiles;
@@ -342,6 +360,8 @@ lp_scene_bin_command(struct lp_scene *scene,
       tail->count++;
    }
 
+   bin->num_cmds++;
+
    return TRUE;
 }
 
@@ -396,10 +416,11 @@ lp_scene_get_num_bins(const struct lp_scene *scene)
 
 
 void
-lp_scene_bin_iter_begin(struct lp_scene *scene);
+lp_scene_bin_iter_begin(struct lp_scene *scene, unsigned num_queues);
 
 struct cmd_bin *
-lp_scene_bin_iter_next(struct lp_scene *scene, int *x, int *y);
+lp_scene_bin_iter_next(struct lp_scene *scene, unsigned queue,
+                       int *x, int *y);
 
 
 
@@ -842,9 +842,44 @@ llvmpipe_flush_frontbuffer(struct pipe_screen *_screen,
    assert(texture->dt);
 
    if (texture->dt) {
+      struct pipe_box damage_box;
+
       if (_pipe)
          llvmpipe_flush_resource(_pipe, resource, 0, true, true,
                                  false, "frontbuffer");
+
+      if (!sub_box) {
+         struct u_rect damage = texture->damage;
+
+         texture->damage.x0 = texture->damage.y0 = 0;
+         texture->damage.x1 = texture->damage.y1 = -1;
+
+         /* The damage is only relative to what the window shows when this
+          * buffer was also the last one presented there, frontends that
+          * flip between buffers get full presents.
+          */
+         if (screen->present_damage &&
+             screen->last_present == texture &&
+             screen->last_present_drawable == context_private) {
+            /* nothing was written since the last full present */
+            if (damage.x1 < damage.x0)
+               return;
+
+            damage.x1 = MIN2(damage.x1, (int)resource->width0 - 1);
+            damage.y1 = MIN2(damage.y1, (int)resource->height0 - 1);
+            u_box_2d(damage.x0, damage.y0,
+                     damage.x1 - damage.x0 + 1, damage.y1 - damage.y0 + 1,
+                     &damage_box);
+            sub_box = &damage_box;
+         }
+         screen->last_present = texture;
+         screen->last_present_drawable = context_private;
+      } else if (screen->last_present_drawable == context_private &&
+                 screen->last_present != texture) {
+         /* the window now shows parts of two buffers */
+         screen->last_present = NULL;
+      }
+
       winsys->displaytarget_display(winsys, texture->dt,
                                     context_private, sub_box);
    }
@@ -857,6 +892,9 @@ llvmpipe_destroy_screen(struct pipe_screen *_screen)
    struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
    struct sw_winsys *winsys = screen->winsys;
 
+   if (screen->async_fs_compile)
+      util_queue_destroy(&screen->fs_compile_queue);
+
    if (screen->cs_tpool)
       lp_cs_tpool_destroy(screen->cs_tpool);
 
@@ -866,9 +904,11 @@ llvmpipe_destroy_screen(struct pipe_screen *_screen)
    lp_jit_screen_cleanup(screen);
 
    if (LP_DEBUG & DEBUG_CACHE_STATS)
-      printf("disk shader cache:   hits = %u, misses = %u\n",
+      printf("disk shader cache:   hits = %u, misses = %u, "
+             "build time saved = %u ms\n",
              screen->num_disk_shader_cache_hits,
-             screen->num_disk_shader_cache_misses);
+             screen->num_disk_shader_cache_misses,
+             (unsigned)(screen->disk_shader_cache_saved_us / 1000));
    disk_cache_destroy(screen->disk_shader_cache);
    if (winsys->destroy)
       winsys->destroy(winsys);
@@ -948,6 +988,7 @@ lp_disk_cache_create(struct llvmpipe_screen *screen)
       return;
 
    _mesa_sha1_update(&ctx, &gallivm_perf, sizeof(gallivm_perf));
+   _mesa_sha1_update(&ctx, &screen->fs_simd16, sizeof(screen->fs_simd16));
    update_cache_sha1_cpu(&ctx);
    _mesa_sha1_final(&ctx, sha1);
    disk_cache_format_hex_id(cache_id, sha1, 20 * 2);
@@ -980,14 +1021,23 @@ lp_disk_cache_find_shader(struct llvmpipe_screen *screen,
    size_t binary_size;
    uint8_t *buffer = disk_cache_get(screen->disk_shader_cache,
                                     sha1, &binary_size);
-   if (!buffer) {
+   if (!buffer || binary_size <= sizeof(uint32_t)) {
+      free(buffer);
       cache->data_size = 0;
       p_atomic_inc(&screen->num_disk_shader_cache_misses);
       return;
    }
+
+   /* The object code is followed by the time it took to build it. */
+   uint32_t build_time_us;
+   binary_size -= sizeof(build_time_us);
+   memcpy(&build_time_us, buffer + binary_size, sizeof(build_time_us));
+
    cache->data_size = binary_size;
    cache->data = buffer;
+   cache->build_time_us = build_time_us;
    p_atomic_inc(&screen->num_disk_shader_cache_hits);
+   p_atomic_add(&screen->disk_shader_cache_saved_us, build_time_us);
 }
 
 
@@ -1002,8 +1052,17 @@ lp_disk_cache_insert_shader(struct llvmpipe_screen *screen,
       return;
    disk_cache_compute_key(screen->disk_shader_cache, ir_sha1_cache_key,
                           20, sha1);
-   disk_cache_put(screen->disk_shader_cache, sha1, cache->data,
-                  cache->data_size, NULL);
+
+   uint32_t build_time_us = cache->build_time_us;
+   size_t size = cache->data_size + sizeof(build_time_us);
+   uint8_t *buffer = malloc(size);
+   if (!buffer)
+      return;
+
+   memcpy(buffer, cache->data, cache->data_size);
+   memcpy(buffer + cache->data_size, &build_time_us, sizeof(build_time_us));
+   disk_cache_put(screen->disk_shader_cache, sha1, buffer, size, NULL);
+   free(buffer);
 }
 
 
@@ -1029,6 +1088,16 @@ llvmpipe_screen_late_init(struct llvmpipe_screen *screen)
       goto out;
    }
 
+   /* One compiler thread per four rasterizer threads is plenty: the queue
+    * only ever sees the first use of a new fragment shader state.
+    */
+   screen->async_fs_compile =
+      debug_get_bool_option("LP_ASYNC_COMPILE", FALSE) &&
+      util_queue_init(&screen->fs_compile_queue, "lpfs", 64,
+                      MAX2(1, DIV_ROUND_UP(screen->num_threads, 4)),
+                      UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                      UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY, NULL);
+
    lp_disk_cache_create(screen);
    screen->late_init_done = true;
 out:
@@ -1094,6 +1163,10 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
 
    screen->allow_cl = !!getenv("LP_CL");
    screen->use_tgsi = (LP_DEBUG & DEBUG_TGSI_IR);
+   screen->tiled_textures = debug_get_bool_option("LP_TILED_TEXTURES", FALSE);
+   screen->fs_simd16 = util_get_cpu_caps()->has_avx512f &&
+                       debug_get_bool_option("LP_FS_SIMD16", FALSE);
+   screen->present_damage = debug_get_bool_option("LP_PRESENT_DAMAGE", FALSE);
    screen->num_threads = util_get_cpu_caps()->nr_cpus > 1
       ? util_get_cpu_caps()->nr_cpus : 0;
 #ifdef EMBEDDED_DEVICE
@@ -38,6 +38,7 @@
 #include "pipe/p_defines.h"
 #include "os/os_thread.h"
 #include "util/list.h"
+#include "util/u_queue.h"
 #include "gallivm/lp_bld.h"
 #include "gallivm/lp_bld_misc.h"
 
@@ -56,6 +57,18 @@ struct llvmpipe_screen
     */
    unsigned timestamp;
 
+   /** Use the tiled layout for new sampled textures (LP_TILED_TEXTURES) */
+   bool tiled_textures;
+
+   /** Shade 16 pixels per fragment shader iteration (LP_FS_SIMD16) */
+   bool fs_simd16;
+
+   /** Only present the damaged part of display targets (LP_PRESENT_DAMAGE) */
+   bool present_damage;
+   /** What the last full present showed where, for LP_PRESENT_DAMAGE */
+   const struct llvmpipe_resource *last_present;
+   const void *last_present_drawable;
+
    struct lp_rasterizer *rast;
    mtx_t rast_mutex;
 
@@ -73,9 +86,14 @@ struct llvmpipe_screen
 
    char renderer_string[100];
 
+   /** Background compilation of specialized fs variants (LP_ASYNC_COMPILE) */
+   bool async_fs_compile;
+   struct util_queue fs_compile_queue;
+
    struct disk_cache *disk_shader_cache;
    unsigned num_disk_shader_cache_hits;
    unsigned num_disk_shader_cache_misses;
+   uint64_t disk_shader_cache_saved_us;
 };
 
 
@@ -68,14 +68,25 @@ try_update_scene_state(struct lp_setup_context *setup);
 static unsigned
 lp_setup_wait_empty_scene(struct lp_setup_context *setup)
 {
-   /* just use the first scene if we run out */
-   if (setup->scenes[0]->fence) {
+   /* Wait for the oldest scene in flight; it is the first one the
+    * rasterizer will be done with.
+    */
+   unsigned oldest = 0;
+   for (unsigned i = 1; i < setup->num_active_scenes; i++) {
+      struct lp_fence *fence = setup->scenes[i]->fence;
+      struct lp_fence *oldest_fence = setup->scenes[oldest]->fence;
+
+      if (fence && (!oldest_fence || (int)(fence->id - oldest_fence->id) < 0))
+         oldest = i;
+   }
+
+   if (setup->scenes[oldest]->fence) {
       debug_printf("%s: wait for scene %d\n",
-                   __FUNCTION__, setup->scenes[0]->fence->id);
-      lp_fence_wait(setup->scenes[0]->fence);
-      lp_scene_end_rasterization(setup->scenes[0]);
+                   __FUNCTION__, setup->scenes[oldest]->fence->id);
+      lp_fence_wait(setup->scenes[oldest]->fence);
+      lp_scene_end_rasterization(setup->scenes[oldest]);
    }
-   return 0;
+   return oldest;
 }
 
 
@@ -97,11 +108,12 @@ lp_setup_get_empty_scene(struct lp_setup_context *setup)
       }
    }
 
-   if (setup->num_active_scenes + 1 > MAX_SCENES) {
-      i = lp_setup_wait_empty_scene(setup);
-   } else if (i == setup->num_active_scenes) {
-      /* allocate a new scene */
-      struct lp_scene *scene = lp_scene_create(setup);
+   if (i == setup->num_active_scenes) {
+      /* allocate a new scene, unless we already have too many in flight */
+      struct lp_scene *scene = NULL;
+      if (setup->num_active_scenes + 1 <= MAX_SCENES)
+         scene = lp_scene_create(setup);
+
       if (!scene) {
          /* block and reuse scenes */
          i = lp_setup_wait_empty_scene(setup);
@@ -1096,6 +1108,42 @@ lp_setup_set_fragment_sampler_state(struct lp_setup_context *setup,
 }
 
 
+/**
+ * Does the given scene access the texture, either as one of its render
+ * targets or through the resources referenced by its commands?
+ */
+static unsigned
+scene_resource_reference(const struct lp_scene *scene,
+                         const struct pipe_resource *texture)
+{
+   /* check the render targets */
+   for (unsigned j = 0; j < scene->fb.nr_cbufs; j++) {
+      if (scene->fb.cbufs[j] && scene->fb.cbufs[j]->texture == texture)
+         return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+   }
+   if (scene->fb.zsbuf && scene->fb.zsbuf->texture == texture) {
+      return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+   }
+
+   /* check resources referenced by the scene */
+   return lp_scene_is_resource_referenced(scene, texture);
+}
+
+
+/**
+ * Has the scene been completely rasterized?  Such scenes keep their
+ * references until they get recycled, but no longer access them.
+ */
+static boolean
+scene_is_done(const struct lp_setup_context *setup,
+              const struct lp_scene *scene)
+{
+   return scene != setup->scene &&
+          scene->fence && scene->fence->issued &&
+          lp_fence_signalled(scene->fence);
+}
+
+
 /**
  * Is the given texture referenced by any scene?
  * Note: we have to check all scenes including any scenes currently
@@ -1117,17 +1165,11 @@ lp_setup_is_resource_referenced(const struct lp_setup_context *setup,
    /* check resources referenced by active scenes */
    for (unsigned i = 0; i < setup->num_active_scenes; i++) {
       struct lp_scene *scene = setup->scenes[i];
-      /* check the render targets */
-      for (unsigned j = 0; j < scene->fb.nr_cbufs; j++) {
-         if (scene->fb.cbufs[j] && scene->fb.cbufs[j]->texture == texture)
-            return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
-      }
-      if (scene->fb.zsbuf && scene->fb.zsbuf->texture == texture) {
-         return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
-      }
 
-      /* check resources referenced by the scene */
-      unsigned ref = lp_scene_is_resource_referenced(scene, texture);
+      if (scene_is_done(setup, scene))
+         continue;
+
+      unsigned ref = scene_resource_reference(scene, texture);
       if (ref)
          return ref;
    }
@@ -1136,6 +1178,45 @@ lp_setup_is_resource_referenced(const struct lp_setup_context *setup,
 }
 
 
+/**
+ * Queue the scene being built if it accesses the given texture, and
+ * return a reference to the fence of the most recently queued scene of
+ * this context which accesses it, or NULL if none is in flight.
+ *
+ * Scenes are rasterized in the order they are queued, so waiting on that
+ * fence is enough for the texture to be idle; there is no need to wait
+ * for any later scene, nor to flush the current one if it doesn't touch
+ * the texture.
+ */
+void
+lp_setup_flush_resource(struct lp_setup_context *setup,
+                        const struct pipe_resource *texture,
+                        struct lp_fence **fence,
+                        const char *reason)
+{
+   struct lp_fence *last_fence = NULL;
+
+   if (setup->scene && scene_resource_reference(setup->scene, texture))
+      lp_setup_flush(setup, reason);
+
+   for (unsigned i = 0; i < setup->num_active_scenes; i++) {
+      struct lp_scene *scene = setup->scenes[i];
+
+      if (scene == setup->scene || !scene->fence || !scene->fence->issued ||
+          lp_fence_signalled(scene->fence))
+         continue;
+
+      if (!scene_resource_reference(scene, texture))
+         continue;
+
+      if (!last_fence || (int)(scene->fence->id - last_fence->id) > 0)
+         last_fence = scene->fence;
+   }
+
+   lp_fence_reference(fence, last_fence);
+}
+
+
 /**
  * Called by vbuf code when we're about to draw something.
  *
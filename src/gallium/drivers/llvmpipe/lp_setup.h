@@ -44,6 +44,7 @@ struct llvmpipe_query;
 struct pipe_fence_handle;
 struct lp_setup_variant;
 struct lp_setup_context;
+struct lp_fence;
 
 void
 lp_setup_reset(struct lp_setup_context *setup);
@@ -130,6 +131,12 @@ unsigned
 lp_setup_is_resource_referenced(const struct lp_setup_context *setup,
                                 const struct pipe_resource *texture);
 
+void
+lp_setup_flush_resource(struct lp_setup_context *setup,
+                        const struct pipe_resource *texture,
+                        struct lp_fence **fence,
+                        const char *reason);
+
 void
 lp_setup_set_sample_mask(struct lp_setup_context *setup,
                          uint32_t sample_mask);
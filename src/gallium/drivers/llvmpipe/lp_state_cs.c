@@ -33,6 +33,7 @@
 #include "gallivm/lp_bld_debug.h"
 #include "gallivm/lp_bld_intr.h"
 #include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_format.h"
 #include "gallivm/lp_bld_gather.h"
 #include "gallivm/lp_bld_coro.h"
 #include "gallivm/lp_bld_nir.h"
@@ -487,6 +488,18 @@ generate_compute(struct llvmpipe_context *lp,
 }
 
 
+static void
+lp_cs_get_ir_sha1(struct lp_compute_shader *shader)
+{
+   struct blob blob = { 0 };
+
+   blob_init(&blob);
+   nir_serialize(&blob, shader->base.ir.nir, true);
+   _mesa_sha1_compute(blob.data, blob.size, shader->ir_sha1);
+   blob_finish(&blob);
+}
+
+
 static void *
 llvmpipe_create_compute_state(struct pipe_context *pipe,
                               const struct pipe_compute_state *templ)
@@ -523,6 +536,7 @@ llvmpipe_create_compute_state(struct pipe_context *pipe,
       shader->base.tokens = tgsi_dup_tokens(templ->prog);
    } else {
       nir_tgsi_scan_shader(shader->base.ir.nir, &shader->info.base, false);
+      lp_cs_get_ir_sha1(shader);
    }
 
    list_inithead(&shader->variants.list);
@@ -758,22 +772,12 @@ static void
 lp_cs_get_ir_cache_key(struct lp_compute_shader_variant *variant,
                        unsigned char ir_sha1_cache_key[20])
 {
-   struct blob blob = { 0 };
-   unsigned ir_size;
-   void *ir_binary;
-
-   blob_init(&blob);
-   nir_serialize(&blob, variant->shader->base.ir.nir, true);
-   ir_binary = blob.data;
-   ir_size = blob.size;
-
    struct mesa_sha1 ctx;
    _mesa_sha1_init(&ctx);
    _mesa_sha1_update(&ctx, &variant->key, variant->shader->variant_key_size);
-   _mesa_sha1_update(&ctx, ir_binary, ir_size);
+   _mesa_sha1_update(&ctx, variant->shader->ir_sha1,
+                     sizeof(variant->shader->ir_sha1));
    _mesa_sha1_final(&ctx, ir_sha1_cache_key);
-
-   blob_finish(&blob);
 }
 
 
@@ -1356,6 +1360,14 @@ cs_exec_fn(void *init_data, int iter_idx, struct lp_cs_local_mem *lmem)
       memset(lmem->local_mem_ptr, 0, job_info->req_local_mem);
    thread_data.shared = lmem->local_mem_ptr;
 
+   if (!lmem->cache)
+      lmem->cache = align_malloc(sizeof(struct lp_build_format_cache), 16);
+   if (lmem->cache) {
+      /* Blocks cached by an earlier job may be stale by now. */
+      memset(lmem->cache->cache_tags, 0, sizeof(lmem->cache->cache_tags));
+      thread_data.cache = lmem->cache;
+   }
+
    unsigned grid_z = iter_idx / (job_info->grid_size[0] * job_info->grid_size[1]);
    unsigned grid_y = (iter_idx - (grid_z * (job_info->grid_size[0] * job_info->grid_size[1]))) / job_info->grid_size[0];
    unsigned grid_x = (iter_idx - (grid_z * (job_info->grid_size[0] * job_info->grid_size[1])) - (grid_y * job_info->grid_size[0]));
@@ -1437,6 +1449,12 @@ llvmpipe_launch_grid(struct pipe_context *pipe,
       mtx_unlock(&screen->cs_mutex);
 
       lp_cs_tpool_wait_for_task(screen->cs_tpool, &task);
+
+      for (unsigned i = 0; i < ARRAY_SIZE(llvmpipe->csctx->images); i++) {
+         const struct pipe_image_view *image = &llvmpipe->csctx->images[i].current;
+         if (image->resource && (image->shader_access & PIPE_IMAGE_ACCESS_WRITE))
+            llvmpipe_resource_damage_all(llvmpipe_resource(image->resource));
+      }
    }
    if (!llvmpipe->queries_disabled)
       llvmpipe->pipeline_statistics.cs_invocations += num_tasks * info->block[0] * info->block[1] * info->block[2];
@@ -118,6 +118,9 @@ struct lp_compute_shader {
    unsigned variants_cached;
    bool zero_initialize_shared_memory;
 
+   /** sha1 of the serialized NIR, used for the disk cache keys */
+   unsigned char ir_sha1[20];
+
    int max_global_buffers;
    struct pipe_resource **global_buffers;
 };
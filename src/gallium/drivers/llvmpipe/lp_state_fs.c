@@ -1063,12 +1063,18 @@ generate_fs_loop(struct gallivm_state *gallivm,
    params.aniso_filter_table = lp_jit_context_aniso_filter_table(gallivm, context_type, context_ptr);
 
    /* Build the actual shader */
-   if (shader->base.type == PIPE_SHADER_IR_TGSI)
+   if (shader->base.type == PIPE_SHADER_IR_TGSI) {
       lp_build_tgsi_soa(gallivm, tokens, &params,
                         outputs);
-   else
-      lp_build_nir_soa(gallivm, shader->base.ir.nir, &params,
+   } else {
+      /* lp_build_nir_soa() lowers the NIR in place.  Keep the shader's copy
+       * untouched so that variants can be built on several threads.
+       */
+      nir_shader *clone = nir_shader_clone(NULL, shader->base.ir.nir);
+      lp_build_nir_soa(gallivm, clone, &params,
                        outputs);
+      ralloc_free(clone);
+   }
 
    /* Alpha test */
    if (key->alpha.enabled) {
@@ -3171,6 +3177,18 @@ generate_fragment(struct llvmpipe_context *lp,
    fs_type.width = 32;           /* 32-bit float */
    fs_type.length = MIN2(lp_native_vector_width / 32, 16); /* n*4 elements per vector */
 
+   /*
+    * 16 wide vectors shade a whole 4x4 stamp at once.  The depth/stencil,
+    * multisample and 1d resource code only deals with up to 8 pixels at a
+    * time though.
+    */
+   if (llvmpipe_screen(lp->pipe.screen)->fs_simd16)
+      fs_type.length = 16;
+   if (fs_type.length > 8 &&
+       (key->depth.enabled || key->stencil[0].enabled ||
+        key->multisample || key->min_samples > 1 || key->resource_1d))
+      fs_type.length = 8;
+
    struct lp_type blend_type;
    memset(&blend_type, 0, sizeof blend_type);
    blend_type.floating = FALSE; /* values are integers */
@@ -3188,9 +3206,8 @@ generate_fragment(struct llvmpipe_context *lp,
 
    blend_vec_type = lp_build_vec_type(gallivm, blend_type);
 
-   char func_name[64];
-   snprintf(func_name, sizeof(func_name), "fs_variant_%s",
-            partial_mask ? "partial" : "whole");
+   const char *func_name = partial_mask ? LP_FS_FUNC_NAME_PARTIAL
+                                        : LP_FS_FUNC_NAME_WHOLE;
 
    arg_types[0] = variant->jit_context_ptr_type;       /* context */
    arg_types[1] = int32_type;                          /* x */
@@ -3223,9 +3240,6 @@ generate_fragment(struct llvmpipe_context *lp,
       if (LLVMGetTypeKind(arg_types[i]) == LLVMPointerTypeKind)
          lp_add_function_attr(function, i + 1, LP_FUNC_ATTR_NOALIAS);
 
-   if (variant->gallivm->cache->data_size)
-      return;
-
    context_ptr  = LLVMGetParam(function, 0);
    x            = LLVMGetParam(function, 1);
    y            = LLVMGetParam(function, 2);
@@ -3474,6 +3488,37 @@ generate_fragment(struct llvmpipe_context *lp,
    lp_llvm_sampler_soa_destroy(sampler);
    lp_llvm_image_soa_destroy(image);
 
+   /*
+    * Blending works on 4 or 8 wide vectors, so hand it the two halves of
+    * the 16 wide shader outputs.
+    */
+   if (fs_type.length == 16) {
+      struct lp_type half_type = fs_type;
+      half_type.length = 8;
+      LLVMTypeRef half_vec_type = lp_build_vec_type(gallivm, half_type);
+      LLVMTypeRef half_ptr_type = LLVMPointerType(half_vec_type, 0);
+      LLVMValueRef one = lp_build_const_int32(gallivm, 1);
+      const unsigned nr_outputs = MAX2(key->nr_cbufs, dual_source_blend ? 2 : 0);
+
+      assert(num_fs == 1);
+      fs_mask[1] = lp_build_extract_range(gallivm, fs_mask[0], 8, 8);
+      fs_mask[0] = lp_build_extract_range(gallivm, fs_mask[0], 0, 8);
+
+      for (unsigned cbuf = 0; cbuf < nr_outputs; cbuf++) {
+         for (unsigned chan = 0; chan < TGSI_NUM_CHANNELS; ++chan) {
+            LLVMValueRef ptr = LLVMBuildBitCast(builder,
+                                                fs_out_color[0][cbuf][chan][0],
+                                                half_ptr_type, "");
+            fs_out_color[0][cbuf][chan][0] = ptr;
+            fs_out_color[0][cbuf][chan][1] =
+               LLVMBuildGEP2(builder, half_vec_type, ptr, &one, 1, "");
+         }
+      }
+
+      fs_type = half_type;
+      num_fs = 2;
+   }
+
    /* Loop over color outputs / color buffers to do blending */
    for (unsigned cbuf = 0; cbuf < key->nr_cbufs; cbuf++) {
       if (key->cbuf_format[cbuf] != PIPE_FORMAT_NONE) {
@@ -3698,36 +3743,60 @@ lp_debug_fs_variant(struct lp_fragment_shader_variant *variant)
 
 
 static void
-lp_fs_get_ir_cache_key(struct lp_fragment_shader_variant *variant,
-                       unsigned char ir_sha1_cache_key[20])
+lp_fs_get_ir_sha1(struct lp_fragment_shader *shader)
 {
    struct blob blob = { 0 };
-   unsigned ir_size;
-   void *ir_binary;
 
    blob_init(&blob);
-   nir_serialize(&blob, variant->shader->base.ir.nir, true);
-   ir_binary = blob.data;
-   ir_size = blob.size;
+   nir_serialize(&blob, shader->base.ir.nir, true);
+   _mesa_sha1_compute(blob.data, blob.size, shader->ir_sha1);
+   blob_finish(&blob);
+}
 
+
+static void
+lp_fs_get_ir_cache_key(struct lp_fragment_shader_variant *variant,
+                       unsigned char ir_sha1_cache_key[20])
+{
    struct mesa_sha1 ctx;
    _mesa_sha1_init(&ctx);
    _mesa_sha1_update(&ctx, &variant->key, variant->shader->variant_key_size);
-   _mesa_sha1_update(&ctx, ir_binary, ir_size);
+   _mesa_sha1_update(&ctx, variant->shader->ir_sha1,
+                     sizeof(variant->shader->ir_sha1));
+   const uint8_t fallback = variant->fallback;
+   _mesa_sha1_update(&ctx, &fallback, sizeof(fallback));
    _mesa_sha1_final(&ctx, ir_sha1_cache_key);
-
-   blob_finish(&blob);
 }
 
 
+/**
+ * Background build of the full version of a fallback variant.
+ */
+struct lp_fs_specialize_job
+{
+   struct llvmpipe_context *lp;
+   struct lp_fragment_shader_variant *fallback;
+   struct lp_fragment_shader_variant *result;
+   struct util_queue_fence fence;
+};
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
+ *
+ * If fallback is set, the opaque whole-tile function and the linear path
+ * are left out.  The variant is then cheaper to build, and still renders
+ * everything correctly through the edge-test function.
+ *
+ * This may run on a compiler thread, with an LLVM context of its own.
  */
 static struct lp_fragment_shader_variant *
 generate_variant(struct llvmpipe_context *lp,
+                 LLVMContextRef context,
                  struct lp_fragment_shader *shader,
-                 const struct lp_fragment_shader_variant_key *key)
+                 const struct lp_fragment_shader_variant_key *key,
+                 bool fallback)
 {
    struct lp_fragment_shader_variant *variant =
       MALLOC(sizeof *variant + shader->variant_key_size - sizeof variant->key);
@@ -3741,30 +3810,8 @@ generate_variant(struct llvmpipe_context *lp,
 
    memcpy(&variant->key, key, shader->variant_key_size);
 
-   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
-   struct lp_cached_code cached = { 0 };
-   unsigned char ir_sha1_cache_key[20];
-   bool needs_caching = false;
-   if (shader->base.ir.nir) {
-      lp_fs_get_ir_cache_key(variant, ir_sha1_cache_key);
-
-      lp_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
-      if (!cached.data_size)
-         needs_caching = true;
-   }
-
-   char module_name[64];
-   snprintf(module_name, sizeof(module_name), "fs%u_variant%u",
-            shader->no, shader->variants_created);
-   variant->gallivm = gallivm_create(module_name, lp->context, &cached);
-   if (!variant->gallivm) {
-      FREE(variant);
-      return NULL;
-   }
-
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
-   variant->no = shader->variants_created++;
 
    /*
     * Determine whether we are touching all channels in the color buffer.
@@ -3815,8 +3862,17 @@ generate_variant(struct llvmpipe_context *lp,
          shader->info.cbuf[0][3].file != TGSI_FILE_NULL
          ? TRUE : FALSE;
 
+   /* The blit and linear paths address textures directly and only know
+    * the linear layout.
+    */
+   boolean tiled_textures = FALSE;
+   for (unsigned i = 0; i < MAX2(key->nr_samplers, key->nr_sampler_views); i++) {
+      if (lp_fs_variant_key_samplers(key)[i].texture_state.tiled)
+         tiled_textures = TRUE;
+   }
+
    /* We only care about opaque blits for now */
-   if (variant->opaque &&
+   if (variant->opaque && !tiled_textures &&
        (shader->kind == LP_FS_KIND_BLIT_RGBA ||
         shader->kind == LP_FS_KIND_BLIT_RGB1)) {
       const struct lp_sampler_static_state *samp0 =
@@ -3855,6 +3911,7 @@ generate_variant(struct llvmpipe_context *lp,
     * the linear path.
     */
    const boolean linear_pipeline =
+         !tiled_textures &&
          !key->stencil[0].enabled &&
          !key->depth.enabled &&
          !shader->info.base.uses_kill &&
@@ -3862,6 +3919,33 @@ generate_variant(struct llvmpipe_context *lp,
          (key->cbuf_format[0] == PIPE_FORMAT_B8G8R8A8_UNORM ||
           key->cbuf_format[0] == PIPE_FORMAT_B8G8R8X8_UNORM);
 
+   /* Only a fallback if there is actually something to leave out. */
+   variant->fallback = fallback && (variant->opaque || linear_pipeline);
+
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+   struct lp_cached_code cached = { 0 };
+   unsigned char ir_sha1_cache_key[20];
+   bool needs_caching = false;
+   if (shader->base.ir.nir) {
+      lp_fs_get_ir_cache_key(variant, ir_sha1_cache_key);
+
+      lp_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
+      if (!cached.data_size)
+         needs_caching = true;
+   }
+
+   variant->no = p_atomic_inc_return(&shader->variants_created) - 1;
+
+   char module_name[64];
+   snprintf(module_name, sizeof(module_name), "fs%u_variant%u",
+            shader->no, variant->no);
+   variant->gallivm = gallivm_create(module_name, context, &cached);
+   if (!variant->gallivm) {
+      lp_fs_reference(lp, &variant->shader, NULL);
+      FREE(variant);
+      return NULL;
+   }
+
    memcpy(&variant->key, key, sizeof *key);
 
    if ((LP_DEBUG & DEBUG_FS) || (gallivm_debug & GALLIVM_DEBUG_IR)) {
@@ -3870,19 +3954,13 @@ generate_variant(struct llvmpipe_context *lp,
 
    llvmpipe_fs_variant_fastpath(variant);
 
-   lp_jit_init_types(variant);
-
-   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
-      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
-
-   if (variant->jit_function[RAST_WHOLE] == NULL) {
-      if (variant->opaque) {
-         /* Specialized shader, which doesn't need to read the color buffer. */
-         generate_fragment(lp, shader, variant, RAST_WHOLE);
-      }
-   }
+   const bool gen_edge = variant->jit_function[RAST_EDGE_TEST] == NULL;
+   /* Specialized shader, which doesn't need to read the color buffer. */
+   const bool gen_whole = variant->jit_function[RAST_WHOLE] == NULL &&
+                          variant->opaque && !variant->fallback;
+   bool gen_linear = false;
 
-   if (linear_pipeline) {
+   if (linear_pipeline && !variant->fallback) {
       /* Currently keeping both the old fastpaths and new linear path
        * active.  The older code is still somewhat faster for the cases
        * it covers.
@@ -3898,20 +3976,32 @@ generate_variant(struct llvmpipe_context *lp,
       /* If the original fastpath doesn't cover this variant, try the new
        * code:
        */
-      if (variant->jit_linear == NULL) {
-         if (shader->kind == LP_FS_KIND_BLIT_RGBA ||
-             shader->kind == LP_FS_KIND_BLIT_RGB1 ||
-             shader->kind == LP_FS_KIND_LLVM_LINEAR) {
-            llvmpipe_fs_variant_linear_llvm(lp, shader, variant);
-         }
-      }
-   } else {
+      gen_linear = variant->jit_linear == NULL &&
+                   (shader->kind == LP_FS_KIND_BLIT_RGBA ||
+                    shader->kind == LP_FS_KIND_BLIT_RGB1 ||
+                    shader->kind == LP_FS_KIND_LLVM_LINEAR);
+   } else if (!linear_pipeline) {
       if (LP_DEBUG & DEBUG_LINEAR) {
          lp_debug_fs_variant(variant);
          debug_printf("    ----> no linear path for this variant\n");
       }
    }
 
+   /*
+    * On a disk cache hit the functions are taken from the cached object
+    * code by name, so there is no IR to build.
+    */
+   if (!cached.data_size) {
+      lp_jit_init_types(variant);
+
+      if (gen_edge)
+         generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
+      if (gen_whole)
+         generate_fragment(lp, shader, variant, RAST_WHOLE);
+      if (gen_linear)
+         llvmpipe_fs_variant_linear_llvm(lp, shader, variant);
+   }
+
    /*
     * Compile everything
     */
@@ -3920,25 +4010,26 @@ generate_variant(struct llvmpipe_context *lp,
 
    variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
 
-   if (variant->function[RAST_EDGE_TEST]) {
+   if (gen_edge) {
       variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
-            gallivm_jit_function(variant->gallivm,
-                                 variant->function[RAST_EDGE_TEST]);
+            gallivm_jit_function_by_name(variant->gallivm,
+                                         LP_FS_FUNC_NAME_PARTIAL);
    }
 
-   if (variant->function[RAST_WHOLE]) {
+   if (gen_whole) {
       variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
-         gallivm_jit_function(variant->gallivm,
-                              variant->function[RAST_WHOLE]);
+         gallivm_jit_function_by_name(variant->gallivm,
+                                      LP_FS_FUNC_NAME_WHOLE);
    } else if (!variant->jit_function[RAST_WHOLE]) {
       variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
          variant->jit_function[RAST_EDGE_TEST];
    }
 
-   if (linear_pipeline) {
-      if (variant->linear_function) {
+   if (linear_pipeline && !variant->fallback) {
+      if (gen_linear) {
          variant->jit_linear_llvm = (lp_jit_linear_llvm_func)
-            gallivm_jit_function(variant->gallivm, variant->linear_function);
+            gallivm_jit_function_by_name(variant->gallivm,
+                                         LP_FS_FUNC_NAME_LINEAR);
       }
 
       /*
@@ -3982,6 +4073,7 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
    } else {
       shader->base.ir.nir = templ->ir.nir;
       nir_tgsi_scan_shader(templ->ir.nir, &shader->info.base, true);
+      lp_fs_get_ir_sha1(shader);
    }
 
    shader->draw_data = draw_create_fragment_shader(llvmpipe->draw, templ);
@@ -4116,7 +4208,22 @@ void
 llvmpipe_destroy_shader_variant(struct llvmpipe_context *lp,
                                 struct lp_fragment_shader_variant *variant)
 {
+   struct lp_fs_specialize_job *job = variant->specialize;
+   if (job) {
+      /* The job reads our key, so it must be done before we go away. */
+      util_queue_fence_wait(&job->fence);
+      if (job->result)
+         llvmpipe_destroy_shader_variant(lp, job->result);
+      util_queue_fence_destroy(&job->fence);
+      FREE(job);
+   }
+
+   if (lp->fs_fallback == variant)
+      lp->fs_fallback = NULL;
+
    gallivm_destroy(variant->gallivm);
+   if (variant->context)
+      LLVMContextDispose(variant->context);
    lp_fs_reference(lp, &variant->shader, NULL);
    FREE(variant);
 }
@@ -4272,6 +4379,7 @@ llvmpipe_set_shader_images(struct pipe_context *pipe,
 
       if (image && image->resource) {
          bool read_only = !(image->access & PIPE_IMAGE_ACCESS_WRITE);
+         assert(!(image->resource->flags & LP_RESOURCE_FLAG_TILED));
          llvmpipe_flush_resource(pipe, image->resource, 0, read_only, false,
                                  false, "image");
       }
@@ -4588,6 +4696,88 @@ make_variant_key(struct llvmpipe_context *lp,
 }
 
 
+static void
+lp_fs_specialize_execute(void *data, void *gdata, int thread_index)
+{
+   struct lp_fs_specialize_job *job = data;
+   struct lp_fragment_shader_variant *fallback = job->fallback;
+
+   /* The context's LLVMContext belongs to the application thread. */
+   LLVMContextRef context = LLVMContextCreate();
+   if (!context)
+      return;
+#if LLVM_VERSION_MAJOR >= 15
+   LLVMContextSetOpaquePointers(context, false);
+#endif
+
+   job->result = generate_variant(job->lp, context, fallback->shader,
+                                  &fallback->key, false);
+   if (job->result)
+      job->result->context = context;
+   else
+      LLVMContextDispose(context);
+}
+
+
+static void
+lp_fs_variant_add(struct llvmpipe_context *lp,
+                  struct lp_fragment_shader_variant *variant)
+{
+   list_add(&variant->list_item_local.list, &variant->shader->variants.list);
+   list_add(&variant->list_item_global.list, &lp->fs_variants_list.list);
+   lp->nr_fs_variants++;
+   lp->nr_fs_instrs += variant->nr_instrs;
+   variant->shader->variants_cached++;
+}
+
+
+/**
+ * Replace a fallback variant by its full version once that is built.
+ * Returns the variant to use from now on.
+ */
+static struct lp_fragment_shader_variant *
+lp_fs_variant_specialize(struct llvmpipe_context *lp,
+                         struct lp_fragment_shader_variant *fallback)
+{
+   struct lp_fs_specialize_job *job = fallback->specialize;
+
+   if (!util_queue_fence_is_signalled(&job->fence))
+      return fallback;
+
+   struct lp_fragment_shader_variant *variant = job->result;
+   util_queue_fence_destroy(&job->fence);
+   FREE(job);
+   fallback->specialize = NULL;
+
+   /* If the full build failed, just keep using the fallback. */
+   if (!variant)
+      return fallback;
+
+   /* Scenes still in flight hold their own references to the fallback. */
+   llvmpipe_remove_shader_variant(lp, fallback);
+   lp_fs_variant_reference(lp, &fallback, NULL);
+   lp_fs_variant_add(lp, variant);
+
+   return variant;
+}
+
+
+/**
+ * Called before every draw while a fallback variant is bound, whether or
+ * not any state changed: once its full version is ready, flag the fragment
+ * shader dirty so llvmpipe_update_fs() swaps it in and the derived state
+ * depending on the variant is recomputed.
+ */
+void
+llvmpipe_update_fs_fallback(struct llvmpipe_context *lp)
+{
+   struct lp_fs_specialize_job *job = lp->fs_fallback->specialize;
+
+   if (util_queue_fence_is_signalled(&job->fence))
+      lp->dirty |= LP_NEW_FS;
+}
+
+
 /**
  * Update fragment shader state.  This is called just prior to drawing
  * something when some fragment-related state has changed.
@@ -4612,6 +4802,9 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
    }
 
    if (variant) {
+      if (variant->specialize)
+         variant = lp_fs_variant_specialize(lp, variant);
+
       /* Move this variant to the head of the list to implement LRU
        * deletion of shader's when we have too many.
        */
@@ -4668,10 +4861,13 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
       }
 
       /*
-       * Generate the new variant.
+       * Generate the new variant.  With asynchronous compilation, only a
+       * cheaper fallback is built here and the full variant is queued.
        */
+      struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
       int64_t t0 = os_time_get();
-      variant = generate_variant(lp, shader, key);
+      variant = generate_variant(lp, lp->context, shader, key,
+                                 screen->async_fs_compile);
       int64_t t1 = os_time_get();
       int64_t dt = t1 - t0;
       LP_COUNT_ADD(llvm_compile_time, dt);
@@ -4679,15 +4875,24 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
 
       /* Put the new variant into the list */
       if (variant) {
-         list_add(&variant->list_item_local.list, &shader->variants.list);
-         list_add(&variant->list_item_global.list, &lp->fs_variants_list.list);
-         lp->nr_fs_variants++;
-         lp->nr_fs_instrs += variant->nr_instrs;
-         shader->variants_cached++;
+         lp_fs_variant_add(lp, variant);
+
+         if (variant->fallback) {
+            struct lp_fs_specialize_job *job = CALLOC_STRUCT(lp_fs_specialize_job);
+            if (job) {
+               util_queue_fence_init(&job->fence);
+               job->lp = lp;
+               job->fallback = variant;
+               variant->specialize = job;
+               util_queue_add_job(&screen->fs_compile_queue, job, &job->fence,
+                                  lp_fs_specialize_execute, NULL, 0);
+            }
+         }
       }
    }
 
    /* Bind this variant */
+   lp->fs_fallback = variant && variant->specialize ? variant : NULL;
    lp_setup_set_fs_variant(lp->setup, variant);
 }
 
@@ -42,12 +42,18 @@
 
 struct tgsi_token;
 struct lp_fragment_shader;
+struct lp_fs_specialize_job;
 
 
 /** Indexes into jit_function[] array */
 #define RAST_WHOLE 0
 #define RAST_EDGE_TEST 1
 
+/** Names of the generated functions, to find them in cached object code */
+#define LP_FS_FUNC_NAME_WHOLE "fs_variant_whole"
+#define LP_FS_FUNC_NAME_PARTIAL "fs_variant_partial"
+#define LP_FS_FUNC_NAME_LINEAR "fs_variant_linear2"
+
 
 enum lp_fs_kind
 {
@@ -168,11 +174,24 @@ struct lp_fragment_shader_variant
 
    unsigned opaque:1;
    unsigned blit:1;
+   /*
+    * Built without the opaque whole-tile function and the linear path,
+    * while the full variant compiles in the background.
+    */
+   unsigned fallback:1;
    unsigned linear_input_mask:16;
    struct pipe_reference reference;
 
    struct gallivm_state *gallivm;
 
+   /* Only set for variants built off the context's thread, which need an
+    * LLVM context of their own.
+    */
+   LLVMContextRef context;
+
+   /* Pending background build of the full variant, for fallback variants */
+   struct lp_fs_specialize_job *specialize;
+
    LLVMTypeRef jit_context_type;
    LLVMTypeRef jit_context_ptr_type;
    LLVMTypeRef jit_thread_data_type;
@@ -233,6 +252,9 @@ struct lp_fragment_shader
    unsigned variants_created;
    unsigned variants_cached;
 
+   /** sha1 of the serialized NIR, used for the disk cache keys */
+   unsigned char ir_sha1[20];
+
    /** Fragment shader input interpolation info */
    struct lp_shader_input inputs[PIPE_MAX_SHADER_INPUTS];
 };
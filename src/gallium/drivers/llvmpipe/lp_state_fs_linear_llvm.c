@@ -279,8 +279,7 @@ llvmpipe_fs_variant_linear_llvm(struct llvmpipe_context *lp,
     * lp_jit.h's lp_jit_frag_func function pointer type, and vice-versa.
     */
 
-   char func_name[256];
-   snprintf(func_name, sizeof(func_name), "fs_variant_linear2");
+   const char *func_name = LP_FS_FUNC_NAME_LINEAR;
 
    LLVMTypeRef ret_type = pint8t;
    LLVMTypeRef arg_types[4];
@@ -307,9 +306,6 @@ llvmpipe_fs_variant_linear_llvm(struct llvmpipe_context *lp,
       }
    }
 
-   if (variant->gallivm->cache->data_size)
-      return;
-
    LLVMValueRef context_ptr = LLVMGetParam(function, 0);
    LLVMValueRef x = LLVMGetParam(function, 1);
    LLVMValueRef y = LLVMGetParam(function, 2);
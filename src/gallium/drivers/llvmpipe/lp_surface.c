@@ -216,6 +216,10 @@ llvmpipe_create_surface(struct pipe_context *pipe,
       }
    }
 
+   /* Tiled textures can't be rendered to, see llvmpipe_texture_can_tile(). */
+   if (pt->flags & LP_RESOURCE_FLAG_TILED)
+      return NULL;
+
    struct pipe_surface *ps = CALLOC_STRUCT(pipe_surface);
    if (ps) {
       pipe_reference_init(&ps->reference, 1);
@@ -0,0 +1,267 @@
+/**************************************************************************
+ *
+ * Copyright 2023 The Mesa Authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Unit tests and micro-benchmark for the compute shader thread pool.
+ *
+ * The tests check that every iteration of a task runs exactly once,
+ * including when several tasks are queued at the same time and when a
+ * task has no iterations at all.  Only with "-o <file>" the benchmark
+ * also runs, reporting dispatches per second for tiny and for unevenly
+ * sized dispatches, and how throughput scales with the number of threads.
+ * Run with "0" as argument to sweep all thread counts up to the number of
+ * CPUs.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_memory.h"
+#include "util/os_time.h"
+
+#include "lp_cs_tpool.h"
+#include "lp_test.h"
+
+
+struct tpool_test_job {
+   unsigned num_iters;
+   unsigned spin;          /**< cost of the most expensive iteration */
+   unsigned *executed;     /**< number of times each iteration ran */
+   unsigned local_size;
+};
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "threads\t"
+           "iterations\t"
+           "dispatches_per_sec\t"
+           "speedup\n");
+
+   fflush(fp);
+}
+
+
+static void
+tpool_test_work(void *data, int iter_idx, struct lp_cs_local_mem *lmem)
+{
+   struct tpool_test_job *job = data;
+
+   if (lmem->local_size < job->local_size) {
+      lmem->local_mem_ptr = REALLOC(lmem->local_mem_ptr, lmem->local_size,
+                                    job->local_size);
+      lmem->local_size = job->local_size;
+   }
+
+   /* Make the cost of the iterations uneven, like workgroups which take
+    * different branches.
+    */
+   volatile unsigned sink = 0;
+   unsigned spin = job->spin * (iter_idx % 8) / 8;
+   for (unsigned i = 0; i < spin; i++)
+      sink += i;
+
+   p_atomic_inc(&job->executed[iter_idx]);
+}
+
+
+static boolean
+check_job(unsigned verbose, const struct tpool_test_job *job)
+{
+   for (unsigned i = 0; i < job->num_iters; i++) {
+      if (job->executed[i] != 1) {
+         if (verbose)
+            printf("iteration %u of %u executed %u times\n",
+                   i, job->num_iters, job->executed[i]);
+         return FALSE;
+      }
+   }
+   return TRUE;
+}
+
+
+/**
+ * Queue num_jobs tasks at once, then wait for all of them.
+ */
+static boolean
+test_concurrent(unsigned verbose, struct lp_cs_tpool *pool,
+                unsigned num_jobs, unsigned num_iters, unsigned spin)
+{
+   struct tpool_test_job *jobs = CALLOC(num_jobs, sizeof(*jobs));
+   struct lp_cs_tpool_task **tasks = CALLOC(num_jobs, sizeof(*tasks));
+   boolean success = TRUE;
+
+   for (unsigned j = 0; j < num_jobs; j++) {
+      jobs[j].num_iters = num_iters;
+      jobs[j].spin = spin;
+      jobs[j].local_size = 64 * (j + 1);
+      jobs[j].executed = CALLOC(MAX2(num_iters, 1), sizeof(unsigned));
+      tasks[j] = lp_cs_tpool_queue_task(pool, tpool_test_work, &jobs[j],
+                                        num_iters);
+   }
+
+   for (unsigned j = 0; j < num_jobs; j++) {
+      lp_cs_tpool_wait_for_task(pool, &tasks[j]);
+      success = success && check_job(verbose, &jobs[j]) && !tasks[j];
+      FREE(jobs[j].executed);
+   }
+
+   FREE(tasks);
+   FREE(jobs);
+   return success;
+}
+
+
+/**
+ * Run num_dispatches back-to-back dispatches of num_iters iterations each
+ * and return the number of dispatches per second.
+ */
+static double
+bench_dispatches(struct lp_cs_tpool *pool, unsigned num_dispatches,
+                 unsigned num_iters, unsigned spin, boolean *success)
+{
+   struct tpool_test_job job;
+   int64_t start, end;
+
+   job.num_iters = num_iters;
+   job.spin = spin;
+   job.local_size = 0;
+   job.executed = CALLOC(num_iters, sizeof(unsigned));
+
+   start = os_time_get_nano();
+   for (unsigned d = 0; d < num_dispatches; d++) {
+      struct lp_cs_tpool_task *task =
+         lp_cs_tpool_queue_task(pool, tpool_test_work, &job, num_iters);
+      lp_cs_tpool_wait_for_task(pool, &task);
+   }
+   end = os_time_get_nano();
+
+   for (unsigned i = 0; i < num_iters; i++) {
+      if (job.executed[i] != num_dispatches)
+         *success = FALSE;
+   }
+   FREE(job.executed);
+
+   return num_dispatches * 1e9 / MAX2(end - start, 1);
+}
+
+
+static boolean
+test_pool(unsigned verbose, FILE *fp, unsigned num_threads,
+          unsigned num_dispatches, const double *base_rate, double *rate)
+{
+   static const struct {
+      unsigned num_iters;
+      unsigned spin;
+   } benches[] = {
+      { 1, 0 },         /* tiny dispatches, pure overhead */
+      { 64, 0 },        /* small dispatches */
+      { 256, 20000 },   /* uneven workgroup cost */
+   };
+   struct lp_cs_tpool *pool = lp_cs_tpool_create(num_threads);
+   boolean success = TRUE;
+
+   if (!pool)
+      return FALSE;
+
+   success = success && test_concurrent(verbose, pool, 1, 0, 0);
+   success = success && test_concurrent(verbose, pool, 1, 1, 0);
+   success = success && test_concurrent(verbose, pool, 1, 1000, 100);
+   success = success && test_concurrent(verbose, pool, 8, 333, 100);
+
+   /* The timing loop is a benchmark, not a test: only run it on request */
+   for (unsigned b = 0; fp && b < ARRAY_SIZE(benches); b++) {
+      unsigned n = benches[b].spin ? MAX2(num_dispatches / 16, 1) : num_dispatches;
+      rate[b] = bench_dispatches(pool, n, benches[b].num_iters,
+                                 benches[b].spin, &success);
+      double speedup = base_rate ? rate[b] / base_rate[b] : 1.0;
+
+      if (verbose)
+         printf("%u threads, %u iterations: %.0f dispatches/s (%.2fx)\n",
+                num_threads, benches[b].num_iters, rate[b], speedup);
+
+      fprintf(fp, "%s\t%u\t%u\t%.0f\t%.2f\n", success ? "pass" : "fail",
+              num_threads, benches[b].num_iters, rate[b], speedup);
+      fflush(fp);
+   }
+
+   lp_cs_tpool_destroy(pool);
+
+   if (!success)
+      printf("FAILED: %u threads\n", num_threads);
+
+   return success;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   unsigned max_threads = MAX2(util_get_cpu_caps()->nr_cpus, 1);
+   double base_rate[3], rate[3];
+   boolean success = TRUE;
+
+   /* No threads at all: everything runs in the calling thread. */
+   success = success && test_pool(verbose, fp, 0, 1000, NULL, base_rate);
+
+   for (unsigned num_threads = 1; ; num_threads *= 2) {
+      num_threads = MIN2(num_threads, max_threads);
+      success = success && test_pool(verbose, fp, num_threads, 10000,
+                                     num_threads == 1 ? NULL : base_rate,
+                                     num_threads == 1 ? base_rate : rate);
+      if (num_threads == max_threads)
+         break;
+   }
+
+   return success;
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   unsigned num_threads = MAX2(util_get_cpu_caps()->nr_cpus, 1);
+   double rate[3];
+
+   return test_pool(verbose, fp, num_threads, n, NULL, rate);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   double rate[3];
+
+   return test_pool(verbose, fp, 1, 100, NULL, rate);
+}
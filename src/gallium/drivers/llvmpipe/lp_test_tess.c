@@ -0,0 +1,538 @@
+/**************************************************************************
+ *
+ * Copyright 2023 The Mesa Authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Unit tests and micro-benchmark for the tessellation pattern cache.
+ *
+ * Patches are drawn through llvmpipe with a TCS and a TES, for each
+ * tessellation domain.  The TCS picks the levels of a patch from a few
+ * LODs, and writes the primitive id into the factors the domain doesn't
+ * read.  The tests check that the tessellator ran once per LOD and served
+ * every other patch from its cache, and that the number of TES invocations
+ * matches a tessellator without a cache.  Only with "-o <file>" the draws
+ * are also timed.
+ */
+
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "frontend/sw_winsys.h"
+#include "gallium/winsys/sw/null/null_sw_winsys.h"
+#include "nir/tgsi_to_nir.h"
+#include "nir_builder.h"
+#include "tessellator/p_tessellator.h"
+#include "tgsi/tgsi_ureg.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_prim.h"
+#include "util/os_time.h"
+
+#include "draw/draw_tess.h"
+#include "lp_context.h"
+#include "lp_public.h"
+#include "lp_test.h"
+
+
+#define NUM_LODS 4
+
+
+struct tess_test_ctx {
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct pipe_resource *vbuf;
+   void *vs, *fs, *rast, *blend, *dsa, *velems;
+};
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "domain\t"
+           "patches\t"
+           "tessellations\t"
+           "cache_hits\t"
+           "patches_per_sec\n");
+
+   fflush(fp);
+}
+
+
+static void *
+create_shader(struct tess_test_ctx *ctx, struct ureg_program *ureg,
+              enum pipe_shader_type stage)
+{
+   struct pipe_shader_state state = {0};
+   const struct tgsi_token *tokens = ureg_get_tokens(ureg, NULL);
+
+   state.type = PIPE_SHADER_IR_NIR;
+   state.ir.nir = tgsi_to_nir(tokens, ctx->screen, false);
+   ureg_free_tokens(tokens);
+   ureg_destroy(ureg);
+
+   if (stage == PIPE_SHADER_VERTEX)
+      return ctx->pipe->create_vs_state(ctx->pipe, &state);
+   else
+      return ctx->pipe->create_fs_state(ctx->pipe, &state);
+}
+
+
+/**
+ * Pass the position through, and the LOD of each vertex as a generic.
+ */
+static void *
+create_vs(struct tess_test_ctx *ctx)
+{
+   struct ureg_program *ureg = ureg_create(PIPE_SHADER_VERTEX);
+
+   ureg_MOV(ureg, ureg_DECL_output(ureg, TGSI_SEMANTIC_POSITION, 0),
+            ureg_DECL_vs_input(ureg, 0));
+   ureg_MOV(ureg, ureg_DECL_output(ureg, TGSI_SEMANTIC_GENERIC, 0),
+            ureg_DECL_vs_input(ureg, 1));
+   ureg_END(ureg);
+
+   return create_shader(ctx, ureg, PIPE_SHADER_VERTEX);
+}
+
+
+static void *
+create_nir_shader(struct tess_test_ctx *ctx, nir_shader *nir)
+{
+   struct pipe_shader_state state = {0};
+
+   nir_validate_shader(nir, "lp_test_tess");
+   nir_shader_gather_info(nir, nir_shader_get_entrypoint(nir));
+   if (ctx->screen->finalize_nir)
+      ctx->screen->finalize_nir(ctx->screen, nir);
+
+   state.type = PIPE_SHADER_IR_NIR;
+   state.ir.nir = nir;
+
+   if (nir->info.stage == MESA_SHADER_TESS_CTRL)
+      return ctx->pipe->create_tcs_state(ctx->pipe, &state);
+   else
+      return ctx->pipe->create_tes_state(ctx->pipe, &state);
+}
+
+
+static nir_variable *
+create_var(nir_shader *nir, nir_variable_mode mode, const struct glsl_type *type,
+           const char *name, unsigned location, unsigned driver_location)
+{
+   nir_variable *var = nir_variable_create(nir, mode, type, name);
+
+   var->data.location = location;
+   var->data.driver_location = driver_location;
+   return var;
+}
+
+
+/**
+ * Take the levels from the LOD of the first vertex, and put the primitive
+ * id into the levels the domain ignores, so they differ on every patch.
+ * TGSI can't describe tessellation shaders for tgsi_to_nir, so the TCS
+ * and the TES are built in NIR directly.
+ */
+static void *
+create_tcs(struct tess_test_ctx *ctx, enum pipe_prim_type prim_mode)
+{
+   const nir_shader_compiler_options *options =
+      ctx->screen->get_compiler_options(ctx->screen, PIPE_SHADER_IR_NIR,
+                                        PIPE_SHADER_TESS_CTRL);
+   nir_builder b = nir_builder_init_simple_shader(MESA_SHADER_TESS_CTRL,
+                                                  options, "tess cache tcs");
+   const struct glsl_type *in_type = glsl_array_type(glsl_vec4_type(), 32, 0);
+   const struct glsl_type *out_type = glsl_array_type(glsl_vec4_type(), 3, 0);
+   unsigned num_outer, num_inner;
+
+   switch (prim_mode) {
+   case PIPE_PRIM_QUADS:
+      num_outer = 4;
+      num_inner = 2;
+      break;
+   case PIPE_PRIM_TRIANGLES:
+      num_outer = 3;
+      num_inner = 1;
+      break;
+   default:
+      num_outer = 2;
+      num_inner = 0;
+      break;
+   }
+
+   nir_variable *in_pos = create_var(b.shader, nir_var_shader_in, in_type,
+                                     "in_pos", VARYING_SLOT_POS, 0);
+   nir_variable *in_lod = create_var(b.shader, nir_var_shader_in, in_type,
+                                     "in_lod", VARYING_SLOT_VAR0, 1);
+   nir_variable *out_pos = create_var(b.shader, nir_var_shader_out, out_type,
+                                      "out_pos", VARYING_SLOT_POS, 0);
+   nir_variable *out_outer = create_var(b.shader, nir_var_shader_out,
+                                        glsl_vec4_type(), "tess outer",
+                                        VARYING_SLOT_TESS_LEVEL_OUTER, 1);
+   nir_variable *out_inner = create_var(b.shader, nir_var_shader_out,
+                                        glsl_vec_type(2), "tess inner",
+                                        VARYING_SLOT_TESS_LEVEL_INNER, 2);
+   out_outer->data.patch = true;
+   out_inner->data.patch = true;
+
+   nir_ssa_def *id = nir_load_invocation_id(&b);
+   nir_store_array_var(&b, out_pos, id, nir_load_array_var(&b, in_pos, id), 0xf);
+
+   nir_ssa_def *lod = nir_channel(&b, nir_load_array_var_imm(&b, in_lod, 0), 0);
+   nir_ssa_def *prim_id = nir_u2f32(&b, nir_load_primitive_id(&b));
+   nir_ssa_def *outer[4], *inner[2];
+
+   for (unsigned i = 0; i < 4; i++)
+      outer[i] = i < num_outer ? lod : prim_id;
+   for (unsigned i = 0; i < 2; i++)
+      inner[i] = i < num_inner ? lod : prim_id;
+   nir_store_var(&b, out_outer, nir_vec(&b, outer, 4), 0xf);
+   nir_store_var(&b, out_inner, nir_vec(&b, inner, 2), 0x3);
+
+   b.shader->num_inputs = 2;
+   b.shader->num_outputs = 3;
+   b.shader->info.tess.tcs_vertices_out = 3;
+
+   return create_nir_shader(ctx, b.shader);
+}
+
+
+static void *
+create_tes(struct tess_test_ctx *ctx, enum pipe_prim_type prim_mode)
+{
+   const nir_shader_compiler_options *options =
+      ctx->screen->get_compiler_options(ctx->screen, PIPE_SHADER_IR_NIR,
+                                        PIPE_SHADER_TESS_EVAL);
+   nir_builder b = nir_builder_init_simple_shader(MESA_SHADER_TESS_EVAL,
+                                                  options, "tess cache tes");
+
+   nir_variable *in_pos =
+      create_var(b.shader, nir_var_shader_in,
+                 glsl_array_type(glsl_vec4_type(), 32, 0), "in_pos",
+                 VARYING_SLOT_POS, 0);
+   nir_variable *out_pos = create_var(b.shader, nir_var_shader_out,
+                                      glsl_vec4_type(), "out_pos",
+                                      VARYING_SLOT_POS, 0);
+
+   nir_ssa_def *coord = nir_load_tess_coord(&b);
+   nir_ssa_def *pos = nir_load_array_var_imm(&b, in_pos, 0);
+   nir_store_var(&b, out_pos,
+                 nir_vec4(&b,
+                          nir_fadd(&b, nir_channel(&b, pos, 0), nir_channel(&b, coord, 0)),
+                          nir_fadd(&b, nir_channel(&b, pos, 1), nir_channel(&b, coord, 1)),
+                          nir_fadd(&b, nir_channel(&b, pos, 2), nir_channel(&b, coord, 2)),
+                          nir_imm_float(&b, 1.0f)),
+                 0xf);
+
+   b.shader->num_inputs = 1;
+   b.shader->num_outputs = 1;
+   b.shader->info.tess._primitive_mode =
+      prim_mode == PIPE_PRIM_QUADS ? TESS_PRIMITIVE_QUADS :
+      prim_mode == PIPE_PRIM_TRIANGLES ? TESS_PRIMITIVE_TRIANGLES :
+                                         TESS_PRIMITIVE_ISOLINES;
+   b.shader->info.tess.spacing = TESS_SPACING_FRACTIONAL_ODD;
+   b.shader->info.tess.ccw = true;
+
+   return create_nir_shader(ctx, b.shader);
+}
+
+
+static void *
+create_fs(struct tess_test_ctx *ctx)
+{
+   struct ureg_program *ureg = ureg_create(PIPE_SHADER_FRAGMENT);
+
+   ureg_END(ureg);
+
+   return create_shader(ctx, ureg, PIPE_SHADER_FRAGMENT);
+}
+
+
+static float
+patch_lod(unsigned patch)
+{
+   return 1.0f + 2.0f * (patch % NUM_LODS);
+}
+
+
+static boolean
+create_context(struct tess_test_ctx *ctx, unsigned num_patches)
+{
+   struct pipe_rasterizer_state rast = {0};
+   struct pipe_blend_state blend = {0};
+   struct pipe_depth_stencil_alpha_state dsa = {0};
+   struct pipe_vertex_element velems[2] = {0};
+   struct pipe_framebuffer_state fb = {0};
+   float (*verts)[5];
+
+   ctx->screen = llvmpipe_create_screen(null_sw_create());
+   if (!ctx->screen)
+      return FALSE;
+   ctx->pipe = ctx->screen->context_create(ctx->screen, NULL, 0);
+   if (!ctx->pipe)
+      return FALSE;
+
+   /* three vertices per patch: position, then the LOD of the patch */
+   verts = CALLOC(num_patches * 3, sizeof(*verts));
+   for (unsigned i = 0; i < num_patches * 3; i++) {
+      verts[i][0] = (float)(i % 3);
+      verts[i][1] = (float)(i % 2);
+      verts[i][3] = 1.0f;
+      verts[i][4] = patch_lod(i / 3);
+   }
+   ctx->vbuf = pipe_buffer_create_with_data(ctx->pipe, PIPE_BIND_VERTEX_BUFFER,
+                                            PIPE_USAGE_IMMUTABLE,
+                                            num_patches * 3 * sizeof(*verts),
+                                            verts);
+   FREE(verts);
+
+   velems[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   velems[1].src_offset = 4 * sizeof(float);
+   velems[1].src_format = PIPE_FORMAT_R32_FLOAT;
+   ctx->velems = ctx->pipe->create_vertex_elements_state(ctx->pipe, 2, velems);
+
+   /* only the geometry stages matter here */
+   rast.rasterizer_discard = 1;
+   rast.half_pixel_center = 1;
+   rast.depth_clip_near = 1;
+   rast.depth_clip_far = 1;
+   ctx->rast = ctx->pipe->create_rasterizer_state(ctx->pipe, &rast);
+   ctx->blend = ctx->pipe->create_blend_state(ctx->pipe, &blend);
+   ctx->dsa = ctx->pipe->create_depth_stencil_alpha_state(ctx->pipe, &dsa);
+
+   ctx->vs = create_vs(ctx);
+   ctx->fs = create_fs(ctx);
+   if (!ctx->vbuf || !ctx->velems || !ctx->rast || !ctx->blend || !ctx->dsa ||
+       !ctx->vs || !ctx->fs)
+      return FALSE;
+
+   fb.width = 64;
+   fb.height = 64;
+   fb.layers = 1;
+   ctx->pipe->set_framebuffer_state(ctx->pipe, &fb);
+   ctx->pipe->bind_vertex_elements_state(ctx->pipe, ctx->velems);
+   ctx->pipe->bind_rasterizer_state(ctx->pipe, ctx->rast);
+   ctx->pipe->bind_blend_state(ctx->pipe, ctx->blend);
+   ctx->pipe->bind_depth_stencil_alpha_state(ctx->pipe, ctx->dsa);
+   ctx->pipe->bind_vs_state(ctx->pipe, ctx->vs);
+   ctx->pipe->bind_fs_state(ctx->pipe, ctx->fs);
+   ctx->pipe->set_patch_vertices(ctx->pipe, 3);
+   return TRUE;
+}
+
+
+static void
+destroy_context(struct tess_test_ctx *ctx)
+{
+   if (ctx->pipe) {
+      if (ctx->vs)
+         ctx->pipe->delete_vs_state(ctx->pipe, ctx->vs);
+      if (ctx->fs)
+         ctx->pipe->delete_fs_state(ctx->pipe, ctx->fs);
+      if (ctx->rast)
+         ctx->pipe->delete_rasterizer_state(ctx->pipe, ctx->rast);
+      if (ctx->blend)
+         ctx->pipe->delete_blend_state(ctx->pipe, ctx->blend);
+      if (ctx->dsa)
+         ctx->pipe->delete_depth_stencil_alpha_state(ctx->pipe, ctx->dsa);
+      if (ctx->velems)
+         ctx->pipe->delete_vertex_elements_state(ctx->pipe, ctx->velems);
+      pipe_resource_reference(&ctx->vbuf, NULL);
+      ctx->pipe->destroy(ctx->pipe);
+   }
+   if (ctx->screen)
+      ctx->screen->destroy(ctx->screen);
+}
+
+
+/**
+ * Number of TES invocations for num_patches patches, from a tessellator
+ * which is re-created for every patch so that it can't use its cache.
+ */
+static uint64_t
+expected_ds_invocations(enum pipe_prim_type prim_mode, unsigned num_patches)
+{
+   uint64_t count = 0;
+
+   for (unsigned i = 0; i < num_patches; i++) {
+      struct pipe_tessellator *ptess =
+         p_tess_init(prim_mode, PIPE_TESS_SPACING_FRACTIONAL_ODD, true, false);
+      struct pipe_tessellation_factors factors = {0};
+      struct pipe_tessellator_data data;
+
+      for (unsigned j = 0; j < 4; j++)
+         factors.outer_tf[j] = patch_lod(i);
+      factors.inner_tf[0] = factors.inner_tf[1] = patch_lod(i);
+      p_tessellate(ptess, &factors, &data);
+      count += data.num_domain_points;
+      p_tess_destroy(ptess);
+   }
+   return count;
+}
+
+
+static boolean
+test_domain(unsigned verbose, FILE *fp, struct tess_test_ctx *ctx,
+            enum pipe_prim_type prim_mode, unsigned num_patches)
+{
+   struct llvmpipe_context *lp = llvmpipe_context(ctx->pipe);
+   struct pipe_context *pipe = ctx->pipe;
+   struct pipe_vertex_buffer vb = {0};
+   struct pipe_draw_info info = {0};
+   struct pipe_draw_start_count_bias draw = {0};
+   union pipe_query_result result;
+   uint64_t calls = 0, hits = 0;
+   boolean success = TRUE;
+   double rate = 0.0;
+
+   void *tcs = create_tcs(ctx, prim_mode);
+   void *tes = create_tes(ctx, prim_mode);
+   if (!tcs || !tes)
+      return FALSE;
+
+   vb.stride = 5 * sizeof(float);
+   vb.buffer.resource = ctx->vbuf;
+   pipe->set_vertex_buffers(pipe, 0, 1, 0, false, &vb);
+   pipe->bind_tcs_state(pipe, tcs);
+   pipe->bind_tes_state(pipe, tes);
+
+   info.mode = PIPE_PRIM_PATCHES;
+   info.instance_count = 1;
+   draw.count = num_patches * 3;
+
+   struct pipe_query *query =
+      pipe->create_query(pipe, PIPE_QUERY_PIPELINE_STATISTICS, 0);
+   pipe->begin_query(pipe, query);
+   pipe->draw_vbo(pipe, &info, 0, NULL, &draw, 1);
+   pipe->end_query(pipe, query);
+   pipe->get_query_result(pipe, query, true, &result);
+   pipe->destroy_query(pipe, query);
+
+   /* the draw module's TES owns the tessellator and its cache */
+   struct draw_tess_eval_shader *dtes = lp->draw->tes.tess_eval_shader;
+   if (dtes && dtes->ptess)
+      p_tess_get_stats(dtes->ptess, &calls, &hits);
+
+   if (calls != num_patches || hits != num_patches - NUM_LODS) {
+      if (verbose)
+         printf("%s: %" PRIu64 " tessellations, %" PRIu64 " cache hits\n",
+                u_prim_name(prim_mode), calls, hits);
+      success = FALSE;
+   }
+
+   uint64_t expected = expected_ds_invocations(prim_mode, num_patches);
+   if (result.pipeline_statistics.ds_invocations != expected) {
+      if (verbose)
+         printf("%s: %" PRIu64 " TES invocations, expected %" PRIu64 "\n",
+                u_prim_name(prim_mode),
+                result.pipeline_statistics.ds_invocations, expected);
+      success = FALSE;
+   }
+
+   /* The timing loop is a benchmark, not a test: only run it on request */
+   if (fp) {
+      const unsigned num_draws = 100;
+      int64_t start = os_time_get_nano();
+
+      for (unsigned d = 0; d < num_draws; d++)
+         pipe->draw_vbo(pipe, &info, 0, NULL, &draw, 1);
+      pipe->flush(pipe, NULL, 0);
+      rate = (double)num_draws * num_patches * 1e9 /
+             MAX2(os_time_get_nano() - start, 1);
+      p_tess_get_stats(dtes->ptess, &calls, &hits);
+   }
+
+   if (verbose)
+      printf("%s: %u patches, %" PRIu64 " tessellations, %" PRIu64
+             " cache hits\n", u_prim_name(prim_mode), num_patches, calls, hits);
+
+   if (fp) {
+      fprintf(fp, "%s\t%s\t%u\t%" PRIu64 "\t%" PRIu64 "\t%.0f\n",
+              success ? "pass" : "fail", u_prim_name(prim_mode),
+              num_patches, calls, hits, rate);
+      fflush(fp);
+   }
+
+   pipe->bind_tcs_state(pipe, NULL);
+   pipe->bind_tes_state(pipe, NULL);
+   pipe->delete_tcs_state(pipe, tcs);
+   pipe->delete_tes_state(pipe, tes);
+
+   if (!success)
+      printf("FAILED: %s\n", u_prim_name(prim_mode));
+
+   return success;
+}
+
+
+static boolean
+test_patches(unsigned verbose, FILE *fp, unsigned num_patches)
+{
+   static const enum pipe_prim_type domains[] = {
+      PIPE_PRIM_TRIANGLES,
+      PIPE_PRIM_QUADS,
+      PIPE_PRIM_LINES,
+   };
+   struct tess_test_ctx ctx = {0};
+   boolean success = create_context(&ctx, num_patches);
+
+   for (unsigned i = 0; success && i < ARRAY_SIZE(domains); i++)
+      success = test_domain(verbose, fp, &ctx, domains[i], num_patches);
+
+   destroy_context(&ctx);
+   return success;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   return test_patches(verbose, fp, 4096);
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_patches(verbose, fp, MAX2(n, NUM_LODS));
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_patches(verbose, fp, 64);
+}
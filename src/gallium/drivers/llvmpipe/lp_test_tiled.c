@@ -0,0 +1,667 @@
+/**************************************************************************
+ *
+ * Copyright 2009 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Unit tests and micro-benchmark for sampling textures stored in the
+ * LP_RESOURCE_FLAG_TILED layout.
+ *
+ * The same texels are stored once linearly and once in tiles, and sampled
+ * through both layouts.  The results must be identical, and nearest
+ * filtered texel centers must match the unpacked texels.  Sizes which are
+ * not multiples of the tile size, and both the SoA and AoS sampling paths,
+ * are covered.  Only with "-o <file>" the benchmark also runs, reporting
+ * bilinear sampling throughput of both layouts for a rotated traversal of
+ * a large texture.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "util/u_memory.h"
+#include "util/u_pointer.h"
+#include "util/os_time.h"
+#include "util/format/u_format.h"
+
+#include "gallivm/lp_bld.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_sample.h"
+#include "gallivm/lp_bld_type.h"
+
+#include "lp_limits.h"
+#include "lp_test.h"
+
+
+/**
+ * The texture description the generated code reads, in place of
+ * lp_jit_texture.
+ */
+struct tiled_test_texture
+{
+   const void *base;
+   uint32_t width;
+   uint32_t height;
+   uint32_t row_stride[LP_MAX_TEXTURE_LEVELS];
+   uint32_t img_stride[LP_MAX_TEXTURE_LEVELS];
+   uint32_t mip_offsets[LP_MAX_TEXTURE_LEVELS];
+};
+
+enum {
+   TILED_TEST_TEXTURE_BASE,
+   TILED_TEST_TEXTURE_WIDTH,
+   TILED_TEST_TEXTURE_HEIGHT,
+   TILED_TEST_TEXTURE_ROW_STRIDE,
+   TILED_TEST_TEXTURE_IMG_STRIDE,
+   TILED_TEST_TEXTURE_MIP_OFFSETS,
+   TILED_TEST_TEXTURE_NUM_FIELDS,
+};
+
+
+typedef void
+(*sample_ptr_t)(const struct tiled_test_texture *texture,
+                const float *s, const float *t, float *texels);
+
+
+static const enum pipe_format formats[] = {
+   PIPE_FORMAT_B8G8R8A8_UNORM,
+   PIPE_FORMAT_R8_UNORM,
+   PIPE_FORMAT_R8G8_UNORM,
+   PIPE_FORMAT_B5G6R5_UNORM,
+   PIPE_FORMAT_R16G16B16A16_FLOAT,
+   PIPE_FORMAT_R32_FLOAT,
+   PIPE_FORMAT_R32G32B32A32_FLOAT,
+};
+
+static const struct {
+   unsigned width;
+   unsigned height;
+} sizes[] = {
+   { 16, 16 },
+   { 13, 7 },
+   { 1, 5 },
+   { 33, 2 },
+};
+
+static const unsigned filters[] = {
+   PIPE_TEX_FILTER_NEAREST,
+   PIPE_TEX_FILTER_LINEAR,
+};
+
+static const unsigned wraps[] = {
+   PIPE_TEX_WRAP_CLAMP_TO_EDGE,
+   PIPE_TEX_WRAP_REPEAT,
+};
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "format\t"
+           "linear_mtexels_per_sec\t"
+           "tiled_mtexels_per_sec\t"
+           "speedup\n");
+
+   fflush(fp);
+}
+
+
+static LLVMValueRef
+texture_member(struct gallivm_state *gallivm,
+               LLVMTypeRef context_type,
+               LLVMValueRef context_ptr,
+               unsigned member_index,
+               boolean emit_load,
+               LLVMTypeRef *out_type)
+{
+   LLVMTypeRef member_type =
+      LLVMStructGetTypeAtIndex(context_type, member_index);
+   LLVMValueRef ptr = LLVMBuildStructGEP2(gallivm->builder, context_type,
+                                          context_ptr, member_index, "");
+
+   if (out_type)
+      *out_type = member_type;
+
+   return emit_load ?
+      LLVMBuildLoad2(gallivm->builder, member_type, ptr, "") : ptr;
+}
+
+
+#define TEXTURE_MEMBER(_name, _index, _emit_load) \
+   static LLVMValueRef \
+   texture_##_name(struct gallivm_state *gallivm, \
+                   LLVMTypeRef context_type, \
+                   LLVMValueRef context_ptr, \
+                   unsigned texture_unit, \
+                   LLVMValueRef texture_unit_offset) \
+   { \
+      return texture_member(gallivm, context_type, context_ptr, \
+                            _index, _emit_load, NULL); \
+   }
+
+#define TEXTURE_MEMBER_OUTTYPE(_name, _index) \
+   static LLVMValueRef \
+   texture_##_name(struct gallivm_state *gallivm, \
+                   LLVMTypeRef context_type, \
+                   LLVMValueRef context_ptr, \
+                   unsigned texture_unit, \
+                   LLVMValueRef texture_unit_offset, \
+                   LLVMTypeRef *out_type) \
+   { \
+      return texture_member(gallivm, context_type, context_ptr, \
+                            _index, FALSE, out_type); \
+   }
+
+#define TEXTURE_CONSTANT(_name, _value) \
+   static LLVMValueRef \
+   texture_##_name(struct gallivm_state *gallivm, \
+                   LLVMTypeRef context_type, \
+                   LLVMValueRef context_ptr, \
+                   unsigned texture_unit, \
+                   LLVMValueRef texture_unit_offset) \
+   { \
+      return lp_build_const_int32(gallivm, _value); \
+   }
+
+TEXTURE_MEMBER(base_ptr, TILED_TEST_TEXTURE_BASE, TRUE)
+TEXTURE_MEMBER(width, TILED_TEST_TEXTURE_WIDTH, TRUE)
+TEXTURE_MEMBER(height, TILED_TEST_TEXTURE_HEIGHT, TRUE)
+TEXTURE_MEMBER_OUTTYPE(row_stride, TILED_TEST_TEXTURE_ROW_STRIDE)
+TEXTURE_MEMBER_OUTTYPE(img_stride, TILED_TEST_TEXTURE_IMG_STRIDE)
+TEXTURE_MEMBER_OUTTYPE(mip_offsets, TILED_TEST_TEXTURE_MIP_OFFSETS)
+TEXTURE_CONSTANT(depth, 1)
+TEXTURE_CONSTANT(first_level, 0)
+TEXTURE_CONSTANT(last_level, 0)
+TEXTURE_CONSTANT(num_samples, 1)
+TEXTURE_CONSTANT(sample_stride, 0)
+
+
+static LLVMValueRef
+sampler_zero_lod(struct gallivm_state *gallivm,
+                 LLVMTypeRef context_type,
+                 LLVMValueRef context_ptr,
+                 unsigned sampler_unit)
+{
+   return lp_build_const_float(gallivm, 0.0f);
+}
+
+
+static LLVMTypeRef
+create_texture_type(struct gallivm_state *gallivm)
+{
+   LLVMContextRef lc = gallivm->context;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(lc);
+   LLVMTypeRef levels_type = LLVMArrayType(int32_type, LP_MAX_TEXTURE_LEVELS);
+   LLVMTypeRef elem_types[TILED_TEST_TEXTURE_NUM_FIELDS];
+
+   elem_types[TILED_TEST_TEXTURE_BASE] =
+      LLVMPointerType(LLVMInt8TypeInContext(lc), 0);
+   elem_types[TILED_TEST_TEXTURE_WIDTH] = int32_type;
+   elem_types[TILED_TEST_TEXTURE_HEIGHT] = int32_type;
+   elem_types[TILED_TEST_TEXTURE_ROW_STRIDE] = levels_type;
+   elem_types[TILED_TEST_TEXTURE_IMG_STRIDE] = levels_type;
+   elem_types[TILED_TEST_TEXTURE_MIP_OFFSETS] = levels_type;
+
+   return LLVMStructTypeInContext(lc, elem_types, ARRAY_SIZE(elem_types), 0);
+}
+
+
+static LLVMValueRef
+add_sample_test(struct gallivm_state *gallivm,
+                enum pipe_format format,
+                boolean tiled,
+                unsigned filter,
+                unsigned wrap)
+{
+   LLVMContextRef context = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type type = lp_float32_vec4_type();
+   LLVMTypeRef vec_type = lp_build_vec_type(gallivm, type);
+   LLVMTypeRef texture_type = create_texture_type(gallivm);
+   LLVMTypeRef args[4];
+
+   args[0] = LLVMPointerType(texture_type, 0);
+   args[1] = LLVMPointerType(vec_type, 0);
+   args[2] = LLVMPointerType(vec_type, 0);
+   args[3] = LLVMPointerType(vec_type, 0);
+
+   LLVMValueRef func =
+      LLVMAddFunction(gallivm->module, tiled ? "sample_tiled" : "sample",
+                      LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                       args, ARRAY_SIZE(args), 0));
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+
+   LLVMBasicBlockRef block =
+      LLVMAppendBasicBlockInContext(context, func, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   struct lp_static_texture_state texture_state;
+   memset(&texture_state, 0, sizeof texture_state);
+   texture_state.format = format;
+   texture_state.res_format = format;
+   texture_state.swizzle_r = PIPE_SWIZZLE_X;
+   texture_state.swizzle_g = PIPE_SWIZZLE_Y;
+   texture_state.swizzle_b = PIPE_SWIZZLE_Z;
+   texture_state.swizzle_a = PIPE_SWIZZLE_W;
+   texture_state.target = PIPE_TEXTURE_2D;
+   texture_state.level_zero_only = 1;
+   texture_state.tiled = tiled;
+
+   struct lp_static_sampler_state sampler_state;
+   memset(&sampler_state, 0, sizeof sampler_state);
+   sampler_state.wrap_s = wrap;
+   sampler_state.wrap_t = wrap;
+   sampler_state.wrap_r = wrap;
+   sampler_state.min_img_filter = filter;
+   sampler_state.mag_img_filter = filter;
+   sampler_state.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+   sampler_state.normalized_coords = 1;
+
+   struct lp_sampler_dynamic_state dynamic_state;
+   memset(&dynamic_state, 0, sizeof dynamic_state);
+   dynamic_state.width = texture_width;
+   dynamic_state.height = texture_height;
+   dynamic_state.depth = texture_depth;
+   dynamic_state.first_level = texture_first_level;
+   dynamic_state.last_level = texture_last_level;
+   dynamic_state.row_stride = texture_row_stride;
+   dynamic_state.img_stride = texture_img_stride;
+   dynamic_state.base_ptr = texture_base_ptr;
+   dynamic_state.mip_offsets = texture_mip_offsets;
+   dynamic_state.num_samples = texture_num_samples;
+   dynamic_state.sample_stride = texture_sample_stride;
+   dynamic_state.min_lod = sampler_zero_lod;
+   dynamic_state.max_lod = sampler_zero_lod;
+   dynamic_state.lod_bias = sampler_zero_lod;
+
+   LLVMValueRef zero = LLVMConstNull(vec_type);
+   LLVMValueRef coords[5] = { zero, zero, zero, zero, zero };
+   coords[0] = LLVMBuildLoad2(builder, vec_type, LLVMGetParam(func, 1), "s");
+   coords[1] = LLVMBuildLoad2(builder, vec_type, LLVMGetParam(func, 2), "t");
+
+   LLVMValueRef offsets[3] = { NULL, NULL, NULL };
+   LLVMValueRef texel[4];
+   struct lp_sampler_params params;
+   memset(&params, 0, sizeof params);
+   params.type = type;
+   /* Sampling functions are shared by unit within a module */
+   params.texture_index = tiled;
+   params.sampler_index = tiled;
+   params.sample_key = LP_SAMPLER_OP_TEXTURE << LP_SAMPLER_OP_TYPE_SHIFT;
+   params.context_type = texture_type;
+   params.context_ptr = LLVMGetParam(func, 0);
+   params.coords = coords;
+   params.offsets = offsets;
+   params.texel = texel;
+
+   lp_build_sample_soa(&texture_state, &sampler_state, &dynamic_state,
+                       gallivm, &params);
+
+   for (unsigned chan = 0; chan < 4; chan++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, chan);
+      LLVMValueRef ptr = LLVMBuildGEP2(builder, vec_type,
+                                       LLVMGetParam(func, 3), &index, 1, "");
+      LLVMBuildStore(builder, texel[chan], ptr);
+   }
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+/**
+ * Both layouts of the same texels.  Rows of tiles are LP_TILED_TEX_DIM rows
+ * of texels apart, as llvmpipe lays them out.
+ */
+struct test_texels
+{
+   unsigned width;
+   unsigned height;
+   unsigned block_size;
+   uint8_t *linear;
+   uint8_t *tiled;
+   struct tiled_test_texture linear_tex;
+   struct tiled_test_texture tiled_tex;
+};
+
+
+static void
+test_texels_init(struct test_texels *texels, enum pipe_format format,
+                 unsigned width, unsigned height)
+{
+   const unsigned block_size = util_format_get_blocksize(format);
+   const unsigned row_stride =
+      align(width, LP_TILED_TEX_DIM) * block_size;
+   const unsigned img_stride =
+      row_stride * align(height, LP_TILED_TEX_DIM);
+   float rgba[4];
+
+   memset(texels, 0, sizeof *texels);
+   texels->width = width;
+   texels->height = height;
+   texels->block_size = block_size;
+   texels->linear = align_malloc(img_stride, 64);
+   texels->tiled = align_malloc(img_stride, 64);
+   memset(texels->linear, 0, img_stride);
+   memset(texels->tiled, 0, img_stride);
+
+   for (unsigned y = 0; y < height; y++) {
+      for (unsigned x = 0; x < width; x++) {
+         uint8_t *linear = texels->linear + y * row_stride + x * block_size;
+         uint8_t *tiled = texels->tiled +
+            (y / LP_TILED_TEX_DIM) * row_stride * LP_TILED_TEX_DIM +
+            (x / LP_TILED_TEX_DIM) * LP_TILED_TEX_DIM * LP_TILED_TEX_DIM *
+               block_size +
+            ((y % LP_TILED_TEX_DIM) * LP_TILED_TEX_DIM +
+             x % LP_TILED_TEX_DIM) * block_size;
+
+         for (unsigned chan = 0; chan < 4; chan++)
+            rgba[chan] = random_float();
+         util_format_pack_rgba(format, linear, rgba, 1);
+         memcpy(tiled, linear, block_size);
+      }
+   }
+
+   texels->linear_tex.base = texels->linear;
+   texels->linear_tex.width = width;
+   texels->linear_tex.height = height;
+   texels->linear_tex.row_stride[0] = row_stride;
+   texels->linear_tex.img_stride[0] = img_stride;
+
+   texels->tiled_tex = texels->linear_tex;
+   texels->tiled_tex.base = texels->tiled;
+   texels->tiled_tex.row_stride[0] = row_stride * LP_TILED_TEX_DIM;
+}
+
+
+static void
+test_texels_fini(struct test_texels *texels)
+{
+   align_free(texels->linear);
+   align_free(texels->tiled);
+}
+
+
+struct sample_funcs
+{
+   LLVMContextRef context;
+   struct gallivm_state *gallivm;
+   sample_ptr_t linear;
+   sample_ptr_t tiled;
+};
+
+
+static void
+sample_funcs_create(struct sample_funcs *funcs, enum pipe_format format,
+                    unsigned filter, unsigned wrap)
+{
+   funcs->context = LLVMContextCreate();
+#if LLVM_VERSION_MAJOR >= 15
+   LLVMContextSetOpaquePointers(funcs->context, false);
+#endif
+   funcs->gallivm = gallivm_create("test_module_tiled", funcs->context, NULL);
+
+   LLVMValueRef linear = add_sample_test(funcs->gallivm, format, FALSE,
+                                         filter, wrap);
+   LLVMValueRef tiled = add_sample_test(funcs->gallivm, format, TRUE,
+                                        filter, wrap);
+
+   gallivm_compile_module(funcs->gallivm);
+
+   funcs->linear = (sample_ptr_t)gallivm_jit_function(funcs->gallivm, linear);
+   funcs->tiled = (sample_ptr_t)gallivm_jit_function(funcs->gallivm, tiled);
+
+   gallivm_free_ir(funcs->gallivm);
+}
+
+
+static void
+sample_funcs_destroy(struct sample_funcs *funcs)
+{
+   gallivm_destroy(funcs->gallivm);
+   LLVMContextDispose(funcs->context);
+}
+
+
+PIPE_ALIGN_STACK
+static boolean
+test_one(unsigned verbose, enum pipe_format format,
+         unsigned width, unsigned height, unsigned filter, unsigned wrap)
+{
+   const struct util_format_description *desc = util_format_description(format);
+   struct sample_funcs funcs;
+   struct test_texels texels;
+   alignas(16) float s[4], t[4];
+   alignas(16) float linear_res[4][4], tiled_res[4][4];
+   boolean success = TRUE;
+
+   if (verbose >= 1)
+      printf("Testing %s %ux%u, %s filter, %s wrap ...\n", desc->short_name,
+             width, height, filter ? "linear" : "nearest",
+             wrap == PIPE_TEX_WRAP_REPEAT ? "repeat" : "clamp");
+
+   sample_funcs_create(&funcs, format, filter, wrap);
+   test_texels_init(&texels, format, width, height);
+
+   for (unsigned i = 0; i < 64 && success; i++) {
+      int x[4], y[4];
+
+      for (unsigned j = 0; j < 4; j++) {
+         /* Texel centers, including some outside of the texture */
+         x[j] = rand() % (3 * width) - (int)width;
+         y[j] = rand() % (3 * height) - (int)height;
+         s[j] = (x[j] + 0.5f) / width;
+         t[j] = (y[j] + 0.5f) / height;
+
+         /* and anywhere in between for filtering */
+         if (filter == PIPE_TEX_FILTER_LINEAR && (i & 1)) {
+            s[j] = random_float() * 3.0f - 1.0f;
+            t[j] = random_float() * 3.0f - 1.0f;
+         }
+      }
+
+      funcs.linear(&texels.linear_tex, s, t, &linear_res[0][0]);
+      funcs.tiled(&texels.tiled_tex, s, t, &tiled_res[0][0]);
+
+      if (memcmp(linear_res, tiled_res, sizeof linear_res) != 0) {
+         printf("FAILED: %s %ux%u, tiled result differs\n",
+                desc->short_name, width, height);
+         success = FALSE;
+      }
+
+      if (filter != PIPE_TEX_FILTER_NEAREST)
+         continue;
+
+      for (unsigned j = 0; j < 4; j++) {
+         int tx = x[j], ty = y[j];
+         float expected[4];
+
+         if (wrap == PIPE_TEX_WRAP_REPEAT) {
+            tx = (tx % (int)width + width) % width;
+            ty = (ty % (int)height + height) % height;
+         } else {
+            tx = CLAMP(tx, 0, (int)width - 1);
+            ty = CLAMP(ty, 0, (int)height - 1);
+         }
+
+         util_format_unpack_rgba(format, expected,
+                                 texels.linear +
+                                 ty * texels.linear_tex.row_stride[0] +
+                                 tx * texels.block_size, 1);
+
+         for (unsigned chan = 0; chan < 4; chan++) {
+            if (fabs(expected[chan] - tiled_res[chan][j]) > 1.0 / 256.0) {
+               printf("FAILED: %s %ux%u, texel (%d, %d) channel %u: "
+                      "%f obtained, %f expected\n",
+                      desc->short_name, width, height, tx, ty, chan,
+                      tiled_res[chan][j], expected[chan]);
+               success = FALSE;
+            }
+         }
+      }
+   }
+
+   test_texels_fini(&texels);
+   sample_funcs_destroy(&funcs);
+
+   return success;
+}
+
+
+/**
+ * Bilinear sampling of a large texture along rows which are rotated by 30
+ * degrees: most 2x2 footprints straddle two texture rows, and successive
+ * footprints move along both axes.
+ */
+PIPE_ALIGN_STACK
+static boolean
+bench_one(unsigned verbose, FILE *fp, enum pipe_format format)
+{
+   const struct util_format_description *desc = util_format_description(format);
+   const unsigned size = 1024;
+   const unsigned num_samples = size * size;
+   const float c = cosf(M_PI / 6), sn = sinf(M_PI / 6);
+   struct sample_funcs funcs;
+   struct test_texels texels;
+   alignas(16) float res[4][4];
+   alignas(16) float check[4][4];
+   boolean success = TRUE;
+   double rate[2];
+
+   float *s = align_malloc(num_samples * sizeof(float), 16);
+   float *t = align_malloc(num_samples * sizeof(float), 16);
+   if (!s || !t) {
+      align_free(s);
+      align_free(t);
+      return FALSE;
+   }
+
+   for (unsigned y = 0; y < size; y++) {
+      for (unsigned x = 0; x < size; x++) {
+         const float dx = (float)x - size / 2, dy = (float)y - size / 2;
+         s[y * size + x] = 0.5f + (dx * c - dy * sn) / size;
+         t[y * size + x] = 0.5f + (dx * sn + dy * c) / size;
+      }
+   }
+
+   sample_funcs_create(&funcs, format, PIPE_TEX_FILTER_LINEAR,
+                       PIPE_TEX_WRAP_REPEAT);
+   test_texels_init(&texels, format, size, size);
+
+   for (unsigned layout = 0; layout < 2; layout++) {
+      const sample_ptr_t sample = layout ? funcs.tiled : funcs.linear;
+      const struct tiled_test_texture *tex =
+         layout ? &texels.tiled_tex : &texels.linear_tex;
+      int64_t best = INT64_MAX;
+
+      for (unsigned pass = 0; pass < 4; pass++) {
+         const int64_t start = os_time_get_nano();
+         for (unsigned i = 0; i < num_samples; i += 4)
+            sample(tex, s + i, t + i, &res[0][0]);
+         best = MIN2(best, os_time_get_nano() - start);
+      }
+      rate[layout] = num_samples / (best / 1000.0);
+   }
+
+   /* Spot check that both layouts still sample the same texels */
+   for (unsigned i = 0; i < num_samples && success; i += 4 * 997) {
+      funcs.linear(&texels.linear_tex, s + i, t + i, &res[0][0]);
+      funcs.tiled(&texels.tiled_tex, s + i, t + i, &check[0][0]);
+      success = memcmp(res, check, sizeof res) == 0;
+   }
+
+   if (verbose >= 1)
+      printf("%s bilinear: %.1f Mtexels/s linear, %.1f Mtexels/s tiled\n",
+             desc->short_name, rate[0], rate[1]);
+
+   fprintf(fp, "%s\t%s\t%.1f\t%.1f\t%.2f\n", success ? "pass" : "fail",
+           desc->short_name, rate[0], rate[1], rate[1] / rate[0]);
+   fflush(fp);
+
+   test_texels_fini(&texels);
+   sample_funcs_destroy(&funcs);
+   align_free(s);
+   align_free(t);
+
+   return success;
+}
+
+
+static boolean
+test_format(unsigned verbose, FILE *fp, enum pipe_format format)
+{
+   boolean success = TRUE;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(sizes); i++)
+      for (unsigned f = 0; f < ARRAY_SIZE(filters); f++)
+         for (unsigned w = 0; w < ARRAY_SIZE(wraps); w++)
+            success &= test_one(verbose, format,
+                                sizes[i].width, sizes[i].height,
+                                filters[f], wraps[w]);
+
+   /* The timing loop is a benchmark, not a test: only run it on request */
+   if (fp)
+      success &= bench_one(verbose, fp, format);
+
+   return success;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   boolean success = TRUE;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(formats); i++)
+      success &= test_format(verbose, fp, formats[i]);
+
+   return success;
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_all(verbose, fp);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   return test_one(verbose, PIPE_FORMAT_B8G8R8A8_UNORM, 13, 7,
+                   PIPE_TEX_FILTER_LINEAR, PIPE_TEX_WRAP_REPEAT);
+}
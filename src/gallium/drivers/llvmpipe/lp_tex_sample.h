@@ -36,9 +36,10 @@ struct lp_sampler_static_state;
 struct lp_image_static_state;
 
 /**
- * Whether texture cache is used for s3tc textures.
+ * Whether the per-thread block cache is used for compressed textures.
+ * Only formats decoded in C go through it, see lp_build_format_use_cache().
  */
-#define LP_USE_TEXTURE_CACHE 0
+#define LP_USE_TEXTURE_CACHE 1
 
 /**
  * Pure-LLVM texture sampling code generator.
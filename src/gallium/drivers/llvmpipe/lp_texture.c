@@ -41,6 +41,10 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_transfer.h"
+#include "util/u_box.h"
+#include "util/u_surface.h"
+
+#include "gallivm/lp_bld_sample.h"
 
 #include "lp_context.h"
 #include "lp_flush.h"
@@ -208,6 +212,108 @@ llvmpipe_can_create_resource(struct pipe_screen *screen,
 }
 
 
+/**
+ * Can this texture use the tiled layout (see LP_RESOURCE_FLAG_TILED)?
+ * Only textures nobody outside of llvmpipe's samplers and transfers looks
+ * at qualify; everything else would have to understand the layout too.
+ * A texture keeps its layout for its whole life, so anything that may be
+ * rendered to stays linear.  Smaller texels sample faster linearly.
+ */
+static boolean
+llvmpipe_texture_can_tile(const struct llvmpipe_screen *screen,
+                          const struct pipe_resource *pt)
+{
+   const unsigned block_size = util_format_get_blocksize(pt->format);
+
+   if (!screen->tiled_textures)
+      return FALSE;
+
+   if (llvmpipe_resource_is_1d(pt) ||
+       pt->nr_samples > 1 ||
+       util_format_is_compressed(pt->format) ||
+       util_format_is_depth_or_stencil(pt->format) ||
+       util_format_get_blockwidth(pt->format) != 1 ||
+       util_format_get_blockheight(pt->format) != 1 ||
+       (block_size != 8 && block_size != 16))
+      return FALSE;
+
+   if (pt->bind & (PIPE_BIND_RENDER_TARGET |
+                   PIPE_BIND_DEPTH_STENCIL |
+                   PIPE_BIND_DISPLAY_TARGET |
+                   PIPE_BIND_SCANOUT |
+                   PIPE_BIND_SHARED |
+                   PIPE_BIND_LINEAR |
+                   PIPE_BIND_SHADER_IMAGE))
+      return FALSE;
+
+   if (pt->flags & (PIPE_RESOURCE_FLAG_MAP_PERSISTENT |
+                    PIPE_RESOURCE_FLAG_MAP_COHERENT))
+      return FALSE;
+
+   return TRUE;
+}
+
+
+/**
+ * Switch a texture laid out by llvmpipe_texture_layout() to the tiled
+ * layout.  Rows of tiles are LP_TILED_TEX_DIM rows of texels apart, so
+ * image strides and sizes stay the same.
+ */
+static void
+llvmpipe_texture_tile_layout(struct llvmpipe_resource *lpr)
+{
+   for (unsigned level = 0; level <= lpr->base.last_level; level++)
+      lpr->row_stride[level] *= LP_TILED_TEX_DIM;
+
+   lpr->base.flags |= LP_RESOURCE_FLAG_TILED;
+}
+
+
+/**
+ * Copy a box of texels between a tiled texture level and a linear buffer.
+ */
+static void
+llvmpipe_copy_tiled_box(struct llvmpipe_resource *lpr,
+                        unsigned level,
+                        const struct pipe_box *box,
+                        uint8_t *linear,
+                        unsigned stride,
+                        uint64_t layer_stride,
+                        bool to_tiled)
+{
+   const unsigned block_size = util_format_get_blocksize(lpr->base.format);
+   const unsigned tile_size =
+      LP_TILED_TEX_DIM * LP_TILED_TEX_DIM * block_size;
+
+   for (int z = 0; z < box->depth; z++) {
+      uint8_t *image = llvmpipe_get_texture_image_address(lpr, box->z + z,
+                                                          level);
+      for (int y = box->y; y < box->y + box->height; y++) {
+         uint8_t *tiled_row = image +
+            (y / LP_TILED_TEX_DIM) * lpr->row_stride[level] +
+            (y % LP_TILED_TEX_DIM) * LP_TILED_TEX_DIM * block_size;
+         uint8_t *linear_row = linear + z * layer_stride +
+            (y - box->y) * stride;
+
+         /* Texels are contiguous up to the next tile boundary. */
+         for (int x = box->x; x < box->x + box->width; ) {
+            const unsigned n = MIN2(LP_TILED_TEX_DIM - x % LP_TILED_TEX_DIM,
+                                    box->x + box->width - x);
+            uint8_t *tiled = tiled_row + (x / LP_TILED_TEX_DIM) * tile_size +
+                             (x % LP_TILED_TEX_DIM) * block_size;
+            uint8_t *texels = linear_row + (x - box->x) * block_size;
+
+            if (to_tiled)
+               memcpy(tiled, texels, n * block_size);
+            else
+               memcpy(texels, tiled, n * block_size);
+            x += n;
+         }
+      }
+   }
+}
+
+
 static boolean
 llvmpipe_displaytarget_layout(struct llvmpipe_screen *screen,
                               struct llvmpipe_resource *lpr,
@@ -228,6 +334,7 @@ llvmpipe_displaytarget_layout(struct llvmpipe_screen *screen,
                                           64,
                                           map_front_private,
                                           &lpr->row_stride[0] );
+   llvmpipe_resource_damage_all(lpr);
 
    return lpr->dt != NULL;
 }
@@ -245,6 +352,7 @@ llvmpipe_resource_create_all(struct pipe_screen *_screen,
       return NULL;
 
    lpr->base = *templat;
+   lpr->base.flags &= ~LP_RESOURCE_FLAG_TILED;
    lpr->screen = screen;
    pipe_reference_init(&lpr->base.reference, 1);
    lpr->base.screen = &screen->base;
@@ -262,6 +370,8 @@ llvmpipe_resource_create_all(struct pipe_screen *_screen,
          /* texture map */
          if (!llvmpipe_texture_layout(screen, lpr, alloc_backing))
             goto fail;
+         if (alloc_backing && llvmpipe_texture_can_tile(screen, &lpr->base))
+            llvmpipe_texture_tile_layout(lpr);
       }
    } else {
       /* other data (vertex buffer, const buffer, etc) */
@@ -607,6 +717,7 @@ llvmpipe_resource_from_handle(struct pipe_screen *_screen,
    if (!lpr->dt) {
       goto no_dt;
    }
+   llvmpipe_resource_damage_all(lpr);
 
    lpr->id = id_counter++;
 
@@ -701,6 +812,11 @@ llvmpipe_transfer_map_ms(struct pipe_context *pipe,
    assert(resource);
    assert(level <= resource->last_level);
 
+   /* Tiled textures are only ever mapped through a linear copy. */
+   if ((resource->flags & LP_RESOURCE_FLAG_TILED) &&
+       (usage & PIPE_MAP_DIRECTLY))
+      return NULL;
+
    /*
     * Transfers, like other pipe operations, must happen in order, so flush
     * the context if necessary.
@@ -783,12 +899,34 @@ llvmpipe_transfer_map_ms(struct pipe_context *pipe,
       /* Do something to notify sharing contexts of a texture change.
        */
       screen->timestamp++;
+      llvmpipe_resource_damage(lpr, box->x, box->y, box->width, box->height);
    }
 
    map +=
       box->y / util_format_get_blockheight(format) * pt->stride +
       box->x / util_format_get_blockwidth(format) * util_format_get_blocksize(format);
 
+   if (resource->flags & LP_RESOURCE_FLAG_TILED) {
+      const unsigned block_size = util_format_get_blocksize(format);
+
+      pt->stride = align(box->width * block_size, 16);
+      pt->layer_stride = (uint64_t)pt->stride * box->height;
+      lpt->staging = align_malloc(pt->layer_stride * box->depth, 64);
+      if (!lpt->staging) {
+         pipe_resource_reference(&pt->resource, NULL);
+         FREE(lpt);
+         *transfer = NULL;
+         return NULL;
+      }
+
+      if (!(usage & (PIPE_MAP_DISCARD_RANGE |
+                     PIPE_MAP_DISCARD_WHOLE_RESOURCE)))
+         llvmpipe_copy_tiled_box(lpr, level, box, lpt->staging,
+                                 pt->stride, pt->layer_stride, false);
+
+      return lpt->staging;
+   }
+
    map += sample * lpr->sample_stride;
    return map;
 }
@@ -811,6 +949,8 @@ static void
 llvmpipe_transfer_unmap(struct pipe_context *pipe,
                         struct pipe_transfer *transfer)
 {
+   struct llvmpipe_transfer *lpt = llvmpipe_transfer(transfer);
+
    assert(transfer->resource);
 
    llvmpipe_resource_unmap(transfer->resource,
@@ -819,8 +959,33 @@ llvmpipe_transfer_unmap(struct pipe_context *pipe,
 
    /* Effectively do the texture_update work here - if texture images
     * needed post-processing to put them into hardware layout, this is
-    * where it would happen.  For llvmpipe, nothing to do.
+    * where it would happen.  Only tiled textures need anything.
     */
+   if (lpt->staging) {
+      struct llvmpipe_resource *lpr = llvmpipe_resource(transfer->resource);
+      const struct pipe_box *box = &transfer->box;
+
+      if (!(transfer->usage & PIPE_MAP_WRITE)) {
+         /* nothing to write back */
+      } else if (lpr->base.flags & LP_RESOURCE_FLAG_TILED) {
+         llvmpipe_copy_tiled_box(lpr, transfer->level, box,
+                                 lpt->staging, transfer->stride,
+                                 transfer->layer_stride, true);
+      } else {
+         /* The texture was made linear while mapped. */
+         util_copy_box(llvmpipe_get_texture_image_address(lpr, 0,
+                                                          transfer->level),
+                       lpr->base.format,
+                       lpr->row_stride[transfer->level],
+                       lpr->img_stride[transfer->level],
+                       box->x, box->y, box->z,
+                       box->width, box->height, box->depth,
+                       lpt->staging, transfer->stride,
+                       transfer->layer_stride, 0, 0, 0);
+      }
+      align_free(lpt->staging);
+   }
+
    assert (transfer->resource);
    pipe_resource_reference(&transfer->resource, NULL);
    FREE(transfer);
@@ -31,6 +31,7 @@
 
 #include "pipe/p_state.h"
 #include "util/u_debug.h"
+#include "util/u_rect.h"
 #include "lp_limits.h"
 #ifdef DEBUG
 #include "util/list.h"
@@ -82,6 +83,12 @@ struct llvmpipe_resource
     */
    struct sw_displaytarget *dt;
 
+   /**
+    * Area of the display target written since it was last presented,
+    * inclusive.  Empty when x1 < x0.
+    */
+   struct u_rect damage;
+
    /**
     * Malloc'ed data for regular textures, or a mapping to dt above.
     */
@@ -112,6 +119,9 @@ struct llvmpipe_resource
 struct llvmpipe_transfer
 {
    struct pipe_transfer base;
+
+   /** Linear copy of the mapped box, for tiled textures */
+   uint8_t *staging;
 };
 
 
@@ -200,6 +210,31 @@ llvmpipe_resource_is_1d(const struct pipe_resource *resource)
 }
 
 
+/**
+ * Note that a region of a display target was written to.
+ */
+static inline void
+llvmpipe_resource_damage(struct llvmpipe_resource *lpr,
+                         int x, int y, int width, int height)
+{
+   if (!lpr->dt || width <= 0 || height <= 0)
+      return;
+
+   const struct u_rect rect = { x, x + width - 1, y, y + height - 1 };
+   if (lpr->damage.x1 < lpr->damage.x0)
+      lpr->damage = rect;
+   else
+      u_rect_union(&lpr->damage, &lpr->damage, &rect);
+}
+
+
+static inline void
+llvmpipe_resource_damage_all(struct llvmpipe_resource *lpr)
+{
+   llvmpipe_resource_damage(lpr, 0, 0, lpr->base.width0, lpr->base.height0);
+}
+
+
 static inline unsigned
 llvmpipe_layer_stride(struct pipe_resource *resource,
                       unsigned level)
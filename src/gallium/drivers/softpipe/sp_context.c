@@ -50,6 +50,7 @@
 #include "sp_tex_tile_cache.h"
 #include "sp_texture.h"
 #include "sp_query.h"
+#include "sp_rast_threads.h"
 #include "sp_screen.h"
 #include "sp_tex_sample.h"
 #include "sp_image.h"
@@ -60,6 +61,8 @@ softpipe_destroy( struct pipe_context *pipe )
    struct softpipe_context *softpipe = softpipe_context( pipe );
    uint i, sh;
 
+   sp_rast_threads_destroy(softpipe->rast_threads);
+
    if (softpipe->blitter) {
       util_blitter_destroy(softpipe->blitter);
    }
@@ -67,24 +70,15 @@ softpipe_destroy( struct pipe_context *pipe )
    if (softpipe->draw)
       draw_destroy( softpipe->draw );
 
-   if (softpipe->quad.shade)
-      softpipe->quad.shade->destroy( softpipe->quad.shade );
-
-   if (softpipe->quad.depth_test)
-      softpipe->quad.depth_test->destroy( softpipe->quad.depth_test );
-
-   if (softpipe->quad.blend)
-      softpipe->quad.blend->destroy( softpipe->quad.blend );
+   sp_destroy_quad_pipe(&softpipe->quad);
 
    if (softpipe->pipe.stream_uploader)
       u_upload_destroy(softpipe->pipe.stream_uploader);
 
    for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
-      sp_destroy_tile_cache(softpipe->cbuf_cache[i]);
       pipe_surface_reference(&softpipe->framebuffer.cbufs[i], NULL);
    }
 
-   sp_destroy_tile_cache(softpipe->zsbuf_cache);
    pipe_surface_reference(&softpipe->framebuffer.zsbuf, NULL);
 
    for (sh = 0; sh < ARRAY_SIZE(softpipe->tex_cache); sh++) {
@@ -106,8 +100,6 @@ softpipe_destroy( struct pipe_context *pipe )
       pipe_vertex_buffer_unreference(&softpipe->vertex_buffer[i]);
    }
 
-   tgsi_exec_machine_destroy(softpipe->fs_machine);
-
    for (i = 0; i < PIPE_SHADER_TYPES; i++) {
       FREE(softpipe->tgsi.sampler[i]);
       FREE(softpipe->tgsi.image[i]);
@@ -231,14 +223,6 @@ softpipe_create_context(struct pipe_screen *screen,
    softpipe->pipe.memory_barrier = softpipe_memory_barrier;
    softpipe->pipe.render_condition = softpipe_render_condition;
    
-   /*
-    * Alloc caches for accessing drawing surfaces and textures.
-    * Must be before quad stage setup!
-    */
-   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
-      softpipe->cbuf_cache[i] = sp_create_tile_cache( &softpipe->pipe );
-   softpipe->zsbuf_cache = sp_create_tile_cache( &softpipe->pipe );
-
    /* Allocate texture caches */
    for (sh = 0; sh < ARRAY_SIZE(softpipe->tex_cache); sh++) {
       for (i = 0; i < ARRAY_SIZE(softpipe->tex_cache[0]); i++) {
@@ -248,12 +232,17 @@ softpipe_create_context(struct pipe_screen *screen,
       }
    }
 
-   softpipe->fs_machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
-
-   /* setup quad rendering stages */
-   softpipe->quad.shade = sp_quad_shade_stage(softpipe);
-   softpipe->quad.depth_test = sp_quad_depth_test_stage(softpipe);
-   softpipe->quad.blend = sp_quad_blend_stage(softpipe);
+   /* setup quad rendering stages and the caches for the drawing surfaces */
+   if (!sp_init_quad_pipe(softpipe, &softpipe->quad))
+      goto fail;
+   softpipe->quad.occlusion_count = &softpipe->occlusion_count;
+   softpipe->quad.ps_invocations =
+      &softpipe->pipeline_statistics.ps_invocations;
+   softpipe->quad_pipe[0] = &softpipe->quad;
+   softpipe->num_quad_pipes = 1;
+
+   /* adds the pipelines of the threads, before the setup context is made */
+   softpipe->rast_threads = sp_rast_threads_create(softpipe);
 
    softpipe->pipe.stream_uploader = u_upload_create_default(&softpipe->pipe);
    if (!softpipe->pipe.stream_uploader)
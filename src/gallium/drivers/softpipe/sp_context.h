@@ -36,11 +36,13 @@
 
 #include "draw/draw_vertex.h"
 
+#include "sp_limits.h"
 #include "sp_quad_pipe.h"
 #include "sp_setup.h"
 
 
 struct softpipe_vbuf_render;
+struct sp_rast_threads;
 struct draw_context;
 struct draw_stage;
 struct softpipe_tile_cache;
@@ -145,13 +147,18 @@ struct softpipe_context {
    enum pipe_render_cond_flag render_cond_mode;
    bool render_cond_cond;
 
-   /** Software quad rendering pipeline */
-   struct {
-      struct quad_stage *shade;
-      struct quad_stage *depth_test;
-      struct quad_stage *blend;
-      struct quad_stage *first; /**< points to one of the above stages */
-   } quad;
+   /** Software quad rendering pipeline, with its interpreter and caches */
+   struct sp_quad_pipe quad;
+
+   /**
+    * The quad pipelines the screen tiles are split between, quad_pipe[0]
+    * is &quad.  The others belong to the rasterizer threads.
+    */
+   struct sp_quad_pipe *quad_pipe[SP_MAX_THREADS];
+   unsigned num_quad_pipes;
+
+   /** Rasterizer threads, NULL when rendering on the calling thread only */
+   struct sp_rast_threads *rast_threads;
 
    /** TGSI exec things */
    struct {
@@ -160,7 +167,6 @@ struct softpipe_context {
       struct sp_tgsi_buffer *buffer[PIPE_SHADER_TYPES];
    } tgsi;
 
-   struct tgsi_exec_machine *fs_machine;
    /** whether early depth testing is enabled */
    bool early_depth;
 
@@ -175,9 +181,6 @@ struct softpipe_context {
 
    boolean dirty_render_cache;
 
-   struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
-   struct softpipe_tile_cache *zsbuf_cache;
-
    unsigned tex_timestamp;
 
    /*
@@ -35,6 +35,7 @@
 #include "draw/draw_context.h"
 #include "sp_flush.h"
 #include "sp_context.h"
+#include "sp_rast_threads.h"
 #include "sp_state.h"
 #include "sp_tile_cache.h"
 #include "sp_tex_tile_cache.h"
@@ -43,6 +44,26 @@
 #include "util/u_string.h"
 
 
+/**
+ * Write back the color and depth tiles of all the quad pipelines.
+ */
+static void
+flush_render_caches(struct softpipe_context *softpipe)
+{
+   uint p, i;
+
+   for (p = 0; p < softpipe->num_quad_pipes; p++) {
+      struct sp_quad_pipe *qp = softpipe->quad_pipe[p];
+
+      for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++)
+         if (qp->cbuf_cache[i])
+            sp_flush_tile_cache(qp->cbuf_cache[i]);
+
+      if (qp->zsbuf_cache)
+         sp_flush_tile_cache(qp->zsbuf_cache);
+   }
+}
+
 void
 softpipe_flush( struct pipe_context *pipe,
                 unsigned flags,
@@ -61,6 +82,8 @@ softpipe_flush( struct pipe_context *pipe,
             sp_flush_tex_tile_cache(softpipe->tex_cache[sh][i]);
          }
       }
+
+      sp_rast_threads_flush_textures(softpipe->rast_threads);
    }
 
    /* If this is a swapbuffers, just flush color buffers.
@@ -68,12 +91,7 @@ softpipe_flush( struct pipe_context *pipe,
     * The zbuffer changes are not discarded, but held in the cache
     * in the hope that a later clear will wipe them out.
     */
-   for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++)
-      if (softpipe->cbuf_cache[i])
-         sp_flush_tile_cache(softpipe->cbuf_cache[i]);
-
-   if (softpipe->zsbuf_cache)
-      sp_flush_tile_cache(softpipe->zsbuf_cache);
+   flush_render_caches(softpipe);
 
    softpipe->dirty_render_cache = FALSE;
 
@@ -180,12 +198,9 @@ void softpipe_texture_barrier(struct pipe_context *pipe, unsigned flags)
       }
    }
 
-   for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++)
-      if (softpipe->cbuf_cache[i])
-         sp_flush_tile_cache(softpipe->cbuf_cache[i]);
+   sp_rast_threads_flush_textures(softpipe->rast_threads);
 
-   if (softpipe->zsbuf_cache)
-      sp_flush_tile_cache(softpipe->zsbuf_cache);
+   flush_render_caches(softpipe);
 
    softpipe->dirty_render_cache = FALSE;
 }
@@ -35,6 +35,13 @@
 struct sp_fragment_shader_variant *
 softpipe_create_fs_variant_exec(struct softpipe_context *softpipe);
 
+struct nir_shader;
+
+struct sp_fragment_shader_variant *
+softpipe_create_fs_variant_nir(struct softpipe_context *softpipe,
+                               struct sp_fragment_shader_variant *exec,
+                               const struct nir_shader *nir);
+
 
 struct tgsi_interp_coef;
 struct tgsi_exec_vector;
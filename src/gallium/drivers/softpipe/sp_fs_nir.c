@@ -0,0 +1,2062 @@
+/**************************************************************************
+ *
+ * Copyright 2023 The Mesa Authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Execute fragment shaders by interpreting NIR directly.
+ *
+ * The shader is lowered to scalar ALU operations and out of SSA, then
+ * flattened into a stream of pre-decoded instructions which read and write
+ * "slots".  A slot holds one 32-bit component for every fragment of up to
+ * SP_NIR_MAX_QUADS quads, so each instruction is a simple loop over all the
+ * fragments of a span rather than over one quad.  SSA values are assigned
+ * slots from their live ranges, so the working set stays small.
+ *
+ * Divergent control flow is handled with an execution mask, the way the
+ * TGSI interpreter does it: both sides of an if run whenever some fragment
+ * takes them, and writes that other fragments might still see are masked.
+ *
+ * Anything this doesn't handle makes softpipe_create_fs_variant_nir() fail,
+ * and the TGSI interpreter is used instead.  Its variant is kept along with
+ * this one and still supplies the shader info and the single-quad path.
+ */
+
+#include <math.h>
+
+#include "nir.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "tgsi/tgsi_exec.h"
+#include "tgsi/tgsi_from_mesa.h"
+#include "tgsi/tgsi_util.h"
+#include "util/u_dynarray.h"
+#include "util/rounding.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#include "sp_context.h"
+#include "sp_fs.h"
+#include "sp_quad.h"
+#include "sp_state.h"
+
+
+#define SP_NIR_MAX_QUADS   16
+#define SP_NIR_MAX_LANES   (SP_NIR_MAX_QUADS * TGSI_QUAD_SIZE)
+#define SP_NIR_MAX_NESTING 32
+
+/* Slots with a fixed meaning, the shader's values follow them */
+#define SP_NIR_SLOT_ZERO    0  /**< always zero, for missing sources */
+#define SP_NIR_SLOT_SCRATCH 1  /**< 4 slots for results written under a mask */
+#define SP_NIR_SLOT_TEMP    5  /**< 4 slots for vectors read and written */
+#define SP_NIR_SLOT_W       9  /**< fragment W, for perspective inputs */
+#define SP_NIR_FIRST_SLOT   10
+
+#define SP_NIR_NO_SLOT      ~0u
+
+
+union sp_nir_chan
+{
+   float f[SP_NIR_MAX_LANES];
+   int32_t i[SP_NIR_MAX_LANES];
+   uint32_t u[SP_NIR_MAX_LANES];
+};
+
+
+enum sp_nir_opcode
+{
+   SP_NIR_ALU,          /**< scalar nir_op */
+   SP_NIR_CONST,        /**< broadcast u.value */
+   SP_NIR_INTERP,       /**< interpolate one input channel */
+   SP_NIR_FACE,
+   SP_NIR_LOAD_UBO,     /**< load from per-fragment block and offset */
+   SP_NIR_LOAD_UBO_CONST,
+   SP_NIR_DISCARD,
+   SP_NIR_DISCARD_IF,
+   SP_NIR_TEX,
+   SP_NIR_TXF,
+   SP_NIR_TXS,
+   SP_NIR_IF,
+   SP_NIR_ELSE,
+   SP_NIR_ENDIF,
+   SP_NIR_LOOP,
+   SP_NIR_ENDLOOP,
+   SP_NIR_BREAK,
+   SP_NIR_CONTINUE,
+};
+
+
+struct sp_nir_inst
+{
+   uint8_t opcode;      /**< enum sp_nir_opcode */
+   uint8_t masked;      /**< only write fragments in the execution mask */
+   uint16_t alu_op;     /**< nir_op for SP_NIR_ALU */
+   uint16_t dst;
+   uint16_t src[3];
+
+   union {
+      uint32_t value;
+      unsigned target;  /**< instruction the control flow continues at */
+      struct {
+         uint16_t index;
+         uint8_t chan;
+         uint8_t interp;
+      } input;
+      struct {
+         uint16_t offset;  /**< in dwords */
+         uint8_t block;
+         uint8_t num_comps;
+      } ubo;
+      struct {
+         uint8_t unit;
+         uint8_t sampler;
+         uint8_t control;     /**< enum tgsi_sampler_control */
+         uint8_t num_coords;
+         int8_t shadow_ref;   /**< argument the comparator goes to, or -1 */
+         int8_t offset[3];
+         uint8_t num_comps;
+         uint8_t levels;      /**< SP_NIR_TXS: return the level count */
+      } tex;
+   } u;
+};
+
+
+struct sp_nir_output
+{
+   unsigned slot;
+   unsigned semantic;   /**< TGSI_SEMANTIC_x */
+   unsigned cbuf;
+};
+
+
+/**
+ * Subclass of sp_fragment_shader_variant
+ */
+struct sp_nir_fragment_shader
+{
+   struct sp_fragment_shader_variant base;
+
+   /** The TGSI translation, which this variant falls back to */
+   struct sp_fragment_shader_variant *exec;
+
+   struct sp_nir_inst *insts;
+   unsigned num_insts;
+   unsigned num_slots;
+   boolean needs_w;
+
+   struct sp_nir_output outputs[PIPE_MAX_SHADER_OUTPUTS];
+   unsigned num_outputs;
+};
+
+
+static inline const struct sp_nir_fragment_shader *
+sp_nir_fragment_shader(const struct sp_fragment_shader_variant *var)
+{
+   return (const struct sp_nir_fragment_shader *) var;
+}
+
+
+/*
+ * Compilation
+ */
+
+struct sp_nir_compile
+{
+   struct sp_nir_fragment_shader *shader;
+   const struct tgsi_shader_info *info;
+   boolean texcoord_semantic;
+   boolean face_is_bool;
+
+   struct util_dynarray insts;
+   struct sp_nir_inst dummy;  /**< emitted to when out of memory */
+
+   /** Base slot of each SSA value and register */
+   unsigned *ssa_slot;
+   unsigned *reg_slot;
+   unsigned output_slot[PIPE_MAX_SHADER_OUTPUTS];
+
+   /** Live ranges of the SSA values, in nir_index_instrs() order */
+   unsigned *ssa_start;
+   unsigned *ssa_end;
+
+   /** For each slot, the last instruction its current value is read by */
+   struct util_dynarray slot_end;
+   unsigned num_slots;
+
+   unsigned loop_depth;
+   unsigned cf_depth;
+   boolean error;
+};
+
+
+static struct sp_nir_inst *
+emit(struct sp_nir_compile *c, enum sp_nir_opcode opcode, unsigned dst)
+{
+   struct sp_nir_inst *inst =
+      util_dynarray_grow(&c->insts, struct sp_nir_inst, 1);
+
+   if (!inst) {
+      c->error = TRUE;
+      inst = &c->dummy;
+   }
+
+   memset(inst, 0, sizeof *inst);
+   inst->opcode = opcode;
+   inst->dst = dst;
+   return inst;
+}
+
+
+static unsigned
+emit_pos(const struct sp_nir_compile *c)
+{
+   return util_dynarray_num_elements(&c->insts, struct sp_nir_inst);
+}
+
+
+static struct sp_nir_inst *
+inst_at(struct sp_nir_compile *c, unsigned pos)
+{
+   return util_dynarray_element(&c->insts, struct sp_nir_inst, pos);
+}
+
+
+static void
+emit_mov(struct sp_nir_compile *c, unsigned dst, unsigned src, bool masked)
+{
+   struct sp_nir_inst *inst = emit(c, SP_NIR_ALU, dst);
+   inst->alu_op = nir_op_mov;
+   inst->src[0] = src;
+   inst->masked = masked;
+}
+
+
+/**
+ * Find room for num_comps consecutive slots which are free at instruction
+ * start and stay taken until end.
+ */
+static unsigned
+alloc_slots(struct sp_nir_compile *c, unsigned num_comps,
+            unsigned start, unsigned end)
+{
+   unsigned *slot_end = c->slot_end.data;
+   unsigned slot, i;
+
+   for (slot = SP_NIR_FIRST_SLOT; slot < c->num_slots; slot++) {
+      for (i = 0; i < num_comps && slot + i < c->num_slots; i++) {
+         if (slot_end[slot + i] >= start)
+            break;
+      }
+      if (i == num_comps || slot + i == c->num_slots)
+         break;
+   }
+
+   if (slot + num_comps > c->num_slots) {
+      unsigned grow = slot + num_comps - c->num_slots;
+      unsigned *added = util_dynarray_grow(&c->slot_end, unsigned, grow);
+
+      if (!added) {
+         c->error = TRUE;
+         return SP_NIR_SLOT_ZERO;
+      }
+      memset(added, 0, grow * sizeof(unsigned));
+      c->num_slots += grow;
+   }
+
+   slot_end = c->slot_end.data;
+   for (i = 0; i < num_comps; i++)
+      slot_end[slot + i] = end;
+
+   return slot;
+}
+
+
+static unsigned
+alloc_fixed_slots(struct sp_nir_compile *c, unsigned num_comps)
+{
+   return alloc_slots(c, num_comps, 0, UINT_MAX);
+}
+
+
+struct sp_nir_loop_range
+{
+   unsigned start, end;
+};
+
+
+static void
+use_ssa(struct sp_nir_compile *c, const nir_ssa_def *def, unsigned ip,
+        const struct sp_nir_loop_range *loops, unsigned num_loops)
+{
+   const unsigned start = c->ssa_start[def->index];
+   unsigned end = MAX2(c->ssa_end[def->index], ip);
+
+   /* A value from outside a loop has to survive all of its iterations */
+   while (num_loops--) {
+      if (start >= loops[num_loops].start)
+         break;
+      end = MAX2(end, loops[num_loops].end);
+   }
+
+   c->ssa_end[def->index] = end;
+}
+
+
+struct use_state
+{
+   struct sp_nir_compile *c;
+   unsigned ip;
+   const struct sp_nir_loop_range *loops;
+   unsigned num_loops;
+};
+
+
+static bool
+use_src_cb(nir_src *src, void *data)
+{
+   struct use_state *state = data;
+
+   if (src->is_ssa)
+      use_ssa(state->c, src->ssa, state->ip, state->loops, state->num_loops);
+   return true;
+}
+
+
+static bool
+def_ssa_cb(nir_ssa_def *def, void *data)
+{
+   struct sp_nir_compile *c = data;
+   unsigned ip = def->parent_instr->index;
+
+   c->ssa_start[def->index] = ip;
+   c->ssa_end[def->index] = ip;
+   return true;
+}
+
+
+static void
+live_cf_list(struct sp_nir_compile *c, struct exec_list *list,
+             struct sp_nir_loop_range *loops, unsigned num_loops)
+{
+   foreach_list_typed(nir_cf_node, node, node, list) {
+      switch (node->type) {
+      case nir_cf_node_block: {
+         nir_block *block = nir_cf_node_as_block(node);
+         struct use_state state = { c, 0, loops, num_loops };
+
+         nir_foreach_instr(instr, block) {
+            state.ip = instr->index;
+            nir_foreach_src(instr, use_src_cb, &state);
+         }
+         break;
+      }
+      case nir_cf_node_if: {
+         nir_if *nif = nir_cf_node_as_if(node);
+         nir_block *prev = nir_cf_node_as_block(nir_cf_node_prev(node));
+
+         if (nif->condition.is_ssa)
+            use_ssa(c, nif->condition.ssa, prev->end_ip, loops, num_loops);
+         live_cf_list(c, &nif->then_list, loops, num_loops);
+         live_cf_list(c, &nif->else_list, loops, num_loops);
+         break;
+      }
+      case nir_cf_node_loop: {
+         nir_loop *loop = nir_cf_node_as_loop(node);
+
+         if (num_loops == SP_NIR_MAX_NESTING) {
+            c->error = TRUE;
+            return;
+         }
+         loops[num_loops].start = nir_loop_first_block(loop)->start_ip;
+         loops[num_loops].end = nir_loop_last_block(loop)->end_ip;
+         live_cf_list(c, &loop->body, loops, num_loops + 1);
+         break;
+      }
+      default:
+         c->error = TRUE;
+         return;
+      }
+   }
+}
+
+
+/**
+ * Values which don't get a slot of their own from their live range:
+ * constants are loaded once up front and never overwritten, undefined
+ * values read as zero and barycentrics are implied by the input loads.
+ */
+static bool
+ssa_has_range(const nir_ssa_def *def)
+{
+   nir_instr *instr = def->parent_instr;
+
+   switch (instr->type) {
+   case nir_instr_type_load_const:
+   case nir_instr_type_ssa_undef:
+      return false;
+   case nir_instr_type_intrinsic:
+      switch (nir_instr_as_intrinsic(instr)->intrinsic) {
+      case nir_intrinsic_load_barycentric_pixel:
+      case nir_intrinsic_load_barycentric_centroid:
+         return false;
+      default:
+         return true;
+      }
+   default:
+      return true;
+   }
+}
+
+
+static bool
+alloc_ssa_cb(nir_ssa_def *def, void *data)
+{
+   struct sp_nir_compile *c = data;
+
+   if (ssa_has_range(def)) {
+      c->ssa_slot[def->index] =
+         alloc_slots(c, def->num_components,
+                     c->ssa_start[def->index], c->ssa_end[def->index]);
+   }
+   return true;
+}
+
+
+static void
+alloc_shader_slots(struct sp_nir_compile *c, nir_function_impl *impl)
+{
+   struct sp_nir_loop_range loops[SP_NIR_MAX_NESTING];
+   unsigned i;
+
+   nir_index_instrs(impl);
+   nir_index_ssa_defs(impl);
+   nir_index_local_regs(impl);
+
+   c->ssa_slot = MALLOC(impl->ssa_alloc * sizeof(unsigned));
+   c->ssa_start = CALLOC(impl->ssa_alloc, sizeof(unsigned));
+   c->ssa_end = CALLOC(impl->ssa_alloc, sizeof(unsigned));
+   c->reg_slot = MALLOC(MAX2(impl->reg_alloc, 1) * sizeof(unsigned));
+   if (!c->ssa_slot || !c->ssa_start || !c->ssa_end || !c->reg_slot) {
+      c->error = TRUE;
+      return;
+   }
+
+   for (i = 0; i < impl->ssa_alloc; i++)
+      c->ssa_slot[i] = SP_NIR_NO_SLOT;
+   for (i = 0; i < PIPE_MAX_SHADER_OUTPUTS; i++)
+      c->output_slot[i] = SP_NIR_NO_SLOT;
+
+   /* The fixed slots are never handed out */
+   c->num_slots = SP_NIR_FIRST_SLOT;
+   if (!util_dynarray_resize(&c->slot_end, unsigned, c->num_slots)) {
+      c->error = TRUE;
+      return;
+   }
+   memset(c->slot_end.data, 0xff, c->num_slots * sizeof(unsigned));
+
+   /* Registers are what's left of the phis, they live across control
+    * flow and keep their slots.
+    */
+   nir_foreach_register(reg, &impl->registers) {
+      if (reg->num_array_elems || reg->bit_size != 32) {
+         c->error = TRUE;
+         return;
+      }
+      c->reg_slot[reg->index] = alloc_fixed_slots(c, reg->num_components);
+   }
+
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block) {
+         nir_foreach_ssa_def(instr, def_ssa_cb, c);
+
+         if (instr->type == nir_instr_type_load_const) {
+            nir_load_const_instr *load = nir_instr_as_load_const(instr);
+            c->ssa_slot[load->def.index] =
+               alloc_fixed_slots(c, load->def.num_components);
+         } else if (instr->type == nir_instr_type_ssa_undef) {
+            c->ssa_slot[nir_instr_as_ssa_undef(instr)->def.index] =
+               SP_NIR_SLOT_ZERO;
+         } else if (instr->type == nir_instr_type_intrinsic) {
+            nir_intrinsic_instr *intr = nir_instr_as_intrinsic(instr);
+            unsigned index;
+
+            if (intr->intrinsic != nir_intrinsic_store_output)
+               continue;
+
+            if (!nir_src_is_const(intr->src[1])) {
+               c->error = TRUE;
+               return;
+            }
+            index = nir_intrinsic_base(intr) + nir_src_as_uint(intr->src[1]);
+            if (index >= PIPE_MAX_SHADER_OUTPUTS) {
+               c->error = TRUE;
+               return;
+            }
+            if (c->output_slot[index] == SP_NIR_NO_SLOT)
+               c->output_slot[index] = alloc_fixed_slots(c, 4);
+         }
+      }
+   }
+
+   live_cf_list(c, &impl->body, loops, 0);
+   if (c->error)
+      return;
+
+   /* Hand out the remaining slots in program order */
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, alloc_ssa_cb, c);
+   }
+}
+
+
+static unsigned
+src_slot(struct sp_nir_compile *c, const nir_src *src)
+{
+   unsigned slot;
+
+   if (src->is_ssa) {
+      if (src->ssa->bit_size != 32)
+         c->error = TRUE;
+      slot = c->ssa_slot[src->ssa->index];
+   } else {
+      if (src->reg.indirect || src->reg.base_offset)
+         c->error = TRUE;
+      slot = c->reg_slot[src->reg.reg->index];
+   }
+
+   if (slot == SP_NIR_NO_SLOT) {
+      c->error = TRUE;
+      return SP_NIR_SLOT_ZERO;
+   }
+   return slot;
+}
+
+
+/**
+ * Returns the slot of the destination and whether writes to it have to
+ * respect the execution mask.  Registers carry values between the sides
+ * of divergent control flow, and inside loops SSA values written in one
+ * iteration may still be needed by fragments which already left it.
+ */
+static unsigned
+dest_slot(struct sp_nir_compile *c, const nir_dest *dest, bool *masked)
+{
+   if (dest->is_ssa) {
+      if (dest->ssa.bit_size != 32)
+         c->error = TRUE;
+      *masked = c->loop_depth > 0;
+      if (c->ssa_slot[dest->ssa.index] == SP_NIR_NO_SLOT) {
+         c->error = TRUE;
+         return SP_NIR_SLOT_ZERO;
+      }
+      return c->ssa_slot[dest->ssa.index];
+   }
+
+   if (dest->reg.indirect || dest->reg.base_offset)
+      c->error = TRUE;
+   *masked = c->cf_depth > 0;
+   return c->reg_slot[dest->reg.reg->index];
+}
+
+
+static bool
+alu_op_supported(nir_op op)
+{
+   switch (op) {
+   case nir_op_mov:
+   case nir_op_f2f32:
+   case nir_op_i2i32:
+   case nir_op_u2u32:
+   case nir_op_fneg:
+   case nir_op_fabs:
+   case nir_op_fsat:
+   case nir_op_fsign:
+   case nir_op_ffloor:
+   case nir_op_fceil:
+   case nir_op_ftrunc:
+   case nir_op_ffract:
+   case nir_op_fround_even:
+   case nir_op_frcp:
+   case nir_op_frsq:
+   case nir_op_fsqrt:
+   case nir_op_fexp2:
+   case nir_op_flog2:
+   case nir_op_fsin:
+   case nir_op_fcos:
+   case nir_op_fpow:
+   case nir_op_fadd:
+   case nir_op_fsub:
+   case nir_op_fmul:
+   case nir_op_ffma:
+   case nir_op_flrp:
+   case nir_op_fmin:
+   case nir_op_fmax:
+   case nir_op_f2i32:
+   case nir_op_f2u32:
+   case nir_op_i2f32:
+   case nir_op_u2f32:
+   case nir_op_b2f32:
+   case nir_op_b2i32:
+   case nir_op_f2b32:
+   case nir_op_i2b32:
+   case nir_op_flt32:
+   case nir_op_fge32:
+   case nir_op_feq32:
+   case nir_op_fneu32:
+   case nir_op_ilt32:
+   case nir_op_ige32:
+   case nir_op_ieq32:
+   case nir_op_ine32:
+   case nir_op_ult32:
+   case nir_op_uge32:
+   case nir_op_b32csel:
+   case nir_op_iadd:
+   case nir_op_isub:
+   case nir_op_imul:
+   case nir_op_ineg:
+   case nir_op_iabs:
+   case nir_op_isign:
+   case nir_op_imin:
+   case nir_op_imax:
+   case nir_op_umin:
+   case nir_op_umax:
+   case nir_op_idiv:
+   case nir_op_udiv:
+   case nir_op_umod:
+   case nir_op_irem:
+   case nir_op_imod:
+   case nir_op_iand:
+   case nir_op_ior:
+   case nir_op_ixor:
+   case nir_op_inot:
+   case nir_op_ishl:
+   case nir_op_ishr:
+   case nir_op_ushr:
+   case nir_op_bit_count:
+   case nir_op_find_lsb:
+   case nir_op_ufind_msb:
+   case nir_op_ifind_msb:
+   case nir_op_bitfield_reverse:
+   case nir_op_fddx:
+   case nir_op_fddy:
+   case nir_op_fddx_coarse:
+   case nir_op_fddy_coarse:
+   case nir_op_fddx_fine:
+   case nir_op_fddy_fine:
+      return true;
+   default:
+      return false;
+   }
+}
+
+
+static void
+emit_alu(struct sp_nir_compile *c, nir_alu_instr *alu)
+{
+   const nir_op_info *info = &nir_op_infos[alu->op];
+   const bool is_vec = nir_op_is_vec(alu->op);
+   unsigned src[NIR_MAX_VEC_COMPONENTS];
+   bool masked, alias = false;
+   unsigned dst, chan, i;
+
+   if (alu->dest.saturate || (!is_vec && !alu_op_supported(alu->op))) {
+      c->error = TRUE;
+      return;
+   }
+
+   dst = dest_slot(c, &alu->dest.dest, &masked);
+
+   for (i = 0; i < info->num_inputs; i++) {
+      const nir_alu_src *asrc = &alu->src[i];
+
+      if (asrc->abs || asrc->negate ||
+          (!is_vec && info->input_sizes[i] != 0)) {
+         c->error = TRUE;
+         return;
+      }
+      src[i] = src_slot(c, &asrc->src);
+
+      if (!alu->dest.dest.is_ssa && !asrc->src.is_ssa &&
+          asrc->src.reg.reg == alu->dest.dest.reg.reg)
+         alias = true;
+   }
+
+   if (c->error)
+      return;
+
+   /* Components are written one at a time, so a register which is also
+    * read with a swizzle goes through the temporaries.
+    */
+   for (chan = 0; chan < 4; chan++) {
+      if (!(alu->dest.write_mask & (1 << chan)))
+         continue;
+
+      if (is_vec) {
+         emit_mov(c, alias ? SP_NIR_SLOT_TEMP + chan : dst + chan,
+                  src[chan] + alu->src[chan].swizzle[0], !alias && masked);
+      } else {
+         struct sp_nir_inst *inst =
+            emit(c, SP_NIR_ALU, alias ? SP_NIR_SLOT_TEMP + chan : dst + chan);
+
+         inst->alu_op = alu->op;
+         inst->masked = !alias && masked;
+         for (i = 0; i < info->num_inputs; i++)
+            inst->src[i] = src[i] + alu->src[i].swizzle[chan];
+      }
+   }
+
+   if (alias) {
+      for (chan = 0; chan < 4; chan++) {
+         if (alu->dest.write_mask & (1 << chan))
+            emit_mov(c, dst + chan, SP_NIR_SLOT_TEMP + chan, masked);
+      }
+   }
+}
+
+
+static int
+find_input(const struct sp_nir_compile *c, unsigned location)
+{
+   unsigned name, index, i;
+
+   tgsi_get_gl_varying_semantic(location, c->texcoord_semantic,
+                                &name, &index);
+
+   for (i = 0; i < c->info->num_inputs; i++) {
+      if (c->info->input_semantic_name[i] == name &&
+          c->info->input_semantic_index[i] == index)
+         return i;
+   }
+   return -1;
+}
+
+
+static void
+emit_load_input(struct sp_nir_compile *c, nir_intrinsic_instr *intr)
+{
+   nir_src *offset = &intr->src[intr->intrinsic == nir_intrinsic_load_input ?
+                                0 : 1];
+   unsigned location, first, dst, chan;
+   int index;
+   bool masked;
+
+   if (!nir_src_is_const(*offset)) {
+      c->error = TRUE;
+      return;
+   }
+
+   if (intr->intrinsic == nir_intrinsic_load_interpolated_input) {
+      nir_intrinsic_instr *bary = nir_src_as_intrinsic(intr->src[0]);
+
+      if (!bary ||
+          (bary->intrinsic != nir_intrinsic_load_barycentric_pixel &&
+           bary->intrinsic != nir_intrinsic_load_barycentric_centroid)) {
+         c->error = TRUE;
+         return;
+      }
+   }
+
+   location = nir_intrinsic_io_semantics(intr).location +
+              nir_src_as_uint(*offset);
+   index = find_input(c, location);
+   if (index < 0) {
+      c->error = TRUE;
+      return;
+   }
+
+   dst = dest_slot(c, &intr->dest, &masked);
+   first = nir_intrinsic_component(intr);
+
+   for (chan = 0; chan < nir_dest_num_components(intr->dest); chan++) {
+      struct sp_nir_inst *inst;
+
+      if (location == VARYING_SLOT_FACE) {
+         inst = emit(c, SP_NIR_FACE, dst + chan);
+         inst->u.value = c->face_is_bool;
+      } else {
+         inst = emit(c, SP_NIR_INTERP, dst + chan);
+         inst->u.input.index = index;
+         inst->u.input.chan = first + chan;
+         inst->u.input.interp = c->info->input_interpolate[index];
+
+         if (inst->u.input.interp == TGSI_INTERPOLATE_PERSPECTIVE ||
+             inst->u.input.interp == TGSI_INTERPOLATE_COLOR)
+            c->shader->needs_w = TRUE;
+      }
+      inst->masked = masked;
+   }
+}
+
+
+static void
+emit_store_output(struct sp_nir_compile *c, nir_intrinsic_instr *intr)
+{
+   const nir_io_semantics sem = nir_intrinsic_io_semantics(intr);
+   const unsigned index = nir_intrinsic_base(intr) +
+                          nir_src_as_uint(intr->src[1]);
+   const unsigned first = nir_intrinsic_component(intr);
+   const unsigned src = src_slot(c, &intr->src[0]);
+   const unsigned dst = c->output_slot[index];
+   struct sp_nir_fragment_shader *shader = c->shader;
+   unsigned chan, i;
+
+   for (i = 0; i < shader->num_outputs; i++) {
+      if (shader->outputs[i].slot == dst)
+         break;
+   }
+
+   if (i == shader->num_outputs) {
+      struct sp_nir_output *output = &shader->outputs[shader->num_outputs++];
+      unsigned semantic_index;
+
+      output->slot = dst;
+      tgsi_get_gl_frag_result_semantic(sem.location, &output->semantic,
+                                       &semantic_index);
+      output->cbuf = semantic_index + sem.dual_source_blend_index;
+   }
+
+   for (chan = 0; chan < 4; chan++) {
+      if (nir_intrinsic_write_mask(intr) & (1 << chan))
+         emit_mov(c, dst + first + chan, src + chan, true);
+   }
+}
+
+
+static void
+emit_load_ubo(struct sp_nir_compile *c, nir_intrinsic_instr *intr)
+{
+   struct sp_nir_inst *inst;
+   bool masked;
+   unsigned dst = dest_slot(c, &intr->dest, &masked);
+
+   if (nir_src_is_const(intr->src[0]) && nir_src_is_const(intr->src[1]) &&
+       nir_src_as_uint(intr->src[0]) < PIPE_MAX_CONSTANT_BUFFERS &&
+       nir_src_as_uint(intr->src[1]) / 4 <= UINT16_MAX) {
+      inst = emit(c, SP_NIR_LOAD_UBO_CONST, dst);
+      inst->u.ubo.block = nir_src_as_uint(intr->src[0]);
+      inst->u.ubo.offset = nir_src_as_uint(intr->src[1]) / 4;
+   } else {
+      inst = emit(c, SP_NIR_LOAD_UBO, dst);
+      inst->src[0] = src_slot(c, &intr->src[0]);
+      inst->src[1] = src_slot(c, &intr->src[1]);
+   }
+   inst->u.ubo.num_comps = nir_dest_num_components(intr->dest);
+   inst->masked = masked;
+}
+
+
+static void
+emit_intrinsic(struct sp_nir_compile *c, nir_intrinsic_instr *intr)
+{
+   switch (intr->intrinsic) {
+   case nir_intrinsic_load_barycentric_pixel:
+   case nir_intrinsic_load_barycentric_centroid:
+      break;
+   case nir_intrinsic_load_input:
+   case nir_intrinsic_load_interpolated_input:
+      emit_load_input(c, intr);
+      break;
+   case nir_intrinsic_load_front_face: {
+      bool masked;
+      struct sp_nir_inst *inst =
+         emit(c, SP_NIR_FACE, dest_slot(c, &intr->dest, &masked));
+      inst->u.value = TRUE;
+      inst->masked = masked;
+      break;
+   }
+   case nir_intrinsic_store_output:
+      emit_store_output(c, intr);
+      break;
+   case nir_intrinsic_load_ubo:
+      emit_load_ubo(c, intr);
+      break;
+   case nir_intrinsic_discard:
+   case nir_intrinsic_terminate:
+   case nir_intrinsic_demote:
+      emit(c, SP_NIR_DISCARD, SP_NIR_SLOT_ZERO);
+      break;
+   case nir_intrinsic_discard_if:
+   case nir_intrinsic_terminate_if:
+   case nir_intrinsic_demote_if:
+      emit(c, SP_NIR_DISCARD_IF, SP_NIR_SLOT_ZERO)->src[0] =
+         src_slot(c, &intr->src[0]);
+      break;
+   default:
+      c->error = TRUE;
+      break;
+   }
+}
+
+
+static enum tgsi_texture_type
+tex_target(const nir_tex_instr *tex)
+{
+   switch (tex->sampler_dim) {
+   case GLSL_SAMPLER_DIM_1D:
+      if (tex->is_shadow)
+         return tex->is_array ? TGSI_TEXTURE_SHADOW1D_ARRAY :
+                                TGSI_TEXTURE_SHADOW1D;
+      return tex->is_array ? TGSI_TEXTURE_1D_ARRAY : TGSI_TEXTURE_1D;
+   case GLSL_SAMPLER_DIM_2D:
+      if (tex->is_shadow)
+         return tex->is_array ? TGSI_TEXTURE_SHADOW2D_ARRAY :
+                                TGSI_TEXTURE_SHADOW2D;
+      return tex->is_array ? TGSI_TEXTURE_2D_ARRAY : TGSI_TEXTURE_2D;
+   case GLSL_SAMPLER_DIM_3D:
+      return TGSI_TEXTURE_3D;
+   case GLSL_SAMPLER_DIM_CUBE:
+      if (tex->is_shadow)
+         return tex->is_array ? TGSI_TEXTURE_SHADOWCUBE_ARRAY :
+                                TGSI_TEXTURE_SHADOWCUBE;
+      return tex->is_array ? TGSI_TEXTURE_CUBE_ARRAY : TGSI_TEXTURE_CUBE;
+   case GLSL_SAMPLER_DIM_RECT:
+      return tex->is_shadow ? TGSI_TEXTURE_SHADOWRECT : TGSI_TEXTURE_RECT;
+   case GLSL_SAMPLER_DIM_BUF:
+      return TGSI_TEXTURE_BUFFER;
+   default:
+      return TGSI_TEXTURE_UNKNOWN;
+   }
+}
+
+
+static void
+emit_tex(struct sp_nir_compile *c, nir_tex_instr *tex)
+{
+   const enum tgsi_texture_type target = tex_target(tex);
+   struct sp_nir_inst *inst;
+   unsigned coord = SP_NIR_SLOT_ZERO;
+   unsigned comparator = SP_NIR_SLOT_ZERO;
+   unsigned lod = SP_NIR_SLOT_ZERO;
+   enum tgsi_sampler_control control = TGSI_SAMPLER_LOD_NONE;
+   int8_t offset[3] = { 0, 0, 0 };
+   bool masked;
+   unsigned dst, i;
+
+   if (target == TGSI_TEXTURE_UNKNOWN ||
+       tex->texture_index >= PIPE_MAX_SHADER_SAMPLER_VIEWS ||
+       tex->sampler_index >= PIPE_MAX_SAMPLERS) {
+      c->error = TRUE;
+      return;
+   }
+
+   for (i = 0; i < tex->num_srcs; i++) {
+      nir_src *src = &tex->src[i].src;
+
+      switch (tex->src[i].src_type) {
+      case nir_tex_src_coord:
+         coord = src_slot(c, src);
+         break;
+      case nir_tex_src_comparator:
+         comparator = src_slot(c, src);
+         break;
+      case nir_tex_src_bias:
+         control = TGSI_SAMPLER_LOD_BIAS;
+         lod = src_slot(c, src);
+         break;
+      case nir_tex_src_lod:
+         control = TGSI_SAMPLER_LOD_EXPLICIT;
+         lod = src_slot(c, src);
+         break;
+      case nir_tex_src_offset: {
+         unsigned chan;
+
+         if (!nir_src_is_const(*src)) {
+            c->error = TRUE;
+            return;
+         }
+         for (chan = 0; chan < nir_src_num_components(*src); chan++)
+            offset[chan] = nir_src_comp_as_int(*src, chan);
+         break;
+      }
+      default:
+         c->error = TRUE;
+         return;
+      }
+   }
+
+   dst = dest_slot(c, &tex->dest, &masked);
+
+   switch (tex->op) {
+   case nir_texop_tex:
+   case nir_texop_txb:
+   case nir_texop_txl: {
+      int shadow_ref = tgsi_util_get_shadow_ref_src_index(target);
+
+      if (target == TGSI_TEXTURE_BUFFER ||
+          tex->coord_components != tgsi_util_get_texture_coord_dim(target) ||
+          (shadow_ref == 4 && control != TGSI_SAMPLER_LOD_NONE)) {
+         c->error = TRUE;
+         return;
+      }
+
+      inst = emit(c, SP_NIR_TEX, dst);
+      inst->u.tex.shadow_ref = tex->is_shadow ? shadow_ref : -1;
+      inst->u.tex.control = control;
+      break;
+   }
+   case nir_texop_txf:
+      if (tex->sampler_dim == GLSL_SAMPLER_DIM_CUBE || tex->is_shadow) {
+         c->error = TRUE;
+         return;
+      }
+      inst = emit(c, SP_NIR_TXF, dst);
+      break;
+   case nir_texop_txs:
+   case nir_texop_query_levels:
+      inst = emit(c, SP_NIR_TXS, dst);
+      inst->u.tex.levels = tex->op == nir_texop_query_levels;
+      break;
+   default:
+      c->error = TRUE;
+      return;
+   }
+
+   inst->src[0] = coord;
+   inst->src[1] = comparator;
+   inst->src[2] = lod;
+   inst->masked = masked;
+   inst->u.tex.unit = tex->texture_index;
+   inst->u.tex.sampler = tex->sampler_index;
+   inst->u.tex.num_coords = tex->coord_components;
+   inst->u.tex.num_comps = nir_dest_num_components(tex->dest);
+   memcpy(inst->u.tex.offset, offset, sizeof offset);
+}
+
+
+static void
+emit_block(struct sp_nir_compile *c, nir_block *block)
+{
+   nir_foreach_instr(instr, block) {
+      switch (instr->type) {
+      case nir_instr_type_alu:
+         emit_alu(c, nir_instr_as_alu(instr));
+         break;
+      case nir_instr_type_intrinsic:
+         emit_intrinsic(c, nir_instr_as_intrinsic(instr));
+         break;
+      case nir_instr_type_tex:
+         emit_tex(c, nir_instr_as_tex(instr));
+         break;
+      case nir_instr_type_load_const:
+      case nir_instr_type_ssa_undef:
+         /* see emit_constants() */
+         break;
+      case nir_instr_type_jump:
+         switch (nir_instr_as_jump(instr)->type) {
+         case nir_jump_break:
+            emit(c, SP_NIR_BREAK, SP_NIR_SLOT_ZERO);
+            break;
+         case nir_jump_continue:
+            emit(c, SP_NIR_CONTINUE, SP_NIR_SLOT_ZERO);
+            break;
+         default:
+            c->error = TRUE;
+            break;
+         }
+         break;
+      default:
+         c->error = TRUE;
+         break;
+      }
+
+      if (c->error)
+         return;
+   }
+}
+
+
+static void
+emit_cf_list(struct sp_nir_compile *c, struct exec_list *list)
+{
+   foreach_list_typed(nir_cf_node, node, node, list) {
+      switch (node->type) {
+      case nir_cf_node_block:
+         emit_block(c, nir_cf_node_as_block(node));
+         break;
+      case nir_cf_node_if: {
+         nir_if *nif = nir_cf_node_as_if(node);
+         unsigned if_pos, else_pos;
+
+         if (c->cf_depth == SP_NIR_MAX_NESTING) {
+            c->error = TRUE;
+            return;
+         }
+
+         if_pos = emit_pos(c);
+         emit(c, SP_NIR_IF, SP_NIR_SLOT_ZERO)->src[0] =
+            src_slot(c, &nif->condition);
+
+         c->cf_depth++;
+         emit_cf_list(c, &nif->then_list);
+         else_pos = emit_pos(c);
+         emit(c, SP_NIR_ELSE, SP_NIR_SLOT_ZERO);
+         emit_cf_list(c, &nif->else_list);
+         c->cf_depth--;
+
+         inst_at(c, if_pos)->u.target = else_pos;
+         inst_at(c, else_pos)->u.target = emit_pos(c);
+         emit(c, SP_NIR_ENDIF, SP_NIR_SLOT_ZERO);
+         break;
+      }
+      case nir_cf_node_loop: {
+         nir_loop *loop = nir_cf_node_as_loop(node);
+         unsigned loop_pos;
+
+         if (c->cf_depth == SP_NIR_MAX_NESTING) {
+            c->error = TRUE;
+            return;
+         }
+
+         loop_pos = emit_pos(c);
+         emit(c, SP_NIR_LOOP, SP_NIR_SLOT_ZERO);
+
+         c->cf_depth++;
+         c->loop_depth++;
+         emit_cf_list(c, &loop->body);
+         c->loop_depth--;
+         c->cf_depth--;
+
+         inst_at(c, loop_pos)->u.target = emit_pos(c);
+         emit(c, SP_NIR_ENDLOOP, SP_NIR_SLOT_ZERO)->u.target = loop_pos;
+         break;
+      }
+      default:
+         c->error = TRUE;
+         break;
+      }
+
+      if (c->error)
+         return;
+   }
+}
+
+
+/**
+ * Constants get their own slots, which are filled once before the shader
+ * runs.
+ */
+static void
+emit_constants(struct sp_nir_compile *c, nir_function_impl *impl)
+{
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block) {
+         nir_load_const_instr *load;
+         unsigned chan;
+
+         if (instr->type != nir_instr_type_load_const)
+            continue;
+
+         load = nir_instr_as_load_const(instr);
+         if (load->def.bit_size != 32) {
+            c->error = TRUE;
+            return;
+         }
+
+         for (chan = 0; chan < load->def.num_components; chan++) {
+            emit(c, SP_NIR_CONST, c->ssa_slot[load->def.index] + chan)
+               ->u.value = load->value[chan].u32;
+         }
+      }
+   }
+}
+
+
+static int
+type_size(const struct glsl_type *type, bool bindless)
+{
+   return glsl_count_attribute_slots(type, false);
+}
+
+
+/**
+ * Lower the shader to the subset of NIR the interpreter executes.
+ */
+static void
+sp_nir_lower(nir_shader *nir)
+{
+   const nir_lower_tex_options tex_options = {
+      .lower_txp = ~0u,
+   };
+
+   NIR_PASS_V(nir, nir_lower_indirect_derefs,
+              nir_var_shader_in | nir_var_function_temp, UINT32_MAX);
+   NIR_PASS_V(nir, nir_lower_vars_to_ssa);
+   NIR_PASS_V(nir, nir_lower_io, nir_var_shader_in | nir_var_shader_out,
+              type_size, (nir_lower_io_options)0);
+   NIR_PASS_V(nir, nir_lower_regs_to_ssa);
+   NIR_PASS_V(nir, nir_lower_tex, &tex_options);
+   NIR_PASS_V(nir, nir_lower_alu_to_scalar, NULL, NULL);
+   NIR_PASS_V(nir, nir_lower_bool_to_int32);
+   NIR_PASS_V(nir, nir_copy_prop);
+   NIR_PASS_V(nir, nir_opt_dce);
+   NIR_PASS_V(nir, nir_convert_from_ssa, true);
+   NIR_PASS_V(nir, nir_opt_dce);
+}
+
+
+static boolean
+sp_nir_compile(struct sp_nir_fragment_shader *shader,
+               struct pipe_screen *screen, const nir_shader *templ)
+{
+   struct sp_nir_compile c;
+   nir_shader *nir = nir_shader_clone(NULL, templ);
+   nir_function_impl *impl;
+
+   memset(&c, 0, sizeof c);
+   c.shader = shader;
+   c.info = &shader->base.info;
+   c.texcoord_semantic = screen->get_param(screen, PIPE_CAP_TGSI_TEXCOORD);
+   util_dynarray_init(&c.insts, NULL);
+   util_dynarray_init(&c.slot_end, NULL);
+
+   nir_foreach_shader_in_variable(var, nir) {
+      if (var->data.location == VARYING_SLOT_FACE)
+         c.face_is_bool = glsl_type_is_boolean(var->type);
+   }
+
+   sp_nir_lower(nir);
+   impl = nir_shader_get_entrypoint(nir);
+
+   alloc_shader_slots(&c, impl);
+   if (!c.error)
+      emit_constants(&c, impl);
+   if (!c.error)
+      emit_cf_list(&c, &impl->body);
+
+   if (!c.error) {
+      shader->num_insts = emit_pos(&c);
+      shader->num_slots = c.num_slots;
+      shader->insts = MALLOC(MAX2(shader->num_insts, 1) *
+                             sizeof(struct sp_nir_inst));
+      if (shader->insts)
+         memcpy(shader->insts, c.insts.data, c.insts.size);
+      else
+         c.error = TRUE;
+   }
+
+   FREE(c.ssa_slot);
+   FREE(c.ssa_start);
+   FREE(c.ssa_end);
+   FREE(c.reg_slot);
+   util_dynarray_fini(&c.insts);
+   util_dynarray_fini(&c.slot_end);
+   ralloc_free(nir);
+
+   return !c.error;
+}
+
+
+/*
+ * Execution
+ */
+
+#define FOR_LANES for (unsigned l = 0; l < n; l++)
+
+#define UNOP(op, type, expr)                                \
+   case nir_op_##op:                                        \
+      FOR_LANES { const type x = a[l]; d[l] = (expr); }    \
+      break
+
+#define BINOP(op, type, expr)                               \
+   case nir_op_##op:                                        \
+      FOR_LANES { const type x = a[l], y = b[l]; d[l] = (expr); } \
+      break
+
+
+/**
+ * The float ops compute the same way the TGSI interpreter does, so that
+ * switching interpreters doesn't change rendering.
+ */
+static bool
+exec_float_alu(nir_op op, float *restrict d, const float *a,
+               const float *b, const float *c, unsigned n)
+{
+   switch (op) {
+   UNOP(fneg, float, -x);
+   UNOP(fabs, float, fabsf(x));
+   UNOP(fsat, float, fminf(fmaxf(x, 0.0f), 1.0f));
+   UNOP(fsign, float, x < 0.0f ? -1.0f : x > 0.0f ? 1.0f : 0.0f);
+   UNOP(ffloor, float, floorf(x));
+   UNOP(fceil, float, ceilf(x));
+   UNOP(ftrunc, float, truncf(x));
+   UNOP(ffract, float, x - floorf(x));
+   UNOP(fround_even, float, _mesa_roundevenf(x));
+   UNOP(frcp, float, 1.0f / x);
+   UNOP(frsq, float, 1.0f / sqrtf(x));
+   UNOP(fsqrt, float, sqrtf(x));
+   UNOP(fexp2, float, powf(2.0f, x));
+   UNOP(flog2, float, logf(x) * 1.442695f);
+   UNOP(fsin, float, sinf(x));
+   UNOP(fcos, float, cosf(x));
+   BINOP(fpow, float, powf(x, y));
+   BINOP(fadd, float, x + y);
+   BINOP(fsub, float, x - y);
+   BINOP(fmul, float, x * y);
+   BINOP(fmin, float, fminf(x, y));
+   BINOP(fmax, float, fmaxf(x, y));
+   case nir_op_ffma:
+      FOR_LANES d[l] = a[l] * b[l] + c[l];
+      break;
+   case nir_op_flrp:
+      FOR_LANES d[l] = c[l] * (b[l] - a[l]) + a[l];
+      break;
+   default:
+      return false;
+   }
+   return true;
+}
+
+
+static void
+exec_alu(nir_op op, union sp_nir_chan *restrict dst,
+         const union sp_nir_chan *src0, const union sp_nir_chan *src1,
+         const union sp_nir_chan *src2, unsigned n)
+{
+   switch (op) {
+   case nir_op_mov:
+   case nir_op_f2f32:
+   case nir_op_i2i32:
+   case nir_op_u2u32:
+      memcpy(dst->u, src0->u, n * sizeof(uint32_t));
+      return;
+
+   case nir_op_fddx:
+   case nir_op_fddx_coarse:
+      for (unsigned q = 0; q < n; q += 4) {
+         const float v = src0->f[q + 3] - src0->f[q + 2];
+         dst->f[q] = dst->f[q + 1] = dst->f[q + 2] = dst->f[q + 3] = v;
+      }
+      return;
+   case nir_op_fddy:
+   case nir_op_fddy_coarse:
+      for (unsigned q = 0; q < n; q += 4) {
+         const float v = src0->f[q + 2] - src0->f[q];
+         dst->f[q] = dst->f[q + 1] = dst->f[q + 2] = dst->f[q + 3] = v;
+      }
+      return;
+   case nir_op_fddx_fine:
+      for (unsigned q = 0; q < n; q += 4) {
+         const float top = src0->f[q + 1] - src0->f[q];
+         const float bottom = src0->f[q + 3] - src0->f[q + 2];
+         dst->f[q] = dst->f[q + 1] = top;
+         dst->f[q + 2] = dst->f[q + 3] = bottom;
+      }
+      return;
+   case nir_op_fddy_fine:
+      for (unsigned q = 0; q < n; q += 4) {
+         const float left = src0->f[q + 2] - src0->f[q];
+         const float right = src0->f[q + 3] - src0->f[q + 1];
+         dst->f[q] = dst->f[q + 2] = left;
+         dst->f[q + 1] = dst->f[q + 3] = right;
+      }
+      return;
+
+   default:
+      break;
+   }
+
+   if (exec_float_alu(op, dst->f, src0->f, src1->f, src2->f, n))
+      return;
+
+   {
+      const float *af = src0->f, *bf = src1->f;
+      const int32_t *ai = src0->i, *bi = src1->i;
+      const uint32_t *a = src0->u, *b = src1->u, *c = src2->u;
+      int32_t *di = dst->i;
+      uint32_t *d = dst->u;
+      float *df = dst->f;
+
+      switch (op) {
+      case nir_op_f2i32:
+         FOR_LANES di[l] = (int32_t)af[l];
+         break;
+      case nir_op_f2u32:
+         FOR_LANES d[l] = (uint32_t)af[l];
+         break;
+      case nir_op_i2f32:
+         FOR_LANES df[l] = (float)ai[l];
+         break;
+      case nir_op_u2f32:
+         FOR_LANES df[l] = (float)a[l];
+         break;
+      case nir_op_b2f32:
+         FOR_LANES df[l] = a[l] ? 1.0f : 0.0f;
+         break;
+      case nir_op_b2i32:
+         FOR_LANES d[l] = a[l] ? 1 : 0;
+         break;
+      case nir_op_f2b32:
+         FOR_LANES d[l] = af[l] != 0.0f ? ~0u : 0;
+         break;
+      case nir_op_i2b32:
+         FOR_LANES d[l] = a[l] ? ~0u : 0;
+         break;
+
+      case nir_op_flt32:
+         FOR_LANES d[l] = af[l] < bf[l] ? ~0u : 0;
+         break;
+      case nir_op_fge32:
+         FOR_LANES d[l] = af[l] >= bf[l] ? ~0u : 0;
+         break;
+      case nir_op_feq32:
+         FOR_LANES d[l] = af[l] == bf[l] ? ~0u : 0;
+         break;
+      case nir_op_fneu32:
+         FOR_LANES d[l] = af[l] != bf[l] ? ~0u : 0;
+         break;
+      case nir_op_ilt32:
+         FOR_LANES d[l] = ai[l] < bi[l] ? ~0u : 0;
+         break;
+      case nir_op_ige32:
+         FOR_LANES d[l] = ai[l] >= bi[l] ? ~0u : 0;
+         break;
+      case nir_op_ieq32:
+         FOR_LANES d[l] = a[l] == b[l] ? ~0u : 0;
+         break;
+      case nir_op_ine32:
+         FOR_LANES d[l] = a[l] != b[l] ? ~0u : 0;
+         break;
+      case nir_op_ult32:
+         FOR_LANES d[l] = a[l] < b[l] ? ~0u : 0;
+         break;
+      case nir_op_uge32:
+         FOR_LANES d[l] = a[l] >= b[l] ? ~0u : 0;
+         break;
+      case nir_op_b32csel:
+         FOR_LANES d[l] = a[l] ? b[l] : c[l];
+         break;
+
+      case nir_op_iadd:
+         FOR_LANES d[l] = a[l] + b[l];
+         break;
+      case nir_op_isub:
+         FOR_LANES d[l] = a[l] - b[l];
+         break;
+      case nir_op_imul:
+         FOR_LANES d[l] = a[l] * b[l];
+         break;
+      case nir_op_ineg:
+         FOR_LANES d[l] = -a[l];
+         break;
+      case nir_op_iabs:
+         FOR_LANES d[l] = ai[l] < 0 ? -a[l] : a[l];
+         break;
+      case nir_op_isign:
+         FOR_LANES di[l] = ai[l] < 0 ? -1 : ai[l] > 0 ? 1 : 0;
+         break;
+      case nir_op_imin:
+         FOR_LANES di[l] = MIN2(ai[l], bi[l]);
+         break;
+      case nir_op_imax:
+         FOR_LANES di[l] = MAX2(ai[l], bi[l]);
+         break;
+      case nir_op_umin:
+         FOR_LANES d[l] = MIN2(a[l], b[l]);
+         break;
+      case nir_op_umax:
+         FOR_LANES d[l] = MAX2(a[l], b[l]);
+         break;
+
+      /* Division by zero gives what the TGSI interpreter returns.  The
+       * fragments outside the execution mask run too, so nothing here may
+       * trap.
+       */
+      case nir_op_idiv:
+         FOR_LANES {
+            if (!bi[l])
+               di[l] = 0;
+            else if (bi[l] == -1)
+               d[l] = -a[l];
+            else
+               di[l] = ai[l] / bi[l];
+         }
+         break;
+      case nir_op_udiv:
+         FOR_LANES d[l] = b[l] ? a[l] / b[l] : ~0u;
+         break;
+      case nir_op_umod:
+         FOR_LANES d[l] = b[l] ? a[l] % b[l] : ~0u;
+         break;
+      case nir_op_irem:
+         FOR_LANES {
+            if (!bi[l])
+               d[l] = ~0u;
+            else if (bi[l] == -1)
+               d[l] = 0;
+            else
+               di[l] = ai[l] % bi[l];
+         }
+         break;
+      case nir_op_imod:
+         FOR_LANES {
+            if (!bi[l]) {
+               d[l] = ~0u;
+            } else if (bi[l] == -1) {
+               d[l] = 0;
+            } else {
+               int32_t r = ai[l] % bi[l];
+               di[l] = (r != 0 && (r < 0) != (bi[l] < 0)) ? r + bi[l] : r;
+            }
+         }
+         break;
+
+      case nir_op_iand:
+         FOR_LANES d[l] = a[l] & b[l];
+         break;
+      case nir_op_ior:
+         FOR_LANES d[l] = a[l] | b[l];
+         break;
+      case nir_op_ixor:
+         FOR_LANES d[l] = a[l] ^ b[l];
+         break;
+      case nir_op_inot:
+         FOR_LANES d[l] = ~a[l];
+         break;
+      case nir_op_ishl:
+         FOR_LANES d[l] = a[l] << (b[l] & 31);
+         break;
+      case nir_op_ishr:
+         FOR_LANES di[l] = ai[l] >> (b[l] & 31);
+         break;
+      case nir_op_ushr:
+         FOR_LANES d[l] = a[l] >> (b[l] & 31);
+         break;
+      case nir_op_bit_count:
+         FOR_LANES d[l] = util_bitcount(a[l]);
+         break;
+      case nir_op_find_lsb:
+         FOR_LANES di[l] = ffs(a[l]) - 1;
+         break;
+      case nir_op_ufind_msb:
+         FOR_LANES di[l] = util_last_bit(a[l]) - 1;
+         break;
+      case nir_op_ifind_msb:
+         FOR_LANES di[l] = util_last_bit_signed(ai[l]) - 1;
+         break;
+      case nir_op_bitfield_reverse:
+         FOR_LANES d[l] = util_bitreverse(a[l]);
+         break;
+
+      default:
+         unreachable("unexpected ALU op");
+      }
+   }
+}
+
+
+static inline uint64_t
+lane_mask(const union sp_nir_chan *cond, unsigned n)
+{
+   uint64_t mask = 0;
+
+   FOR_LANES {
+      if (cond->u[l])
+         mask |= BITFIELD64_BIT(l);
+   }
+   return mask;
+}
+
+
+static inline void
+write_masked(union sp_nir_chan *dst, const union sp_nir_chan *src,
+             uint64_t exec, unsigned n)
+{
+   FOR_LANES {
+      if (exec & BITFIELD64_BIT(l))
+         dst->u[l] = src->u[l];
+   }
+}
+
+
+/**
+ * Copy results which were computed into the scratch slots to the
+ * destination.
+ */
+static inline void
+write_scratch(union sp_nir_chan *r, const struct sp_nir_inst *inst,
+              unsigned num_comps, uint64_t exec, uint64_t all, unsigned n)
+{
+   unsigned chan;
+
+   for (chan = 0; chan < num_comps; chan++) {
+      if (inst->masked && exec != all)
+         write_masked(&r[inst->dst + chan], &r[SP_NIR_SLOT_SCRATCH + chan],
+                      exec, n);
+      else
+         memcpy(r[inst->dst + chan].u, r[SP_NIR_SLOT_SCRATCH + chan].u,
+                n * sizeof(uint32_t));
+   }
+}
+
+
+static void
+exec_interp(union sp_nir_chan *restrict d, const struct sp_nir_inst *inst,
+            const union sp_nir_chan *w, struct quad_header *quads[],
+            unsigned nr, boolean flatshade_color)
+{
+   const struct tgsi_interp_coef *coef = &quads[0]->coef[inst->u.input.index];
+   const unsigned chan = inst->u.input.chan;
+   const float a0 = coef->a0[chan];
+   const float dadx = coef->dadx[chan];
+   const float dady = coef->dady[chan];
+   unsigned interp = inst->u.input.interp;
+   unsigned q;
+
+   if (interp == TGSI_INTERPOLATE_COLOR)
+      interp = flatshade_color ? TGSI_INTERPOLATE_CONSTANT :
+                                 TGSI_INTERPOLATE_PERSPECTIVE;
+
+   for (q = 0; q < nr; q++) {
+      const float x = (float) quads[q]->input.x0;
+      const float y = (float) quads[q]->input.y0;
+      const float a = a0 + dadx * x + dady * y;
+      float *v = &d->f[q * 4];
+
+      switch (interp) {
+      case TGSI_INTERPOLATE_CONSTANT:
+         v[0] = v[1] = v[2] = v[3] = a0;
+         break;
+      case TGSI_INTERPOLATE_LINEAR:
+         v[0] = a;
+         v[1] = a + dadx;
+         v[2] = a + dady;
+         v[3] = a + dadx + dady;
+         break;
+      default:
+         v[0] = a / w->f[q * 4];
+         v[1] = (a + dadx) / w->f[q * 4 + 1];
+         v[2] = (a + dady) / w->f[q * 4 + 2];
+         v[3] = (a + dadx + dady) / w->f[q * 4 + 3];
+         break;
+      }
+   }
+}
+
+
+static void
+exec_load_ubo(union sp_nir_chan *r, const struct sp_nir_inst *inst,
+              const struct tgsi_exec_machine *machine, unsigned n)
+{
+   const unsigned num_comps = inst->u.ubo.num_comps;
+   unsigned chan;
+
+   if (inst->opcode == SP_NIR_LOAD_UBO_CONST) {
+      const unsigned block = inst->u.ubo.block;
+      const uint32_t *buf = machine->Consts[block];
+      const unsigned size = machine->ConstsSize[block] / 4;
+
+      for (chan = 0; chan < num_comps; chan++) {
+         const unsigned pos = inst->u.ubo.offset + chan;
+         const uint32_t v = buf && pos < size ? buf[pos] : 0;
+         uint32_t *d = r[SP_NIR_SLOT_SCRATCH + chan].u;
+
+         FOR_LANES d[l] = v;
+      }
+      return;
+   }
+
+   FOR_LANES {
+      const unsigned block = r[inst->src[0]].u[l];
+      const unsigned offset = r[inst->src[1]].u[l] / 4;
+      const uint32_t *buf = NULL;
+      unsigned size = 0;
+
+      if (block < PIPE_MAX_CONSTANT_BUFFERS) {
+         buf = machine->Consts[block];
+         size = machine->ConstsSize[block] / 4;
+      }
+
+      for (chan = 0; chan < num_comps; chan++) {
+         const unsigned pos = offset + chan;
+         r[SP_NIR_SLOT_SCRATCH + chan].u[l] = buf && pos < size ? buf[pos] : 0;
+      }
+   }
+}
+
+
+static void
+exec_tex(union sp_nir_chan *r, const struct sp_nir_inst *inst,
+         struct tgsi_sampler *sampler, unsigned n)
+{
+   unsigned q, chan, i;
+
+   for (q = 0; q < n; q += 4) {
+      float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
+      const float *args[5];
+
+      for (i = 0; i < ARRAY_SIZE(args); i++)
+         args[i] = &r[SP_NIR_SLOT_ZERO].f[q];
+      for (i = 0; i < inst->u.tex.num_coords; i++)
+         args[i] = &r[inst->src[0] + i].f[q];
+      if (inst->u.tex.shadow_ref >= 0)
+         args[inst->u.tex.shadow_ref] = &r[inst->src[1]].f[q];
+      if (inst->u.tex.control != TGSI_SAMPLER_LOD_NONE)
+         args[4] = &r[inst->src[2]].f[q];
+
+      sampler->get_samples(sampler, inst->u.tex.unit, inst->u.tex.sampler,
+                           args[0], args[1], args[2], args[3], args[4],
+                           NULL, inst->u.tex.offset,
+                           inst->u.tex.control, rgba);
+
+      for (chan = 0; chan < inst->u.tex.num_comps; chan++)
+         memcpy(&r[SP_NIR_SLOT_SCRATCH + chan].f[q], rgba[chan],
+                sizeof rgba[chan]);
+   }
+}
+
+
+static void
+exec_txf(union sp_nir_chan *r, const struct sp_nir_inst *inst,
+         struct tgsi_sampler *sampler, unsigned n)
+{
+   unsigned q, chan, i;
+
+   for (q = 0; q < n; q += 4) {
+      float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE];
+      const int *args[3];
+
+      for (i = 0; i < ARRAY_SIZE(args); i++)
+         args[i] = &r[SP_NIR_SLOT_ZERO].i[q];
+      for (i = 0; i < inst->u.tex.num_coords; i++)
+         args[i] = &r[inst->src[0] + i].i[q];
+
+      sampler->get_texel(sampler, inst->u.tex.unit,
+                         args[0], args[1], args[2], &r[inst->src[2]].i[q],
+                         inst->u.tex.offset, rgba);
+
+      for (chan = 0; chan < inst->u.tex.num_comps; chan++)
+         memcpy(&r[SP_NIR_SLOT_SCRATCH + chan].f[q], rgba[chan],
+                sizeof rgba[chan]);
+   }
+}
+
+
+static void
+exec_txs(union sp_nir_chan *r, const struct sp_nir_inst *inst,
+         struct tgsi_sampler *sampler, unsigned n)
+{
+   unsigned q, chan;
+
+   for (q = 0; q < n; q += 4) {
+      int dims[4];
+
+      sampler->get_dims(sampler, inst->u.tex.unit, r[inst->src[2]].i[q], dims);
+
+      for (chan = 0; chan < inst->u.tex.num_comps; chan++) {
+         const int v = dims[inst->u.tex.levels ? 3 : chan];
+         int32_t *d = &r[SP_NIR_SLOT_SCRATCH + chan].i[q];
+         d[0] = d[1] = d[2] = d[3] = v;
+      }
+   }
+}
+
+
+/**
+ * Run the shader on nr <= SP_NIR_MAX_QUADS quads.
+ * \return mask of the quads which still have live fragments
+ */
+static unsigned
+nir_run_span(const struct sp_nir_fragment_shader *shader,
+             struct tgsi_exec_machine *machine,
+             struct quad_header *quads[], unsigned nr,
+             bool early_depth_test, union sp_nir_chan *r)
+{
+   const unsigned n = nr * TGSI_QUAD_SIZE;
+   const uint64_t all = n == 64 ? ~0ull : BITFIELD64_MASK(n);
+   struct {
+      uint64_t saved, other;
+   } ifs[SP_NIR_MAX_NESTING];
+   struct {
+      uint64_t saved, broken, continued;
+      unsigned end, if_depth;
+   } loops[SP_NIR_MAX_NESTING];
+   unsigned if_depth = 0, loop_depth = 0;
+   uint64_t exec = all, killed = 0;
+   unsigned pc, q, i, live = 0;
+
+   memset(r[SP_NIR_SLOT_ZERO].u, 0, n * sizeof(uint32_t));
+
+   /* Channels the shader doesn't write come out as zero */
+   for (i = 0; i < shader->num_outputs; i++) {
+      for (q = 0; q < TGSI_NUM_CHANNELS; q++)
+         memset(r[shader->outputs[i].slot + q].u, 0, n * sizeof(uint32_t));
+   }
+
+   if (shader->needs_w) {
+      for (q = 0; q < nr; q++) {
+         const struct tgsi_interp_coef *coef = quads[q]->posCoef;
+         const float dadx = coef->dadx[3];
+         const float dady = coef->dady[3];
+         const float a0 = coef->a0[3] + dadx * quads[q]->input.x0 +
+                          dady * quads[q]->input.y0;
+         float *w = &r[SP_NIR_SLOT_W].f[q * 4];
+
+         w[0] = a0;
+         w[1] = a0 + dadx;
+         w[2] = a0 + dady;
+         w[3] = a0 + dadx + dady;
+      }
+   }
+
+   for (pc = 0; pc < shader->num_insts; pc++) {
+      const struct sp_nir_inst *inst = &shader->insts[pc];
+      const bool partial = inst->masked && exec != all;
+      union sp_nir_chan *d =
+         &r[partial ? SP_NIR_SLOT_SCRATCH : inst->dst];
+
+      switch (inst->opcode) {
+      case SP_NIR_ALU:
+         exec_alu(inst->alu_op, d, &r[inst->src[0]], &r[inst->src[1]],
+                  &r[inst->src[2]], n);
+         break;
+
+      case SP_NIR_CONST:
+         FOR_LANES d->u[l] = inst->u.value;
+         break;
+
+      case SP_NIR_INTERP:
+         exec_interp(d, inst, &r[SP_NIR_SLOT_W], quads, nr,
+                     machine->flatshade_color);
+         break;
+
+      case SP_NIR_FACE:
+         for (q = 0; q < nr; q++) {
+            const boolean front = !quads[q]->input.facing;
+
+            for (i = 0; i < 4; i++) {
+               if (inst->u.value)
+                  d->u[q * 4 + i] = front ? ~0u : 0;
+               else
+                  d->f[q * 4 + i] = front ? 1.0f : -1.0f;
+            }
+         }
+         break;
+
+      case SP_NIR_LOAD_UBO:
+      case SP_NIR_LOAD_UBO_CONST:
+         exec_load_ubo(r, inst, machine, n);
+         write_scratch(r, inst, inst->u.ubo.num_comps, exec, all, n);
+         continue;
+
+      case SP_NIR_TEX:
+         exec_tex(r, inst, machine->Sampler, n);
+         write_scratch(r, inst, inst->u.tex.num_comps, exec, all, n);
+         continue;
+
+      case SP_NIR_TXF:
+         exec_txf(r, inst, machine->Sampler, n);
+         write_scratch(r, inst, inst->u.tex.num_comps, exec, all, n);
+         continue;
+
+      case SP_NIR_TXS:
+         exec_txs(r, inst, machine->Sampler, n);
+         write_scratch(r, inst, inst->u.tex.num_comps, exec, all, n);
+         continue;
+
+      case SP_NIR_DISCARD:
+         killed |= exec;
+         continue;
+
+      case SP_NIR_DISCARD_IF:
+         killed |= exec & lane_mask(&r[inst->src[0]], n);
+         continue;
+
+      case SP_NIR_IF: {
+         const uint64_t cond = lane_mask(&r[inst->src[0]], n);
+
+         ifs[if_depth].saved = exec;
+         ifs[if_depth].other = exec & ~cond;
+         if_depth++;
+         exec &= cond;
+         if (!exec)
+            pc = inst->u.target - 1;
+         continue;
+      }
+
+      case SP_NIR_ELSE:
+         exec = ifs[if_depth - 1].other;
+         if (!exec)
+            pc = inst->u.target - 1;
+         continue;
+
+      case SP_NIR_ENDIF:
+         if_depth--;
+         exec = ifs[if_depth].saved;
+         if (loop_depth) {
+            exec &= ~(loops[loop_depth - 1].broken |
+                      loops[loop_depth - 1].continued);
+
+            /* nothing left to run in this iteration */
+            if (!exec)
+               pc = loops[loop_depth - 1].end - 1;
+         }
+         continue;
+
+      case SP_NIR_LOOP:
+         loops[loop_depth].saved = exec;
+         loops[loop_depth].broken = 0;
+         loops[loop_depth].continued = 0;
+         loops[loop_depth].end = inst->u.target;
+         loops[loop_depth].if_depth = if_depth;
+         loop_depth++;
+         continue;
+
+      case SP_NIR_ENDLOOP:
+         /* ENDIF may have jumped here past the ends of enclosing ifs */
+         if_depth = loops[loop_depth - 1].if_depth;
+         exec = loops[loop_depth - 1].saved & ~loops[loop_depth - 1].broken;
+         loops[loop_depth - 1].continued = 0;
+         if (exec) {
+            pc = inst->u.target;
+         } else {
+            loop_depth--;
+            exec = loops[loop_depth].saved;
+         }
+         continue;
+
+      case SP_NIR_BREAK:
+         loops[loop_depth - 1].broken |= exec;
+         exec = 0;
+         continue;
+
+      case SP_NIR_CONTINUE:
+         loops[loop_depth - 1].continued |= exec;
+         exec = 0;
+         continue;
+
+      default:
+         unreachable("bad instruction");
+      }
+
+      if (partial)
+         write_masked(&r[inst->dst], d, exec, n);
+   }
+
+   for (q = 0; q < nr; q++) {
+      struct quad_header *quad = quads[q];
+
+      quad->inout.mask &= ~(killed >> (q * 4));
+      if (!quad->inout.mask)
+         continue;
+
+      live |= 1 << q;
+
+      for (i = 0; i < shader->num_outputs; i++) {
+         const struct sp_nir_output *output = &shader->outputs[i];
+         const union sp_nir_chan *out = &r[output->slot];
+         unsigned chan;
+
+         switch (output->semantic) {
+         case TGSI_SEMANTIC_COLOR:
+            for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+               memcpy(quad->output.color[output->cbuf][chan],
+                      &out[chan].f[q * 4],
+                      sizeof quad->output.color[0][0]);
+            break;
+         case TGSI_SEMANTIC_POSITION:
+            if (!early_depth_test)
+               memcpy(quad->output.depth, &out[0].f[q * 4],
+                      sizeof quad->output.depth);
+            break;
+         case TGSI_SEMANTIC_STENCIL:
+            if (!early_depth_test) {
+               for (chan = 0; chan < TGSI_QUAD_SIZE; chan++)
+                  quad->output.stencil[chan] = out[0].u[q * 4 + chan];
+            }
+            break;
+         }
+      }
+   }
+
+   return live;
+}
+
+
+static unsigned
+nir_run_quads(const struct sp_fragment_shader_variant *var,
+              struct tgsi_exec_machine *machine,
+              struct quad_header *quads[], unsigned nr,
+              bool early_depth_test, void *scratch)
+{
+   const struct sp_nir_fragment_shader *shader = sp_nir_fragment_shader(var);
+   unsigned first, live = 0;
+
+   for (first = 0; first < nr; first += SP_NIR_MAX_QUADS) {
+      live |= nir_run_span(shader, machine, quads + first,
+                           MIN2(nr - first, SP_NIR_MAX_QUADS),
+                           early_depth_test, scratch) << first;
+   }
+
+   return live;
+}
+
+
+static void
+nir_delete(struct sp_fragment_shader_variant *var,
+           struct tgsi_exec_machine *machine)
+{
+   struct sp_nir_fragment_shader *shader =
+      (struct sp_nir_fragment_shader *) var;
+
+   shader->exec->delete(shader->exec, machine);
+   FREE(shader->insts);
+   FREE(shader);
+}
+
+
+/**
+ * Wrap the TGSI variant exec in one which runs nir instead.
+ * \return NULL if the shader uses anything the NIR interpreter doesn't
+ * handle, exec should be used as it is then
+ */
+struct sp_fragment_shader_variant *
+softpipe_create_fs_variant_nir(struct softpipe_context *softpipe,
+                               struct sp_fragment_shader_variant *exec,
+                               const struct nir_shader *nir)
+{
+   struct sp_nir_fragment_shader *shader;
+
+   shader = CALLOC_STRUCT(sp_nir_fragment_shader);
+   if (!shader)
+      return NULL;
+
+   /* Inherit the tokens, the info and the per-quad entrypoints */
+   shader->base = *exec;
+   shader->exec = exec;
+
+   if (!sp_nir_compile(shader, softpipe->pipe.screen, nir)) {
+      FREE(shader->insts);
+      FREE(shader);
+      return NULL;
+   }
+
+   shader->base.run_quads = nir_run_quads;
+   shader->base.quads_scratch_size =
+      shader->num_slots * sizeof(union sp_nir_chan);
+   shader->base.delete = nir_delete;
+
+   return &shader->base;
+}
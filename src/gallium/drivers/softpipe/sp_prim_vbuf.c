@@ -40,6 +40,7 @@
 #include "sp_setup.h"
 #include "sp_state.h"
 #include "sp_prim_vbuf.h"
+#include "sp_rast_threads.h"
 #include "draw/draw_context.h"
 #include "draw/draw_vbuf.h"
 #include "util/u_memory.h"
@@ -153,21 +154,36 @@ static inline cptrf4 get_vert( const void *vertex_buffer,
 }
 
 
+/**
+ * The primitives of one draw_elements() or draw_arrays() call.  Every
+ * rasterizer thread walks all of them with its own setup context.
+ */
+struct sp_vbuf_prims
+{
+   enum pipe_prim_type prim;
+   const void *vertex_buffer;
+   unsigned stride;
+   boolean flatshade_first;
+   const ushort *indices;  /**< NULL for draw_arrays() */
+   unsigned nr;
+};
+
+
 /**
  * draw elements / indexed primitives
  */
 static void
-sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
+setup_elements(struct setup_context *setup, const void *data)
 {
-   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
-   struct softpipe_context *softpipe = cvbr->softpipe;
-   const unsigned stride = softpipe->vertex_info.size * sizeof(float);
-   const void *vertex_buffer = cvbr->vertex_buffer;
-   struct setup_context *setup = cvbr->setup;
-   const boolean flatshade_first = softpipe->rasterizer->flatshade_first;
+   const struct sp_vbuf_prims *prims = data;
+   const unsigned stride = prims->stride;
+   const void *vertex_buffer = prims->vertex_buffer;
+   const ushort *indices = prims->indices;
+   const uint nr = prims->nr;
+   const boolean flatshade_first = prims->flatshade_first;
    unsigned i;
 
-   switch (cvbr->prim) {
+   switch (prims->prim) {
    case PIPE_PRIM_POINTS:
       for (i = 0; i < nr; i++) {
          sp_setup_point( setup,
@@ -353,18 +369,16 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
  * It's up to us to convert the vertex array into point/line/tri prims.
  */
 static void
-sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
+setup_arrays(struct setup_context *setup, const void *data)
 {
-   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
-   struct softpipe_context *softpipe = cvbr->softpipe;
-   struct setup_context *setup = cvbr->setup;
-   const unsigned stride = softpipe->vertex_info.size * sizeof(float);
-   const void *vertex_buffer =
-      (void *) get_vert(cvbr->vertex_buffer, start, stride);
-   const boolean flatshade_first = softpipe->rasterizer->flatshade_first;
+   const struct sp_vbuf_prims *prims = data;
+   const unsigned stride = prims->stride;
+   const void *vertex_buffer = prims->vertex_buffer;
+   const uint nr = prims->nr;
+   const boolean flatshade_first = prims->flatshade_first;
    unsigned i;
 
-   switch (cvbr->prim) {
+   switch (prims->prim) {
    case PIPE_PRIM_POINTS:
       for (i = 0; i < nr; i++) {
          sp_setup_point( setup,
@@ -587,6 +601,44 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    }
 }
 
+static void
+sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
+{
+   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
+   struct softpipe_context *softpipe = cvbr->softpipe;
+   struct sp_vbuf_prims prims;
+
+   prims.prim = cvbr->prim;
+   prims.vertex_buffer = cvbr->vertex_buffer;
+   prims.stride = softpipe->vertex_info.size * sizeof(float);
+   prims.flatshade_first = softpipe->rasterizer->flatshade_first;
+   prims.indices = indices;
+   prims.nr = nr;
+
+   sp_rast_threads_run(softpipe->rast_threads, cvbr->setup,
+                       setup_elements, &prims);
+}
+
+
+static void
+sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
+{
+   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
+   struct softpipe_context *softpipe = cvbr->softpipe;
+   struct sp_vbuf_prims prims;
+
+   prims.prim = cvbr->prim;
+   prims.stride = softpipe->vertex_info.size * sizeof(float);
+   prims.vertex_buffer = get_vert(cvbr->vertex_buffer, start, prims.stride);
+   prims.flatshade_first = softpipe->rasterizer->flatshade_first;
+   prims.indices = NULL;
+   prims.nr = nr;
+
+   sp_rast_threads_run(softpipe->rast_threads, cvbr->setup,
+                       setup_arrays, &prims);
+}
+
+
 /*
  * FIXME: it is unclear if primitives_storage_needed (which is generally
  * the same as pipe query num_primitives_generated) should increase
@@ -667,7 +719,14 @@ sp_create_vbuf_backend(struct softpipe_context *sp)
 
    cvbr->softpipe = sp;
 
-   cvbr->setup = sp_setup_create_context(cvbr->softpipe);
+   cvbr->setup = sp_setup_create_context(cvbr->softpipe, sp->num_quad_pipes);
+   if (!cvbr->setup) {
+      FREE(cvbr);
+      return NULL;
+   }
+
+   /* the other pipelines are added by the rasterizer threads as needed */
+   sp_setup_set_quad_pipe(cvbr->setup, 0, &sp->quad);
 
    return &cvbr->base;
 }
@@ -51,7 +51,9 @@ struct quad_shade_stage
 {
    struct quad_stage stage;  /**< base class */
 
-   /* no other fields at this time */
+   /** For fs variants which shade all the quads at once */
+   void *scratch;
+   unsigned scratch_size;
 };
 
 
@@ -63,11 +65,10 @@ static inline boolean
 shade_quad(struct quad_stage *qs, struct quad_header *quad)
 {
    struct softpipe_context *softpipe = qs->softpipe;
-   struct tgsi_exec_machine *machine = softpipe->fs_machine;
+   struct tgsi_exec_machine *machine = qs->qp->fs_machine;
 
    if (softpipe->active_statistics_queries) {
-      softpipe->pipeline_statistics.ps_invocations +=
-         util_bitcount(quad->inout.mask);         
+      *qs->qp->ps_invocations += util_bitcount(quad->inout.mask);
    }
 
    /* run shader */
@@ -96,6 +97,47 @@ coverage_quad(struct quad_stage *qs, struct quad_header *quad)
 }
 
 
+/**
+ * Make sure there's enough scratch memory for the fs variant's run_quads.
+ */
+static boolean
+grow_scratch(struct quad_shade_stage *qss, unsigned size)
+{
+   if (qss->scratch_size < size) {
+      align_free(qss->scratch);
+      qss->scratch = align_malloc(size, 16);
+      qss->scratch_size = qss->scratch ? size : 0;
+   }
+   return qss->scratch != NULL;
+}
+
+
+/**
+ * Execute the fragment shader for all the quads with one call.
+ * \return bitmask of the quads which are still alive
+ */
+static unsigned
+shade_quads_batched(struct quad_stage *qs,
+                    struct quad_header *quads[],
+                    unsigned nr)
+{
+   struct quad_shade_stage *qss = (struct quad_shade_stage *) qs;
+   struct softpipe_context *softpipe = qs->softpipe;
+   const struct sp_fragment_shader_variant *var = softpipe->fs_variant;
+   struct tgsi_exec_machine *machine = qs->qp->fs_machine;
+   unsigned i;
+
+   if (softpipe->active_statistics_queries) {
+      for (i = 0; i < nr; i++)
+         *qs->qp->ps_invocations += util_bitcount(quads[i]->inout.mask);
+   }
+
+   machine->flatshade_color = softpipe->rasterizer->flatshade ? TRUE : FALSE;
+   return var->run_quads(var, machine, quads, nr, softpipe->early_depth,
+                         qss->scratch);
+}
+
+
 /**
  * Shade/write an array of quads
  * Called via quad_stage::run()
@@ -106,8 +148,9 @@ shade_quads(struct quad_stage *qs,
             unsigned nr)
 {
    struct softpipe_context *softpipe = qs->softpipe;
-   struct tgsi_exec_machine *machine = softpipe->fs_machine;
+   struct tgsi_exec_machine *machine = qs->qp->fs_machine;
    unsigned i, nr_quads = 0;
+   unsigned live = 0;
 
    tgsi_exec_set_constant_buffers(machine, PIPE_MAX_CONSTANT_BUFFERS,
                          softpipe->mapped_constants[PIPE_SHADER_FRAGMENT],
@@ -115,6 +158,17 @@ shade_quads(struct quad_stage *qs,
 
    machine->InterpCoefs = quads[0]->coef;
 
+   if (softpipe->fs_variant->run_quads &&
+       grow_scratch((struct quad_shade_stage *) qs,
+                    softpipe->fs_variant->quads_scratch_size)) {
+      live = shade_quads_batched(qs, quads, nr);
+   } else {
+      for (i = 0; i < nr; i++) {
+         if (shade_quad(qs, quads[i]))
+            live |= 1u << i;
+      }
+   }
+
    for (i = 0; i < nr; i++) {
       /* Only omit this quad from the output list if all the fragments
        * are killed _AND_ it's not the first quad in the list.
@@ -125,7 +179,7 @@ shade_quads(struct quad_stage *qs,
        * Z values in each pass.  If interpolation starts with different quads
        * we can get different Z values for the same (x,y).
        */
-      if (!shade_quad(qs, quads[i]) && i > 0)
+      if (!(live & (1u << i)) && i > 0)
          continue; /* quad totally culled/killed */
 
       if (/*do_coverage*/ 0)
@@ -152,6 +206,9 @@ shade_begin(struct quad_stage *qs)
 static void
 shade_destroy(struct quad_stage *qs)
 {
+   struct quad_shade_stage *qss = (struct quad_shade_stage *) qs;
+
+   align_free(qss->scratch);
    FREE( qs );
 }
 
@@ -28,14 +28,94 @@
 
 #include "sp_context.h"
 #include "sp_state.h"
+#include "sp_tile_cache.h"
 #include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_exec.h"
+
+
+/**
+ * Create the stages, the fragment shader interpreter and the surface tile
+ * caches of a quad pipeline.  The counters are left for the caller to
+ * point somewhere.
+ */
+boolean
+sp_init_quad_pipe(struct softpipe_context *sp, struct sp_quad_pipe *qp)
+{
+   uint i;
+
+   /* The tile caches must exist before the stages are set up */
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      qp->cbuf_cache[i] = sp_create_tile_cache(&sp->pipe);
+      if (!qp->cbuf_cache[i])
+         return FALSE;
+   }
+   qp->zsbuf_cache = sp_create_tile_cache(&sp->pipe);
+   if (!qp->zsbuf_cache)
+      return FALSE;
+
+   qp->fs_machine = tgsi_exec_machine_create(PIPE_SHADER_FRAGMENT);
+   if (!qp->fs_machine)
+      return FALSE;
+
+   qp->shade = sp_quad_shade_stage(sp);
+   qp->depth_test = sp_quad_depth_test_stage(sp);
+   qp->blend = sp_quad_blend_stage(sp);
+   if (!qp->shade || !qp->depth_test || !qp->blend)
+      return FALSE;
+
+   qp->shade->qp = qp;
+   qp->depth_test->qp = qp;
+   qp->blend->qp = qp;
+
+   return TRUE;
+}
+
+
+void
+sp_destroy_quad_pipe(struct sp_quad_pipe *qp)
+{
+   uint i;
+
+   if (qp->shade)
+      qp->shade->destroy( qp->shade );
+
+   if (qp->depth_test)
+      qp->depth_test->destroy( qp->depth_test );
+
+   if (qp->blend)
+      qp->blend->destroy( qp->blend );
+
+   if (qp->fs_machine)
+      tgsi_exec_machine_destroy(qp->fs_machine);
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+      sp_destroy_tile_cache(qp->cbuf_cache[i]);
+
+   sp_destroy_tile_cache(qp->zsbuf_cache);
+}
 
 
 static void
-insert_stage_at_head(struct softpipe_context *sp, struct quad_stage *quad)
+insert_stage_at_head(struct sp_quad_pipe *qp, struct quad_stage *quad)
 {
-   quad->next = sp->quad.first;
-   sp->quad.first = quad;
+   quad->next = qp->first;
+   qp->first = quad;
+}
+
+
+void
+sp_link_quad_pipeline(struct sp_quad_pipe *qp, boolean early_depth_test)
+{
+   qp->first = qp->blend;
+
+   if (early_depth_test) {
+      insert_stage_at_head( qp, qp->shade );
+      insert_stage_at_head( qp, qp->depth_test );
+   }
+   else {
+      insert_stage_at_head( qp, qp->depth_test );
+      insert_stage_at_head( qp, qp->shade );
+   }
 }
 
 
@@ -51,16 +131,6 @@ sp_build_quad_pipeline(struct softpipe_context *sp)
        !sp->fs_variant->info.writes_stencil) ||
       sp->fs_variant->info.properties[TGSI_PROPERTY_FS_EARLY_DEPTH_STENCIL];
 
-   sp->quad.first = sp->quad.blend;
-
    sp->early_depth = early_depth_test;
-   if (early_depth_test) {
-      insert_stage_at_head( sp, sp->quad.shade );
-      insert_stage_at_head( sp, sp->quad.depth_test );
-   }
-   else {
-      insert_stage_at_head( sp, sp->quad.depth_test );
-      insert_stage_at_head( sp, sp->quad.shade );
-   }
+   sp_link_quad_pipeline(&sp->quad, early_depth_test);
 }
-
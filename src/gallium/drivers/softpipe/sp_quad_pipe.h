@@ -31,9 +31,15 @@
 #ifndef SP_QUAD_PIPE_H
 #define SP_QUAD_PIPE_H
 
+#include "pipe/p_compiler.h"
+#include "pipe/p_state.h"
+
 
 struct softpipe_context;
+struct softpipe_tile_cache;
+struct tgsi_exec_machine;
 struct quad_header;
+struct sp_quad_pipe;
 
 
 /**
@@ -43,6 +49,7 @@ struct quad_header;
  */
 struct quad_stage {
    struct softpipe_context *softpipe;
+   struct sp_quad_pipe *qp;  /**< the pipeline this stage belongs to */
 
    struct quad_stage *next;
 
@@ -66,6 +73,34 @@ struct quad_stage *sp_quad_blend_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_colormask_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_output_stage( struct softpipe_context *softpipe );
 
+
+/**
+ * One instance of the quad pipeline, along with the interpreter and the
+ * surface tile caches its stages work with.  The context has one for
+ * rendering on the calling thread and each rasterizer thread has another
+ * (see sp_rast_threads.c).
+ */
+struct sp_quad_pipe {
+   struct quad_stage *shade;
+   struct quad_stage *depth_test;
+   struct quad_stage *blend;
+   struct quad_stage *first; /**< points to one of the above stages */
+
+   struct tgsi_exec_machine *fs_machine;
+
+   struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
+   struct softpipe_tile_cache *zsbuf_cache;
+
+   /** Where the occlusion and fragment shader invocation counts go */
+   uint64_t *occlusion_count;
+   uint64_t *ps_invocations;
+};
+
+boolean sp_init_quad_pipe(struct softpipe_context *sp,
+                          struct sp_quad_pipe *qp);
+void sp_destroy_quad_pipe(struct sp_quad_pipe *qp);
+
+void sp_link_quad_pipeline(struct sp_quad_pipe *qp, boolean early_depth_test);
 void sp_build_quad_pipeline(struct softpipe_context *sp);
 
 #endif /* SP_QUAD_PIPE_H */
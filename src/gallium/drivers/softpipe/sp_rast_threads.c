@@ -0,0 +1,453 @@
+/**************************************************************************
+ *
+ * Copyright 2023 The Mesa Authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * Rasterizer worker threads, see sp_rast_threads.h.
+ */
+
+#include <stdio.h>
+
+#include "os/os_thread.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_thread.h"
+#include "tgsi/tgsi_exec.h"
+
+#include "sp_context.h"
+#include "sp_quad_pipe.h"
+#include "sp_rast_threads.h"
+#include "sp_setup.h"
+#include "sp_state.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_texture.h"
+#include "sp_tile_cache.h"
+
+
+DEBUG_GET_ONCE_NUM_OPTION(sp_num_threads, "SOFTPIPE_NUM_THREADS", 0)
+
+
+struct sp_rast_thread
+{
+   struct sp_rast_threads *rast;
+   unsigned index;   /**< the quad pipeline index, 0 is the context's */
+
+   thrd_t thread;
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+
+   struct sp_quad_pipe quad;
+   struct setup_context *setup;
+
+   /** Fragment shader texturing through this thread's own caches */
+   struct sp_tgsi_sampler *sampler;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+
+   /** The variant bound to quad.fs_machine */
+   const struct sp_fragment_shader_variant *fs_variant;
+
+   uint64_t occlusion_count;
+   uint64_t ps_invocations;
+};
+
+
+struct sp_rast_threads
+{
+   struct softpipe_context *softpipe;
+
+   /** The draw the threads are working on */
+   sp_rast_func func;
+   const void *data;
+   unsigned fpstate;
+
+   boolean exit;
+
+   unsigned num_workers;
+   struct sp_rast_thread worker[SP_MAX_THREADS - 1];
+};
+
+
+static int
+rast_thread_func(void *arg)
+{
+   struct sp_rast_thread *t = (struct sp_rast_thread *) arg;
+   struct sp_rast_threads *rast = t->rast;
+   char name[16];
+
+   snprintf(name, sizeof(name), "softpipe-%u", t->index);
+   u_thread_setname(name);
+
+   while (1) {
+      pipe_semaphore_wait(&t->work_ready);
+
+      if (rast->exit)
+         break;
+
+      /* shade with the rounding/denormal modes of the context's thread */
+      if (util_fpstate_get() != rast->fpstate)
+         util_fpstate_set(rast->fpstate);
+
+      sp_setup_begin(t->setup);
+      rast->func(t->setup, rast->data);
+
+      pipe_semaphore_signal(&t->work_done);
+   }
+
+   return 0;
+}
+
+
+/**
+ * Point the fragment shader sampler of a thread at the currently bound
+ * samplers and views, and its fragment shader machine at the current
+ * variant.
+ * \return FALSE if the thread has to share the context's texture caches
+ *         as it couldn't get its own, so that it can't run concurrently.
+ */
+static boolean
+prepare_thread(struct sp_rast_thread *t)
+{
+   struct softpipe_context *sp = t->rast->softpipe;
+   const struct sp_tgsi_sampler *fs_sampler =
+      sp->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   boolean own_caches = TRUE;
+   unsigned i;
+
+   memcpy(t->sampler->sp_sampler, fs_sampler->sp_sampler,
+          sizeof(t->sampler->sp_sampler));
+
+   for (i = 0; i < sp->num_sampler_views[PIPE_SHADER_FRAGMENT]; i++) {
+      struct pipe_sampler_view *view =
+         sp->sampler_views[PIPE_SHADER_FRAGMENT][i];
+      struct softpipe_tex_tile_cache *tc = t->tex_cache[i];
+
+      t->sampler->sp_sview[i] = fs_sampler->sp_sview[i];
+
+      if (!view)
+         continue;
+
+      if (!tc) {
+         tc = t->tex_cache[i] = sp_create_tex_tile_cache(&sp->pipe);
+         if (!tc) {
+            own_caches = FALSE;
+            continue;
+         }
+      }
+
+      sp_tex_tile_cache_set_sampler_view(tc, view);
+      if (tc->texture) {
+         struct softpipe_resource *spt = softpipe_resource(tc->texture);
+         if (spt->timestamp != tc->timestamp) {
+            sp_tex_tile_cache_validate_texture(tc);
+            tc->timestamp = spt->timestamp;
+         }
+      }
+
+      t->sampler->sp_sview[i].cache = tc;
+   }
+
+   if (t->fs_variant != sp->fs_variant) {
+      sp->fs_variant->prepare(sp->fs_variant, t->quad.fs_machine,
+                              (struct tgsi_sampler *) t->sampler,
+                              (struct tgsi_image *)
+                                 sp->tgsi.image[PIPE_SHADER_FRAGMENT],
+                              (struct tgsi_buffer *)
+                                 sp->tgsi.buffer[PIPE_SHADER_FRAGMENT]);
+      t->fs_variant = sp->fs_variant;
+   }
+
+   sp_link_quad_pipeline(&t->quad, sp->early_depth);
+
+   return own_caches;
+}
+
+
+/**
+ * Rasterize a draw.  The worker threads go through the primitives along
+ * with the calling thread, unless the fragment shader writes memory: those
+ * writes have to happen in primitive order over the whole framebuffer, so
+ * then the calling thread feeds all the quad pipelines itself.
+ */
+void
+sp_rast_threads_run(struct sp_rast_threads *rast,
+                    struct setup_context *setup,
+                    sp_rast_func func, const void *data)
+{
+   struct softpipe_context *sp;
+   boolean concurrent;
+   unsigned i;
+
+   /* nothing can get shaded without a fragment shader */
+   if (!rast || !rast->softpipe->fs_variant) {
+      func(setup, data);
+      return;
+   }
+
+   sp = rast->softpipe;
+   concurrent = !sp->fs_variant->info.writes_memory;
+
+   for (i = 0; i < rast->num_workers; i++) {
+      if (!prepare_thread(&rast->worker[i]))
+         concurrent = FALSE;
+   }
+
+   if (concurrent) {
+      rast->func = func;
+      rast->data = data;
+      rast->fpstate = util_fpstate_get();
+
+      for (i = 0; i < rast->num_workers; i++)
+         pipe_semaphore_signal(&rast->worker[i].work_ready);
+
+      func(setup, data);
+
+      for (i = 0; i < rast->num_workers; i++)
+         pipe_semaphore_wait(&rast->worker[i].work_done);
+   }
+   else {
+      for (i = 0; i < rast->num_workers; i++) {
+         struct sp_rast_thread *t = &rast->worker[i];
+         sp_setup_set_quad_pipe(setup, t->index, &t->quad);
+      }
+      sp_setup_begin(setup);
+
+      func(setup, data);
+
+      for (i = 0; i < rast->num_workers; i++)
+         sp_setup_set_quad_pipe(setup, rast->worker[i].index, NULL);
+   }
+
+   for (i = 0; i < rast->num_workers; i++) {
+      struct sp_rast_thread *t = &rast->worker[i];
+
+      sp->occlusion_count += t->occlusion_count;
+      sp->pipeline_statistics.ps_invocations += t->ps_invocations;
+      t->occlusion_count = 0;
+      t->ps_invocations = 0;
+   }
+}
+
+
+/**
+ * Drop the texture tiles cached by the threads.
+ */
+void
+sp_rast_threads_flush_textures(struct sp_rast_threads *rast)
+{
+   unsigned i, j;
+
+   if (!rast)
+      return;
+
+   for (i = 0; i < rast->num_workers; i++) {
+      struct sp_rast_thread *t = &rast->worker[i];
+
+      for (j = 0; j < ARRAY_SIZE(t->tex_cache); j++) {
+         if (t->tex_cache[j])
+            sp_flush_tex_tile_cache(t->tex_cache[j]);
+      }
+   }
+}
+
+
+/**
+ * Called before a fragment shader variant gets deleted.
+ */
+void
+sp_rast_threads_unbind_fs_variant(struct sp_rast_threads *rast,
+                                  const struct sp_fragment_shader_variant *var)
+{
+   unsigned i;
+
+   if (!rast)
+      return;
+
+   for (i = 0; i < rast->num_workers; i++) {
+      struct sp_rast_thread *t = &rast->worker[i];
+
+      if (t->fs_variant == var) {
+         tgsi_exec_machine_bind_shader(t->quad.fs_machine,
+                                       NULL, NULL, NULL, NULL);
+         t->fs_variant = NULL;
+      }
+   }
+}
+
+
+static void
+destroy_thread_state(struct sp_rast_thread *t)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(t->tex_cache); i++)
+      sp_destroy_tex_tile_cache(t->tex_cache[i]);
+
+   FREE(t->sampler);
+
+   if (t->setup)
+      sp_setup_destroy_context(t->setup);
+
+   sp_destroy_quad_pipe(&t->quad);
+}
+
+
+static boolean
+init_thread(struct sp_rast_threads *rast, struct sp_rast_thread *t,
+            unsigned index, unsigned num_threads)
+{
+   struct softpipe_context *sp = rast->softpipe;
+
+   t->rast = rast;
+   t->index = index;
+
+   if (!sp_init_quad_pipe(sp, &t->quad))
+      goto fail;
+   t->quad.occlusion_count = &t->occlusion_count;
+   t->quad.ps_invocations = &t->ps_invocations;
+
+   t->sampler = sp_create_tgsi_sampler();
+   t->setup = sp_setup_create_context(sp, num_threads);
+   if (!t->sampler || !t->setup)
+      goto fail;
+   sp_setup_set_quad_pipe(t->setup, index, &t->quad);
+
+   pipe_semaphore_init(&t->work_ready, 0);
+   pipe_semaphore_init(&t->work_done, 0);
+   if (thrd_success != u_thread_create(&t->thread, rast_thread_func, t)) {
+      pipe_semaphore_destroy(&t->work_ready);
+      pipe_semaphore_destroy(&t->work_done);
+      goto fail;
+   }
+
+   return TRUE;
+
+fail:
+   destroy_thread_state(t);
+   return FALSE;
+}
+
+
+/**
+ * Restrict the surface tile caches of a quad pipeline to its share of the
+ * screen tiles, see tile_pipe() in sp_setup.c.
+ */
+static void
+set_tile_cache_share(struct sp_quad_pipe *qp, unsigned index,
+                     unsigned num_pipes)
+{
+   uint64_t mask = 0;
+   unsigned pos, i;
+
+   for (pos = index; pos < NUM_ENTRIES; pos += num_pipes)
+      mask |= BITFIELD64_BIT(pos);
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+      sp_tile_cache_set_entry_mask(qp->cbuf_cache[i], mask);
+   sp_tile_cache_set_entry_mask(qp->zsbuf_cache, mask);
+}
+
+
+/**
+ * Create the rasterizer threads requested with SOFTPIPE_NUM_THREADS and
+ * add their quad pipelines to the context.
+ * \return NULL when rendering on the calling thread only.
+ */
+struct sp_rast_threads *
+sp_rast_threads_create(struct softpipe_context *softpipe)
+{
+   unsigned num_threads = MIN2(debug_get_option_sp_num_threads(),
+                               SP_MAX_THREADS);
+   struct sp_rast_threads *rast;
+   unsigned i;
+
+   assert(softpipe->num_quad_pipes == 1);
+
+   if (num_threads <= 1)
+      return NULL;
+
+   rast = CALLOC_STRUCT(sp_rast_threads);
+   if (!rast)
+      return NULL;
+
+   rast->softpipe = softpipe;
+
+   for (i = 1; i < num_threads; i++) {
+      if (!init_thread(rast, &rast->worker[rast->num_workers], i,
+                       num_threads)) {
+         sp_rast_threads_destroy(rast);
+         return NULL;
+      }
+      rast->num_workers++;
+   }
+
+   softpipe->quad_pipe[0] = &softpipe->quad;
+   for (i = 0; i < rast->num_workers; i++)
+      softpipe->quad_pipe[i + 1] = &rast->worker[i].quad;
+   softpipe->num_quad_pipes = num_threads;
+
+   for (i = 0; i < num_threads; i++)
+      set_tile_cache_share(softpipe->quad_pipe[i], i, num_threads);
+
+   return rast;
+}
+
+
+void
+sp_rast_threads_destroy(struct sp_rast_threads *rast)
+{
+   struct softpipe_context *sp;
+   unsigned i;
+
+   if (!rast)
+      return;
+
+   sp = rast->softpipe;
+
+   /* wake the threads up to notice the exit flag */
+   rast->exit = TRUE;
+   for (i = 0; i < rast->num_workers; i++)
+      pipe_semaphore_signal(&rast->worker[i].work_ready);
+
+   for (i = 0; i < rast->num_workers; i++) {
+      struct sp_rast_thread *t = &rast->worker[i];
+
+      thrd_join(t->thread, NULL);
+      pipe_semaphore_destroy(&t->work_ready);
+      pipe_semaphore_destroy(&t->work_done);
+      destroy_thread_state(t);
+   }
+
+   /* back to the context's own pipeline, with all of the screen */
+   if (sp->num_quad_pipes > 1) {
+      set_tile_cache_share(&sp->quad, 0, 1);
+      sp->num_quad_pipes = 1;
+   }
+
+   FREE(rast);
+}
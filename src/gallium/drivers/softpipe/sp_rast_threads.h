@@ -0,0 +1,68 @@
+/**************************************************************************
+ *
+ * Copyright 2023 The Mesa Authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Rasterization on worker threads.
+ *
+ * The screen tiles are split between the context's quad pipeline and one
+ * quad pipeline per worker thread by their tile cache entry position, see
+ * tile_pipe() in sp_setup.c.  Every thread runs primitive setup for the
+ * whole draw but only emits the quads of its own tiles.  As each cache
+ * entry is used by a single pipeline, tiles get loaded and written back
+ * just like they would with one pipeline and the results are identical.
+ */
+
+#ifndef SP_RAST_THREADS_H
+#define SP_RAST_THREADS_H
+
+struct setup_context;
+struct softpipe_context;
+struct sp_fragment_shader_variant;
+struct sp_rast_threads;
+
+/** Feeds the primitives of a draw to a setup context */
+typedef void (*sp_rast_func)(struct setup_context *setup, const void *data);
+
+struct sp_rast_threads *
+sp_rast_threads_create(struct softpipe_context *softpipe);
+
+void
+sp_rast_threads_destroy(struct sp_rast_threads *rast);
+
+void
+sp_rast_threads_run(struct sp_rast_threads *rast,
+                    struct setup_context *setup,
+                    sp_rast_func func, const void *data);
+
+void
+sp_rast_threads_flush_textures(struct sp_rast_threads *rast);
+
+void
+sp_rast_threads_unbind_fs_variant(struct sp_rast_threads *rast,
+                                  const struct sp_fragment_shader_variant *var);
+
+#endif /* SP_RAST_THREADS_H */
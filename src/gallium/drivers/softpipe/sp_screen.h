@@ -47,6 +47,7 @@ struct softpipe_screen {
     */
    unsigned timestamp;
    boolean use_llvm;
+   boolean use_nir_exec;
 };
 
 static inline struct softpipe_screen *
@@ -65,6 +66,7 @@ enum sp_debug_flag {
    SP_DBG_USE_LLVM        = BITFIELD_BIT(6),
    SP_DBG_NO_RAST         = BITFIELD_BIT(7),
    SP_DBG_USE_TGSI        = BITFIELD_BIT(8),
+   SP_DBG_NIR_EXEC        = BITFIELD_BIT(9),
 };
 
 extern int sp_debug;
@@ -38,6 +38,7 @@
 #include "sp_quad_pipe.h"
 #include "sp_setup.h"
 #include "sp_state.h"
+#include "sp_tile_cache.h"
 #include "draw/draw_context.h"
 #include "pipe/p_shader_tokens.h"
 #include "util/u_math.h"
@@ -75,6 +76,14 @@ struct edge {
 struct setup_context {
    struct softpipe_context *softpipe;
 
+   /**
+    * Where the quads go.  The screen tiles are split between num_pipes quad
+    * pipelines by their tile cache position, quads for a NULL pipeline are
+    * dropped as another thread's setup context takes care of them.
+    */
+   struct sp_quad_pipe *qp[SP_MAX_THREADS];
+   unsigned num_pipes;
+
    /* Vertices are just an array of floats making up each attribute in
     * turn.  Currently fixed at 4 floats, but should change in time.
     * Codegen will help cope with this.
@@ -122,6 +131,23 @@ struct setup_context {
 
 
 
+/**
+ * Return the quad pipeline for the screen tile containing pixel (x, y).
+ * Tiles are assigned by their position in the tile caches so that each
+ * cache entry is only ever used by one pipeline, which keeps the tile
+ * write-backs, and hence the results, the same as with a single pipeline.
+ */
+static inline struct sp_quad_pipe *
+tile_pipe(const struct setup_context *setup, int x, int y, unsigned layer)
+{
+   if (setup->num_pipes == 1)
+      return setup->qp[0];
+
+   return setup->qp[tile_cache_pos(tile_address(x, y, layer)) %
+                    setup->num_pipes];
+}
+
+
 /**
  * Clip setup->quad against the scissor/surface bounds.
  */
@@ -160,16 +186,22 @@ quad_clip(struct setup_context *setup, struct quad_header *quad)
 static inline void
 clip_emit_quad(struct setup_context *setup, struct quad_header *quad)
 {
+   struct sp_quad_pipe *qp = tile_pipe(setup, quad->input.x0, quad->input.y0,
+                                       quad->input.layer);
+
+   if (!qp)
+      return;
+
    quad_clip(setup, quad);
 
    if (quad->inout.mask) {
-      struct softpipe_context *sp = setup->softpipe;
+      struct quad_stage *pipe = qp->first;
 
 #if DEBUG_FRAGS
       setup->numFragsEmitted += util_bitcount(quad->inout.mask);
 #endif
 
-      sp->quad.first->run( sp->quad.first, &quad, 1 );
+      pipe->run( pipe, &quad, 1 );
    }
 }
 
@@ -204,12 +236,16 @@ flush_spans(struct setup_context *setup)
    const int xleft1 = setup->span.left[1];
    const int xright0 = setup->span.right[0];
    const int xright1 = setup->span.right[1];
-   struct quad_stage *pipe = setup->softpipe->quad.first;
 
    const int minleft = block_x(MIN2(xleft0, xleft1));
    const int maxright = MAX2(xright0, xright1);
    int x;
 
+   /* The chunks never straddle a screen tile, so splitting the tiles
+    * between quad pipelines leaves the quad lists we emit unchanged.
+    */
+   STATIC_ASSERT(TILE_SIZE % MAX_QUADS == 0);
+
    /* process quads in horizontal chunks of 16 */
    for (x = minleft; x < maxright; x += step) {
       unsigned skip_left0 = CLAMP(xleft0 - x, 0, step);
@@ -230,6 +266,12 @@ flush_spans(struct setup_context *setup)
       unsigned mask0 = ~skipmask_left0 & ~skipmask_right0;
       unsigned mask1 = ~skipmask_left1 & ~skipmask_right1;
 
+      struct sp_quad_pipe *qp = tile_pipe(setup, x, setup->span.y,
+                                          setup->quad[0].input.layer);
+
+      if (!qp)
+         continue;
+
       if (mask0 | mask1) {
          do {
             unsigned quadmask = (mask0 & 3) | ((mask1 & 3) << 2);
@@ -249,7 +291,7 @@ flush_spans(struct setup_context *setup)
             lx += 2;
          } while (mask0 | mask1);
 
-         pipe->run( pipe, setup->quad_ptrs, q );
+         qp->first->run( qp->first, setup->quad_ptrs, q );
       }
    }
 
@@ -814,7 +856,8 @@ sp_setup_tri(struct setup_context *setup,
 
    flush_spans( setup );
 
-   if (setup->softpipe->active_statistics_queries) {
+   /* counted once, by the setup context feeding the context's own pipeline */
+   if (setup->softpipe->active_statistics_queries && setup->qp[0]) {
       setup->softpipe->pipeline_statistics.c_primitives++;
    }
 
@@ -1365,12 +1408,26 @@ void
 sp_setup_prepare(struct setup_context *setup)
 {
    struct softpipe_context *sp = setup->softpipe;
-   int i;
-   unsigned max_layer = ~0;
+
    if (sp->dirty) {
       softpipe_update_derived(sp, sp->reduced_api_prim);
    }
 
+   sp_setup_begin(setup);
+}
+
+
+/**
+ * Latch the current, already validated, state into the setup context and
+ * begin its quad pipelines.
+ */
+void
+sp_setup_begin(struct setup_context *setup)
+{
+   struct softpipe_context *sp = setup->softpipe;
+   int i;
+   unsigned p, max_layer = ~0;
+
    /* Note: nr_attrs is only used for debugging (vertex printing) */
    setup->nr_vertex_attrs = draw_num_shader_outputs(sp->draw);
 
@@ -1401,7 +1458,11 @@ sp_setup_prepare(struct setup_context *setup)
 
    setup->max_layer = max_layer;
 
-   sp->quad.first->begin( sp->quad.first );
+   for (p = 0; p < setup->num_pipes; p++) {
+      struct sp_quad_pipe *qp = setup->qp[p];
+      if (qp)
+         qp->first->begin( qp->first );
+   }
 
    if (sp->reduced_api_prim == PIPE_PRIM_TRIANGLES &&
        sp->rasterizer->fill_front == PIPE_POLYGON_MODE_FILL &&
@@ -1424,15 +1485,36 @@ sp_setup_destroy_context(struct setup_context *setup)
 
 
 /**
- * Create a new primitive setup/render stage.
+ * Set the quad pipeline for the screen tiles of the given index, or NULL
+ * to drop them.  The pipeline gets begun in sp_setup_begin().
+ */
+void
+sp_setup_set_quad_pipe(struct setup_context *setup, unsigned index,
+                       struct sp_quad_pipe *qp)
+{
+   assert(index < setup->num_pipes);
+   setup->qp[index] = qp;
+}
+
+
+/**
+ * Create a new primitive setup/render stage, splitting the screen tiles
+ * between num_pipes quad pipelines.
  */
 struct setup_context *
-sp_setup_create_context(struct softpipe_context *softpipe)
+sp_setup_create_context(struct softpipe_context *softpipe,
+                        unsigned num_pipes)
 {
    struct setup_context *setup = CALLOC_STRUCT(setup_context);
    unsigned i;
 
+   assert(num_pipes >= 1 && num_pipes <= SP_MAX_THREADS);
+
+   if (!setup)
+      return NULL;
+
    setup->softpipe = softpipe;
+   setup->num_pipes = num_pipes;
 
    for (i = 0; i < MAX_QUADS; i++) {
       setup->quad[i].coef = setup->coef;
@@ -29,6 +29,7 @@
 
 struct setup_context;
 struct softpipe_context;
+struct sp_quad_pipe;
 
 /**
  * Attribute interpolation mode
@@ -70,8 +71,12 @@ sp_clamp_viewport_idx(int idx)
    return (PIPE_MAX_VIEWPORTS > idx && idx >= 0) ? idx : 0;
 }
 
-struct setup_context *sp_setup_create_context( struct softpipe_context *softpipe );
+struct setup_context *sp_setup_create_context( struct softpipe_context *softpipe,
+                                              unsigned num_pipes );
+void sp_setup_set_quad_pipe( struct setup_context *setup, unsigned index,
+                             struct sp_quad_pipe *qp );
 void sp_setup_prepare( struct setup_context *setup );
+void sp_setup_begin( struct setup_context *setup );
 void sp_setup_destroy_context( struct setup_context *setup );
 
 #endif
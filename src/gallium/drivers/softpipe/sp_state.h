@@ -91,6 +91,19 @@ struct sp_fragment_shader_variant
 		   struct quad_header *quad,
 		   bool early_depth_test);
 
+   /**
+    * Optional: shade nr quads at once.  Returns a bitmask of the quads
+    * with fragments left alive, and needs quads_scratch_size bytes of
+    * 16-byte aligned scratch memory.
+    */
+   unsigned (*run_quads)(const struct sp_fragment_shader_variant *shader,
+                         struct tgsi_exec_machine *machine,
+                         struct quad_header *quads[],
+                         unsigned nr,
+                         bool early_depth_test,
+                         void *scratch);
+   unsigned quads_scratch_size;
+
    /* Deletes this instance of the object */
    void (*delete)(struct sp_fragment_shader_variant *shader,
                   struct tgsi_exec_machine *machine);
@@ -104,6 +117,7 @@ struct sp_fragment_shader {
    struct pipe_shader_state shader;
    struct sp_fragment_shader_variant *variants;
    struct draw_fragment_shader *draw_shader;
+   struct nir_shader *nir;      /**< kept for SOFTPIPE_DEBUG=nir_exec */
 };
 
 
@@ -343,7 +343,7 @@ update_fragment_shader(struct softpipe_context *softpipe, unsigned prim)
 
       /* prepare the TGSI interpreter for FS execution */
       softpipe->fs_variant->prepare(softpipe->fs_variant, 
-                                    softpipe->fs_machine,
+                                    softpipe->quad.fs_machine,
                                     (struct tgsi_sampler *) softpipe->
                                     tgsi.sampler[PIPE_SHADER_FRAGMENT],
                                     (struct tgsi_image *)softpipe->tgsi.image[PIPE_SHADER_FRAGMENT],
@@ -29,6 +29,7 @@
 #include "sp_screen.h"
 #include "sp_state.h"
 #include "sp_fs.h"
+#include "sp_rast_threads.h"
 #include "sp_texture.h"
 
 #include "nir.h"
@@ -68,6 +69,13 @@ create_fs_variant(struct softpipe_context *softpipe,
 
       tgsi_scan_shader(var->tokens, &var->info);
 
+      if (fs->nir) {
+         struct sp_fragment_shader_variant *nir_var =
+            softpipe_create_fs_variant_nir(softpipe, var, fs->nir);
+         if (nir_var)
+            var = nir_var;
+      }
+
       /* See comments elsewhere about draw fragment shaders */
 #if 0
       /* draw's fs state */
@@ -154,6 +162,11 @@ softpipe_create_fs_state(struct pipe_context *pipe,
    struct softpipe_context *softpipe = softpipe_context(pipe);
    struct sp_fragment_shader *state = CALLOC_STRUCT(sp_fragment_shader);
 
+   /* nir_to_tgsi() consumes the NIR, keep a copy to execute */
+   if (templ->type == PIPE_SHADER_IR_NIR &&
+       softpipe_screen(pipe->screen)->use_nir_exec)
+      state->nir = nir_shader_clone(NULL, templ->ir.nir);
+
    softpipe_create_shader_state(pipe, &state->shader, templ,
                                 sp_debug & SP_DBG_FS);
 
@@ -162,6 +175,7 @@ softpipe_create_fs_state(struct pipe_context *pipe,
                                                     &state->shader);
    if (!state->draw_shader) {
       tgsi_free_tokens(state->shader.tokens);
+      ralloc_free(state->nir);
       FREE(state);
       return NULL;
    }
@@ -218,12 +232,14 @@ softpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
       draw_delete_fragment_shader(softpipe->draw, var->draw_shader);
 #endif
 
-      var->delete(var, softpipe->fs_machine);
+      sp_rast_threads_unbind_fs_variant(softpipe->rast_threads, var);
+      var->delete(var, softpipe->quad.fs_machine);
    }
 
    draw_delete_fragment_shader(softpipe->draw, state->draw_shader);
 
    tgsi_free_tokens(state->shader.tokens);
+   ralloc_free(state->nir);
    FREE(state);
 }
 
@@ -49,7 +49,7 @@ softpipe_set_framebuffer_state(struct pipe_context *pipe,
                                const struct pipe_framebuffer_state *fb)
 {
    struct softpipe_context *sp = softpipe_context(pipe);
-   uint i;
+   uint i, p;
 
    draw_flush(sp->draw);
 
@@ -59,13 +59,15 @@ softpipe_set_framebuffer_state(struct pipe_context *pipe,
       /* check if changing cbuf */
       if (sp->framebuffer.cbufs[i] != cb) {
          /* flush old */
-         sp_flush_tile_cache(sp->cbuf_cache[i]);
+         for (p = 0; p < sp->num_quad_pipes; p++)
+            sp_flush_tile_cache(sp->quad_pipe[p]->cbuf_cache[i]);
 
          /* assign new */
          pipe_surface_reference(&sp->framebuffer.cbufs[i], cb);
 
          /* update cache */
-         sp_tile_cache_set_surface(sp->cbuf_cache[i], cb);
+         for (p = 0; p < sp->num_quad_pipes; p++)
+            sp_tile_cache_set_surface(sp->quad_pipe[p]->cbuf_cache[i], cb);
       }
    }
 
@@ -74,13 +76,15 @@ softpipe_set_framebuffer_state(struct pipe_context *pipe,
    /* zbuf changing? */
    if (sp->framebuffer.zsbuf != fb->zsbuf) {
       /* flush old */
-      sp_flush_tile_cache(sp->zsbuf_cache);
+      for (p = 0; p < sp->num_quad_pipes; p++)
+         sp_flush_tile_cache(sp->quad_pipe[p]->zsbuf_cache);
 
       /* assign new */
       pipe_surface_reference(&sp->framebuffer.zsbuf, fb->zsbuf);
 
       /* update cache */
-      sp_tile_cache_set_surface(sp->zsbuf_cache, fb->zsbuf);
+      for (p = 0; p < sp->num_quad_pipes; p++)
+         sp_tile_cache_set_surface(sp->quad_pipe[p]->zsbuf_cache, fb->zsbuf);
 
       /* Tell draw module how deep the Z/depth buffer is
        *
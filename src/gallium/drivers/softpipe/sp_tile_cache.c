@@ -42,16 +42,6 @@ static struct softpipe_cached_tile *
 sp_alloc_tile(struct softpipe_tile_cache *tc);
 
 
-/**
- * Return the position in the cache for the tile that contains win pos (x,y).
- * We currently use a direct mapped cache so this is like a hack key.
- * At some point we should investigate something more sophisticated, like
- * a LRU replacement policy.
- */
-#define CACHE_POS(x, y, l)                        \
-   (((x) + (y) * 5 + (l) * 10) % NUM_ENTRIES)
-
-
 static inline int addr_to_clear_pos(union tile_address addr)
 {
    int pos;
@@ -99,11 +89,15 @@ sp_create_tile_cache( struct pipe_context *pipe )
 
    STATIC_ASSERT(sizeof(union tile_address) == 4);
 
+   /* entry_mask has a bit per entry */
+   STATIC_ASSERT(NUM_ENTRIES <= 64);
+
    STATIC_ASSERT((TILE_SIZE << TILE_ADDR_BITS) >= MAX_WIDTH);
 
    tc = CALLOC_STRUCT( softpipe_tile_cache );
    if (tc) {
       tc->pipe = pipe;
+      tc->entry_mask = BITFIELD64_MASK(NUM_ENTRIES);
       for (pos = 0; pos < ARRAY_SIZE(tc->tile_addrs); pos++) {
          tc->tile_addrs[pos].bits.invalid = 1;
       }
@@ -218,6 +212,19 @@ sp_tile_cache_set_surface(struct softpipe_tile_cache *tc,
 }
 
 
+/**
+ * Restrict the cache to the tiles at the given entry positions.  The other
+ * tiles are handled by the caches of other quad pipelines, so they are
+ * neither fetched nor cleared here.
+ */
+void
+sp_tile_cache_set_entry_mask(struct softpipe_tile_cache *tc, uint64_t mask)
+{
+   assert(mask & BITFIELD64_MASK(NUM_ENTRIES));
+   tc->entry_mask = mask;
+}
+
+
 /**
  * Return the transfer being cached.
  */
@@ -359,6 +366,9 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc, int layer)
       for (x = 0; x < w; x += TILE_SIZE) {
          union tile_address addr = tile_address(x, y, layer);
 
+         if (!(tc->entry_mask & BITFIELD64_BIT(tile_cache_pos(addr))))
+            continue;
+
          if (is_clear_flag_set(tc->clear_flags, addr, tc->clear_flags_size)) {
             /* write the scratch tile to the surface */
             if (tc->depth_stencil) {
@@ -488,10 +498,11 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
 {
    struct pipe_transfer *pt;
    /* cache pos/entry: */
-   const int pos = CACHE_POS(addr.bits.x,
-                             addr.bits.y, addr.bits.layer);
+   const int pos = tile_cache_pos(addr);
    struct softpipe_cached_tile *tile = tc->entries[pos];
    int layer;
+
+   assert(tc->entry_mask & BITFIELD64_BIT(pos));
    if (!tile) {
       tile = sp_alloc_tile(tc);
       tc->entries[pos] = tile;
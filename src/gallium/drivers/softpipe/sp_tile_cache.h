@@ -78,6 +78,15 @@ struct softpipe_cached_tile
 
 #define NUM_ENTRIES 50
 
+/**
+ * Return the position in the cache for the tile that contains win pos (x,y).
+ * We currently use a direct mapped cache so this is like a hack key.
+ * At some point we should investigate something more sophisticated, like
+ * a LRU replacement policy.
+ */
+#define CACHE_POS(x, y, l)                        \
+   (((x) + (y) * 5 + (l) * 10) % NUM_ENTRIES)
+
 
 struct softpipe_tile_cache
 {
@@ -94,6 +103,7 @@ struct softpipe_tile_cache
    union pipe_color_union clear_color; /**< for color bufs */
    uint64_t clear_val;        /**< for z+stencil */
    boolean depth_stencil; /**< Is the surface a depth/stencil format? */
+   uint64_t entry_mask;   /**< entry positions this cache holds tiles for */
 
    struct softpipe_cached_tile *tile;  /**< scratch tile for clears */
 
@@ -112,6 +122,9 @@ extern void
 sp_tile_cache_set_surface(struct softpipe_tile_cache *tc,
                           struct pipe_surface *sps);
 
+extern void
+sp_tile_cache_set_entry_mask(struct softpipe_tile_cache *tc, uint64_t mask);
+
 extern struct pipe_surface *
 sp_tile_cache_get_surface(struct softpipe_tile_cache *tc);
 
@@ -141,6 +154,12 @@ tile_address( unsigned x,
    return addr;
 }
 
+static inline unsigned
+tile_cache_pos(union tile_address addr)
+{
+   return CACHE_POS(addr.bits.x, addr.bits.y, addr.bits.layer);
+}
+
 /* Quickly retrieve tile if it matches last lookup.
  */
 static inline struct softpipe_cached_tile *
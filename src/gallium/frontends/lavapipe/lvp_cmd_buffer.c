@@ -28,10 +28,14 @@
 #include "vk_common_entrypoints.h"
 
 static void
-lvp_cmd_buffer_destroy(struct vk_command_buffer *cmd_buffer)
+lvp_cmd_buffer_destroy(struct vk_command_buffer *vk_cmd_buffer)
 {
-   vk_command_buffer_finish(cmd_buffer);
-   vk_free(&cmd_buffer->pool->alloc, cmd_buffer);
+   struct lvp_cmd_buffer *cmd_buffer =
+      container_of(vk_cmd_buffer, struct lvp_cmd_buffer, vk);
+
+   vk_cmd_queue_finish(&cmd_buffer->pruned_cmds);
+   vk_command_buffer_finish(vk_cmd_buffer);
+   vk_free(&vk_cmd_buffer->pool->alloc, cmd_buffer);
 }
 
 static VkResult
@@ -55,6 +59,7 @@ lvp_create_cmd_buffer(struct vk_command_pool *pool,
    }
 
    cmd_buffer->device = device;
+   vk_cmd_queue_init(&cmd_buffer->pruned_cmds, &pool->alloc);
 
    cmd_buffer->status = LVP_CMD_BUFFER_STATUS_INITIAL;
    *cmd_buffer_out = &cmd_buffer->vk;
@@ -70,6 +75,7 @@ lvp_reset_cmd_buffer(struct vk_command_buffer *vk_cmd_buffer,
       container_of(vk_cmd_buffer, struct lvp_cmd_buffer, vk);
 
    vk_command_buffer_reset(&cmd_buffer->vk);
+   vk_cmd_queue_reset(&cmd_buffer->pruned_cmds);
 
    cmd_buffer->status = LVP_CMD_BUFFER_STATUS_INITIAL;
 }
@@ -97,6 +103,9 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_EndCommandBuffer(
    LVP_FROM_HANDLE(lvp_cmd_buffer, cmd_buffer, commandBuffer);
    VkResult result = vk_command_buffer_get_record_result(&cmd_buffer->vk);
 
+   if (result == VK_SUCCESS)
+      lvp_cmd_queue_prune(&cmd_buffer->vk.cmd_queue, &cmd_buffer->pruned_cmds);
+
    cmd_buffer->status = result == VK_SUCCESS ?
       LVP_CMD_BUFFER_STATUS_EXECUTABLE :
       LVP_CMD_BUFFER_STATUS_INVALID;
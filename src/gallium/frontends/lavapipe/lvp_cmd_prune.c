@@ -0,0 +1,268 @@
+/*
+ * Copyright © 2023 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "lvp_private.h"
+
+/* State commands whose effect only depends on their own arguments, as long
+ * as no other kind of state command runs in between.  Everything else
+ * (pipeline binds, other dynamic state, render passes, copies, ...) ends
+ * the window in which these can be compared.
+ */
+enum lvp_prune_slot {
+   LVP_PRUNE_VIEWPORT,
+   LVP_PRUNE_SCISSOR,
+   LVP_PRUNE_LINE_WIDTH,
+   LVP_PRUNE_DEPTH_BIAS,
+   LVP_PRUNE_BLEND_CONSTANTS,
+   LVP_PRUNE_STENCIL_REFERENCE,
+   LVP_PRUNE_DESCRIPTOR_SETS,
+   LVP_PRUNE_INDEX_BUFFER,
+   LVP_PRUNE_VERTEX_BUFFERS,
+   LVP_PRUNE_PUSH_CONSTANTS,
+   LVP_PRUNE_NUM_SLOTS,
+   LVP_PRUNE_NONE = LVP_PRUNE_NUM_SLOTS,
+};
+
+static enum lvp_prune_slot
+prune_slot(const struct vk_cmd_queue_entry *cmd)
+{
+   switch (cmd->type) {
+   case VK_CMD_SET_VIEWPORT:
+   case VK_CMD_SET_VIEWPORT_WITH_COUNT:
+      return LVP_PRUNE_VIEWPORT;
+   case VK_CMD_SET_SCISSOR:
+   case VK_CMD_SET_SCISSOR_WITH_COUNT:
+      return LVP_PRUNE_SCISSOR;
+   case VK_CMD_SET_LINE_WIDTH:
+      return LVP_PRUNE_LINE_WIDTH;
+   case VK_CMD_SET_DEPTH_BIAS:
+      return LVP_PRUNE_DEPTH_BIAS;
+   case VK_CMD_SET_BLEND_CONSTANTS:
+      return LVP_PRUNE_BLEND_CONSTANTS;
+   case VK_CMD_SET_STENCIL_REFERENCE:
+      return LVP_PRUNE_STENCIL_REFERENCE;
+   case VK_CMD_BIND_DESCRIPTOR_SETS:
+      return LVP_PRUNE_DESCRIPTOR_SETS;
+   case VK_CMD_BIND_INDEX_BUFFER:
+      return LVP_PRUNE_INDEX_BUFFER;
+   case VK_CMD_BIND_VERTEX_BUFFERS2:
+      return LVP_PRUNE_VERTEX_BUFFERS;
+   case VK_CMD_PUSH_CONSTANTS:
+      return LVP_PRUNE_PUSH_CONSTANTS;
+   default:
+      return LVP_PRUNE_NONE;
+   }
+}
+
+/* commands that consume the current state without changing it */
+static bool
+is_draw_or_dispatch(const struct vk_cmd_queue_entry *cmd)
+{
+   switch (cmd->type) {
+   case VK_CMD_DRAW:
+   case VK_CMD_DRAW_INDEXED:
+   case VK_CMD_DRAW_MULTI_EXT:
+   case VK_CMD_DRAW_MULTI_INDEXED_EXT:
+   case VK_CMD_DRAW_INDIRECT:
+   case VK_CMD_DRAW_INDEXED_INDIRECT:
+   case VK_CMD_DRAW_INDIRECT_COUNT:
+   case VK_CMD_DRAW_INDEXED_INDIRECT_COUNT:
+   case VK_CMD_DRAW_INDIRECT_BYTE_COUNT_EXT:
+   case VK_CMD_DISPATCH:
+   case VK_CMD_DISPATCH_BASE:
+   case VK_CMD_DISPATCH_INDIRECT:
+      return true;
+   default:
+      return false;
+   }
+}
+
+static bool
+vertex_buffers_equal(const struct vk_cmd_bind_vertex_buffers2 *a,
+                     const struct vk_cmd_bind_vertex_buffers2 *b)
+{
+   unsigned n = a->binding_count;
+
+   if (a->first_binding != b->first_binding || n != b->binding_count ||
+       !a->strides != !b->strides || !a->sizes != !b->sizes)
+      return false;
+   if (memcmp(a->buffers, b->buffers, n * sizeof(*a->buffers)) ||
+       memcmp(a->offsets, b->offsets, n * sizeof(*a->offsets)))
+      return false;
+   if (a->strides && memcmp(a->strides, b->strides, n * sizeof(*a->strides)))
+      return false;
+   if (a->sizes && memcmp(a->sizes, b->sizes, n * sizeof(*a->sizes)))
+      return false;
+   return true;
+}
+
+/* Whether executing b right after a leaves the rendering state unchanged. */
+static bool
+prune_cmds_equal(const struct vk_cmd_queue_entry *a,
+                 const struct vk_cmd_queue_entry *b)
+{
+   if (a->type != b->type)
+      return false;
+
+   switch (a->type) {
+   case VK_CMD_SET_VIEWPORT:
+      return a->u.set_viewport.first_viewport == b->u.set_viewport.first_viewport &&
+             a->u.set_viewport.viewport_count == b->u.set_viewport.viewport_count &&
+             !memcmp(a->u.set_viewport.viewports, b->u.set_viewport.viewports,
+                     a->u.set_viewport.viewport_count * sizeof(VkViewport));
+   case VK_CMD_SET_VIEWPORT_WITH_COUNT:
+      return a->u.set_viewport_with_count.viewport_count == b->u.set_viewport_with_count.viewport_count &&
+             !memcmp(a->u.set_viewport_with_count.viewports, b->u.set_viewport_with_count.viewports,
+                     a->u.set_viewport_with_count.viewport_count * sizeof(VkViewport));
+   case VK_CMD_SET_SCISSOR:
+      return a->u.set_scissor.first_scissor == b->u.set_scissor.first_scissor &&
+             a->u.set_scissor.scissor_count == b->u.set_scissor.scissor_count &&
+             !memcmp(a->u.set_scissor.scissors, b->u.set_scissor.scissors,
+                     a->u.set_scissor.scissor_count * sizeof(VkRect2D));
+   case VK_CMD_SET_SCISSOR_WITH_COUNT:
+      return a->u.set_scissor_with_count.scissor_count == b->u.set_scissor_with_count.scissor_count &&
+             !memcmp(a->u.set_scissor_with_count.scissors, b->u.set_scissor_with_count.scissors,
+                     a->u.set_scissor_with_count.scissor_count * sizeof(VkRect2D));
+   case VK_CMD_SET_LINE_WIDTH:
+      return !memcmp(&a->u.set_line_width, &b->u.set_line_width,
+                     sizeof(a->u.set_line_width));
+   case VK_CMD_SET_DEPTH_BIAS:
+      return !memcmp(&a->u.set_depth_bias, &b->u.set_depth_bias,
+                     sizeof(a->u.set_depth_bias));
+   case VK_CMD_SET_BLEND_CONSTANTS:
+      return !memcmp(&a->u.set_blend_constants, &b->u.set_blend_constants,
+                     sizeof(a->u.set_blend_constants));
+   case VK_CMD_SET_STENCIL_REFERENCE:
+      return a->u.set_stencil_reference.face_mask == b->u.set_stencil_reference.face_mask &&
+             a->u.set_stencil_reference.reference == b->u.set_stencil_reference.reference;
+   case VK_CMD_BIND_DESCRIPTOR_SETS: {
+      const struct vk_cmd_bind_descriptor_sets *da = &a->u.bind_descriptor_sets;
+      const struct vk_cmd_bind_descriptor_sets *db = &b->u.bind_descriptor_sets;
+      return da->pipeline_bind_point == db->pipeline_bind_point &&
+             da->layout == db->layout &&
+             da->first_set == db->first_set &&
+             da->descriptor_set_count == db->descriptor_set_count &&
+             da->dynamic_offset_count == db->dynamic_offset_count &&
+             !memcmp(da->descriptor_sets, db->descriptor_sets,
+                     da->descriptor_set_count * sizeof(VkDescriptorSet)) &&
+             (!da->dynamic_offset_count ||
+              !memcmp(da->dynamic_offsets, db->dynamic_offsets,
+                      da->dynamic_offset_count * sizeof(uint32_t)));
+   }
+   case VK_CMD_BIND_INDEX_BUFFER:
+      return a->u.bind_index_buffer.buffer == b->u.bind_index_buffer.buffer &&
+             a->u.bind_index_buffer.offset == b->u.bind_index_buffer.offset &&
+             a->u.bind_index_buffer.index_type == b->u.bind_index_buffer.index_type;
+   case VK_CMD_BIND_VERTEX_BUFFERS2:
+      return vertex_buffers_equal(&a->u.bind_vertex_buffers2,
+                                  &b->u.bind_vertex_buffers2);
+   case VK_CMD_PUSH_CONSTANTS:
+      return a->u.push_constants.stage_flags == b->u.push_constants.stage_flags &&
+             a->u.push_constants.offset == b->u.push_constants.offset &&
+             a->u.push_constants.size == b->u.push_constants.size &&
+             !memcmp(a->u.push_constants.values, b->u.push_constants.values,
+                     a->u.push_constants.size);
+   default:
+      return false;
+   }
+}
+
+/* Whether b completely replaces the state written by a, so that a can be
+ * dropped when nothing consumed the state in between.
+ */
+static bool
+prune_cmd_overrides(const struct vk_cmd_queue_entry *a,
+                    const struct vk_cmd_queue_entry *b)
+{
+   if (a->type != b->type)
+      return false;
+
+   switch (a->type) {
+   case VK_CMD_SET_VIEWPORT:
+      return a->u.set_viewport.first_viewport == b->u.set_viewport.first_viewport &&
+             a->u.set_viewport.viewport_count == b->u.set_viewport.viewport_count;
+   case VK_CMD_SET_VIEWPORT_WITH_COUNT:
+      return a->u.set_viewport_with_count.viewport_count <= b->u.set_viewport_with_count.viewport_count;
+   case VK_CMD_SET_SCISSOR:
+      return a->u.set_scissor.first_scissor == b->u.set_scissor.first_scissor &&
+             a->u.set_scissor.scissor_count == b->u.set_scissor.scissor_count;
+   case VK_CMD_SET_SCISSOR_WITH_COUNT:
+      return a->u.set_scissor_with_count.scissor_count <= b->u.set_scissor_with_count.scissor_count;
+   case VK_CMD_SET_LINE_WIDTH:
+   case VK_CMD_SET_DEPTH_BIAS:
+   case VK_CMD_SET_BLEND_CONSTANTS:
+   case VK_CMD_BIND_INDEX_BUFFER:
+      return true;
+   case VK_CMD_SET_STENCIL_REFERENCE:
+      return (a->u.set_stencil_reference.face_mask &
+              ~b->u.set_stencil_reference.face_mask) == 0;
+   case VK_CMD_PUSH_CONSTANTS:
+      return a->u.push_constants.stage_flags == b->u.push_constants.stage_flags &&
+             a->u.push_constants.offset == b->u.push_constants.offset &&
+             a->u.push_constants.size == b->u.push_constants.size;
+   default:
+      /* descriptor sets and vertex buffers can leave bindings of the earlier
+       * command live, keep those
+       */
+      return false;
+   }
+}
+
+/* Pre-validate the recorded stream on the recording thread: state commands
+ * that re-set what is already bound, or that get overwritten before any
+ * draw or dispatch reads them, are moved to the pruned queue so queue
+ * submission neither replays them nor re-emits the state they would dirty.
+ */
+void
+lvp_cmd_queue_prune(struct vk_cmd_queue *queue, struct vk_cmd_queue *pruned)
+{
+   struct vk_cmd_queue_entry *last[LVP_PRUNE_NUM_SLOTS] = {0};
+   bool consumed[LVP_PRUNE_NUM_SLOTS] = {0};
+
+   list_for_each_entry_safe(struct vk_cmd_queue_entry, cmd,
+                            &queue->cmds, cmd_link) {
+      enum lvp_prune_slot slot = prune_slot(cmd);
+
+      if (slot == LVP_PRUNE_NONE) {
+         if (is_draw_or_dispatch(cmd)) {
+            memset(consumed, true, sizeof(consumed));
+         } else {
+            memset(last, 0, sizeof(last));
+         }
+         continue;
+      }
+
+      struct vk_cmd_queue_entry *prev = last[slot];
+      if (prev && prune_cmds_equal(prev, cmd)) {
+         list_del(&cmd->cmd_link);
+         list_addtail(&cmd->cmd_link, &pruned->cmds);
+         continue;
+      }
+      if (prev && !consumed[slot] && prune_cmd_overrides(prev, cmd)) {
+         list_del(&prev->cmd_link);
+         list_addtail(&prev->cmd_link, &pruned->cmds);
+      }
+      last[slot] = cmd;
+      consumed[slot] = false;
+   }
+}
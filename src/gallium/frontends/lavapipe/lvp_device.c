@@ -243,6 +243,12 @@ lvp_physical_device_init(struct lvp_physical_device *device,
    for (unsigned i = 0; i < ARRAY_SIZE(device->drv_options); i++)
       device->drv_options[i] = device->pscreen->get_compiler_options(device->pscreen, PIPE_SHADER_IR_NIR, i);
 
+   /* Share llvmpipe's disk cache so lowered shaders are kept across runs
+    * next to the compiled code.
+    */
+   if (device->pscreen->get_disk_shader_cache)
+      device->vk.disk_cache = device->pscreen->get_disk_shader_cache(device->pscreen);
+
    device->sync_timeline_type = vk_sync_timeline_get_type(&lvp_pipe_sync_type);
    device->sync_types[0] = &lvp_pipe_sync_type;
    device->sync_types[1] = &device->sync_timeline_type.sync;
@@ -1598,6 +1604,7 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateDevice(
 
    device->queue.state = device + 1;
    device->poison_mem = debug_get_bool_option("LVP_POISON_MEMORY", false);
+   device->inline_stats = debug_get_bool_option("LVP_INLINE_STATS", false);
 
    struct vk_device_dispatch_table dispatch_table;
    vk_device_dispatch_table_from_entrypoints(&dispatch_table,
@@ -1631,6 +1638,25 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateDevice(
       return result;
    }
 
+   /* Shaders specialized on uniform values get built on a background thread
+    * while the generic shader is used.
+    */
+   if (debug_get_bool_option("LVP_ASYNC_INLINE", false))
+      util_queue_init(&device->inline_queue, "lvpinl", 64, 1,
+                      UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                      UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY, NULL);
+
+   struct vk_pipeline_cache_create_info cache_info = { 0 };
+   device->pipeline_cache = vk_pipeline_cache_create(&device->vk, &cache_info, NULL);
+   if (!device->pipeline_cache) {
+      if (util_queue_is_initialized(&device->inline_queue))
+         util_queue_destroy(&device->inline_queue);
+      lvp_queue_finish(&device->queue);
+      vk_device_finish(&device->vk);
+      vk_free(&device->vk.alloc, device);
+      return vk_error(instance, VK_ERROR_OUT_OF_HOST_MEMORY);
+   }
+
    *pDevice = lvp_device_to_handle(device);
 
    return VK_SUCCESS;
@@ -1645,7 +1671,10 @@ VKAPI_ATTR void VKAPI_CALL lvp_DestroyDevice(
 
    if (device->queue.last_fence)
       device->pscreen->fence_reference(device->pscreen, &device->queue.last_fence, NULL);
+   vk_pipeline_cache_destroy(device->pipeline_cache, NULL);
    lvp_queue_finish(&device->queue);
+   if (util_queue_is_initialized(&device->inline_queue))
+      util_queue_destroy(&device->inline_queue);
    vk_device_finish(&device->vk);
    vk_free(&device->vk.alloc, device);
 }
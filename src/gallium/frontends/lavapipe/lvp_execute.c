@@ -85,6 +85,8 @@ struct rendering_state {
    bool pcbuf_dirty[PIPE_SHADER_TYPES];
    bool has_pcbuf[PIPE_SHADER_TYPES];
    bool inlines_dirty[PIPE_SHADER_TYPES];
+   /* inlined-uniform variants still being built, generic shaders bound meanwhile */
+   struct lvp_inline_variant *inlines_pending[PIPE_SHADER_TYPES];
    bool vp_dirty;
    bool scissor_dirty;
    bool ib_dirty;
@@ -272,95 +274,97 @@ update_pcbuf(struct rendering_state *state, enum pipe_shader_type pstage)
 }
 
 static void
-update_inline_shader_state(struct rendering_state *state, enum pipe_shader_type sh, bool pcbuf_dirty, bool constbuf_dirty)
+bind_inline_shader_state(struct rendering_state *state, enum pipe_shader_type sh, void *shader_state)
+{
+   switch (sh) {
+   case PIPE_SHADER_VERTEX:
+      state->pctx->bind_vs_state(state->pctx, shader_state);
+      break;
+   case PIPE_SHADER_TESS_CTRL:
+      state->pctx->bind_tcs_state(state->pctx, shader_state);
+      break;
+   case PIPE_SHADER_TESS_EVAL:
+      state->pctx->bind_tes_state(state->pctx, shader_state);
+      break;
+   case PIPE_SHADER_GEOMETRY:
+      state->pctx->bind_gs_state(state->pctx, shader_state);
+      break;
+   case PIPE_SHADER_FRAGMENT:
+      state->pctx->bind_fs_state(state->pctx, shader_state);
+      break;
+   case PIPE_SHADER_COMPUTE:
+      state->pctx->bind_compute_state(state->pctx, shader_state);
+      break;
+   default: break;
+   }
+}
+
+/* swap in a variant built in the background once it is ready */
+static void
+update_inline_pending(struct rendering_state *state, enum pipe_shader_type sh)
+{
+   struct lvp_inline_variant *variant = state->inlines_pending[sh];
+   if (!util_queue_fence_is_signalled(&variant->ready))
+      return;
+   state->inlines_pending[sh] = NULL;
+   bind_inline_shader_state(state, sh, lvp_inline_variant_shader_state(variant));
+}
+
+static void
+update_inline_shader_state(struct rendering_state *state, enum pipe_shader_type sh)
 {
    bool is_compute = sh == PIPE_SHADER_COMPUTE;
-   uint32_t inline_uniforms[MAX_INLINABLE_UNIFORMS];
+   uint32_t inline_uniforms[PIPE_MAX_CONSTANT_BUFFERS][MAX_INLINABLE_UNIFORMS] = {0};
    unsigned stage = tgsi_processor_to_shader_stage(sh);
    state->inlines_dirty[sh] = false;
+   state->inlines_pending[sh] = NULL;
    if (!state->pipeline[is_compute]->inlines[stage].can_inline)
       return;
    struct lvp_pipeline *pipeline = state->pipeline[is_compute];
    /* these buffers have already been flushed in llvmpipe, so they're safe to read */
-   nir_shader *base_nir = pipeline->pipeline_nir[stage];
-   if (stage == PIPE_SHADER_TESS_EVAL && state->tess_ccw)
-      base_nir = pipeline->tess_ccw;
-   nir_shader *nir = nir_shader_clone(pipeline->pipeline_nir[stage], base_nir);
-   nir_function_impl *impl = nir_shader_get_entrypoint(nir);
-   unsigned ssa_alloc = impl->ssa_alloc;
-   unsigned count = pipeline->inlines[stage].count[0];
-   if (count && pcbuf_dirty) {
-      unsigned push_size = get_pcbuf_size(state, sh);
-      for (unsigned i = 0; i < count; i++) {
-         unsigned offset = pipeline->inlines[stage].uniform_offsets[0][i];
-         if (offset < push_size) {
-            memcpy(&inline_uniforms[i], &state->push_constants[offset], sizeof(uint32_t));
-         } else {
-            for (unsigned i = 0; i < state->uniform_blocks[sh].count; i++) {
-               if (offset < push_size + state->uniform_blocks[sh].size[i]) {
-                  unsigned ubo_offset = offset - push_size;
-                  uint8_t *block = state->uniform_blocks[sh].block[i];
-                  memcpy(&inline_uniforms[i], &block[ubo_offset], sizeof(uint32_t));
-                  break;
+   u_foreach_bit(slot, pipeline->inlines[stage].can_inline) {
+      unsigned count = pipeline->inlines[stage].count[slot];
+      if (slot == 0) {
+         unsigned push_size = get_pcbuf_size(state, sh);
+         for (unsigned i = 0; i < count; i++) {
+            unsigned offset = pipeline->inlines[stage].uniform_offsets[0][i];
+            if (offset < push_size) {
+               memcpy(&inline_uniforms[0][i], &state->push_constants[offset], sizeof(uint32_t));
+            } else {
+               unsigned block_start = push_size;
+               for (unsigned j = 0; j < state->uniform_blocks[sh].count; j++) {
+                  if (offset < block_start + state->uniform_blocks[sh].size[j]) {
+                     uint8_t *block = state->uniform_blocks[sh].block[j];
+                     memcpy(&inline_uniforms[0][i], &block[offset - block_start], sizeof(uint32_t));
+                     break;
+                  }
+                  block_start += state->uniform_blocks[sh].size[j];
                }
-               push_size += state->uniform_blocks[sh].size[i];
             }
          }
-      }
-      NIR_PASS_V(nir, lvp_inline_uniforms, pipeline, inline_uniforms, 0);
-   }
-   if (constbuf_dirty) {
-      struct pipe_box box = {0};
-      u_foreach_bit(slot, pipeline->inlines[stage].can_inline) {
-         unsigned count = pipeline->inlines[stage].count[slot];
+      } else {
+         struct pipe_box box = {0};
          struct pipe_constant_buffer *cbuf = &state->const_buffer[sh][slot - 1];
          struct pipe_resource *pres = cbuf->buffer;
+         if (!pres)
+            continue;
          box.x = cbuf->buffer_offset;
          box.width = cbuf->buffer_size - cbuf->buffer_offset;
          struct pipe_transfer *xfer;
          uint8_t *map = state->pctx->buffer_map(state->pctx, pres, 0, PIPE_MAP_READ, &box, &xfer);
          for (unsigned i = 0; i < count; i++) {
             unsigned offset = pipeline->inlines[stage].uniform_offsets[slot][i];
-            memcpy(&inline_uniforms[i], map + offset, sizeof(uint32_t));
+            memcpy(&inline_uniforms[slot][i], map + offset, sizeof(uint32_t));
          }
          state->pctx->buffer_unmap(state->pctx, xfer);
-         NIR_PASS_V(nir, lvp_inline_uniforms, pipeline, inline_uniforms, slot);
       }
    }
-   lvp_shader_optimize(nir);
-   impl = nir_shader_get_entrypoint(nir);
-   void *shader_state;
-   if (ssa_alloc - impl->ssa_alloc < ssa_alloc / 2 &&
-       !pipeline->inlines[stage].must_inline) {
-      /* not enough change; don't inline further */
-      pipeline->inlines[stage].can_inline = 0;
-      ralloc_free(nir);
-      pipeline->shader_cso[sh] = lvp_pipeline_compile(pipeline, nir_shader_clone(NULL, pipeline->pipeline_nir[stage]));
-      shader_state = pipeline->shader_cso[sh];
-   } else {
-      shader_state = lvp_pipeline_compile(pipeline, nir);
-   }
-   switch (sh) {
-   case PIPE_SHADER_VERTEX:
-      state->pctx->bind_vs_state(state->pctx, shader_state);
-      break;
-   case PIPE_SHADER_TESS_CTRL:
-      state->pctx->bind_tcs_state(state->pctx, shader_state);
-      break;
-   case PIPE_SHADER_TESS_EVAL:
-      state->pctx->bind_tes_state(state->pctx, shader_state);
-      break;
-   case PIPE_SHADER_GEOMETRY:
-      state->pctx->bind_gs_state(state->pctx, shader_state);
-      break;
-   case PIPE_SHADER_FRAGMENT:
-      state->pctx->bind_fs_state(state->pctx, shader_state);
-      break;
-   case PIPE_SHADER_COMPUTE:
-      state->pctx->bind_compute_state(state->pctx, shader_state);
-      break;
-   default: break;
-   }
+
+   bool tess_ccw = stage == MESA_SHADER_TESS_EVAL && state->tess_ccw;
+   void *shader_state = lvp_pipeline_inline_variant(pipeline, stage, tess_ccw,
+                                                    inline_uniforms,
+                                                    &state->inlines_pending[sh]);
+   bind_inline_shader_state(state, sh, shader_state);
 }
 
 static void emit_compute_state(struct rendering_state *state)
@@ -372,11 +376,9 @@ static void emit_compute_state(struct rendering_state *state)
       state->iv_dirty[PIPE_SHADER_COMPUTE] = false;
    }
 
-   bool pcbuf_dirty = state->pcbuf_dirty[PIPE_SHADER_COMPUTE];
    if (state->pcbuf_dirty[PIPE_SHADER_COMPUTE])
       update_pcbuf(state, PIPE_SHADER_COMPUTE);
 
-   bool constbuf_dirty = state->constbuf_dirty[PIPE_SHADER_COMPUTE];
    if (state->constbuf_dirty[PIPE_SHADER_COMPUTE]) {
       for (unsigned i = 0; i < state->num_const_bufs[PIPE_SHADER_COMPUTE]; i++)
          state->pctx->set_constant_buffer(state->pctx, PIPE_SHADER_COMPUTE,
@@ -385,7 +387,9 @@ static void emit_compute_state(struct rendering_state *state)
    }
 
    if (state->inlines_dirty[PIPE_SHADER_COMPUTE])
-      update_inline_shader_state(state, PIPE_SHADER_COMPUTE, pcbuf_dirty, constbuf_dirty);
+      update_inline_shader_state(state, PIPE_SHADER_COMPUTE);
+   else if (state->inlines_pending[PIPE_SHADER_COMPUTE])
+      update_inline_pending(state, PIPE_SHADER_COMPUTE);
 
    if (state->sb_dirty[PIPE_SHADER_COMPUTE]) {
       state->pctx->set_shader_buffers(state->pctx, PIPE_SHADER_COMPUTE,
@@ -487,10 +491,7 @@ static void emit_state(struct rendering_state *state)
       state->ve_dirty = false;
    }
 
-   bool constbuf_dirty[PIPE_SHADER_TYPES] = {false};
-   bool pcbuf_dirty[PIPE_SHADER_TYPES] = {false};
    for (sh = 0; sh < PIPE_SHADER_COMPUTE; sh++) {
-      constbuf_dirty[sh] = state->constbuf_dirty[sh];
       if (state->constbuf_dirty[sh]) {
          for (unsigned idx = 0; idx < state->num_const_bufs[sh]; idx++)
             state->pctx->set_constant_buffer(state->pctx, sh,
@@ -500,14 +501,15 @@ static void emit_state(struct rendering_state *state)
    }
 
    for (sh = 0; sh < PIPE_SHADER_COMPUTE; sh++) {
-      pcbuf_dirty[sh] = state->pcbuf_dirty[sh];
       if (state->pcbuf_dirty[sh])
          update_pcbuf(state, sh);
    }
 
    for (sh = 0; sh < PIPE_SHADER_COMPUTE; sh++) {
       if (state->inlines_dirty[sh])
-         update_inline_shader_state(state, sh, pcbuf_dirty[sh], constbuf_dirty[sh]);
+         update_inline_shader_state(state, sh);
+      else if (state->inlines_pending[sh])
+         update_inline_pending(state, sh);
    }
 
    for (sh = 0; sh < PIPE_SHADER_COMPUTE; sh++) {
@@ -576,6 +578,7 @@ static void handle_compute_pipeline(struct vk_cmd_queue_entry *cmd,
    state->dispatch_info.block[1] = pipeline->pipeline_nir[MESA_SHADER_COMPUTE]->info.workgroup_size[1];
    state->dispatch_info.block[2] = pipeline->pipeline_nir[MESA_SHADER_COMPUTE]->info.workgroup_size[2];
    state->inlines_dirty[PIPE_SHADER_COMPUTE] = pipeline->inlines[MESA_SHADER_COMPUTE].can_inline;
+   state->inlines_pending[PIPE_SHADER_COMPUTE] = NULL;
    if (!pipeline->inlines[MESA_SHADER_COMPUTE].can_inline)
       state->pctx->bind_compute_state(state->pctx, pipeline->shader_cso[PIPE_SHADER_COMPUTE]);
 }
@@ -648,6 +651,7 @@ static void handle_graphics_pipeline(struct vk_cmd_queue_entry *cmd,
       state->sb_dirty[sh] |= state->num_shader_buffers[sh] && state->access[sh].buffers_written != pipeline->access[sh].buffers_written;
    }
    memcpy(state->access, pipeline->access, sizeof(struct lvp_access_info) * 5); //4 vertex stages + fragment
+   memset(state->inlines_pending, 0, sizeof(state->inlines_pending[0]) * PIPE_SHADER_COMPUTE);
 
    for (enum pipe_shader_type sh = PIPE_SHADER_VERTEX; sh < PIPE_SHADER_COMPUTE; sh++)
       state->has_pcbuf[sh] = false;
@@ -3731,6 +3735,8 @@ static void handle_set_tessellation_domain_origin(struct vk_cmd_queue_entry *cmd
    state->tess_ccw = tess_ccw;
    if (state->tess_states[state->tess_ccw])
       state->pctx->bind_tes_state(state->pctx, state->tess_states[state->tess_ccw]);
+   else if (state->pipeline[0] && state->pipeline[0]->inlines[MESA_SHADER_TESS_EVAL].can_inline)
+      state->inlines_dirty[PIPE_SHADER_TESS_EVAL] = true;
 }
 
 static void handle_set_depth_clamp_enable(struct vk_cmd_queue_entry *cmd,
@@ -26,6 +26,7 @@
 #include "vk_render_pass.h"
 #include "vk_util.h"
 #include "glsl_types.h"
+#include "util/mesa-sha1.h"
 #include "util/os_time.h"
 #include "spirv/nir_spirv.h"
 #include "nir/nir_builder.h"
@@ -46,21 +47,65 @@
       dst = temp;                                                \
    } while(0)
 
+static void
+delete_shader_state(struct pipe_context *ctx, enum pipe_shader_type sh, void *cso)
+{
+   switch (sh) {
+   case PIPE_SHADER_VERTEX:
+      ctx->delete_vs_state(ctx, cso);
+      break;
+   case PIPE_SHADER_FRAGMENT:
+      ctx->delete_fs_state(ctx, cso);
+      break;
+   case PIPE_SHADER_GEOMETRY:
+      ctx->delete_gs_state(ctx, cso);
+      break;
+   case PIPE_SHADER_TESS_CTRL:
+      ctx->delete_tcs_state(ctx, cso);
+      break;
+   case PIPE_SHADER_TESS_EVAL:
+      ctx->delete_tes_state(ctx, cso);
+      break;
+   case PIPE_SHADER_COMPUTE:
+      ctx->delete_compute_state(ctx, cso);
+      break;
+   default:
+      unreachable("illegal shader");
+   }
+}
+
+static void
+inline_variant_destroy(struct lvp_device *device, struct lvp_inline_variant *variant)
+{
+   /* the variant may still be getting built */
+   util_queue_fence_wait(&variant->ready);
+   util_queue_fence_destroy(&variant->ready);
+   if (variant->cso)
+      delete_shader_state(device->queue.ctx,
+                          pipe_shader_type_from_mesa(variant->stage),
+                          variant->cso);
+   ralloc_free(variant);
+}
+
 void
 lvp_pipeline_destroy(struct lvp_device *device, struct lvp_pipeline *pipeline)
 {
-   if (pipeline->shader_cso[PIPE_SHADER_VERTEX])
-      device->queue.ctx->delete_vs_state(device->queue.ctx, pipeline->shader_cso[PIPE_SHADER_VERTEX]);
-   if (pipeline->shader_cso[PIPE_SHADER_FRAGMENT])
-      device->queue.ctx->delete_fs_state(device->queue.ctx, pipeline->shader_cso[PIPE_SHADER_FRAGMENT]);
-   if (pipeline->shader_cso[PIPE_SHADER_GEOMETRY])
-      device->queue.ctx->delete_gs_state(device->queue.ctx, pipeline->shader_cso[PIPE_SHADER_GEOMETRY]);
-   if (pipeline->shader_cso[PIPE_SHADER_TESS_CTRL])
-      device->queue.ctx->delete_tcs_state(device->queue.ctx, pipeline->shader_cso[PIPE_SHADER_TESS_CTRL]);
-   if (pipeline->shader_cso[PIPE_SHADER_TESS_EVAL])
-      device->queue.ctx->delete_tes_state(device->queue.ctx, pipeline->shader_cso[PIPE_SHADER_TESS_EVAL]);
-   if (pipeline->shader_cso[PIPE_SHADER_COMPUTE])
-      device->queue.ctx->delete_compute_state(device->queue.ctx, pipeline->shader_cso[PIPE_SHADER_COMPUTE]);
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      struct lvp_inline_cache *cache = &pipeline->inline_cache[i];
+      if (device->inline_stats && cache->hits + cache->misses)
+         fprintf(stderr, "lavapipe: pipeline %p %s: %u inlined-uniform variants, %u hits, %u misses\n",
+                 (void *)pipeline, _mesa_shader_stage_to_abbrev(i),
+                 cache->num_variants, cache->hits, cache->misses);
+      for (unsigned j = 0; j < cache->num_variants; j++)
+         inline_variant_destroy(device, cache->variants[j]);
+   }
+
+   for (unsigned sh = 0; sh < PIPE_SHADER_TYPES; sh++) {
+      if (pipeline->shader_cso[sh])
+         delete_shader_state(device->queue.ctx, sh, pipeline->shader_cso[sh]);
+   }
+   if (pipeline->tess_ccw_cso)
+      delete_shader_state(device->queue.ctx, PIPE_SHADER_TESS_EVAL, pipeline->tess_ccw_cso);
 
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++)
       ralloc_free(pipeline->pipeline_nir[i]);
@@ -359,14 +404,23 @@ lvp_shader_optimize(nir_shader *nir)
 
 static VkResult
 lvp_shader_compile_to_ir(struct lvp_pipeline *pipeline,
+                         struct vk_pipeline_cache *cache,
                          const VkPipelineShaderStageCreateInfo *sinfo)
 {
    struct lvp_device *pdevice = pipeline->device;
    gl_shader_stage stage = vk_to_mesa_shader_stage(sinfo->stage);
    assert(stage <= MESA_SHADER_COMPUTE && stage != MESA_SHADER_NONE);
+   unsigned char sha1[SHA1_DIGEST_LENGTH];
    VkResult result;
    nir_shader *nir;
 
+   lvp_pipeline_hash_shader_stage(pipeline, sinfo, sha1);
+   nir = lvp_pipeline_cache_lookup_shader(cache, pipeline, stage, sha1);
+   if (nir) {
+      pipeline->pipeline_nir[stage] = nir;
+      return VK_SUCCESS;
+   }
+
    const struct spirv_to_nir_options spirv_options = {
       .environment = NIR_SPIRV_VULKAN,
       .caps = {
@@ -511,6 +565,8 @@ lvp_shader_compile_to_ir(struct lvp_pipeline *pipeline,
       pipeline->inlines[stage].must_inline = lvp_find_inlinable_uniforms(pipeline, nir);
    pipeline->pipeline_nir[stage] = nir;
 
+   lvp_pipeline_cache_add_shader(cache, pipeline, nir, sha1);
+
    return VK_SUCCESS;
 }
 
@@ -637,6 +693,134 @@ lvp_pipeline_compile(struct lvp_pipeline *pipeline, nir_shader *nir)
    return lvp_pipeline_compile_stage(pipeline, nir);
 }
 
+/* The shader state without inlined uniforms, compiled on first use. */
+static void *
+get_generic_cso(struct lvp_pipeline *pipeline, gl_shader_stage stage, bool tess_ccw)
+{
+   void **cso = tess_ccw ? &pipeline->tess_ccw_cso :
+                           &pipeline->shader_cso[pipe_shader_type_from_mesa(stage)];
+   if (!*cso) {
+      nir_shader *nir = tess_ccw ? pipeline->tess_ccw : pipeline->pipeline_nir[stage];
+      *cso = lvp_pipeline_compile(pipeline, nir_shader_clone(NULL, nir));
+   }
+   return *cso;
+}
+
+static void
+inline_variant_build(void *data, void *gdata, int thread_index)
+{
+   struct lvp_inline_variant *variant = data;
+   struct lvp_pipeline *pipeline = variant->pipeline;
+   const struct lvp_inline_info *inlines = &pipeline->inlines[variant->stage];
+   nir_shader *base_nir = variant->tess_ccw ? pipeline->tess_ccw :
+                                              pipeline->pipeline_nir[variant->stage];
+   nir_shader *nir = nir_shader_clone(NULL, base_nir);
+   nir_function_impl *impl = nir_shader_get_entrypoint(nir);
+   unsigned ssa_alloc = impl->ssa_alloc;
+
+   u_foreach_bit(slot, inlines->can_inline)
+      NIR_PASS_V(nir, lvp_inline_uniforms, pipeline, variant->values[slot], slot);
+   lvp_shader_optimize(nir);
+
+   impl = nir_shader_get_entrypoint(nir);
+   variant->no_gain = ssa_alloc - impl->ssa_alloc < ssa_alloc / 2 &&
+                      !inlines->must_inline;
+   if (variant->no_gain)
+      ralloc_free(nir);
+   else
+      variant->cso = lvp_pipeline_compile(pipeline, nir);
+}
+
+/**
+ * Return the shader state of a variant whose build has finished.
+ */
+void *
+lvp_inline_variant_shader_state(struct lvp_inline_variant *variant)
+{
+   struct lvp_pipeline *pipeline = variant->pipeline;
+   gl_shader_stage stage = variant->stage;
+   struct lvp_inline_cache *cache = &pipeline->inline_cache[stage];
+
+   if (variant->no_gain) {
+      /* not enough change; don't inline further */
+      for (unsigned i = 0; i < cache->num_variants; i++)
+         util_queue_fence_wait(&cache->variants[i]->ready);
+      pipeline->inlines[stage].can_inline = 0;
+      get_generic_cso(pipeline, stage, false);
+      if (stage == MESA_SHADER_TESS_EVAL && pipeline->tess_ccw)
+         get_generic_cso(pipeline, stage, true);
+      return get_generic_cso(pipeline, stage, variant->tess_ccw);
+   }
+
+   return variant->cso;
+}
+
+/**
+ * Return the shader state to bind for the given inlinable uniform values.
+ *
+ * Variants are cached per pipeline stage in LRU order.  With an inline queue
+ * a new variant is inlined and compiled in the background: the generic shader
+ * state is returned and *pending set to the variant until it is ready, see
+ * lvp_inline_variant_shader_state().
+ */
+void *
+lvp_pipeline_inline_variant(struct lvp_pipeline *pipeline, gl_shader_stage stage,
+                            bool tess_ccw,
+                            const uint32_t values[PIPE_MAX_CONSTANT_BUFFERS][MAX_INLINABLE_UNIFORMS],
+                            struct lvp_inline_variant **pending)
+{
+   struct lvp_device *device = pipeline->device;
+   struct lvp_inline_cache *cache = &pipeline->inline_cache[stage];
+   struct lvp_inline_variant *variant = NULL;
+   unsigned i;
+
+   *pending = NULL;
+
+   for (i = 0; i < cache->num_variants; i++) {
+      if (cache->variants[i]->tess_ccw == tess_ccw &&
+          !memcmp(cache->variants[i]->values, values, sizeof(cache->variants[i]->values))) {
+         variant = cache->variants[i];
+         break;
+      }
+   }
+
+   if (variant) {
+      memmove(&cache->variants[1], &cache->variants[0], i * sizeof(cache->variants[0]));
+      if (util_queue_fence_is_signalled(&variant->ready))
+         cache->hits++;
+   } else {
+      /* the least recently used variant is never the one currently bound */
+      if (cache->num_variants == LVP_MAX_INLINE_VARIANTS)
+         inline_variant_destroy(device, cache->variants[--cache->num_variants]);
+
+      variant = rzalloc(NULL, struct lvp_inline_variant);
+      variant->pipeline = pipeline;
+      variant->stage = stage;
+      variant->tess_ccw = tess_ccw;
+      memcpy(variant->values, values, sizeof(variant->values));
+      util_queue_fence_init(&variant->ready);
+
+      memmove(&cache->variants[1], &cache->variants[0],
+              cache->num_variants * sizeof(cache->variants[0]));
+      cache->num_variants++;
+      cache->misses++;
+
+      if (util_queue_is_initialized(&device->inline_queue))
+         util_queue_add_job(&device->inline_queue, variant, &variant->ready,
+                            inline_variant_build, NULL, 0);
+      else
+         inline_variant_build(variant, NULL, 0);
+   }
+   cache->variants[0] = variant;
+
+   if (!util_queue_fence_is_signalled(&variant->ready)) {
+      *pending = variant;
+      return get_generic_cso(pipeline, stage, tess_ccw);
+   }
+
+   return lvp_inline_variant_shader_state(variant);
+}
+
 #ifndef NDEBUG
 static bool
 layouts_equal(const struct lvp_descriptor_set_layout *a, const struct lvp_descriptor_set_layout *b)
@@ -729,7 +913,7 @@ merge_layouts(struct vk_device *device, struct lvp_pipeline *dst, struct lvp_pip
 static VkResult
 lvp_graphics_pipeline_init(struct lvp_pipeline *pipeline,
                            struct lvp_device *device,
-                           struct lvp_pipeline_cache *cache,
+                           struct vk_pipeline_cache *cache,
                            const VkGraphicsPipelineCreateInfo *pCreateInfo)
 {
    VkResult result;
@@ -818,7 +1002,7 @@ lvp_graphics_pipeline_init(struct lvp_pipeline *pipeline,
          if (!(pipeline->stages & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT))
             continue;
       }
-      result = lvp_shader_compile_to_ir(pipeline, sinfo);
+      result = lvp_shader_compile_to_ir(pipeline, cache, sinfo);
       if (result != VK_SUCCESS)
          goto fail;
 
@@ -926,7 +1110,7 @@ lvp_graphics_pipeline_create(
    VkPipeline *pPipeline)
 {
    LVP_FROM_HANDLE(lvp_device, device, _device);
-   LVP_FROM_HANDLE(lvp_pipeline_cache, cache, _cache);
+   VK_FROM_HANDLE(vk_pipeline_cache, cache, _cache);
    struct lvp_pipeline *pipeline;
    VkResult result;
 
@@ -939,6 +1123,9 @@ lvp_graphics_pipeline_create(
 
    vk_object_base_init(&device->vk, &pipeline->base,
                        VK_OBJECT_TYPE_PIPELINE);
+   if (!cache)
+      cache = device->pipeline_cache;
+
    uint64_t t0 = os_time_get_nano();
    result = lvp_graphics_pipeline_init(pipeline, device, cache, pCreateInfo);
    if (result != VK_SUCCESS) {
@@ -994,7 +1181,7 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateGraphicsPipelines(
 static VkResult
 lvp_compute_pipeline_init(struct lvp_pipeline *pipeline,
                           struct lvp_device *device,
-                          struct lvp_pipeline_cache *cache,
+                          struct vk_pipeline_cache *cache,
                           const VkComputePipelineCreateInfo *pCreateInfo)
 {
    pipeline->device = device;
@@ -1005,7 +1192,7 @@ lvp_compute_pipeline_init(struct lvp_pipeline *pipeline,
    pipeline->mem_ctx = ralloc_context(NULL);
    pipeline->is_compute_pipeline = true;
 
-   VkResult result = lvp_shader_compile_to_ir(pipeline, &pCreateInfo->stage);
+   VkResult result = lvp_shader_compile_to_ir(pipeline, cache, &pCreateInfo->stage);
    if (result != VK_SUCCESS)
       return result;
 
@@ -1022,7 +1209,7 @@ lvp_compute_pipeline_create(
    VkPipeline *pPipeline)
 {
    LVP_FROM_HANDLE(lvp_device, device, _device);
-   LVP_FROM_HANDLE(lvp_pipeline_cache, cache, _cache);
+   VK_FROM_HANDLE(vk_pipeline_cache, cache, _cache);
    struct lvp_pipeline *pipeline;
    VkResult result;
 
@@ -1035,6 +1222,9 @@ lvp_compute_pipeline_create(
 
    vk_object_base_init(&device->vk, &pipeline->base,
                        VK_OBJECT_TYPE_PIPELINE);
+   if (!cache)
+      cache = device->pipeline_cache;
+
    uint64_t t0 = os_time_get_nano();
    result = lvp_compute_pipeline_init(pipeline, device, cache, pCreateInfo);
    if (result != VK_SUCCESS) {
@@ -21,82 +21,240 @@
  * IN THE SOFTWARE.
  */
 
+
 #include "lvp_private.h"
+#include "vk_pipeline.h"
+#include "util/blob.h"
+#include "util/mesa-sha1.h"
+#include "nir_serialize.h"
+
+/* Pipelines are cached per shader stage: each entry holds the NIR of one
+ * stage after it has been lowered to the pipeline layout, along with the
+ * pipeline info gathered from it while lowering.  The LLVM code generated
+ * for it by llvmpipe is cached separately, in the screen's disk cache.
+ */
+struct lvp_cached_shader {
+   struct vk_pipeline_cache_object base;
+
+   unsigned char sha1[SHA1_DIGEST_LENGTH];
+
+   struct lvp_access_info access;
+   struct lvp_inline_info inlines;
+
+   uint32_t nir_size;
+   void *nir_data;
+};
 
-VKAPI_ATTR VkResult VKAPI_CALL lvp_CreatePipelineCache(
-    VkDevice                                    _device,
-    const VkPipelineCacheCreateInfo*            pCreateInfo,
-    const VkAllocationCallbacks*                pAllocator,
-    VkPipelineCache*                            pPipelineCache)
+static const struct vk_pipeline_cache_object_ops lvp_cached_shader_ops;
+
+static struct lvp_cached_shader *
+lvp_cached_shader_create(struct vk_device *device,
+                         const void *key_data, size_t key_size,
+                         const struct lvp_access_info *access,
+                         const struct lvp_inline_info *inlines,
+                         const void *nir_data, size_t nir_size)
 {
-   LVP_FROM_HANDLE(lvp_device, device, _device);
-   struct lvp_pipeline_cache *cache;
+   assert(key_size == SHA1_DIGEST_LENGTH);
 
-   assert(pCreateInfo->sType == VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO);
+   VK_MULTIALLOC(ma);
+   VK_MULTIALLOC_DECL(&ma, struct lvp_cached_shader, shader, 1);
+   VK_MULTIALLOC_DECL_SIZE(&ma, char, data, nir_size);
 
-   cache = vk_alloc2(&device->vk.alloc, pAllocator,
-                       sizeof(*cache), 8,
-                       VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
-   if (cache == NULL)
-      return vk_error(device, VK_ERROR_OUT_OF_HOST_MEMORY);
+   if (!vk_multialloc_alloc(&ma, &device->alloc,
+                            VK_SYSTEM_ALLOCATION_SCOPE_DEVICE))
+      return NULL;
 
-   vk_object_base_init(&device->vk, &cache->base,
-                       VK_OBJECT_TYPE_PIPELINE_CACHE);
-   if (pAllocator)
-     cache->alloc = *pAllocator;
-   else
-     cache->alloc = device->vk.alloc;
+   memcpy(shader->sha1, key_data, key_size);
+   vk_pipeline_cache_object_init(device, &shader->base,
+                                 &lvp_cached_shader_ops,
+                                 shader->sha1, sizeof(shader->sha1));
 
-   cache->device = device;
-   *pPipelineCache = lvp_pipeline_cache_to_handle(cache);
+   shader->access = *access;
+   shader->inlines = *inlines;
+   shader->nir_size = nir_size;
+   shader->nir_data = data;
+   memcpy(data, nir_data, nir_size);
 
-   return VK_SUCCESS;
+   return shader;
 }
 
-VKAPI_ATTR void VKAPI_CALL lvp_DestroyPipelineCache(
-    VkDevice                                    _device,
-    VkPipelineCache                             _cache,
-    const VkAllocationCallbacks*                pAllocator)
+static bool
+lvp_cached_shader_serialize(struct vk_pipeline_cache_object *object,
+                            struct blob *blob)
 {
-   LVP_FROM_HANDLE(lvp_device, device, _device);
-   LVP_FROM_HANDLE(lvp_pipeline_cache, cache, _cache);
+   struct lvp_cached_shader *shader =
+      container_of(object, struct lvp_cached_shader, base);
 
-   if (!_cache)
-      return;
-//   lvp_pipeline_cache_finish(cache);
-   vk_object_base_finish(&cache->base);
-   vk_free2(&device->vk.alloc, pAllocator, cache);
+   blob_write_bytes(blob, &shader->access, sizeof(shader->access));
+   blob_write_bytes(blob, &shader->inlines, sizeof(shader->inlines));
+   blob_write_uint32(blob, shader->nir_size);
+   blob_write_bytes(blob, shader->nir_data, shader->nir_size);
+
+   return !blob->out_of_memory;
+}
+
+static struct vk_pipeline_cache_object *
+lvp_cached_shader_deserialize(struct vk_device *device,
+                              const void *key_data, size_t key_size,
+                              struct blob_reader *blob)
+{
+   struct lvp_access_info access;
+   struct lvp_inline_info inlines;
+
+   blob_copy_bytes(blob, &access, sizeof(access));
+   blob_copy_bytes(blob, &inlines, sizeof(inlines));
+   uint32_t nir_size = blob_read_uint32(blob);
+   const void *nir_data = blob_read_bytes(blob, nir_size);
+
+   if (blob->overrun || key_size != SHA1_DIGEST_LENGTH)
+      return NULL;
+
+   struct lvp_cached_shader *shader =
+      lvp_cached_shader_create(device, key_data, key_size, &access, &inlines,
+                               nir_data, nir_size);
+
+   return shader ? &shader->base : NULL;
+}
+
+static void
+lvp_cached_shader_destroy(struct vk_pipeline_cache_object *object)
+{
+   struct lvp_cached_shader *shader =
+      container_of(object, struct lvp_cached_shader, base);
+
+   vk_pipeline_cache_object_finish(&shader->base);
+   vk_free(&object->device->alloc, shader);
+}
+
+static const struct vk_pipeline_cache_object_ops lvp_cached_shader_ops = {
+   .serialize = lvp_cached_shader_serialize,
+   .deserialize = lvp_cached_shader_deserialize,
+   .destroy = lvp_cached_shader_destroy,
+};
+
+static void
+hash_set_layout(struct mesa_sha1 *ctx,
+                const struct lvp_descriptor_set_layout *layout)
+{
+   _mesa_sha1_update(ctx, &layout->binding_count, sizeof(layout->binding_count));
+   _mesa_sha1_update(ctx, &layout->size, sizeof(layout->size));
+   _mesa_sha1_update(ctx, &layout->shader_stages, sizeof(layout->shader_stages));
+   _mesa_sha1_update(ctx, layout->stage, sizeof(layout->stage));
+   _mesa_sha1_update(ctx, &layout->dynamic_offset_count,
+                     sizeof(layout->dynamic_offset_count));
+
+   for (unsigned i = 0; i < layout->binding_count; i++) {
+      const struct lvp_descriptor_set_binding_layout *binding = &layout->binding[i];
+
+      _mesa_sha1_update(ctx, &binding->descriptor_index, sizeof(binding->descriptor_index));
+      _mesa_sha1_update(ctx, &binding->type, sizeof(binding->type));
+      _mesa_sha1_update(ctx, &binding->array_size, sizeof(binding->array_size));
+      _mesa_sha1_update(ctx, &binding->valid, sizeof(binding->valid));
+      _mesa_sha1_update(ctx, &binding->dynamic_index, sizeof(binding->dynamic_index));
+      _mesa_sha1_update(ctx, binding->stage, sizeof(binding->stage));
+   }
 }
 
-VKAPI_ATTR VkResult VKAPI_CALL lvp_GetPipelineCacheData(
-        VkDevice                                    _device,
-        VkPipelineCache                             _cache,
-        size_t*                                     pDataSize,
-        void*                                       pData)
+/* The lowered NIR depends on the shader stage and on how the pipeline
+ * layout maps descriptors to gallium slots, so both go into the key.
+ */
+void
+lvp_pipeline_hash_shader_stage(const struct lvp_pipeline *pipeline,
+                               const VkPipelineShaderStageCreateInfo *sinfo,
+                               unsigned char *sha1)
 {
-   VkResult result = VK_SUCCESS;
-   if (pData) {
-      if (*pDataSize < 32) {
-         *pDataSize = 0;
-         result = VK_INCOMPLETE;
-      } else {
-         uint32_t *hdr = (uint32_t *)pData;
-         hdr[0] = 32;
-         hdr[1] = 1;
-         hdr[2] = VK_VENDOR_ID_MESA;
-         hdr[3] = 0;
-         lvp_device_get_cache_uuid(&hdr[4]);
+   const struct lvp_pipeline_layout *layout = pipeline->layout;
+   unsigned char stage_sha1[SHA1_DIGEST_LENGTH];
+   struct mesa_sha1 ctx;
+
+   vk_pipeline_hash_shader_stage(sinfo, NULL, stage_sha1);
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, stage_sha1, sizeof(stage_sha1));
+
+   if (layout) {
+      _mesa_sha1_update(&ctx, &layout->push_constant_size,
+                        sizeof(layout->push_constant_size));
+      _mesa_sha1_update(&ctx, &layout->push_constant_stages,
+                        sizeof(layout->push_constant_stages));
+      _mesa_sha1_update(&ctx, layout->stage, sizeof(layout->stage));
+      _mesa_sha1_update(&ctx, &layout->vk.set_count, sizeof(layout->vk.set_count));
+      for (unsigned s = 0; s < layout->vk.set_count; s++) {
+         bool has_set = layout->vk.set_layouts[s] != NULL;
+
+         _mesa_sha1_update(&ctx, &has_set, sizeof(has_set));
+         if (has_set)
+            hash_set_layout(&ctx, vk_to_lvp_descriptor_set_layout(layout->vk.set_layouts[s]));
       }
-   } else
-      *pDataSize = 32;
-   return result;
+   }
+
+   _mesa_sha1_final(&ctx, sha1);
 }
 
-VKAPI_ATTR VkResult VKAPI_CALL lvp_MergePipelineCaches(
-        VkDevice                                    _device,
-        VkPipelineCache                             destCache,
-        uint32_t                                    srcCacheCount,
-        const VkPipelineCache*                      pSrcCaches)
+nir_shader *
+lvp_pipeline_cache_lookup_shader(struct vk_pipeline_cache *cache,
+                                 struct lvp_pipeline *pipeline,
+                                 gl_shader_stage stage,
+                                 const unsigned char *sha1)
 {
-   return VK_SUCCESS;
+   struct lvp_physical_device *pdevice = pipeline->device->physical_device;
+   struct vk_pipeline_cache_object *object;
+   bool cache_hit;
+
+   object = vk_pipeline_cache_lookup_object(cache, sha1, SHA1_DIGEST_LENGTH,
+                                            &lvp_cached_shader_ops, &cache_hit);
+   if (!object)
+      return NULL;
+
+   struct lvp_cached_shader *shader =
+      container_of(object, struct lvp_cached_shader, base);
+   struct blob_reader blob;
+
+   blob_reader_init(&blob, shader->nir_data, shader->nir_size);
+   nir_shader *nir = nir_deserialize(NULL, pdevice->drv_options[stage], &blob);
+   if (nir && (blob.overrun || nir->info.stage != stage)) {
+      ralloc_free(nir);
+      nir = NULL;
+   }
+
+   if (nir) {
+      pipeline->access[stage].images_read |= shader->access.images_read;
+      pipeline->access[stage].images_written |= shader->access.images_written;
+      pipeline->access[stage].buffers_written |= shader->access.buffers_written;
+      pipeline->inlines[stage] = shader->inlines;
+   }
+
+   vk_pipeline_cache_object_unref(object);
+
+   return nir;
+}
+
+void
+lvp_pipeline_cache_add_shader(struct vk_pipeline_cache *cache,
+                              const struct lvp_pipeline *pipeline,
+                              const nir_shader *nir,
+                              const unsigned char *sha1)
+{
+   gl_shader_stage stage = nir->info.stage;
+   struct blob blob;
+
+   blob_init(&blob);
+   nir_serialize(&blob, nir, false);
+   if (blob.out_of_memory) {
+      blob_finish(&blob);
+      return;
+   }
+
+   struct lvp_cached_shader *shader =
+      lvp_cached_shader_create(cache->base.device, sha1, SHA1_DIGEST_LENGTH,
+                               &pipeline->access[stage],
+                               &pipeline->inlines[stage],
+                               blob.data, blob.size);
+   blob_finish(&blob);
+   if (!shader)
+      return;
+
+   struct vk_pipeline_cache_object *cached =
+      vk_pipeline_cache_add_object(cache, &shader->base);
+   vk_pipeline_cache_object_unref(cached);
 }
@@ -69,6 +69,7 @@ typedef uint32_t xcb_window_t;
 #include "vk_command_pool.h"
 #include "vk_descriptor_set_layout.h"
 #include "vk_graphics_state.h"
+#include "vk_pipeline_cache.h"
 #include "vk_pipeline_layout.h"
 #include "vk_queue.h"
 #include "vk_sync.h"
@@ -166,12 +167,6 @@ struct lvp_queue {
    simple_mtx_t pipeline_lock;
 };
 
-struct lvp_pipeline_cache {
-   struct vk_object_base                        base;
-   struct lvp_device *                          device;
-   VkAllocationCallbacks                        alloc;
-};
-
 struct lvp_device {
    struct vk_device vk;
 
@@ -179,7 +174,11 @@ struct lvp_device {
    struct lvp_instance *                       instance;
    struct lvp_physical_device *physical_device;
    struct pipe_screen *pscreen;
+   struct vk_pipeline_cache *pipeline_cache;
    bool poison_mem;
+   bool inline_stats;
+   /* builds inlined-uniform variants when LVP_ASYNC_INLINE is set */
+   struct util_queue inline_queue;
 };
 
 void lvp_device_get_cache_uuid(void *uuid);
@@ -403,6 +402,38 @@ struct lvp_access_info {
    uint64_t buffers_written;
 };
 
+struct lvp_inline_info {
+   uint32_t uniform_offsets[PIPE_MAX_CONSTANT_BUFFERS][MAX_INLINABLE_UNIFORMS];
+   uint8_t count[PIPE_MAX_CONSTANT_BUFFERS];
+   bool must_inline;
+   uint32_t can_inline; //bitmask
+};
+
+/* upper bound of inlined-uniform variants kept per pipeline stage */
+#define LVP_MAX_INLINE_VARIANTS 16
+
+/* A shader stage with its inlinable uniforms replaced by fixed values. */
+struct lvp_inline_variant {
+   struct lvp_pipeline *pipeline;
+   gl_shader_stage stage;
+   bool tess_ccw;
+   uint32_t values[PIPE_MAX_CONSTANT_BUFFERS][MAX_INLINABLE_UNIFORMS];
+
+   /* inlining barely shrank the shader, so no cso was compiled */
+   bool no_gain;
+   void *cso;
+   /* signalled once cso is compiled */
+   struct util_queue_fence ready;
+};
+
+struct lvp_inline_cache {
+   /* most recently used first */
+   struct lvp_inline_variant *variants[LVP_MAX_INLINE_VARIANTS];
+   unsigned num_variants;
+   unsigned hits;
+   unsigned misses;
+};
+
 struct lvp_pipeline {
    struct vk_object_base base;
    struct lvp_device *                          device;
@@ -418,12 +449,8 @@ struct lvp_pipeline {
    nir_shader *tess_ccw;
    void *shader_cso[PIPE_SHADER_TYPES];
    void *tess_ccw_cso;
-   struct {
-      uint32_t uniform_offsets[PIPE_MAX_CONSTANT_BUFFERS][MAX_INLINABLE_UNIFORMS];
-      uint8_t count[PIPE_MAX_CONSTANT_BUFFERS];
-      bool must_inline;
-      uint32_t can_inline; //bitmask
-   } inlines[MESA_SHADER_STAGES];
+   struct lvp_inline_info inlines[MESA_SHADER_STAGES];
+   struct lvp_inline_cache inline_cache[MESA_SHADER_STAGES];
    gl_shader_stage last_vertex;
    struct pipe_stream_output_info stream_output;
    struct vk_graphics_pipeline_state graphics_state;
@@ -488,6 +515,9 @@ struct lvp_cmd_buffer {
 
    enum lvp_cmd_buffer_status status;
 
+   /* state commands dropped from vk.cmd_queue at EndCommandBuffer time */
+   struct vk_cmd_queue pruned_cmds;
+
    uint8_t push_constants[MAX_PUSH_CONSTANTS_SIZE];
 };
 
@@ -536,8 +566,6 @@ VK_DEFINE_NONDISP_HANDLE_CASTS(lvp_event, base, VkEvent, VK_OBJECT_TYPE_EVENT)
 VK_DEFINE_NONDISP_HANDLE_CASTS(lvp_image, vk.base, VkImage, VK_OBJECT_TYPE_IMAGE)
 VK_DEFINE_NONDISP_HANDLE_CASTS(lvp_image_view, vk.base, VkImageView,
                                VK_OBJECT_TYPE_IMAGE_VIEW);
-VK_DEFINE_NONDISP_HANDLE_CASTS(lvp_pipeline_cache, base, VkPipelineCache,
-                               VK_OBJECT_TYPE_PIPELINE_CACHE)
 VK_DEFINE_NONDISP_HANDLE_CASTS(lvp_pipeline, base, VkPipeline,
                                VK_OBJECT_TYPE_PIPELINE)
 VK_DEFINE_NONDISP_HANDLE_CASTS(lvp_pipeline_layout, vk.base, VkPipelineLayout,
@@ -564,6 +592,7 @@ struct lvp_cmd_push_descriptor_set {
 };
 
 void lvp_add_enqueue_cmd_entrypoints(struct vk_device_dispatch_table *disp);
+void lvp_cmd_queue_prune(struct vk_cmd_queue *queue, struct vk_cmd_queue *pruned);
 
 VkResult lvp_execute_cmds(struct lvp_device *device,
                           struct lvp_queue *queue,
@@ -620,6 +649,27 @@ void
 lvp_inline_uniforms(nir_shader *shader, const struct lvp_pipeline *pipeline, const uint32_t *uniform_values, uint32_t ubo);
 void *
 lvp_pipeline_compile(struct lvp_pipeline *pipeline, nir_shader *base_nir);
+void *
+lvp_pipeline_inline_variant(struct lvp_pipeline *pipeline, gl_shader_stage stage,
+                            bool tess_ccw,
+                            const uint32_t values[PIPE_MAX_CONSTANT_BUFFERS][MAX_INLINABLE_UNIFORMS],
+                            struct lvp_inline_variant **pending);
+void *
+lvp_inline_variant_shader_state(struct lvp_inline_variant *variant);
+void
+lvp_pipeline_hash_shader_stage(const struct lvp_pipeline *pipeline,
+                               const VkPipelineShaderStageCreateInfo *sinfo,
+                               unsigned char *sha1);
+nir_shader *
+lvp_pipeline_cache_lookup_shader(struct vk_pipeline_cache *cache,
+                                 struct lvp_pipeline *pipeline,
+                                 gl_shader_stage stage,
+                                 const unsigned char *sha1);
+void
+lvp_pipeline_cache_add_shader(struct vk_pipeline_cache *cache,
+                              const struct lvp_pipeline *pipeline,
+                              const nir_shader *nir,
+                              const unsigned char *sha1);
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,268 @@
+/*
+ * Copyright © 2023 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Unit tests for lvp_cmd_queue_prune: command sequences are recorded into a
+ * vk_cmd_queue the way the enqueue entrypoints do it, pruned, and the
+ * commands left in the queue are compared with the expected ones.  Each
+ * command is identified by its type and a tag taken from its arguments
+ * (viewport x, scissor x, first push constant value, index buffer handle).
+ */
+
+#include <stdio.h>
+
+#include "lvp_private.h"
+#include "vk_alloc.h"
+
+struct expected_cmd {
+   enum vk_cmd_type type;
+   uint32_t tag;
+};
+
+struct prune_test {
+   const char *name;
+   void (*record)(struct vk_cmd_queue *queue);
+   const struct expected_cmd *expected;
+   unsigned num_expected;
+};
+
+static void
+set_viewport(struct vk_cmd_queue *queue, float x)
+{
+   VkViewport viewport = { x, 0.0f, 64.0f, 64.0f, 0.0f, 1.0f };
+
+   vk_enqueue_cmd_set_viewport(queue, 0, 1, &viewport);
+}
+
+static void
+set_scissor(struct vk_cmd_queue *queue, int32_t x)
+{
+   VkRect2D scissor = { { x, 0 }, { 64, 64 } };
+
+   vk_enqueue_cmd_set_scissor(queue, 0, 1, &scissor);
+}
+
+static void
+push_constants(struct vk_cmd_queue *queue, uint32_t offset, uint32_t value)
+{
+   uint32_t values[4] = { value, value, value, value };
+
+   vk_enqueue_cmd_push_constants(queue, VK_NULL_HANDLE,
+                                 VK_SHADER_STAGE_VERTEX_BIT, offset,
+                                 sizeof(values), values);
+}
+
+static void
+bind_index_buffer(struct vk_cmd_queue *queue, uint32_t buffer)
+{
+   vk_enqueue_cmd_bind_index_buffer(queue, (VkBuffer)(uintptr_t)buffer, 0,
+                                    VK_INDEX_TYPE_UINT16);
+}
+
+static void
+draw(struct vk_cmd_queue *queue)
+{
+   vk_enqueue_cmd_draw(queue, 3, 1, 0, 0);
+}
+
+static void
+draw_indexed(struct vk_cmd_queue *queue)
+{
+   vk_enqueue_cmd_draw_indexed(queue, 3, 1, 0, 0, 0);
+}
+
+static uint32_t
+cmd_tag(const struct vk_cmd_queue_entry *cmd)
+{
+   switch (cmd->type) {
+   case VK_CMD_SET_VIEWPORT:
+      return (uint32_t)cmd->u.set_viewport.viewports[0].x;
+   case VK_CMD_SET_SCISSOR:
+      return cmd->u.set_scissor.scissors[0].offset.x;
+   case VK_CMD_SET_STENCIL_REFERENCE:
+      return cmd->u.set_stencil_reference.reference;
+   case VK_CMD_PUSH_CONSTANTS:
+      return ((const uint32_t *)cmd->u.push_constants.values)[0];
+   case VK_CMD_BIND_INDEX_BUFFER:
+      return (uint32_t)(uintptr_t)cmd->u.bind_index_buffer.buffer;
+   default:
+      return 0;
+   }
+}
+
+/* A viewport overwritten before the draw is dropped, so is a scissor
+ * identical to the bound one.  Stencil references for different faces
+ * don't override each other.
+ */
+static void
+record_dynamic_state(struct vk_cmd_queue *queue)
+{
+   set_viewport(queue, 1);
+   set_viewport(queue, 2);
+   set_scissor(queue, 8);
+   draw(queue);
+   set_scissor(queue, 8);
+   vk_enqueue_cmd_set_stencil_reference(queue, VK_STENCIL_FACE_FRONT_BIT, 3);
+   vk_enqueue_cmd_set_stencil_reference(queue, VK_STENCIL_FACE_BACK_BIT, 4);
+   draw(queue);
+}
+
+static const struct expected_cmd expected_dynamic_state[] = {
+   { VK_CMD_SET_VIEWPORT, 2 },
+   { VK_CMD_SET_SCISSOR, 8 },
+   { VK_CMD_DRAW, 0 },
+   { VK_CMD_SET_STENCIL_REFERENCE, 3 },
+   { VK_CMD_SET_STENCIL_REFERENCE, 4 },
+   { VK_CMD_DRAW, 0 },
+};
+
+/* An update of another range is kept, one of the same range overwritten
+ * before the draw is dropped.  Values a draw read stay when updated after
+ * it, unless the update pushes the same values again.
+ */
+static void
+record_push_constants(struct vk_cmd_queue *queue)
+{
+   push_constants(queue, 16, 3);
+   push_constants(queue, 0, 1);
+   push_constants(queue, 0, 2);
+   draw(queue);
+   push_constants(queue, 0, 2);
+   draw(queue);
+   push_constants(queue, 0, 4);
+   draw(queue);
+}
+
+static const struct expected_cmd expected_push_constants[] = {
+   { VK_CMD_PUSH_CONSTANTS, 3 },
+   { VK_CMD_PUSH_CONSTANTS, 2 },
+   { VK_CMD_DRAW, 0 },
+   { VK_CMD_DRAW, 0 },
+   { VK_CMD_PUSH_CONSTANTS, 4 },
+   { VK_CMD_DRAW, 0 },
+};
+
+/* An index buffer rebound across a draw is kept, re-binding the same one
+ * is dropped, and so is one replaced before any draw used it.
+ */
+static void
+record_index_buffer(struct vk_cmd_queue *queue)
+{
+   bind_index_buffer(queue, 1);
+   draw_indexed(queue);
+   bind_index_buffer(queue, 2);
+   draw_indexed(queue);
+   bind_index_buffer(queue, 2);
+   draw_indexed(queue);
+   bind_index_buffer(queue, 3);
+   bind_index_buffer(queue, 1);
+   draw_indexed(queue);
+}
+
+static const struct expected_cmd expected_index_buffer[] = {
+   { VK_CMD_BIND_INDEX_BUFFER, 1 },
+   { VK_CMD_DRAW_INDEXED, 0 },
+   { VK_CMD_BIND_INDEX_BUFFER, 2 },
+   { VK_CMD_DRAW_INDEXED, 0 },
+   { VK_CMD_DRAW_INDEXED, 0 },
+   { VK_CMD_BIND_INDEX_BUFFER, 1 },
+   { VK_CMD_DRAW_INDEXED, 0 },
+};
+
+/* Any other command ends the window, nothing is compared across it. */
+static void
+record_window_break(struct vk_cmd_queue *queue)
+{
+   set_viewport(queue, 1);
+   vk_enqueue_cmd_set_cull_mode(queue, VK_CULL_MODE_BACK_BIT);
+   set_viewport(queue, 1);
+   set_viewport(queue, 5);
+   draw(queue);
+}
+
+static const struct expected_cmd expected_window_break[] = {
+   { VK_CMD_SET_VIEWPORT, 1 },
+   { VK_CMD_SET_CULL_MODE, 0 },
+   { VK_CMD_SET_VIEWPORT, 5 },
+   { VK_CMD_DRAW, 0 },
+};
+
+#define PRUNE_TEST(name) \
+   { #name, record_##name, expected_##name, ARRAY_SIZE(expected_##name) }
+
+static const struct prune_test tests[] = {
+   PRUNE_TEST(dynamic_state),
+   PRUNE_TEST(push_constants),
+   PRUNE_TEST(index_buffer),
+   PRUNE_TEST(window_break),
+};
+
+static bool
+run_test(const struct prune_test *test)
+{
+   VkAllocationCallbacks *alloc =
+      (VkAllocationCallbacks *)vk_default_allocator();
+   struct vk_cmd_queue queue, pruned;
+   unsigned num_recorded, num_pruned, i = 0;
+   bool success = true;
+
+   vk_cmd_queue_init(&queue, alloc);
+   vk_cmd_queue_init(&pruned, alloc);
+
+   test->record(&queue);
+   num_recorded = list_length(&queue.cmds);
+   lvp_cmd_queue_prune(&queue, &pruned);
+   num_pruned = list_length(&pruned.cmds);
+
+   list_for_each_entry(struct vk_cmd_queue_entry, cmd, &queue.cmds, cmd_link) {
+      if (i >= test->num_expected ||
+          cmd->type != test->expected[i].type ||
+          cmd_tag(cmd) != test->expected[i].tag) {
+         printf("%s: command %u is %s (%u)\n", test->name, i,
+                vk_cmd_queue_type_names[cmd->type], cmd_tag(cmd));
+         success = false;
+      }
+      i++;
+   }
+   if (i != test->num_expected || num_recorded != i + num_pruned) {
+      printf("%s: %u of %u commands left, expected %u\n", test->name, i,
+             num_recorded, test->num_expected);
+      success = false;
+   }
+
+   vk_cmd_queue_finish(&queue);
+   vk_cmd_queue_finish(&pruned);
+
+   printf("%s: %s\n", test->name, success ? "pass" : "FAIL");
+   return success;
+}
+
+int
+main(int argc, char **argv)
+{
+   bool success = true;
+
+   for (unsigned i = 0; i < ARRAY_SIZE(tests); i++)
+      success &= run_test(&tests[i]);
+
+   return success ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+/**************************************************************************
+ *
+ * Copyright 2023 The Mesa Authors.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Vertex fetch throughput of the translate backends, in millions of
+ * vertices per second, for every input format converted to
+ * R32G32B32A32_FLOAT through run_elts.
+ *
+ * Usage: ./translate_bench [format-name-substring]
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "translate/translate.h"
+#include "util/u_memory.h"
+#include "util/os_time.h"
+#include "util/format/u_format.h"
+
+
+#define NUM_VERTS   (64 * 1024)
+#define MIN_TIME_NS (50 * 1000 * 1000)
+
+struct backend
+{
+   const char *name;
+   struct translate *(*create)(const struct translate_key *key);
+};
+
+static const struct backend backends[] = {
+   { "generic", translate_generic_create },
+#if defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)
+   { "x86", translate_sse2_create },
+#endif
+#ifdef DRAW_LLVM_AVAILABLE
+   { "llvm", translate_llvm_create },
+#endif
+};
+
+
+/**
+ * Returns the throughput in Mvertices/s, or a negative value if the
+ * backend doesn't handle the key.
+ */
+static double
+bench(const struct backend *backend, const struct translate_key *key,
+      const void *src, unsigned src_stride,
+      const unsigned *elts, void *dst)
+{
+   struct translate *translate = backend->create(key);
+   int64_t start, elapsed;
+   unsigned runs = 0;
+
+   if (!translate)
+      return -1.0;
+
+   translate->set_buffer(translate, 0, src, src_stride, NUM_VERTS - 1);
+
+   /* warm up, this is also where the llvm backend compiles */
+   translate->run_elts(translate, elts, NUM_VERTS, 0, 0, dst);
+
+   start = os_time_get_nano();
+   do {
+      translate->run_elts(translate, elts, NUM_VERTS, 0, 0, dst);
+      runs++;
+      elapsed = os_time_get_nano() - start;
+   } while (elapsed < MIN_TIME_NS);
+
+   translate->release(translate);
+
+   return (double)runs * NUM_VERTS * 1000.0 / (double)elapsed;
+}
+
+
+int main(int argc, char **argv)
+{
+   const char *filter = argc > 1 ? argv[1] : NULL;
+   struct translate_key key;
+   unsigned char *src, *dst;
+   unsigned *elts;
+   unsigned format, i;
+
+   src = align_malloc(NUM_VERTS * 32, 64);
+   dst = align_malloc(NUM_VERTS * 16, 64);
+   elts = align_malloc(NUM_VERTS * sizeof *elts, 64);
+
+   srand(4359025);
+   for (i = 0; i < NUM_VERTS * 32; i++)
+      src[i] = rand() & 0x3f;
+
+   /* mostly sequential, like post-transform cache friendly meshes */
+   for (i = 0; i < NUM_VERTS; i++)
+      elts[i] = MIN2(i + (rand() & 15), NUM_VERTS - 1);
+
+   memset(&key, 0, sizeof key);
+   key.output_stride = 16;
+   key.nr_elements = 1;
+   key.element[0].type = TRANSLATE_ELEMENT_NORMAL;
+   key.element[0].output_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+   printf("%-40s", "format (Mverts/s)");
+   for (i = 0; i < ARRAY_SIZE(backends); i++)
+      printf("%10s", backends[i].name);
+   printf("\n");
+
+   for (format = 1; format < PIPE_FORMAT_COUNT; format++) {
+      const struct util_format_description *desc =
+         util_format_description(format);
+
+      if (!desc ||
+          desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+          desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+          desc->channel[0].pure_integer ||
+          desc->block.bits > 32 * 8 ||
+          !translate_is_output_format_supported(format))
+         continue;
+
+      if (filter && !strstr(desc->name, filter))
+         continue;
+
+      key.element[0].input_format = format;
+
+      printf("%-40s", desc->short_name);
+      for (i = 0; i < ARRAY_SIZE(backends); i++) {
+         double rate = bench(&backends[i], &key, src, desc->block.bits / 8,
+                             elts, dst);
+         if (rate < 0.0)
+            printf("%10s", "-");
+         else
+            printf("%10.1f", rate);
+      }
+      printf("\n");
+      fflush(stdout);
+   }
+
+   align_free(src);
+   align_free(dst);
+   align_free(elts);
+
+   return 0;
+}
@@ -67,6 +67,7 @@ struct xlib_displaytarget
 
    Display *display;
    Visual *visual;
+   int depth;
    XImage *tempImage;
    GC gc;
 
@@ -195,6 +196,7 @@ alloc_shm_ximage(struct xlib_displaytarget *xlib_dt,
       return;
    }
 
+   (void) XSetErrorHandler(old_handler);
    xlib_dt->shm = True;
 }
 
@@ -204,6 +206,9 @@ alloc_ximage(struct xlib_displaytarget *xlib_dt,
              struct xlib_drawable *xmb,
              unsigned width, unsigned height)
 {
+   xlib_dt->visual = xmb->visual;
+   xlib_dt->depth = xmb->depth;
+
    /* try allocating a shared memory image first */
    if (xlib_dt->shm) {
       alloc_shm_ximage(xlib_dt, xmb, width, height);
@@ -220,6 +225,25 @@ alloc_ximage(struct xlib_displaytarget *xlib_dt,
                                    8, 0);
 }
 
+/**
+ * Free the XImage of a display target.  The pixels belong to the display
+ * target and are left alone, a shared memory segment is only detached from
+ * the X server.
+ */
+static void
+destroy_ximage(struct xlib_displaytarget *xlib_dt)
+{
+   if (!xlib_dt->tempImage)
+      return;
+
+   if (xlib_dt->shm)
+      XShmDetach(xlib_dt->display, &xlib_dt->shminfo);
+
+   xlib_dt->tempImage->data = NULL;
+   XDestroyImage(xlib_dt->tempImage);
+   xlib_dt->tempImage = NULL;
+}
+
 static bool
 xlib_is_displaytarget_format_supported(struct sw_winsys *ws,
                                        unsigned tex_usage,
@@ -256,6 +280,8 @@ xlib_displaytarget_destroy(struct sw_winsys *ws,
 {
    struct xlib_displaytarget *xlib_dt = xlib_displaytarget(dt);
 
+   destroy_ximage(xlib_dt);
+
    if (xlib_dt->data) {
       if (xlib_dt->shminfo.shmid >= 0) {
          shmdt(xlib_dt->shminfo.shmaddr);
@@ -263,23 +289,11 @@ xlib_displaytarget_destroy(struct sw_winsys *ws,
          
          xlib_dt->shminfo.shmid = -1;
          xlib_dt->shminfo.shmaddr = (char *) -1;
-
-         xlib_dt->data = NULL;
-         if (xlib_dt->tempImage)
-            xlib_dt->tempImage->data = NULL;
       }
       else {
          align_free(xlib_dt->data);
-         if (xlib_dt->tempImage && xlib_dt->tempImage->data == xlib_dt->data) {
-            xlib_dt->tempImage->data = NULL;
-         }
-         xlib_dt->data = NULL;
       }
-   }
-
-   if (xlib_dt->tempImage) {
-      XDestroyImage(xlib_dt->tempImage);
-      xlib_dt->tempImage = NULL;
+      xlib_dt->data = NULL;
    }
 
    if (xlib_dt->gc)
@@ -325,10 +339,14 @@ xlib_sw_display(struct xlib_drawable *xlib_drawable,
          xlib_dt->gc = NULL;
       }
 
-      if (xlib_dt->tempImage) {
-         XDestroyImage(xlib_dt->tempImage);
-         xlib_dt->tempImage = NULL;
-      }
+      /* The image, and the shared memory segment attached for it, belong
+       * to the connection rather than the drawable.  Keep them unless the
+       * new drawable needs a different pixel layout, re-attaching costs a
+       * round trip to the server.
+       */
+      if (xlib_dt->visual != xlib_drawable->visual ||
+          xlib_dt->depth != xlib_drawable->depth)
+         destroy_ximage(xlib_dt);
 
       xlib_dt->drawable = xlib_drawable->drawable;
    }
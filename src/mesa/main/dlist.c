@@ -1649,6 +1649,20 @@ save_MultiDrawElementsIndirect(UNUSED GLenum mode,
                "glMultiDrawElementsIndirect() during display list compile");
 }
 
+/**
+ * Forget the state values tracked in ctx->ListState.Current, for example
+ * after glPopAttrib which restores values set outside of the list.
+ */
+static void
+invalidate_saved_state_values(struct gl_context *ctx)
+{
+   /* Loopback usage applies recursively, so remember this state */
+   bool use_loopback = ctx->ListState.Current.UseLoopback;
+   memset(&ctx->ListState.Current, 0, sizeof ctx->ListState.Current);
+   ctx->ListState.Current.UseLoopback = use_loopback;
+}
+
+
 /**
  * While building a display list we cache some OpenGL state.
  * Under some circumstances we need to invalidate that state (immediately
@@ -1665,15 +1679,95 @@ invalidate_saved_current_state(struct gl_context *ctx)
    for (i = 0; i < MAT_ATTRIB_MAX; i++)
       ctx->ListState.ActiveMaterialSize[i] = 0;
 
-   /* Loopback usage applies recursively, so remember this state */
-   bool use_loopback = ctx->ListState.Current.UseLoopback;
-   memset(&ctx->ListState.Current, 0, sizeof ctx->ListState.Current);
-   ctx->ListState.Current.UseLoopback = use_loopback;
+   invalidate_saved_state_values(ctx);
 
    ctx->Driver.CurrentSavePrimitive = PRIM_UNKNOWN;
 }
 
 
+/**
+ * Whether a state value set earlier in the list makes a new call setting
+ * \p value a no-op.  \p known is zero when the list hasn't set it yet.
+ *
+ * Not compiling such calls avoids flushing the vertices, so the glBegin/
+ * glEnd pairs around them end up in one vertex list and their draws are
+ * merged by the vbo module.
+ */
+static inline bool
+saved_enum_is_current(GLenum16 known, GLenum value)
+{
+   return known != 0 && known == value;
+}
+
+
+static inline bool
+saved_float_is_current(GLfloat known, GLfloat value)
+{
+   return known != 0.0f && known == value;
+}
+
+
+/**
+ * The bit of ctx->ListState.Current.Enabled tracking \p cap, or -1.
+ *
+ * Only caps which nothing but glEnable/Disable, glEnablei/Disablei and
+ * glPopAttrib can change are tracked.
+ */
+static int
+dlist_enable_bit(GLenum cap)
+{
+   switch (cap) {
+   case GL_ALPHA_TEST:            return 0;
+   case GL_BLEND:                 return 1;
+   case GL_COLOR_MATERIAL:        return 2;
+   case GL_CULL_FACE:             return 3;
+   case GL_DEPTH_TEST:            return 4;
+   case GL_FOG:                   return 5;
+   case GL_LIGHTING:              return 6;
+   case GL_LINE_SMOOTH:           return 7;
+   case GL_LINE_STIPPLE:          return 8;
+   case GL_NORMALIZE:             return 9;
+   case GL_POLYGON_OFFSET_FILL:   return 10;
+   case GL_POLYGON_OFFSET_LINE:   return 11;
+   case GL_POLYGON_OFFSET_POINT:  return 12;
+   case GL_RESCALE_NORMAL:        return 13;
+   case GL_SCISSOR_TEST:          return 14;
+   case GL_STENCIL_TEST:          return 15;
+   default:
+      if (cap >= GL_LIGHT0 && cap <= GL_LIGHT7)
+         return 16 + (cap - GL_LIGHT0);
+      return -1;
+   }
+}
+
+
+/**
+ * Record a glEnable/Disable of \p cap in the list.
+ *
+ * \return true if the list already set \p cap to \p state, in which case
+ * the call doesn't need to be compiled
+ */
+static bool
+save_enable_state(struct gl_context *ctx, GLenum cap, bool state)
+{
+   const int bit = dlist_enable_bit(cap);
+
+   if (bit < 0)
+      return false;
+
+   if (ctx->ListState.Current.EnableKnown & BITFIELD_BIT(bit) &&
+       !!(ctx->ListState.Current.Enabled & BITFIELD_BIT(bit)) == state)
+      return true;
+
+   ctx->ListState.Current.EnableKnown |= BITFIELD_BIT(bit);
+   if (state)
+      ctx->ListState.Current.Enabled |= BITFIELD_BIT(bit);
+   else
+      ctx->ListState.Current.Enabled &= ~BITFIELD_BIT(bit);
+   return false;
+}
+
+
 static void GLAPIENTRY
 save_CallList(GLuint list)
 {
@@ -2196,7 +2290,18 @@ save_CullFace(GLenum mode)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   if (saved_enum_is_current(ctx->ListState.Current.CullFace, mode)) {
+      if (ctx->ExecuteFlag)
+         CALL_CullFace(ctx->Exec, (mode));
+      return;
+   }
+
+   SAVE_FLUSH_VERTICES(ctx);
+
+   ctx->ListState.Current.CullFace = mode;
+
    n = alloc_instruction(ctx, OPCODE_CULL_FACE, 1);
    if (n) {
       n[1].e = mode;
@@ -2212,7 +2317,18 @@ save_DepthFunc(GLenum func)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   if (saved_enum_is_current(ctx->ListState.Current.DepthFunc, func)) {
+      if (ctx->ExecuteFlag)
+         CALL_DepthFunc(ctx->Exec, (func));
+      return;
+   }
+
+   SAVE_FLUSH_VERTICES(ctx);
+
+   ctx->ListState.Current.DepthFunc = func;
+
    n = alloc_instruction(ctx, OPCODE_DEPTH_FUNC, 1);
    if (n) {
       n[1].e = func;
@@ -2228,7 +2344,18 @@ save_DepthMask(GLboolean mask)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   if (ctx->ListState.Current.DepthMask == 1 + !!mask) {
+      if (ctx->ExecuteFlag)
+         CALL_DepthMask(ctx->Exec, (mask));
+      return;
+   }
+
+   SAVE_FLUSH_VERTICES(ctx);
+
+   ctx->ListState.Current.DepthMask = 1 + !!mask;
+
    n = alloc_instruction(ctx, OPCODE_DEPTH_MASK, 1);
    if (n) {
       n[1].b = mask;
@@ -2261,7 +2388,16 @@ save_Disable(GLenum cap)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   if (save_enable_state(ctx, cap, false)) {
+      if (ctx->ExecuteFlag)
+         CALL_Disable(ctx->Exec, (cap));
+      return;
+   }
+
+   SAVE_FLUSH_VERTICES(ctx);
+
    n = alloc_instruction(ctx, OPCODE_DISABLE, 1);
    if (n) {
       n[1].e = cap;
@@ -2278,6 +2414,10 @@ save_Disablei(GLuint index, GLenum cap)
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
    ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
+
+   /* GL_BLEND and GL_SCISSOR_TEST are both indexed and tracked */
+   ctx->ListState.Current.EnableKnown = 0;
+
    n = alloc_instruction(ctx, OPCODE_DISABLE_INDEXED, 2);
    if (n) {
       n[1].ui = index;
@@ -2336,7 +2476,16 @@ save_Enable(GLenum cap)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   if (save_enable_state(ctx, cap, true)) {
+      if (ctx->ExecuteFlag)
+         CALL_Enable(ctx->Exec, (cap));
+      return;
+   }
+
+   SAVE_FLUSH_VERTICES(ctx);
+
    n = alloc_instruction(ctx, OPCODE_ENABLE, 1);
    if (n) {
       n[1].e = cap;
@@ -2354,6 +2503,10 @@ save_Enablei(GLuint index, GLenum cap)
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
    ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
+
+   /* GL_BLEND and GL_SCISSOR_TEST are both indexed and tracked */
+   ctx->ListState.Current.EnableKnown = 0;
+
    n = alloc_instruction(ctx, OPCODE_ENABLE_INDEXED, 2);
    if (n) {
       n[1].ui = index;
@@ -2481,7 +2634,18 @@ save_FrontFace(GLenum mode)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   if (saved_enum_is_current(ctx->ListState.Current.FrontFace, mode)) {
+      if (ctx->ExecuteFlag)
+         CALL_FrontFace(ctx->Exec, (mode));
+      return;
+   }
+
+   SAVE_FLUSH_VERTICES(ctx);
+
+   ctx->ListState.Current.FrontFace = mode;
+
    n = alloc_instruction(ctx, OPCODE_FRONT_FACE, 1);
    if (n) {
       n[1].e = mode;
@@ -2762,7 +2926,18 @@ save_LineWidth(GLfloat width)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   if (saved_float_is_current(ctx->ListState.Current.LineWidth, width)) {
+      if (ctx->ExecuteFlag)
+         CALL_LineWidth(ctx->Exec, (width));
+      return;
+   }
+
+   SAVE_FLUSH_VERTICES(ctx);
+
+   ctx->ListState.Current.LineWidth = width;
+
    n = alloc_instruction(ctx, OPCODE_LINE_WIDTH, 1);
    if (n) {
       n[1].f = width;
@@ -3309,7 +3484,18 @@ save_PointSize(GLfloat size)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   if (saved_float_is_current(ctx->ListState.Current.PointSize, size)) {
+      if (ctx->ExecuteFlag)
+         CALL_PointSize(ctx->Exec, (size));
+      return;
+   }
+
+   SAVE_FLUSH_VERTICES(ctx);
+
+   ctx->ListState.Current.PointSize = size;
+
    n = alloc_instruction(ctx, OPCODE_POINT_SIZE, 1);
    if (n) {
       n[1].f = size;
@@ -3325,7 +3511,21 @@ save_PolygonMode(GLenum face, GLenum mode)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   /* The faces overlap, so only a repeat of the last call is a no-op */
+   if (saved_enum_is_current(ctx->ListState.Current.PolygonModeFace, face) &&
+       saved_enum_is_current(ctx->ListState.Current.PolygonMode, mode)) {
+      if (ctx->ExecuteFlag)
+         CALL_PolygonMode(ctx->Exec, (face, mode));
+      return;
+   }
+
+   SAVE_FLUSH_VERTICES(ctx);
+
+   ctx->ListState.Current.PolygonModeFace = face;
+   ctx->ListState.Current.PolygonMode = mode;
+
    n = alloc_instruction(ctx, OPCODE_POLYGON_MODE, 2);
    if (n) {
       n[1].e = face;
@@ -3397,6 +3597,10 @@ save_PopAttrib(void)
    GET_CURRENT_CONTEXT(ctx);
    ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
    (void) alloc_instruction(ctx, OPCODE_POP_ATTRIB, 0);
+
+   /* This may restore anything set before the list was called */
+   invalidate_saved_state_values(ctx);
+
    if (ctx->ExecuteFlag) {
       CALL_PopAttrib(ctx->Exec, ());
    }
@@ -13994,6 +14198,36 @@ _mesa_glthread_execute_list(struct gl_context *ctx, GLuint list)
          case OPCODE_MATRIX_POP:
             _mesa_glthread_MatrixPopEXT(ctx, n[1].e);
             break;
+         case OPCODE_DISABLE_INDEXED:
+            _mesa_glthread_Enablei(ctx, n[1].e, n[2].ui, false);
+            break;
+         case OPCODE_ENABLE_INDEXED:
+            _mesa_glthread_Enablei(ctx, n[1].e, n[2].ui, true);
+            break;
+         case OPCODE_BLEND_FUNC_SEPARATE:
+            _mesa_glthread_BlendFuncSeparate(ctx, n[1].e, n[2].e, n[3].e,
+                                             n[4].e);
+            break;
+         case OPCODE_BLEND_FUNC_I:
+         case OPCODE_BLEND_FUNC_SEPARATE_I:
+            _mesa_glthread_BlendFunci(ctx, n[1].ui);
+            break;
+         case OPCODE_DEPTH_FUNC:
+            _mesa_glthread_DepthFunc(ctx, n[1].e);
+            break;
+         case OPCODE_DEPTH_MASK:
+            _mesa_glthread_DepthMask(ctx, n[1].b);
+            break;
+         case OPCODE_VIEWPORT:
+            _mesa_glthread_Viewport(ctx, n[1].i, n[2].i, n[3].i, n[4].i);
+            break;
+         case OPCODE_VIEWPORT_ARRAY_V:
+            _mesa_glthread_ViewportIndexed(ctx, n[1].ui, n[2].si);
+            break;
+         case OPCODE_VIEWPORT_INDEXED_F:
+         case OPCODE_VIEWPORT_INDEXED_FV:
+            _mesa_glthread_ViewportIndexed(ctx, n[1].ui, 1);
+            break;
          case OPCODE_CONTINUE:
             n = (Node *)get_pointer(&n[1]);
             continue;
@@ -14034,6 +14268,17 @@ _mesa_glthread_should_execute_list(struct gl_context *ctx,
       case OPCODE_ACTIVE_TEXTURE:   /* GL_ARB_multitexture */
       case OPCODE_MATRIX_PUSH:
       case OPCODE_MATRIX_POP:
+      case OPCODE_DISABLE_INDEXED:
+      case OPCODE_ENABLE_INDEXED:
+      case OPCODE_BLEND_FUNC_SEPARATE:
+      case OPCODE_BLEND_FUNC_I:
+      case OPCODE_BLEND_FUNC_SEPARATE_I:
+      case OPCODE_DEPTH_FUNC:
+      case OPCODE_DEPTH_MASK:
+      case OPCODE_VIEWPORT:
+      case OPCODE_VIEWPORT_ARRAY_V:
+      case OPCODE_VIEWPORT_INDEXED_F:
+      case OPCODE_VIEWPORT_INDEXED_FV:
          return true;
       case OPCODE_CONTINUE:
          n = (Node *)get_pointer(&n[1]);
@@ -29,6 +29,8 @@
 #include "glformats.h"
 #include "format_pack.h"
 #include "format_unpack.h"
+#include "sse_format_convert.h"
+#include "x86/common_x86_asm.h"
 
 const mesa_array_format RGBA32_FLOAT =
    MESA_ARRAY_FORMAT(MESA_ARRAY_FORMAT_BASE_FORMAT_RGBA_VARIANTS,
@@ -1539,6 +1541,25 @@ _mesa_swizzle_and_convert(void *void_dst, enum mesa_array_format_datatype dst_ty
                                   swizzle, normalized, count))
       return;
 
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1) {
+      int done = _mesa_swizzle_and_convert_sse41(void_dst, dst_type,
+                                                 num_dst_channels,
+                                                 void_src, src_type,
+                                                 num_src_channels,
+                                                 swizzle, normalized, count);
+      if (done == count)
+         return;
+
+      /* the remaining pixels go through the loops below */
+      void_dst = (uint8_t *) void_dst + done * num_dst_channels *
+                 _mesa_array_format_datatype_get_size(dst_type);
+      void_src = (const uint8_t *) void_src + done * num_src_channels *
+                 _mesa_array_format_datatype_get_size(src_type);
+      count -= done;
+   }
+#endif
+
    switch (dst_type) {
    case MESA_ARRAY_FORMAT_TYPE_FLOAT:
       convert_float(void_dst, num_dst_channels, void_src, src_type,
@@ -36,9 +36,11 @@
 #include "main/glthread.h"
 #include "main/glthread_marshal.h"
 #include "main/hash.h"
+#include "util/hash_table.h"
 #include "util/u_atomic.h"
 #include "util/u_thread.h"
 #include "util/u_cpu_detect.h"
+#include "util/os_time.h"
 
 #include "state_tracker/st_context.h"
 
@@ -111,7 +113,10 @@ _mesa_glthread_init(struct gl_context *ctx)
 
    assert(!glthread->enabled);
 
-   if (!util_queue_init(&glthread->queue, "gl", MARSHAL_MAX_BATCHES - 2,
+   /* _mesa_glthread_flush_batch waits for the batch to be filled next, so
+    * adding a job never has to wait for a free slot in the queue.
+    */
+   if (!util_queue_init(&glthread->queue, "gl", MARSHAL_MAX_BATCHES - 1,
                         1, 0, NULL)) {
       return;
    }
@@ -140,6 +145,7 @@ _mesa_glthread_init(struct gl_context *ctx)
    }
    glthread->next_batch = &glthread->batches[glthread->next];
    glthread->used = 0;
+   glthread->batch_limit = MARSHAL_MAX_CMD_SIZE / 8;
 
    glthread->enabled = true;
    glthread->stats.queue = &glthread->queue;
@@ -152,6 +158,22 @@ _mesa_glthread_init(struct gl_context *ctx)
 
    glthread->LastDListChangeBatchIndex = -1;
 
+   /* Initial values of the state that isn't 0. */
+   glthread->Dither = true;
+   glthread->DepthFunc = GL_LESS;
+   glthread->DepthMask = GL_TRUE;
+   glthread->BlendFuncValid = true;
+   glthread->BlendFunc[0] = GL_ONE;
+   glthread->BlendFunc[1] = GL_ZERO;
+   glthread->BlendFunc[2] = GL_ONE;
+   glthread->BlendFunc[3] = GL_ZERO;
+
+   if (MESA_DEBUG_FLAGS & DEBUG_GLTHREAD_SYNCS) {
+      glthread->SyncCounts =
+         _mesa_hash_table_create(NULL, _mesa_hash_string,
+                                 _mesa_key_string_equal);
+   }
+
    /* Execute the thread initialization function in the thread. */
    struct util_queue_fence fence;
    util_queue_fence_init(&fence);
@@ -167,6 +189,38 @@ free_vao(void *data, UNUSED void *userData)
    free(data);
 }
 
+static int
+compare_sync_counts(const void *a, const void *b)
+{
+   const struct hash_entry *ea = *(const struct hash_entry **)a;
+   const struct hash_entry *eb = *(const struct hash_entry **)b;
+
+   return (int)((uintptr_t)eb->data - (uintptr_t)ea->data);
+}
+
+static void
+print_sync_counts(struct gl_context *ctx)
+{
+   struct hash_table *counts = ctx->GLThread.SyncCounts;
+   struct hash_entry **entries = malloc(counts->entries * sizeof(*entries));
+   unsigned num = 0;
+
+   if (!entries)
+      return;
+
+   hash_table_foreach(counts, entry)
+      entries[num++] = entry;
+
+   qsort(entries, num, sizeof(*entries), compare_sync_counts);
+
+   _mesa_debug(ctx, "glthread syncs per function:\n");
+   for (unsigned i = 0; i < num; i++) {
+      _mesa_debug(ctx, "%10u  gl%s\n", (unsigned)(uintptr_t)entries[i]->data,
+                  (const char *)entries[i]->key);
+   }
+   free(entries);
+}
+
 void
 _mesa_glthread_destroy(struct gl_context *ctx, const char *reason)
 {
@@ -188,6 +242,12 @@ _mesa_glthread_destroy(struct gl_context *ctx, const char *reason)
    _mesa_DeleteHashTable(glthread->VAOs);
    _mesa_glthread_release_upload_buffer(ctx);
 
+   if (glthread->SyncCounts) {
+      print_sync_counts(ctx);
+      _mesa_hash_table_destroy(glthread->SyncCounts, NULL);
+      glthread->SyncCounts = NULL;
+   }
+
    ctx->GLThread.enabled = false;
    ctx->CurrentClientDispatch = ctx->CurrentServerDispatch;
 
@@ -250,7 +310,16 @@ _mesa_glthread_flush_batch(struct gl_context *ctx)
       return;
    }
 
+   /* If the worker thread has already executed everything, it's waiting
+    * for us, and smaller batches would let it start sooner.
+    */
+   bool worker_idle =
+      util_queue_fence_is_signalled(&glthread->batches[glthread->last].fence);
+
    p_atomic_add(&glthread->stats.num_offloaded_items, glthread->used);
+   p_atomic_add(&glthread->stats.batch_fill_sum,
+                glthread->used * 100 / (MARSHAL_MAX_BATCH_SIZE / 8));
+   p_atomic_inc(&glthread->stats.num_filled_batches);
    next->used = glthread->used;
 
    util_queue_add_job(&glthread->queue, next, &next->fence,
@@ -260,6 +329,29 @@ _mesa_glthread_flush_batch(struct gl_context *ctx)
    glthread->next_batch = &glthread->batches[glthread->next];
    glthread->used = 0;
 
+   /* Wait for the next batch to be free, and adjust the batch size.
+    *
+    * If we have to wait, the worker thread is the bottleneck, so make
+    * batches larger to decrease its per-batch overhead and to queue more
+    * calls. If the worker thread is idle, make batches smaller to decrease
+    * latency. The size grows quickly and shrinks slowly, so that a few
+    * light batches between heavy ones don't make it oscillate.
+    */
+   if (!util_queue_fence_is_signalled(&glthread->next_batch->fence)) {
+      int64_t start = os_time_get_nano();
+
+      util_queue_fence_wait(&glthread->next_batch->fence);
+      p_atomic_add(&glthread->stats.stall_time_us,
+                   (os_time_get_nano() - start) / 1000);
+
+      glthread->batch_limit = MIN2(glthread->batch_limit * 2,
+                                   MARSHAL_MAX_BATCH_SIZE / 8);
+   } else if (worker_idle) {
+      glthread->batch_limit = MAX2(glthread->batch_limit -
+                                   glthread->batch_limit / 8,
+                                   MARSHAL_MAX_CMD_SIZE / 8);
+   }
+
    glthread->LastCallList = NULL;
    glthread->LastBindBuffer = NULL;
 }
@@ -324,8 +416,16 @@ _mesa_glthread_finish_before(struct gl_context *ctx, const char *func)
 {
    _mesa_glthread_finish(ctx);
 
-   /* Uncomment this if you want to know where glthread syncs. */
-   /*printf("fallback to sync: %s\n", func);*/
+   /* Count where glthread syncs. */
+   if (unlikely(ctx->GLThread.SyncCounts)) {
+      struct hash_entry *entry =
+         _mesa_hash_table_search(ctx->GLThread.SyncCounts, func);
+
+      if (entry)
+         entry->data = (void *)((uintptr_t)entry->data + 1);
+      else
+         _mesa_hash_table_insert(ctx->GLThread.SyncCounts, func, (void *)1);
+   }
 }
 
 void
@@ -24,7 +24,7 @@
 #ifndef _GLTHREAD_H
 #define _GLTHREAD_H
 
-/* The size of one batch and the maximum size of one call.
+/* The initial and minimum size of one batch and the maximum size of one call.
  *
  * This should be as low as possible, so that:
  * - multiple synchronizations within a frame don't slow us down much
@@ -35,6 +35,15 @@
  */
 #define MARSHAL_MAX_CMD_SIZE (8 * 1024)
 
+/* The storage size of one batch.
+ *
+ * Batches are flushed when they reach glthread_state::batch_limit, which
+ * starts at MARSHAL_MAX_CMD_SIZE and grows up to this when the app thread
+ * has to wait for the worker thread, so that the per-batch overhead of
+ * the worker thread goes down and more calls can be queued.
+ */
+#define MARSHAL_MAX_BATCH_SIZE (32 * 1024)
+
 /* The number of batch slots in memory.
  *
  * One batch is being executed, one batch is being filled, the rest are
@@ -60,6 +69,7 @@ extern "C" {
 
 struct gl_context;
 struct gl_buffer_object;
+struct hash_table;
 struct _mesa_HashTable;
 struct _glapi_table;
 
@@ -111,7 +121,7 @@ struct glthread_batch
    unsigned used;
 
    /** Data contained in the command buffer. */
-   uint64_t buffer[MARSHAL_MAX_CMD_SIZE / 8];
+   uint64_t buffer[MARSHAL_MAX_BATCH_SIZE / 8];
 };
 
 struct glthread_client_attrib {
@@ -136,6 +146,16 @@ struct glthread_attrib_node {
    bool DepthTest;
    bool Lighting;
    bool PolygonStipple;
+   bool PolygonOffsetFill;
+   bool ScissorTest;
+   bool StencilTest;
+   bool Dither;
+   GLenum16 DepthFunc;
+   GLboolean DepthMask;
+   bool BlendFuncValid;
+   GLenum16 BlendFunc[4];
+   bool ViewportValid;
+   GLint Viewport[4];
 };
 
 typedef enum {
@@ -169,6 +189,12 @@ struct glthread_state
    /** For L3 cache pinning. */
    unsigned pin_thread_counter;
 
+   /**
+    * Number of syncs per GL function, only counted with
+    * MESA_DEBUG=glthread_syncs.
+    */
+   struct hash_table *SyncCounts;
+
    /** The ring of batches in memory. */
    struct glthread_batch batches[MARSHAL_MAX_BATCHES];
 
@@ -184,6 +210,12 @@ struct glthread_state
    /** Number of uint64_t elements filled already. */
    unsigned used;
 
+   /**
+    * Number of uint64_t elements after which the batch is flushed.
+    * This adapts to how fast the worker thread executes batches.
+    */
+   unsigned batch_limit;
+
    /** Upload buffer. */
    struct gl_buffer_object *upload_buffer;
    uint8_t *upload_ptr;
@@ -236,12 +268,34 @@ struct glthread_state
    int AttribStackDepth;
    int MatrixStackDepth[M_NUM_MATRIX_STACKS];
 
-   /** Enable states. */
+   /** Enable states. Blend and ScissorTest are for index 0. */
    bool Blend;
    bool DepthTest;
    bool CullFace;
    bool Lighting;
    bool PolygonStipple;
+   bool PolygonOffsetFill;
+   bool ScissorTest;
+   bool StencilTest;
+   bool Dither;
+
+   /** Depth state. */
+   GLenum16 DepthFunc;
+   GLboolean DepthMask;
+
+   /**
+    * Blend factors of draw buffer 0: SrcRGB, DstRGB, SrcA, DstA.
+    * Not valid if they were set by a call that might have failed.
+    */
+   bool BlendFuncValid;
+   GLenum16 BlendFunc[4];
+
+   /**
+    * Viewport 0. Not valid until glViewport is called, because the initial
+    * viewport is the drawable size when the context is first made current.
+    */
+   bool ViewportValid;
+   GLint Viewport[4];
 
    GLuint CurrentDrawFramebuffer;
    GLuint CurrentReadFramebuffer;
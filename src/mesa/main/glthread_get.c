@@ -24,6 +24,22 @@
 #include "main/glthread_marshal.h"
 #include "main/dispatch.h"
 
+uint32_t
+_mesa_unmarshal_GetBooleanv(struct gl_context *ctx,
+                            const struct marshal_cmd_GetBooleanv *cmd)
+{
+   unreachable("never executed");
+   return 0;
+}
+
+uint32_t
+_mesa_unmarshal_GetFloatv(struct gl_context *ctx,
+                          const struct marshal_cmd_GetFloatv *cmd)
+{
+   unreachable("never executed");
+   return 0;
+}
+
 uint32_t
 _mesa_unmarshal_GetIntegerv(struct gl_context *ctx,
                             const struct marshal_cmd_GetIntegerv *cmd)
@@ -32,107 +48,250 @@ _mesa_unmarshal_GetIntegerv(struct gl_context *ctx,
    return 0;
 }
 
-void GLAPIENTRY
-_mesa_marshal_GetIntegerv(GLenum pname, GLint *p)
+/**
+ * Return the value of a state variable that glthread tracks, so that glGet
+ * doesn't have to sync.
+ *
+ * \param p        up to 4 values
+ * \param is_bool  whether the values are GLbooleans
+ * \return  the number of values, or 0 if the caller must sync
+ */
+static unsigned
+get_tracked_value(struct gl_context *ctx, GLenum pname, GLint *p,
+                  bool *is_bool)
 {
-   GET_CURRENT_CONTEXT(ctx);
+   struct glthread_state *glthread = &ctx->GLThread;
 
    /* This will generate GL_INVALID_OPERATION, as it should. */
-   if (ctx->GLThread.inside_begin_end)
-      goto sync;
+   if (glthread->inside_begin_end)
+      return 0;
 
    /* TODO: Use get_hash_params.py to return values for items containing:
     * - CONST(
     * - CONTEXT_[A-Z]*(Const
     */
 
+   *is_bool = false;
+
    switch (pname) {
    case GL_ACTIVE_TEXTURE:
-      *p = GL_TEXTURE0 + ctx->GLThread.ActiveTexture;
-      return;
+      p[0] = GL_TEXTURE0 + glthread->ActiveTexture;
+      return 1;
    case GL_ARRAY_BUFFER_BINDING:
-      *p = ctx->GLThread.CurrentArrayBufferName;
-      return;
+      p[0] = glthread->CurrentArrayBufferName;
+      return 1;
    case GL_ATTRIB_STACK_DEPTH:
-      *p = ctx->GLThread.AttribStackDepth;
-      return;
+      p[0] = glthread->AttribStackDepth;
+      return 1;
    case GL_CLIENT_ACTIVE_TEXTURE:
-      *p = GL_TEXTURE0 + ctx->GLThread.ClientActiveTexture;
-      return;
+      p[0] = GL_TEXTURE0 + glthread->ClientActiveTexture;
+      return 1;
    case GL_CLIENT_ATTRIB_STACK_DEPTH:
-      *p = ctx->GLThread.ClientAttribStackTop;
-      return;
+      p[0] = glthread->ClientAttribStackTop;
+      return 1;
    case GL_CURRENT_PROGRAM:
-      *p = ctx->GLThread.CurrentProgram;
-      return;
+      p[0] = glthread->CurrentProgram;
+      return 1;
    case GL_DRAW_INDIRECT_BUFFER_BINDING:
-      *p = ctx->GLThread.CurrentDrawIndirectBufferName;
-      return;
+      p[0] = glthread->CurrentDrawIndirectBufferName;
+      return 1;
    case GL_DRAW_FRAMEBUFFER_BINDING:
-      *p = ctx->GLThread.CurrentDrawFramebuffer;
-      return;
+      p[0] = glthread->CurrentDrawFramebuffer;
+      return 1;
    case GL_READ_FRAMEBUFFER_BINDING:
-      *p = ctx->GLThread.CurrentReadFramebuffer;
-      return;
+      p[0] = glthread->CurrentReadFramebuffer;
+      return 1;
    case GL_PIXEL_PACK_BUFFER_BINDING:
-      *p = ctx->GLThread.CurrentPixelPackBufferName;
-      return;
+      p[0] = glthread->CurrentPixelPackBufferName;
+      return 1;
    case GL_PIXEL_UNPACK_BUFFER_BINDING:
-      *p = ctx->GLThread.CurrentPixelUnpackBufferName;
-      return;
+      p[0] = glthread->CurrentPixelUnpackBufferName;
+      return 1;
    case GL_QUERY_BUFFER_BINDING:
-      *p = ctx->GLThread.CurrentQueryBufferName;
-      return;
+      p[0] = glthread->CurrentQueryBufferName;
+      return 1;
 
    case GL_MATRIX_MODE:
-      *p = ctx->GLThread.MatrixMode;
-      return;
+      p[0] = glthread->MatrixMode;
+      return 1;
    case GL_CURRENT_MATRIX_STACK_DEPTH_ARB:
-      *p = ctx->GLThread.MatrixStackDepth[ctx->GLThread.MatrixIndex] + 1;
-      return;
+      p[0] = glthread->MatrixStackDepth[glthread->MatrixIndex] + 1;
+      return 1;
    case GL_MODELVIEW_STACK_DEPTH:
-      *p = ctx->GLThread.MatrixStackDepth[M_MODELVIEW] + 1;
-      return;
+      p[0] = glthread->MatrixStackDepth[M_MODELVIEW] + 1;
+      return 1;
    case GL_PROJECTION_STACK_DEPTH:
-      *p = ctx->GLThread.MatrixStackDepth[M_PROJECTION] + 1;
-      return;
+      p[0] = glthread->MatrixStackDepth[M_PROJECTION] + 1;
+      return 1;
    case GL_TEXTURE_STACK_DEPTH:
-      *p = ctx->GLThread.MatrixStackDepth[M_TEXTURE0 + ctx->GLThread.ActiveTexture] + 1;
-      return;
+      p[0] = glthread->MatrixStackDepth[M_TEXTURE0 + glthread->ActiveTexture] + 1;
+      return 1;
 
    case GL_VERTEX_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_POS)) != 0;
-      return;
+      p[0] = (glthread->CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_POS)) != 0;
+      return 1;
    case GL_NORMAL_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_NORMAL)) != 0;
-      return;
+      p[0] = (glthread->CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_NORMAL)) != 0;
+      return 1;
    case GL_COLOR_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_COLOR0)) != 0;
-      return;
+      p[0] = (glthread->CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_COLOR0)) != 0;
+      return 1;
    case GL_SECONDARY_COLOR_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_COLOR1)) != 0;
-      return;
+      p[0] = (glthread->CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_COLOR1)) != 0;
+      return 1;
    case GL_FOG_COORD_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_FOG)) != 0;
-      return;
+      p[0] = (glthread->CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_FOG)) != 0;
+      return 1;
    case GL_INDEX_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_COLOR_INDEX)) != 0;
-      return;
+      p[0] = (glthread->CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_COLOR_INDEX)) != 0;
+      return 1;
    case GL_EDGE_FLAG_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_EDGEFLAG)) != 0;
-      return;
+      p[0] = (glthread->CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_EDGEFLAG)) != 0;
+      return 1;
    case GL_TEXTURE_COORD_ARRAY:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled &
-            (1 << (VERT_ATTRIB_TEX0 + ctx->GLThread.ClientActiveTexture))) != 0;
-      return;
+      p[0] = (glthread->CurrentVAO->UserEnabled &
+            (1 << (VERT_ATTRIB_TEX0 + glthread->ClientActiveTexture))) != 0;
+      return 1;
    case GL_POINT_SIZE_ARRAY_OES:
-      *p = (ctx->GLThread.CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_POINT_SIZE)) != 0;
+      p[0] = (glthread->CurrentVAO->UserEnabled & (1 << VERT_ATTRIB_POINT_SIZE)) != 0;
+      return 1;
+
+   case GL_VERTEX_ARRAY_BINDING:
+      /* The current VAO is only tracked in compatibility contexts. */
+      if (ctx->API == API_OPENGL_CORE)
+         return 0;
+      p[0] = glthread->CurrentVAO->Name;
+      return 1;
+   case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+      if (ctx->API == API_OPENGL_CORE)
+         return 0;
+      p[0] = glthread->CurrentVAO->CurrentElementBufferName;
+      return 1;
+   case GL_PRIMITIVE_RESTART_INDEX:
+      if (!_mesa_is_desktop_gl(ctx) || ctx->Version < 31)
+         return 0;
+      p[0] = glthread->RestartIndex;
+      return 1;
+   case GL_LIST_BASE:
+      if (ctx->API != API_OPENGL_COMPAT)
+         return 0;
+      p[0] = glthread->ListBase;
+      return 1;
+
+   case GL_VIEWPORT:
+      if (!glthread->ViewportValid)
+         return 0;
+      memcpy(p, glthread->Viewport, sizeof(glthread->Viewport));
+      return 4;
+   case GL_DEPTH_FUNC:
+      p[0] = glthread->DepthFunc;
+      return 1;
+   case GL_BLEND_SRC:
+   case GL_BLEND_SRC_RGB:
+   case GL_BLEND_DST:
+   case GL_BLEND_DST_RGB:
+   case GL_BLEND_SRC_ALPHA:
+   case GL_BLEND_DST_ALPHA:
+      if (!glthread->BlendFuncValid)
+         return 0;
+      switch (pname) {
+      case GL_BLEND_SRC:
+      case GL_BLEND_SRC_RGB:
+         p[0] = glthread->BlendFunc[0];
+         break;
+      case GL_BLEND_DST:
+      case GL_BLEND_DST_RGB:
+         p[0] = glthread->BlendFunc[1];
+         break;
+      case GL_BLEND_SRC_ALPHA:
+         p[0] = glthread->BlendFunc[2];
+         break;
+      default:
+         p[0] = glthread->BlendFunc[3];
+         break;
+      }
+      return 1;
+   }
+
+   *is_bool = true;
+
+   switch (pname) {
+   case GL_DEPTH_WRITEMASK:
+      p[0] = glthread->DepthMask;
+      return 1;
+   case GL_BLEND:
+      p[0] = glthread->Blend;
+      return 1;
+   case GL_CULL_FACE:
+      p[0] = glthread->CullFace;
+      return 1;
+   case GL_DEPTH_TEST:
+      p[0] = glthread->DepthTest;
+      return 1;
+   case GL_DITHER:
+      p[0] = glthread->Dither;
+      return 1;
+   case GL_POLYGON_OFFSET_FILL:
+      p[0] = glthread->PolygonOffsetFill;
+      return 1;
+   case GL_SCISSOR_TEST:
+      p[0] = glthread->ScissorTest;
+      return 1;
+   case GL_STENCIL_TEST:
+      p[0] = glthread->StencilTest;
+      return 1;
+   }
+
+   return 0;
+}
+
+void GLAPIENTRY
+_mesa_marshal_GetBooleanv(GLenum pname, GLboolean *p)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   GLint values[4];
+   bool is_bool;
+   unsigned num = get_tracked_value(ctx, pname, values, &is_bool);
+
+   if (num) {
+      for (unsigned i = 0; i < num; i++)
+         p[i] = is_bool ? (GLboolean)values[i] : values[i] != 0;
+      return;
+   }
+
+   _mesa_glthread_finish_before(ctx, "GetBooleanv");
+   CALL_GetBooleanv(ctx->CurrentServerDispatch, (pname, p));
+}
+
+void GLAPIENTRY
+_mesa_marshal_GetFloatv(GLenum pname, GLfloat *p)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   GLint values[4];
+   bool is_bool;
+   unsigned num = get_tracked_value(ctx, pname, values, &is_bool);
+
+   if (num) {
+      for (unsigned i = 0; i < num; i++)
+         p[i] = is_bool ? (values[i] ? 1.0f : 0.0f) : (GLfloat)values[i];
       return;
    }
 
-sync:
+   _mesa_glthread_finish_before(ctx, "GetFloatv");
+   CALL_GetFloatv(ctx->CurrentServerDispatch, (pname, p));
+}
+
+void GLAPIENTRY
+_mesa_marshal_GetIntegerv(GLenum pname, GLint *p)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   bool is_bool;
+
+   if (get_tracked_value(ctx, pname, p, &is_bool))
+      return;
+
    _mesa_glthread_finish_before(ctx, "GetIntegerv");
    CALL_GetIntegerv(ctx->CurrentServerDispatch, (pname, p));
 }
 
-/* TODO: Implement glGetBooleanv, glGetFloatv, etc. if needed */
+/* TODO: Implement glGetDoublev, glGetInteger64v, etc. if needed */
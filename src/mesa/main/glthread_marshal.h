@@ -61,7 +61,7 @@ _mesa_glthread_allocate_command(struct gl_context *ctx,
 
    assert (num_elements <= MARSHAL_MAX_CMD_SIZE / 8);
 
-   if (unlikely(glthread->used + num_elements > MARSHAL_MAX_CMD_SIZE / 8))
+   if (unlikely(glthread->used + num_elements > glthread->batch_limit))
       _mesa_glthread_flush_batch(ctx);
 
    struct glthread_batch *next = glthread->next_batch;
@@ -488,6 +488,18 @@ _mesa_glthread_Enable(struct gl_context *ctx, GLenum cap)
    case GL_POLYGON_STIPPLE:
       ctx->GLThread.PolygonStipple = true;
       break;
+   case GL_POLYGON_OFFSET_FILL:
+      ctx->GLThread.PolygonOffsetFill = true;
+      break;
+   case GL_SCISSOR_TEST:
+      ctx->GLThread.ScissorTest = true;
+      break;
+   case GL_STENCIL_TEST:
+      ctx->GLThread.StencilTest = true;
+      break;
+   case GL_DITHER:
+      ctx->GLThread.Dither = true;
+      break;
    case GL_VERTEX_ARRAY:
    case GL_NORMAL_ARRAY:
    case GL_COLOR_ARRAY:
@@ -529,6 +541,18 @@ _mesa_glthread_Disable(struct gl_context *ctx, GLenum cap)
    case GL_POLYGON_STIPPLE:
       ctx->GLThread.PolygonStipple = false;
       break;
+   case GL_POLYGON_OFFSET_FILL:
+      ctx->GLThread.PolygonOffsetFill = false;
+      break;
+   case GL_SCISSOR_TEST:
+      ctx->GLThread.ScissorTest = false;
+      break;
+   case GL_STENCIL_TEST:
+      ctx->GLThread.StencilTest = false;
+      break;
+   case GL_DITHER:
+      ctx->GLThread.Dither = false;
+      break;
    case GL_VERTEX_ARRAY:
    case GL_NORMAL_ARRAY:
    case GL_COLOR_ARRAY:
@@ -544,6 +568,28 @@ _mesa_glthread_Disable(struct gl_context *ctx, GLenum cap)
    }
 }
 
+static inline void
+_mesa_glthread_Enablei(struct gl_context *ctx, GLenum cap, GLuint index,
+                       bool value)
+{
+   if (ctx->GLThread.ListMode == GL_COMPILE ||
+       ctx->GLThread.inside_begin_end)
+      return;
+
+   /* Only index 0 is tracked, which is what glIsEnabled returns. */
+   if (index != 0)
+      return;
+
+   switch (cap) {
+   case GL_BLEND:
+      ctx->GLThread.Blend = value;
+      break;
+   case GL_SCISSOR_TEST:
+      ctx->GLThread.ScissorTest = value;
+      break;
+   }
+}
+
 static inline int
 _mesa_glthread_IsEnabled(struct gl_context *ctx, GLenum cap)
 {
@@ -562,6 +608,14 @@ _mesa_glthread_IsEnabled(struct gl_context *ctx, GLenum cap)
       return ctx->GLThread.Lighting;
    case GL_POLYGON_STIPPLE:
       return ctx->GLThread.PolygonStipple;
+   case GL_POLYGON_OFFSET_FILL:
+      return ctx->GLThread.PolygonOffsetFill;
+   case GL_SCISSOR_TEST:
+      return ctx->GLThread.ScissorTest;
+   case GL_STENCIL_TEST:
+      return ctx->GLThread.StencilTest;
+   case GL_DITHER:
+      return ctx->GLThread.Dither;
    case GL_VERTEX_ARRAY:
       return !!(ctx->GLThread.CurrentVAO->UserEnabled & VERT_BIT_POS);
    case GL_NORMAL_ARRAY:
@@ -590,17 +644,42 @@ _mesa_glthread_PushAttrib(struct gl_context *ctx, GLbitfield mask)
 
    attr->Mask = mask;
 
-   if (mask & GL_ENABLE_BIT)
+   if (mask & (GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT)) {
       attr->Blend = ctx->GLThread.Blend;
+      attr->Dither = ctx->GLThread.Dither;
+   }
+
+   if (mask & GL_COLOR_BUFFER_BIT) {
+      attr->BlendFuncValid = ctx->GLThread.BlendFuncValid;
+      memcpy(attr->BlendFunc, ctx->GLThread.BlendFunc,
+             sizeof(attr->BlendFunc));
+   }
 
    if (mask & (GL_POLYGON_BIT | GL_ENABLE_BIT)) {
       attr->CullFace = ctx->GLThread.CullFace;
       attr->PolygonStipple = ctx->GLThread.PolygonStipple;
+      attr->PolygonOffsetFill = ctx->GLThread.PolygonOffsetFill;
    }
 
    if (mask & (GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT))
       attr->DepthTest = ctx->GLThread.DepthTest;
 
+   if (mask & GL_DEPTH_BUFFER_BIT) {
+      attr->DepthFunc = ctx->GLThread.DepthFunc;
+      attr->DepthMask = ctx->GLThread.DepthMask;
+   }
+
+   if (mask & (GL_SCISSOR_BIT | GL_ENABLE_BIT))
+      attr->ScissorTest = ctx->GLThread.ScissorTest;
+
+   if (mask & (GL_STENCIL_BUFFER_BIT | GL_ENABLE_BIT))
+      attr->StencilTest = ctx->GLThread.StencilTest;
+
+   if (mask & GL_VIEWPORT_BIT) {
+      attr->ViewportValid = ctx->GLThread.ViewportValid;
+      memcpy(attr->Viewport, ctx->GLThread.Viewport, sizeof(attr->Viewport));
+   }
+
    if (mask & (GL_LIGHTING_BIT | GL_ENABLE_BIT))
       attr->Lighting = ctx->GLThread.Lighting;
 
@@ -624,17 +703,42 @@ _mesa_glthread_PopAttrib(struct gl_context *ctx)
       &ctx->GLThread.AttribStack[--ctx->GLThread.AttribStackDepth];
    unsigned mask = attr->Mask;
 
-   if (mask & GL_ENABLE_BIT)
+   if (mask & (GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT)) {
       ctx->GLThread.Blend = attr->Blend;
+      ctx->GLThread.Dither = attr->Dither;
+   }
+
+   if (mask & GL_COLOR_BUFFER_BIT) {
+      ctx->GLThread.BlendFuncValid = attr->BlendFuncValid;
+      memcpy(ctx->GLThread.BlendFunc, attr->BlendFunc,
+             sizeof(attr->BlendFunc));
+   }
 
    if (mask & (GL_POLYGON_BIT | GL_ENABLE_BIT)) {
       ctx->GLThread.CullFace = attr->CullFace;
       ctx->GLThread.PolygonStipple = attr->PolygonStipple;
+      ctx->GLThread.PolygonOffsetFill = attr->PolygonOffsetFill;
    }
 
    if (mask & (GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT))
       ctx->GLThread.DepthTest = attr->DepthTest;
 
+   if (mask & GL_DEPTH_BUFFER_BIT) {
+      ctx->GLThread.DepthFunc = attr->DepthFunc;
+      ctx->GLThread.DepthMask = attr->DepthMask;
+   }
+
+   if (mask & (GL_SCISSOR_BIT | GL_ENABLE_BIT))
+      ctx->GLThread.ScissorTest = attr->ScissorTest;
+
+   if (mask & (GL_STENCIL_BUFFER_BIT | GL_ENABLE_BIT))
+      ctx->GLThread.StencilTest = attr->StencilTest;
+
+   if (mask & GL_VIEWPORT_BIT) {
+      ctx->GLThread.ViewportValid = attr->ViewportValid;
+      memcpy(ctx->GLThread.Viewport, attr->Viewport, sizeof(attr->Viewport));
+   }
+
    if (mask & (GL_LIGHTING_BIT | GL_ENABLE_BIT))
       ctx->GLThread.Lighting = attr->Lighting;
 
@@ -647,6 +751,130 @@ _mesa_glthread_PopAttrib(struct gl_context *ctx)
    }
 }
 
+static inline bool
+_mesa_glthread_is_common_blend_factor(GLenum factor, bool src)
+{
+   /* These are legal in all APIs. */
+   switch (factor) {
+   case GL_ZERO:
+   case GL_ONE:
+   case GL_SRC_COLOR:
+   case GL_ONE_MINUS_SRC_COLOR:
+   case GL_DST_COLOR:
+   case GL_ONE_MINUS_DST_COLOR:
+   case GL_SRC_ALPHA:
+   case GL_ONE_MINUS_SRC_ALPHA:
+   case GL_DST_ALPHA:
+   case GL_ONE_MINUS_DST_ALPHA:
+      return true;
+   case GL_SRC_ALPHA_SATURATE:
+      return src;
+   default:
+      return false;
+   }
+}
+
+static inline void
+_mesa_glthread_BlendFuncSeparate(struct gl_context *ctx, GLenum sfactorRGB,
+                                 GLenum dfactorRGB, GLenum sfactorA,
+                                 GLenum dfactorA)
+{
+   if (ctx->GLThread.ListMode == GL_COMPILE ||
+       ctx->GLThread.inside_begin_end)
+      return;
+
+   /* Other factors depend on the API and extensions, and are likely to be
+    * rare, so just let glGet sync when they are used.
+    */
+   if (!_mesa_glthread_is_common_blend_factor(sfactorRGB, true) ||
+       !_mesa_glthread_is_common_blend_factor(dfactorRGB, false) ||
+       !_mesa_glthread_is_common_blend_factor(sfactorA, true) ||
+       !_mesa_glthread_is_common_blend_factor(dfactorA, false)) {
+      ctx->GLThread.BlendFuncValid = false;
+      return;
+   }
+
+   ctx->GLThread.BlendFuncValid = true;
+   ctx->GLThread.BlendFunc[0] = sfactorRGB;
+   ctx->GLThread.BlendFunc[1] = dfactorRGB;
+   ctx->GLThread.BlendFunc[2] = sfactorA;
+   ctx->GLThread.BlendFunc[3] = dfactorA;
+}
+
+static inline void
+_mesa_glthread_BlendFunci(struct gl_context *ctx, GLuint buf)
+{
+   if (ctx->GLThread.ListMode == GL_COMPILE)
+      return;
+
+   if (buf == 0)
+      ctx->GLThread.BlendFuncValid = false;
+}
+
+static inline void
+_mesa_glthread_DepthFunc(struct gl_context *ctx, GLenum func)
+{
+   if (ctx->GLThread.ListMode == GL_COMPILE ||
+       ctx->GLThread.inside_begin_end)
+      return;
+
+   /* Invalid values don't change the state. */
+   if (func >= GL_NEVER && func <= GL_ALWAYS)
+      ctx->GLThread.DepthFunc = func;
+}
+
+static inline void
+_mesa_glthread_DepthMask(struct gl_context *ctx, GLboolean flag)
+{
+   if (ctx->GLThread.ListMode == GL_COMPILE ||
+       ctx->GLThread.inside_begin_end)
+      return;
+
+   ctx->GLThread.DepthMask = flag;
+}
+
+static inline void
+_mesa_glthread_Viewport(struct gl_context *ctx, GLint x, GLint y,
+                        GLsizei width, GLsizei height)
+{
+   if (ctx->GLThread.ListMode == GL_COMPILE ||
+       ctx->GLThread.inside_begin_end)
+      return;
+
+   /* A negative size is an error, which doesn't change the state. */
+   if (width < 0 || height < 0)
+      return;
+
+   /* Mesa clamps the viewport to implementation limits, which we don't
+    * replicate here.
+    */
+   ctx->GLThread.ViewportValid =
+      width <= ctx->Const.MaxViewportWidth &&
+      height <= ctx->Const.MaxViewportHeight &&
+      ((!_mesa_has_ARB_viewport_array(ctx) &&
+        !_mesa_has_OES_viewport_array(ctx)) ||
+       (x >= ctx->Const.ViewportBounds.Min &&
+        x <= ctx->Const.ViewportBounds.Max &&
+        y >= ctx->Const.ViewportBounds.Min &&
+        y <= ctx->Const.ViewportBounds.Max));
+
+   ctx->GLThread.Viewport[0] = x;
+   ctx->GLThread.Viewport[1] = y;
+   ctx->GLThread.Viewport[2] = width;
+   ctx->GLThread.Viewport[3] = height;
+}
+
+static inline void
+_mesa_glthread_ViewportIndexed(struct gl_context *ctx, GLuint first,
+                               GLsizei count)
+{
+   if (ctx->GLThread.ListMode == GL_COMPILE)
+      return;
+
+   if (first == 0 && count > 0)
+      ctx->GLThread.ViewportValid = false;
+}
+
 static bool
 is_matrix_stack_full(struct gl_context *ctx, gl_matrix_index idx)
 {
@@ -2932,9 +2932,21 @@ struct gl_dlist_state
 
    struct {
       /* State known to have been set by the currently-compiling display
-       * list.  Used to eliminate some redundant state changes.
+       * list.  Used to eliminate some redundant state changes, which
+       * also keeps the surrounding glBegin/glEnd pairs in one vertex list.
+       * Zero means unknown.
        */
       GLenum16 ShadeModel;
+      GLenum16 CullFace;
+      GLenum16 FrontFace;
+      GLenum16 DepthFunc;
+      GLenum16 PolygonModeFace;  /**< face of the last glPolygonMode */
+      GLenum16 PolygonMode;
+      GLubyte DepthMask;         /**< 1 + mask */
+      GLfloat LineWidth;
+      GLfloat PointSize;
+      GLbitfield EnableKnown;    /**< see dlist_enable_bit() */
+      GLbitfield Enabled;
       bool UseLoopback;
    } Current;
 };
@@ -3712,7 +3724,8 @@ enum _debug
    DEBUG_ALWAYS_FLUSH		= (1 << 1),
    DEBUG_INCOMPLETE_TEXTURE     = (1 << 2),
    DEBUG_INCOMPLETE_FBO         = (1 << 3),
-   DEBUG_CONTEXT                = (1 << 4)
+   DEBUG_CONTEXT                = (1 << 4),
+   DEBUG_GLTHREAD_SYNCS         = (1 << 5)
 };
 
 #ifdef __cplusplus
@@ -0,0 +1,303 @@
+/*
+ * Copyright © 2023 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * SSE4.1 versions of the most common _mesa_swizzle_and_convert() cases.
+ *
+ * A group of pixels is loaded into one vector in the narrower of the two
+ * types, the swizzle is done there with a single pshufb (plus an OR for the
+ * channels which are set to one), and then the vector is widened to the
+ * destination type if needed.  The results are bit for bit the same as
+ * those of the scalar loops in format_utils.c.
+ */
+
+#include "main/sse_format_convert.h"
+#include "util/macros.h"
+#include <smmintrin.h>
+#include <string.h>
+
+enum conversion {
+   CONVERT_NONE,           /* same type, swizzle only */
+   CONVERT_UNORM8_FLOAT,   /* also non-normalized ubyte to float */
+   CONVERT_FLOAT_UNORM8,
+   CONVERT_HALF_FLOAT,
+};
+
+
+static inline __m128i
+load_bytes(const uint8_t *src, unsigned n)
+{
+   int32_t d;
+
+   switch (n) {
+   case 4:
+      memcpy(&d, src, 4);
+      return _mm_cvtsi32_si128(d);
+   case 8:
+      return _mm_loadl_epi64((const __m128i *) src);
+   case 12:
+      memcpy(&d, src + 8, 4);
+      return _mm_insert_epi32(_mm_loadl_epi64((const __m128i *) src), d, 2);
+   default:
+      assert(n == 16);
+      return _mm_loadu_si128((const __m128i *) src);
+   }
+}
+
+
+static inline void
+store_bytes(uint8_t *dst, __m128i v, unsigned n)
+{
+   int32_t d;
+
+   switch (n) {
+   case 4:
+      d = _mm_cvtsi128_si32(v);
+      memcpy(dst, &d, 4);
+      break;
+   case 8:
+      _mm_storel_epi64((__m128i *) dst, v);
+      break;
+   case 12:
+      _mm_storel_epi64((__m128i *) dst, v);
+      d = _mm_extract_epi32(v, 2);
+      memcpy(dst + 8, &d, 4);
+      break;
+   default:
+      assert(n == 16);
+      _mm_storeu_si128((__m128i *) dst, v);
+      break;
+   }
+}
+
+
+/**
+ * _mesa_float_to_unorm(x, 8) on 4 * num_vecs floats, packed into bytes.
+ * NaN gives 0 like the scalar version, as maxps returns its second operand
+ * when either one is NaN.
+ */
+static inline __m128i
+float_to_unorm8(const float *src, unsigned num_vecs)
+{
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 one = _mm_set1_ps(1.0f);
+   const __m128 scale = _mm_set1_ps(255.0f);
+   __m128i v[4];
+   unsigned i;
+
+   for (i = 0; i < 4; i++) {
+      if (i < num_vecs) {
+         __m128 x = _mm_loadu_ps(src + 4 * i);
+         x = _mm_min_ps(_mm_max_ps(x, zero), one);
+         v[i] = _mm_cvtps_epi32(_mm_mul_ps(x, scale));
+      } else {
+         v[i] = _mm_setzero_si128();
+      }
+   }
+
+   return _mm_packus_epi16(_mm_packus_epi32(v[0], v[1]),
+                           _mm_packus_epi32(v[2], v[3]));
+}
+
+
+/**
+ * Same as _mesa_half_to_float_slow() on 4 halves held in 32-bit lanes.
+ */
+static inline __m128
+half_to_float(__m128i h)
+{
+   const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(0xef << 23));
+   const __m128 infnan = _mm_set1_ps(65536.0f);
+   const __m128 exp_mask = _mm_castsi128_ps(_mm_set1_epi32(0xff << 23));
+   __m128i bits = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+   __m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+   __m128 f = _mm_mul_ps(_mm_castsi128_ps(bits), magic);
+
+   f = _mm_or_ps(f, _mm_and_ps(_mm_cmpge_ps(f, infnan), exp_mask));
+   return _mm_or_ps(f, _mm_castsi128_ps(sign));
+}
+
+
+/**
+ * Converts as many pixels as it can in whole groups.
+ *
+ * The arguments are exactly the same as for _mesa_swizzle_and_convert.
+ *
+ * \return  the number of pixels converted, the caller converts the rest
+ */
+int
+_mesa_swizzle_and_convert_sse41(void *void_dst,
+                                enum mesa_array_format_datatype dst_type,
+                                int num_dst_channels,
+                                const void *void_src,
+                                enum mesa_array_format_datatype src_type,
+                                int num_src_channels,
+                                const uint8_t swizzle[4], bool normalized,
+                                int count)
+{
+   alignas(16) uint8_t mask_bytes[16], one_bytes[16];
+   enum conversion conversion;
+   unsigned elem_size, pixels, src_stride, dst_stride;
+   uint32_t one;
+   __m128i mask, ones;
+   const uint8_t *src = void_src;
+   uint8_t *dst = void_dst;
+   int i, p, c;
+
+   if (src_type == dst_type) {
+      conversion = CONVERT_NONE;
+      elem_size = _mesa_array_format_datatype_get_size(src_type);
+
+      switch (src_type) {
+      case MESA_ARRAY_FORMAT_TYPE_UBYTE:
+         one = normalized ? UINT8_MAX : 1;
+         break;
+      case MESA_ARRAY_FORMAT_TYPE_BYTE:
+         one = normalized ? INT8_MAX : 1;
+         break;
+      case MESA_ARRAY_FORMAT_TYPE_USHORT:
+         one = normalized ? UINT16_MAX : 1;
+         break;
+      case MESA_ARRAY_FORMAT_TYPE_SHORT:
+         one = normalized ? INT16_MAX : 1;
+         break;
+      case MESA_ARRAY_FORMAT_TYPE_HALF:
+         one = 0x3c00;
+         break;
+      default:
+         /* a single 32-bit pixel per vector is slower than the C loop */
+         return 0;
+      }
+   } else if (src_type == MESA_ARRAY_FORMAT_TYPE_UBYTE &&
+              dst_type == MESA_ARRAY_FORMAT_TYPE_FLOAT) {
+      conversion = CONVERT_UNORM8_FLOAT;
+      elem_size = 1;
+      one = normalized ? UINT8_MAX : 1;
+   } else if (src_type == MESA_ARRAY_FORMAT_TYPE_FLOAT &&
+              dst_type == MESA_ARRAY_FORMAT_TYPE_UBYTE && normalized) {
+      conversion = CONVERT_FLOAT_UNORM8;
+      elem_size = 1;
+      one = UINT8_MAX;
+   } else if (src_type == MESA_ARRAY_FORMAT_TYPE_HALF &&
+              dst_type == MESA_ARRAY_FORMAT_TYPE_FLOAT) {
+      conversion = CONVERT_HALF_FLOAT;
+      elem_size = 2;
+      one = 0x3c00;
+   } else {
+      return 0;
+   }
+
+   if (num_src_channels < 1 || num_src_channels > 4 ||
+       num_dst_channels < 1 || num_dst_channels > 4)
+      return 0;
+
+   /* Reading a channel the source doesn't have gives garbage in the
+    * scalar code, leave that to it.
+    */
+   for (c = 0; c < num_dst_channels; c++) {
+      if (swizzle[c] >= num_src_channels &&
+          swizzle[c] < MESA_FORMAT_SWIZZLE_ZERO)
+         return 0;
+   }
+
+   /* 16 bytes of the narrower type, which is 4 channels of 4 pixels at most */
+   pixels = 4 / elem_size;
+   if (count < (int) pixels)
+      return 0;
+
+   for (p = 0; p < (int) pixels; p++) {
+      for (c = 0; c < num_dst_channels; c++) {
+         const unsigned pos = (p * num_dst_channels + c) * elem_size;
+         unsigned b;
+
+         for (b = 0; b < elem_size; b++) {
+            if (swizzle[c] < num_src_channels)
+               mask_bytes[pos + b] = (p * num_src_channels + swizzle[c]) *
+                                     elem_size + b;
+            else
+               mask_bytes[pos + b] = 0x80;
+
+            if (swizzle[c] == MESA_FORMAT_SWIZZLE_ONE)
+               one_bytes[pos + b] = one >> (8 * b);
+            else
+               one_bytes[pos + b] = 0;
+         }
+      }
+   }
+   for (i = pixels * num_dst_channels * elem_size; i < 16; i++) {
+      mask_bytes[i] = 0x80;
+      one_bytes[i] = 0;
+   }
+
+   mask = _mm_load_si128((const __m128i *) mask_bytes);
+   ones = _mm_load_si128((const __m128i *) one_bytes);
+
+   src_stride = pixels * num_src_channels *
+                _mesa_array_format_datatype_get_size(src_type);
+   dst_stride = pixels * num_dst_channels *
+                _mesa_array_format_datatype_get_size(dst_type);
+
+   for (i = 0; i + (int) pixels <= count; i += pixels) {
+      __m128i v;
+
+      if (conversion == CONVERT_FLOAT_UNORM8)
+         v = float_to_unorm8((const float *) src, num_src_channels);
+      else
+         v = load_bytes(src, src_stride);
+
+      v = _mm_or_si128(_mm_shuffle_epi8(v, mask), ones);
+
+      switch (conversion) {
+      case CONVERT_UNORM8_FLOAT: {
+         const __m128 scale = _mm_set1_ps(normalized ? 1.0f / 255.0f : 1.0f);
+
+         for (c = 0; c < num_dst_channels; c++) {
+            __m128 f = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(v));
+            _mm_storeu_ps((float *) dst + 4 * c, _mm_mul_ps(f, scale));
+            v = _mm_srli_si128(v, 4);
+         }
+         break;
+      }
+      case CONVERT_HALF_FLOAT: {
+         __m128 lo = half_to_float(_mm_cvtepu16_epi32(v));
+         __m128 hi = half_to_float(_mm_cvtepu16_epi32(_mm_srli_si128(v, 8)));
+
+         if (dst_stride <= 16) {
+            store_bytes(dst, _mm_castps_si128(lo), dst_stride);
+         } else {
+            _mm_storeu_ps((float *) dst, lo);
+            store_bytes(dst + 16, _mm_castps_si128(hi), dst_stride - 16);
+         }
+         break;
+      }
+      default:
+         store_bytes(dst, v, dst_stride);
+         break;
+      }
+
+      src += src_stride;
+      dst += dst_stride;
+   }
+
+   return i;
+}
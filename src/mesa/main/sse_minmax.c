@@ -93,3 +93,196 @@ _mesa_uint_array_min_max(const unsigned *ui_indices, unsigned *min_index,
    *min_index = min_ui;
    *max_index = max_ui;
 }
+
+
+/*
+ * The functions below also skip the primitive restart index when asked to.
+ * Restart indices are turned into 0 for the max and into the largest value
+ * of the type for the min, so they never win.  The results are the same as
+ * those of the scalar loops in vbo_get_minmax_index_mapped(), including
+ * min = ~0 and max = 0 when there are no indices besides restart ones.
+ */
+
+static inline unsigned
+reduce_max_epu32(__m128i v)
+{
+   v = _mm_max_epu32(v, _mm_srli_si128(v, 8));
+   v = _mm_max_epu32(v, _mm_srli_si128(v, 4));
+   return _mm_cvtsi128_si32(v);
+}
+
+
+static inline unsigned
+reduce_min_epu32(__m128i v)
+{
+   v = _mm_min_epu32(v, _mm_srli_si128(v, 8));
+   v = _mm_min_epu32(v, _mm_srli_si128(v, 4));
+   return _mm_cvtsi128_si32(v);
+}
+
+
+void
+_mesa_uint_array_min_max_restart(const unsigned *ui_indices,
+                                 unsigned *min_index, unsigned *max_index,
+                                 const unsigned count,
+                                 const unsigned restart_index)
+{
+   unsigned max_ui = 0;
+   unsigned min_ui = ~0U;
+   unsigned i = 0;
+
+   if (count >= 8) {
+      const __m128i restart4 = _mm_set1_epi32(restart_index);
+      __m128i max_ui4 = _mm_setzero_si128();
+      __m128i min_ui4 = _mm_set1_epi32(~0U);
+
+      for (; i + 4 <= count; i += 4) {
+         __m128i v = _mm_loadu_si128((const __m128i *)&ui_indices[i]);
+         __m128i eq = _mm_cmpeq_epi32(v, restart4);
+
+         max_ui4 = _mm_max_epu32(max_ui4, _mm_andnot_si128(eq, v));
+         min_ui4 = _mm_min_epu32(min_ui4, _mm_or_si128(eq, v));
+      }
+
+      max_ui = reduce_max_epu32(max_ui4);
+      min_ui = reduce_min_epu32(min_ui4);
+   }
+
+   for (; i < count; i++) {
+      if (ui_indices[i] != restart_index) {
+         if (ui_indices[i] > max_ui)
+            max_ui = ui_indices[i];
+         if (ui_indices[i] < min_ui)
+            min_ui = ui_indices[i];
+      }
+   }
+
+   *min_index = min_ui;
+   *max_index = max_ui;
+}
+
+
+void
+_mesa_ushort_array_min_max(const uint16_t *us_indices,
+                           unsigned *min_index, unsigned *max_index,
+                           const unsigned count, bool restart,
+                           const unsigned restart_index)
+{
+   unsigned max_us = 0;
+   unsigned min_us = ~0U;
+   unsigned i = 0;
+
+   /* a restart index that doesn't fit never matches */
+   if (restart_index > UINT16_MAX)
+      restart = false;
+
+   if (count >= 16) {
+      const __m128i restart8 = _mm_set1_epi16(restart_index);
+      const __m128i ones = _mm_set1_epi32(~0U);
+      __m128i max_us8 = _mm_setzero_si128();
+      __m128i min_us8 = ones;
+
+      if (restart) {
+         for (; i + 8 <= count; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i *)&us_indices[i]);
+            __m128i eq = _mm_cmpeq_epi16(v, restart8);
+
+            max_us8 = _mm_max_epu16(max_us8, _mm_andnot_si128(eq, v));
+            min_us8 = _mm_min_epu16(min_us8, _mm_or_si128(eq, v));
+         }
+      } else {
+         for (; i + 8 <= count; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i *)&us_indices[i]);
+
+            max_us8 = _mm_max_epu16(max_us8, v);
+            min_us8 = _mm_min_epu16(min_us8, v);
+         }
+      }
+
+      /* phminposuw does the horizontal min, and the max is the min of the
+       * inverted values
+       */
+      min_us = _mm_extract_epi16(_mm_minpos_epu16(min_us8), 0);
+      max_us = UINT16_MAX ^
+               _mm_extract_epi16(_mm_minpos_epu16(_mm_xor_si128(max_us8, ones)), 0);
+
+      /* Only restart indices seen so far.  A real 0xffff index would have
+       * made max 0xffff too.
+       */
+      if (min_us == UINT16_MAX && max_us < UINT16_MAX)
+         min_us = ~0U;
+   }
+
+   for (; i < count; i++) {
+      if (!restart || us_indices[i] != restart_index) {
+         if (us_indices[i] > max_us)
+            max_us = us_indices[i];
+         if (us_indices[i] < min_us)
+            min_us = us_indices[i];
+      }
+   }
+
+   *min_index = min_us;
+   *max_index = max_us;
+}
+
+
+void
+_mesa_ubyte_array_min_max(const uint8_t *ub_indices,
+                          unsigned *min_index, unsigned *max_index,
+                          const unsigned count, bool restart,
+                          const unsigned restart_index)
+{
+   unsigned max_ub = 0;
+   unsigned min_ub = ~0U;
+   unsigned i = 0;
+
+   if (restart_index > UINT8_MAX)
+      restart = false;
+
+   if (count >= 32) {
+      const __m128i restart16 = _mm_set1_epi8(restart_index);
+      __m128i max_ub16 = _mm_setzero_si128();
+      __m128i min_ub16 = _mm_set1_epi32(~0U);
+
+      if (restart) {
+         for (; i + 16 <= count; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)&ub_indices[i]);
+            __m128i eq = _mm_cmpeq_epi8(v, restart16);
+
+            max_ub16 = _mm_max_epu8(max_ub16, _mm_andnot_si128(eq, v));
+            min_ub16 = _mm_min_epu8(min_ub16, _mm_or_si128(eq, v));
+         }
+      } else {
+         for (; i + 16 <= count; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)&ub_indices[i]);
+
+            max_ub16 = _mm_max_epu8(max_ub16, v);
+            min_ub16 = _mm_min_epu8(min_ub16, v);
+         }
+      }
+
+      /* widen to 16 bits so that phminposuw can do the horizontal part */
+      min_ub16 = _mm_min_epu8(min_ub16, _mm_srli_epi16(min_ub16, 8));
+      max_ub16 = _mm_max_epu8(max_ub16, _mm_srli_epi16(max_ub16, 8));
+      min_ub = _mm_extract_epi16(
+         _mm_minpos_epu16(_mm_and_si128(min_ub16, _mm_set1_epi16(0xff))), 0);
+      max_ub = UINT8_MAX ^ _mm_extract_epi16(
+         _mm_minpos_epu16(_mm_andnot_si128(max_ub16, _mm_set1_epi16(0xff))), 0);
+
+      if (min_ub == UINT8_MAX && max_ub < UINT8_MAX)
+         min_ub = ~0U;
+   }
+
+   for (; i < count; i++) {
+      if (!restart || ub_indices[i] != restart_index) {
+         if (ub_indices[i] > max_ub)
+            max_ub = ub_indices[i];
+         if (ub_indices[i] < min_ub)
+            min_ub = ub_indices[i];
+      }
+   }
+
+   *min_index = min_ub;
+   *max_index = max_ub;
+}
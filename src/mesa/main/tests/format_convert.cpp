@@ -0,0 +1,166 @@
+/*
+ * Copyright © 2023 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name format_convert.cpp
+ *
+ * Check that the SIMD paths of _mesa_swizzle_and_convert() give exactly
+ * what the scalar loops do.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main/formats.h"
+#include "main/macros.h"
+#include "util/format/format_utils.h"
+
+/* format_utils.h itself has no extern "C" */
+extern "C" {
+#include "main/format_utils.h"
+#include "x86/common_x86_asm.h"
+}
+
+namespace {
+
+struct conversion {
+   enum mesa_array_format_datatype dst_type;
+   enum mesa_array_format_datatype src_type;
+   bool normalized;
+};
+
+const struct conversion conversions[] = {
+   { MESA_ARRAY_FORMAT_TYPE_UBYTE, MESA_ARRAY_FORMAT_TYPE_UBYTE, true },
+   { MESA_ARRAY_FORMAT_TYPE_UBYTE, MESA_ARRAY_FORMAT_TYPE_UBYTE, false },
+   { MESA_ARRAY_FORMAT_TYPE_BYTE, MESA_ARRAY_FORMAT_TYPE_BYTE, true },
+   { MESA_ARRAY_FORMAT_TYPE_USHORT, MESA_ARRAY_FORMAT_TYPE_USHORT, true },
+   { MESA_ARRAY_FORMAT_TYPE_SHORT, MESA_ARRAY_FORMAT_TYPE_SHORT, false },
+   { MESA_ARRAY_FORMAT_TYPE_HALF, MESA_ARRAY_FORMAT_TYPE_HALF, true },
+   { MESA_ARRAY_FORMAT_TYPE_UINT, MESA_ARRAY_FORMAT_TYPE_UINT, true },
+   { MESA_ARRAY_FORMAT_TYPE_FLOAT, MESA_ARRAY_FORMAT_TYPE_FLOAT, true },
+   { MESA_ARRAY_FORMAT_TYPE_FLOAT, MESA_ARRAY_FORMAT_TYPE_UBYTE, true },
+   { MESA_ARRAY_FORMAT_TYPE_FLOAT, MESA_ARRAY_FORMAT_TYPE_UBYTE, false },
+   { MESA_ARRAY_FORMAT_TYPE_UBYTE, MESA_ARRAY_FORMAT_TYPE_FLOAT, true },
+   { MESA_ARRAY_FORMAT_TYPE_FLOAT, MESA_ARRAY_FORMAT_TYPE_HALF, true },
+};
+
+const uint8_t swizzles[][4] = {
+   { 0, 1, 2, 3 },
+   { 2, 1, 0, 3 },
+   { 3, 2, 1, 0 },
+   { 0, 1, 2, MESA_FORMAT_SWIZZLE_ONE },
+   { MESA_FORMAT_SWIZZLE_ZERO, 0, MESA_FORMAT_SWIZZLE_ONE, 1 },
+   { 1, 1, 1, 0 },
+};
+
+/* Not a multiple of any group size, so the scalar tail runs too */
+const int count = 37;
+
+void
+fill_source(uint8_t *src, enum mesa_array_format_datatype type, int num)
+{
+   for (int i = 0; i < num; i++) {
+      switch (type) {
+      case MESA_ARRAY_FORMAT_TYPE_FLOAT: {
+         /* mostly in [0, 1], but some need clamping */
+         float f = (rand() % 1200 - 100) / 1000.0f;
+         memcpy(src + i * 4, &f, 4);
+         break;
+      }
+      case MESA_ARRAY_FORMAT_TYPE_HALF: {
+         /* no NaNs, F16C may quiet them where the slow path doesn't */
+         uint16_t h = rand();
+         if ((h & 0x7c00) == 0x7c00)
+            h &= ~0x3ff;
+         memcpy(src + i * 2, &h, 2);
+         break;
+      }
+      default:
+         for (int b = 0; b < _mesa_array_format_datatype_get_size(type); b++)
+            src[i * _mesa_array_format_datatype_get_size(type) + b] = rand();
+         break;
+      }
+   }
+}
+
+}
+
+
+TEST(FormatConvertTest, SIMDMatchesScalar)
+{
+   const int saved_features = _mesa_x86_cpu_features;
+
+   _mesa_get_x86_features();
+   const int features = _mesa_x86_cpu_features;
+   _mesa_x86_cpu_features = saved_features;
+
+   if (!(features & X86_FEATURE_SSE4_1))
+      GTEST_SKIP() << "no SSE4.1";
+
+   srand(4321);
+
+   for (const struct conversion &conv : conversions) {
+      for (int num_src = 1; num_src <= 4; num_src++) {
+         for (int num_dst = 1; num_dst <= 4; num_dst++) {
+            for (const auto &swizzle_in : swizzles) {
+               uint8_t src[count * 4 * 4];
+               uint8_t simd[count * 4 * 4], scalar[count * 4 * 4];
+               uint8_t swizzle[4];
+
+               for (int c = 0; c < 4; c++) {
+                  swizzle[c] = swizzle_in[c];
+                  if (swizzle[c] < 4)
+                     swizzle[c] %= num_src;
+               }
+
+               SCOPED_TRACE(testing::Message()
+                            << "src type " << conv.src_type
+                            << " dst type " << conv.dst_type
+                            << " normalized " << conv.normalized
+                            << " " << num_src << " -> " << num_dst
+                            << " swizzle " << (int) swizzle[0]
+                            << (int) swizzle[1] << (int) swizzle[2]
+                            << (int) swizzle[3]);
+
+               fill_source(src, conv.src_type, count * num_src);
+               memset(simd, 0xcd, sizeof(simd));
+               memset(scalar, 0xcd, sizeof(scalar));
+
+               _mesa_x86_cpu_features = features;
+               _mesa_swizzle_and_convert(simd, conv.dst_type, num_dst,
+                                         src, conv.src_type, num_src,
+                                         swizzle, conv.normalized, count);
+               _mesa_x86_cpu_features = 0;
+               _mesa_swizzle_and_convert(scalar, conv.dst_type, num_dst,
+                                         src, conv.src_type, num_src,
+                                         swizzle, conv.normalized, count);
+
+               EXPECT_EQ(memcmp(simd, scalar, sizeof(simd)), 0);
+            }
+         }
+      }
+   }
+
+   _mesa_x86_cpu_features = saved_features;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright © 2023 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Throughput of _mesa_swizzle_and_convert() for the conversions texture
+ * uploads and readbacks hit most, in MB/s of destination data, with the
+ * scalar loops and with the SIMD paths the CPU supports.
+ *
+ * Usage: ./format_convert_bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "main/format_utils.h"
+#include "util/os_time.h"
+#include "util/u_memory.h"
+#include "x86/common_x86_asm.h"
+
+#define NUM_PIXELS  (256 * 256)
+#define MIN_TIME_NS (50 * 1000 * 1000)
+
+#define ONE  MESA_FORMAT_SWIZZLE_ONE
+
+struct bench_case
+{
+   const char *name;
+   enum mesa_array_format_datatype dst_type;
+   int num_dst_channels;
+   enum mesa_array_format_datatype src_type;
+   int num_src_channels;
+   uint8_t swizzle[4];
+   bool normalized;
+};
+
+static const struct bench_case cases[] = {
+   { "RGB8 -> RGBA8", MESA_ARRAY_FORMAT_TYPE_UBYTE, 4,
+     MESA_ARRAY_FORMAT_TYPE_UBYTE, 3, { 0, 1, 2, ONE }, true },
+   { "BGRA8 -> RGBA8", MESA_ARRAY_FORMAT_TYPE_UBYTE, 4,
+     MESA_ARRAY_FORMAT_TYPE_UBYTE, 4, { 2, 1, 0, 3 }, true },
+   { "RGBA8 -> RGB8", MESA_ARRAY_FORMAT_TYPE_UBYTE, 3,
+     MESA_ARRAY_FORMAT_TYPE_UBYTE, 4, { 0, 1, 2, 3 }, true },
+   { "RG8 -> RGBA8", MESA_ARRAY_FORMAT_TYPE_UBYTE, 4,
+     MESA_ARRAY_FORMAT_TYPE_UBYTE, 2, { 0, 1, 4, ONE }, true },
+   { "RGB16 -> RGBA16", MESA_ARRAY_FORMAT_TYPE_USHORT, 4,
+     MESA_ARRAY_FORMAT_TYPE_USHORT, 3, { 0, 1, 2, ONE }, true },
+   { "RGBA8 -> RGBA32F", MESA_ARRAY_FORMAT_TYPE_FLOAT, 4,
+     MESA_ARRAY_FORMAT_TYPE_UBYTE, 4, { 0, 1, 2, 3 }, true },
+   { "BGRA8 -> RGBA32F", MESA_ARRAY_FORMAT_TYPE_FLOAT, 4,
+     MESA_ARRAY_FORMAT_TYPE_UBYTE, 4, { 2, 1, 0, 3 }, true },
+   { "RGBA32F -> RGBA8", MESA_ARRAY_FORMAT_TYPE_UBYTE, 4,
+     MESA_ARRAY_FORMAT_TYPE_FLOAT, 4, { 0, 1, 2, 3 }, true },
+   { "RGBA32F -> BGRA8", MESA_ARRAY_FORMAT_TYPE_UBYTE, 4,
+     MESA_ARRAY_FORMAT_TYPE_FLOAT, 4, { 2, 1, 0, 3 }, true },
+   { "RGB32F -> RGBA32F", MESA_ARRAY_FORMAT_TYPE_FLOAT, 4,
+     MESA_ARRAY_FORMAT_TYPE_FLOAT, 3, { 0, 1, 2, ONE }, true },
+   { "RGBA16F -> RGBA32F", MESA_ARRAY_FORMAT_TYPE_FLOAT, 4,
+     MESA_ARRAY_FORMAT_TYPE_HALF, 4, { 0, 1, 2, 3 }, true },
+   { "RGB16F -> RGBA32F", MESA_ARRAY_FORMAT_TYPE_FLOAT, 4,
+     MESA_ARRAY_FORMAT_TYPE_HALF, 3, { 0, 1, 2, ONE }, true },
+};
+
+
+static double
+bench(const struct bench_case *c, void *dst, const void *src)
+{
+   const unsigned dst_bytes = NUM_PIXELS * c->num_dst_channels *
+                              _mesa_array_format_datatype_get_size(c->dst_type);
+   int64_t start, elapsed;
+   unsigned runs = 0;
+
+   start = os_time_get_nano();
+   do {
+      _mesa_swizzle_and_convert(dst, c->dst_type, c->num_dst_channels,
+                                src, c->src_type, c->num_src_channels,
+                                c->swizzle, c->normalized, NUM_PIXELS);
+      runs++;
+      elapsed = os_time_get_nano() - start;
+   } while (elapsed < MIN_TIME_NS);
+
+   return (double)runs * dst_bytes * 1000.0 / (double)elapsed;
+}
+
+
+int main(int argc, char **argv)
+{
+   int features;
+   uint8_t *src, *dst;
+   unsigned i;
+
+   _mesa_get_x86_features();
+   features = _mesa_x86_cpu_features;
+
+   src = align_malloc(NUM_PIXELS * 16, 64);
+   dst = align_malloc(NUM_PIXELS * 16, 64);
+
+   /* small values, so that these are also sane floats and halves */
+   srand(4359025);
+   for (i = 0; i < NUM_PIXELS * 16; i++)
+      src[i] = (i & 1) ? 0x3b : rand() & 0xff;
+
+   printf("%-24s%12s%12s\n", "conversion (MB/s)", "scalar",
+          cpu_has_sse4_1 ? "sse4.1" : "-");
+
+   for (i = 0; i < ARRAY_SIZE(cases); i++) {
+      double scalar, simd = 0.0;
+
+      _mesa_x86_cpu_features = 0;
+      scalar = bench(&cases[i], dst, src);
+
+      _mesa_x86_cpu_features = features;
+      if (cpu_has_sse4_1)
+         simd = bench(&cases[i], dst, src);
+
+      printf("%-24s%12.1f%12.1f\n", cases[i].name, scalar, simd);
+      fflush(stdout);
+   }
+
+   align_free(src);
+   align_free(dst);
+
+   return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright © 2023 The Mesa Authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name minmax_index.cpp
+ *
+ * Check that the SIMD paths of vbo_get_minmax_index_mapped() give exactly
+ * what the scalar loops do, with and without primitive restart.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+
+#include "vbo/vbo.h"
+
+extern "C" {
+#include "x86/common_x86_asm.h"
+}
+
+namespace {
+
+/* Short ones only hit the scalar tail, the others cover every tail length */
+const unsigned counts[] = { 0, 1, 7, 31, 32, 33, 47, 100, 1000 };
+
+const unsigned index_sizes[] = { 1, 2, 4 };
+
+enum fill {
+   FILL_RANDOM,
+   FILL_WITH_RESTARTS,
+   FILL_ONLY_RESTARTS,
+   FILL_MAX_VALUES,
+};
+
+void
+fill_indices(uint8_t *indices, unsigned index_size, unsigned count,
+             enum fill fill, unsigned restart_index)
+{
+   for (unsigned i = 0; i < count; i++) {
+      uint32_t v = rand() ^ ((uint32_t) rand() << 16);
+
+      switch (fill) {
+      case FILL_RANDOM:
+         break;
+      case FILL_WITH_RESTARTS:
+         if (rand() % 4 == 0)
+            v = restart_index;
+         break;
+      case FILL_ONLY_RESTARTS:
+         v = restart_index;
+         break;
+      case FILL_MAX_VALUES:
+         v = rand() % 2 ? ~0u : restart_index;
+         break;
+      }
+
+      switch (index_size) {
+      case 1:
+         indices[i] = v;
+         break;
+      case 2:
+         ((uint16_t *) indices)[i] = v;
+         break;
+      default:
+         ((uint32_t *) indices)[i] = v;
+         break;
+      }
+   }
+}
+
+}
+
+
+TEST(MinMaxIndexTest, SIMDMatchesScalar)
+{
+   const int saved_features = _mesa_x86_cpu_features;
+
+   _mesa_get_x86_features();
+   const int features = _mesa_x86_cpu_features;
+   _mesa_x86_cpu_features = saved_features;
+
+   if (!(features & X86_FEATURE_SSE4_1))
+      GTEST_SKIP() << "no SSE4.1";
+
+   srand(1234);
+
+   for (unsigned index_size : index_sizes) {
+      const unsigned type_max = index_size == 4 ? ~0u :
+                                (1u << (8 * index_size)) - 1;
+      const unsigned restart_indices[] = { type_max, 0, 5, ~0u };
+
+      for (unsigned count : counts) {
+         for (unsigned restart_index : restart_indices) {
+            for (int fill = FILL_RANDOM; fill <= FILL_MAX_VALUES; fill++) {
+               for (int restart = 0; restart <= 1; restart++) {
+                  /* + 4 so that the start can be misaligned */
+                  alignas(16) uint8_t buf[(1000 + 4) * 4];
+                  uint8_t *indices = buf + (rand() % 4) * index_size;
+                  unsigned simd_min, simd_max, scalar_min, scalar_max;
+
+                  SCOPED_TRACE(testing::Message()
+                               << "index size " << index_size
+                               << " count " << count
+                               << " restart index " << restart_index
+                               << " fill " << fill
+                               << " restart " << restart);
+
+                  fill_indices(indices, index_size, count, (enum fill) fill,
+                               restart_index);
+
+                  _mesa_x86_cpu_features = features;
+                  vbo_get_minmax_index_mapped(count, index_size,
+                                              restart_index, restart,
+                                              indices, &simd_min, &simd_max);
+                  _mesa_x86_cpu_features = 0;
+                  vbo_get_minmax_index_mapped(count, index_size,
+                                              restart_index, restart,
+                                              indices, &scalar_min,
+                                              &scalar_max);
+
+                  EXPECT_EQ(simd_min, scalar_min);
+                  EXPECT_EQ(simd_max, scalar_max);
+               }
+            }
+         }
+      }
+   }
+
+   _mesa_x86_cpu_features = saved_features;
+}
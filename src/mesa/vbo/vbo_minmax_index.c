@@ -28,6 +28,7 @@
 
 #include "main/glheader.h"
 #include "main/context.h"
+#include "main/errors.h"
 #include "main/varray.h"
 #include "main/macros.h"
 #include "main/sse_minmax.h"
@@ -35,6 +36,7 @@
 #include "util/hash_table.h"
 #include "util/u_memory.h"
 #include "pipe/p_state.h"
+#include <inttypes.h>
 
 struct minmax_cache_key {
    GLintptr offset;
@@ -102,7 +104,8 @@ vbo_delete_minmax_cache(struct gl_buffer_object *bufferObj)
 
 
 static GLboolean
-vbo_get_minmax_cached(struct gl_buffer_object *bufferObj,
+vbo_get_minmax_cached(struct gl_context *ctx,
+                      struct gl_buffer_object *bufferObj,
                       unsigned index_size, GLintptr offset, GLuint count,
                       GLuint *min_index, GLuint *max_index)
 {
@@ -129,6 +132,15 @@ vbo_get_minmax_cached(struct gl_buffer_object *bufferObj,
       unsigned optimism = bufferObj->Size;
       if (bufferObj->MinMaxCacheMissIndices > optimism &&
           bufferObj->MinMaxCacheHitIndices < bufferObj->MinMaxCacheMissIndices - optimism) {
+         uint64_t hits = bufferObj->MinMaxCacheHitIndices;
+         uint64_t total = hits + bufferObj->MinMaxCacheMissIndices;
+
+         _mesa_perf_debug(ctx, MESA_DEBUG_SEVERITY_MEDIUM,
+                          "disabling the index min/max cache of buffer %u, "
+                          "only %u%% of %"PRIu64" scanned indices were hits\n",
+                          bufferObj->Name, (unsigned)(hits * 100 / total),
+                          total);
+
          bufferObj->UsageHistory |= USAGE_DISABLE_MINMAX_CACHE;
          vbo_delete_minmax_cache(bufferObj);
          goto out_disable;
@@ -234,6 +246,30 @@ vbo_get_minmax_index_mapped(unsigned count, unsigned index_size,
                             const void *indices,
                             unsigned *min_index, unsigned *max_index)
 {
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1) {
+      switch (index_size) {
+      case 4:
+         if (restart)
+            _mesa_uint_array_min_max_restart(indices, min_index, max_index,
+                                             count, restartIndex);
+         else
+            _mesa_uint_array_min_max(indices, min_index, max_index, count);
+         return;
+      case 2:
+         _mesa_ushort_array_min_max(indices, min_index, max_index, count,
+                                    restart, restartIndex);
+         return;
+      case 1:
+         _mesa_ubyte_array_min_max(indices, min_index, max_index, count,
+                                   restart, restartIndex);
+         return;
+      default:
+         unreachable("not reached");
+      }
+   }
+#endif
+
    switch (index_size) {
    case 4: {
       const GLuint *ui_indices = (const GLuint *)indices;
@@ -248,16 +284,10 @@ vbo_get_minmax_index_mapped(unsigned count, unsigned index_size,
          }
       }
       else {
-#if defined(USE_SSE41)
-         if (cpu_has_sse4_1) {
-            _mesa_uint_array_min_max(ui_indices, &min_ui, &max_ui, count);
+         for (unsigned i = 0; i < count; i++) {
+            if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
+            if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
          }
-         else
-#endif
-            for (unsigned i = 0; i < count; i++) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
       }
       *min_index = min_ui;
       *max_index = max_ui;
@@ -333,8 +363,8 @@ vbo_get_minmax_index(struct gl_context *ctx, struct gl_buffer_object *obj,
    } else {
       GLsizeiptr size = MIN2((GLsizeiptr)count * index_size, obj->Size);
 
-      if (vbo_get_minmax_cached(obj, index_size, offset, count, min_index,
-                                max_index))
+      if (vbo_get_minmax_cached(ctx, obj, index_size, offset, count,
+                                min_index, max_index))
          return;
 
       indices = _mesa_bufferobj_map_range(ctx, offset, size, GL_MAP_READ_BIT,
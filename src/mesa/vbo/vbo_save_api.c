@@ -72,6 +72,9 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
  * When the position attribute is received, all the attributes are then 
  * copied to the vertex_store (see the end of ATTR_UNION).
  * The vertex_store is simply an extensible float array.
+ * The vertex list is compiled when a state change is saved between two
+ * glBegin/glEnd pairs.  dlist.c doesn't compile state changes which only
+ * repeat values the list already set, so these pairs stay in one list.
  * When the vertex list needs to be compiled (see compile_vertex_list),
  * several transformations are performed:
  *   - some primitives are merged together (eg: two consecutive GL_TRIANGLES
@@ -167,7 +167,7 @@ _mesa_signed_to_signed(int src, unsigned dst_size)
 static inline unsigned
 _mesa_signed_to_unsigned(int src, unsigned dst_size)
 {
-   return CLAMP(src, 0, u_uintN_max(dst_size));
+   return CLAMP((int64_t)src, 0, (int64_t)u_uintN_max(dst_size));
 }
 
 static inline unsigned
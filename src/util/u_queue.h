@@ -274,6 +274,11 @@ struct util_queue_monitoring
    unsigned num_direct_items;
    unsigned num_syncs;
    unsigned num_batches;
+
+   /* Time the user waited for a free batch, and how full batches were. */
+   unsigned stall_time_us;
+   unsigned batch_fill_sum; /* in percent of the batch storage */
+   unsigned num_filled_batches;
 };
 
 #ifdef __cplusplus